@@ -163,6 +163,45 @@ VLC_API block_t *block_Init(block_t *block,
  */
 VLC_API block_t *block_Alloc(size_t size) VLC_USED VLC_MALLOC;
 
+/**
+ * Enables the block slab allocator.
+ *
+ * Once enabled, small blocks allocated with block_Alloc() are served from
+ * per-thread caches of power of two size classes instead of the heap.
+ * Blocks are released with block_Release() as usual. Each call must be
+ * matched by a call to block_slab_Disable().
+ */
+VLC_API void block_slab_Enable(void);
+
+/**
+ * Disables the block slab allocator.
+ *
+ * Once the last block_slab_Enable() call is matched, the cached blocks of
+ * the shared depot and of the calling thread are freed, and blocks are
+ * allocated from the heap again. Other threads free their cached blocks on
+ * their next block release, or when they exit.
+ */
+VLC_API void block_slab_Disable(void);
+
+/** Block slab allocator statistics (cumulative) */
+struct vlc_block_slab_stats
+{
+    unsigned long long allocs; /**< blocks allocated from the slab */
+    unsigned long long magazine_hits; /**< served from a thread cache */
+    unsigned long long depot_hits; /**< moved from the shared depot */
+    unsigned long long heap_allocs; /**< allocated from the heap */
+    unsigned long long frees; /**< blocks released to the slab */
+    unsigned long long depot_returns; /**< returned to the shared depot */
+};
+
+/**
+ * Gets the block slab allocator statistics.
+ *
+ * Counters from threads other than the calling one are updated
+ * periodically, and may lag slightly.
+ */
+VLC_API void block_slab_GetStats(struct vlc_block_slab_stats *);
+
 VLC_API block_t *block_TryRealloc(block_t *, ssize_t pre, size_t body) VLC_USED;
 
 /**
@@ -55,6 +55,7 @@ unsigned vlc_CPU_raw(void);
 #  define VLC_CPU_AVX2   0x00004000
 #  define VLC_CPU_XOP    0x00008000
 #  define VLC_CPU_FMA4   0x00010000
+#  define VLC_CPU_AVX512 0x00020000 /* F, BW and VL */
 
 # if defined (__MMX__)
 #  define vlc_CPU_MMX() (1)
@@ -118,8 +119,19 @@ unsigned vlc_CPU_raw(void);
 
 # ifdef __AVX2__
 #  define vlc_CPU_AVX2() (1)
+#  define VLC_AVX2
 # else
 #  define vlc_CPU_AVX2() ((vlc_CPU() & VLC_CPU_AVX2) != 0)
+#  define VLC_AVX2 __attribute__ ((__target__ ("avx2")))
+# endif
+
+# if defined (__AVX512F__) && defined (__AVX512BW__) && defined (__AVX512VL__)
+#  define vlc_CPU_AVX512() (1)
+#  define VLC_AVX512
+# else
+#  define vlc_CPU_AVX512() ((vlc_CPU() & VLC_CPU_AVX512) != 0)
+#  define VLC_AVX512 \
+    __attribute__ ((__target__ ("avx512f,avx512bw,avx512vl")))
 # endif
 
 # ifdef __3dNOW__
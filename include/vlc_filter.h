@@ -289,6 +289,41 @@ VLC_API void filter_DelProxyCallbacks( vlc_object_t *obj, filter_t *filter,
 # define filter_DelProxyCallbacks(a, b, c) \
     filter_DelProxyCallbacks(VLC_OBJECT(a), b, c)
 
+/**
+ * Slice callback for filter_ExecuteSlices().
+ *
+ * \param opaque data pointer passed to filter_ExecuteSlices()
+ * \param first first line of the slice
+ * \param end line following the last line of the slice
+ */
+typedef void (*filter_slice_cb)( filter_t *, void *opaque,
+                                 unsigned first, unsigned end );
+
+/**
+ * Runs a callback over consecutive slices of lines.
+ *
+ * The lines [0, lines) are split in slices which are processed in parallel by
+ * the shared filter threads of the instance and by the calling thread.
+ * It returns once every slice has been processed, so the slices must not
+ * depend on each other. It can be called from a slice callback.
+ *
+ * \param lines number of lines to process
+ * \param align the slice boundaries are multiple of this number of lines
+ */
+VLC_API void filter_ExecuteSlices( filter_t *, unsigned lines, unsigned align,
+                                   filter_slice_cb, void *opaque );
+
+/**
+ * Converts a line of the first plane of a picture into a line of another
+ * plane, so that slices of the first plane can be mapped to the other planes.
+ */
+static inline unsigned filter_SliceLine( const picture_t *pic, int plane,
+                                         unsigned line )
+{
+    return (uint64_t)line * pic->p[plane].i_visible_lines
+                          / pic->p[0].i_visible_lines;
+}
+
 typedef filter_t vlc_blender_t;
 
 /**
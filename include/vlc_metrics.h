@@ -0,0 +1,131 @@
+/*****************************************************************************
+ * vlc_metrics.h: metrics export
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_METRICS_H
+# define VLC_METRICS_H 1
+
+/**
+ * \defgroup metrics Metrics
+ * \ingroup misc
+ *
+ * Process metrics, exported in the Prometheus text format.
+ *
+ * Components that keep counters register a metrics source with the LibVLC
+ * instance. Whenever the metrics are collected, the source callback reports
+ * the current value of its counters. The callback is called with an internal
+ * lock held: it must only read the counters (typically atomic variables) and
+ * must not block.
+ *
+ * @{
+ */
+
+/**
+ * Metric type.
+ */
+enum vlc_metric_type
+{
+    VLC_METRIC_COUNTER, /**< Monotonically increasing value */
+    VLC_METRIC_GAUGE, /**< Value that can go up and down */
+};
+
+/**
+ * Metric description.
+ *
+ * The metric name must be a valid Prometheus metric name. Descriptions are
+ * usually static constant data shared by every source of the same kind.
+ * Values are grouped by metric name, under the description of the first
+ * value reported with that name.
+ */
+struct vlc_metric
+{
+    const char *name; /**< Metric name */
+    const char *help; /**< Human-readable description */
+    enum vlc_metric_type type; /**< Metric type */
+};
+
+typedef struct vlc_metrics_source vlc_metrics_source_t;
+typedef struct vlc_metrics_writer vlc_metrics_writer_t;
+
+/**
+ * Metrics source callback.
+ *
+ * Reports the current value of each metric of the source with
+ * vlc_metrics_Report().
+ *
+ * @param opaque data pointer passed to vlc_metrics_Register()
+ * @param writer metrics writer to report values to
+ */
+typedef void (*vlc_metrics_cb)(void *opaque, vlc_metrics_writer_t *writer);
+
+/**
+ * Registers a metrics source.
+ *
+ * The variadic arguments are pairs of label names and values, terminated by
+ * a NULL label name. They are attached to all the values of the source.
+ *
+ * @param obj an object of the LibVLC instance to register with
+ * @param cb callback reporting the values of the source
+ * @param opaque data pointer for the callback
+ * @return the source, or NULL on error
+ */
+VLC_API vlc_metrics_source_t *vlc_metrics_Register(vlc_object_t *obj,
+                                                   vlc_metrics_cb cb,
+                                                   void *opaque, ...)
+VLC_USED;
+#define vlc_metrics_Register(o, cb, opaque, ...) \
+        vlc_metrics_Register(VLC_OBJECT(o), cb, opaque, __VA_ARGS__)
+
+/**
+ * Unregisters a metrics source.
+ *
+ * When this function returns, the source callback is not running and will
+ * not be called anymore.
+ *
+ * @param src the source to unregister (or NULL)
+ */
+VLC_API void vlc_metrics_Unregister(vlc_metrics_source_t *src);
+
+/**
+ * Reports a metric value.
+ *
+ * This can only be called from a source callback.
+ *
+ * @param writer metrics writer passed to the source callback
+ * @param metric metric description, which must remain valid until
+ *               vlc_metrics_Collect() returns
+ * @param value current value
+ */
+VLC_API void vlc_metrics_Report(vlc_metrics_writer_t *writer,
+                                const struct vlc_metric *metric,
+                                double value);
+
+/**
+ * Collects the metrics of all sources.
+ *
+ * @param obj an object of the LibVLC instance
+ * @return the metrics in the Prometheus text exposition format (the caller
+ *         must free() it), or NULL on error
+ */
+VLC_API char *vlc_metrics_Collect(vlc_object_t *obj) VLC_USED;
+#define vlc_metrics_Collect(o) vlc_metrics_Collect(VLC_OBJECT(o))
+
+/** @} */
+
+#endif
@@ -103,6 +103,7 @@ struct vlc_http_mgr
     vlc_tls_client_t *creds;
     struct vlc_http_cookie_jar_t *jar;
     struct vlc_http_conn *conn;
+    bool conn_h2;
 };
 
 static struct vlc_http_conn *vlc_http_mgr_find(struct vlc_http_mgr *mgr,
@@ -203,6 +204,7 @@ static struct vlc_http_msg *vlc_https_request(struct vlc_http_mgr *mgr,
     }
 
     mgr->conn = conn;
+    mgr->conn_h2 = http2;
 
     return vlc_http_mgr_reuse(mgr, host, port, req);
 }
@@ -253,6 +255,7 @@ static struct vlc_http_msg *vlc_http_request(struct vlc_http_mgr *mgr,
     }
 
     mgr->conn = conn;
+    mgr->conn_h2 = false;
     return resp;
 }
 
@@ -271,6 +274,11 @@ struct vlc_http_cookie_jar_t *vlc_http_mgr_get_jar(struct vlc_http_mgr *mgr)
     return mgr->jar;
 }
 
+bool vlc_http_mgr_is_multiplexed(struct vlc_http_mgr *mgr)
+{
+    return mgr->conn != NULL && mgr->conn_h2;
+}
+
 struct vlc_http_mgr *vlc_http_mgr_create(vlc_object_t *obj,
                                          struct vlc_http_cookie_jar_t *jar)
 {
@@ -283,6 +291,7 @@ struct vlc_http_mgr *vlc_http_mgr_create(vlc_object_t *obj,
     mgr->creds = NULL;
     mgr->jar = jar;
     mgr->conn = NULL;
+    mgr->conn_h2 = false;
     return mgr;
 }
 
@@ -54,6 +54,16 @@ struct vlc_http_msg *vlc_http_mgr_request(struct vlc_http_mgr *mgr, bool https,
 
 struct vlc_http_cookie_jar_t *vlc_http_mgr_get_jar(struct vlc_http_mgr *);
 
+/**
+ * Checks if requests can be multiplexed
+ *
+ * The manager keeps a single connection. Unless it is an HTTP/2 connection,
+ * a request issued while another one is in progress replaces it.
+ *
+ * @return true if the current connection is an HTTP/2 connection
+ */
+bool vlc_http_mgr_is_multiplexed(struct vlc_http_mgr *mgr);
+
 /**
  * Creates an HTTP connection manager
  *
@@ -53,13 +53,29 @@
  */
 #define MRU 65507u
 
+/* Maximum number of datagrams received with a single recvmmsg() call */
+#define VLEN_MAX 256
+
 typedef struct {
     int fd;
     int timeout;
 
     size_t length;
     char *offset;
-    char buf[MRU];
+    char *buf; /* MRU bytes, or vlen times MRU bytes when batching */
+
+#ifdef HAVE_RECVMMSG
+    /* Batched receive: recvmmsg() fills the MRU-sized slots of buf, then
+     * each datagram is copied to a block of its own size. */
+    unsigned vlen;
+    block_t *queue;
+    block_t **queue_last;
+    struct mmsghdr *msgs;
+    struct iovec *iovecs;
+
+    uint64_t packets;
+    uint64_t syscalls;
+#endif
 } access_sys_t;
 
 static int Control(stream_t *access, int query, va_list args)
@@ -132,6 +148,65 @@ static ssize_t Read(stream_t *access, void *buf, size_t len)
     return val;
 }
 
+#ifdef HAVE_RECVMMSG
+static block_t *BlockRecv(stream_t *access, bool *restrict eof)
+{
+    access_sys_t *sys = access->p_sys;
+
+    if (sys->queue == NULL) {
+        struct pollfd ufd[1];
+
+        ufd[0].fd = sys->fd;
+        ufd[0].events = POLLIN;
+
+        switch (vlc_poll_i11e(ufd, 1, sys->timeout)) {
+            case 0:
+                msg_Err(access, "receive time-out");
+                *eof = true;
+                return NULL;
+            case -1:
+                return NULL;
+        }
+
+        int val = recvmmsg(sys->fd, sys->msgs, sys->vlen, MSG_DONTWAIT, NULL);
+        if (val <= 0)
+            return NULL;
+
+        sys->syscalls++;
+        sys->packets += val;
+
+        for (int i = 0; i < val; i++) {
+            size_t len = sys->msgs[i].msg_len;
+
+            if (unlikely(sys->msgs[i].msg_hdr.msg_flags & MSG_TRUNC))
+                msg_Err(access, "%zu bytes packet truncated (MRU was %u)",
+                        len, MRU);
+
+            /* Copy rather than hand out the MRU-sized slot: a typical
+             * 1316 bytes datagram must not pin 64 KiB while it is queued. */
+            block_t *block = block_Alloc(len);
+            if (unlikely(block == NULL))
+                break; /* drop the rest of the batch */
+            memcpy(block->p_buffer, sys->iovecs[i].iov_base, len);
+            block_ChainLastAppend(&sys->queue_last, block);
+        }
+
+        if (sys->queue == NULL)
+            return NULL;
+    }
+
+    /* Hand the queued datagrams one at a time, the stream layer does not
+     * expect chained blocks. */
+    block_t *block = sys->queue;
+
+    sys->queue = block->p_next;
+    if (sys->queue == NULL)
+        sys->queue_last = &sys->queue;
+    block->p_next = NULL;
+    return block;
+}
+#endif
+
 /*****************************************************************************
  * Open: open the socket
  *****************************************************************************/
@@ -148,9 +223,48 @@ static int Open( vlc_object_t *p_this )
         return VLC_ENOMEM;
 
     sys->length = 0;
+    sys->buf = NULL;
     p_access->p_sys = sys;
     p_access->pf_read = Read;
     p_access->pf_block = NULL;
+#ifdef HAVE_RECVMMSG
+    sys->vlen = var_InheritInteger( p_access, "udp-batch" );
+    if( sys->vlen > VLEN_MAX )
+        sys->vlen = VLEN_MAX;
+    sys->queue = NULL;
+    sys->queue_last = &sys->queue;
+    sys->msgs = NULL;
+    sys->iovecs = NULL;
+    sys->packets = 0;
+    sys->syscalls = 0;
+
+    if( sys->vlen > 1 )
+    {
+        sys->buf = vlc_obj_malloc( p_this, (size_t)sys->vlen * MRU );
+        sys->msgs = vlc_obj_calloc( p_this, sys->vlen, sizeof( *sys->msgs ) );
+        sys->iovecs = vlc_obj_calloc( p_this, sys->vlen, sizeof( *sys->iovecs ) );
+        if( unlikely( sys->buf == NULL || sys->msgs == NULL
+                   || sys->iovecs == NULL ) )
+            return VLC_ENOMEM;
+
+        for( unsigned i = 0; i < sys->vlen; i++ )
+        {
+            sys->msgs[i].msg_hdr.msg_iov = &sys->iovecs[i];
+            sys->msgs[i].msg_hdr.msg_iovlen = 1;
+            sys->iovecs[i].iov_base = sys->buf + (size_t)i * MRU;
+            sys->iovecs[i].iov_len = MRU;
+        }
+
+        p_access->pf_read = NULL;
+        p_access->pf_block = BlockRecv;
+    }
+#endif
+    if( sys->buf == NULL )
+    {   /* Read() overflow buffer */
+        sys->buf = vlc_obj_malloc( p_this, MRU );
+        if( unlikely( sys->buf == NULL ) )
+            return VLC_ENOMEM;
+    }
     p_access->pf_control = Control;
     p_access->pf_seek = NULL;
 
@@ -228,10 +342,22 @@ static void Close( vlc_object_t *p_this )
     stream_t     *p_access = (stream_t*)p_this;
     access_sys_t *sys = p_access->p_sys;
 
+#ifdef HAVE_RECVMMSG
+    if( sys->syscalls > 0 )
+        msg_Dbg( p_access, "received %"PRIu64" packets in %"PRIu64
+                 " system calls (%.2f packets/call)", sys->packets,
+                 sys->syscalls, (double)sys->packets / sys->syscalls );
+
+    block_ChainRelease( sys->queue );
+#endif
     net_Close( sys->fd );
 }
 
 #define TIMEOUT_TEXT N_("UDP Source timeout (sec)")
+#define BATCH_TEXT N_("Receive batch size")
+#define BATCH_LONGTEXT N_( \
+    "Maximum number of datagrams received with a single system call. " \
+    "Set to 1 to receive datagrams one at a time.")
 
 vlc_module_begin()
     set_shortname(N_("UDP"))
@@ -242,6 +368,10 @@ vlc_module_begin()
     add_obsolete_integer("server-port") /* since 2.0.0 */
     add_obsolete_integer("udp-buffer") /* since 3.0.0 */
     add_integer("udp-timeout", -1, TIMEOUT_TEXT, NULL, true)
+#ifdef HAVE_RECVMMSG
+    add_integer_with_range("udp-batch", 32, 1, VLEN_MAX,
+                           BATCH_TEXT, BATCH_LONGTEXT, true)
+#endif
 
     set_capability("access", 0)
     add_shortcut("udp", "udpstream", "udp4", "udp6")
@@ -48,9 +48,17 @@
 #endif
 
 #include <vlc_network.h>
+#ifdef HAVE_SYS_UIO_H
+#   include <sys/uio.h>
+#endif
 
 #define MAX_EMPTY_BLOCKS 200
 
+/* Maximum number of mux blocks gathered in a single datagram */
+#define DGRAM_IOV_MAX 64
+/* Maximum number of datagrams sent with a single sendmmsg() call */
+#define DGRAM_VLEN_MAX 64
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -71,6 +79,12 @@ static void Close( vlc_object_t * );
                           "helps reducing the scheduling load on " \
                           "heavily-loaded systems." )
 
+#define BATCH_TEXT N_("Batching window (ms)")
+#define BATCH_LONGTEXT N_("Datagrams due within this window are sent " \
+                          "together with a single system call. Datagrams " \
+                          "carrying a clock reference always start a new " \
+                          "batch. Set to 0 to send datagrams one by one." )
+
 vlc_module_begin ()
     set_description( N_("UDP stream output") )
     set_shortname( "UDP" )
@@ -79,6 +93,10 @@ vlc_module_begin ()
     add_integer( SOUT_CFG_PREFIX "caching", DEFAULT_PTS_DELAY / 1000, CACHING_TEXT, CACHING_LONGTEXT, true )
     add_integer( SOUT_CFG_PREFIX "group", 1, GROUP_TEXT, GROUP_LONGTEXT,
                                  true )
+#ifdef HAVE_SENDMMSG
+    add_integer( SOUT_CFG_PREFIX "batch", 0, BATCH_TEXT, BATCH_LONGTEXT,
+                 true )
+#endif
 
     set_capability( "sout access", 0 )
     add_shortcut( "udp" )
@@ -92,6 +110,9 @@ vlc_module_end ()
 static const char *const ppsz_sout_options[] = {
     "caching",
     "group",
+#ifdef HAVE_SENDMMSG
+    "batch",
+#endif
     NULL
 };
 
@@ -108,6 +129,23 @@ static int Control( sout_access_out_t *, int, va_list );
 
 static void* ThreadWrite( void * );
 
+/* A datagram is gathered from the mux output blocks without copying them.
+ * A mux block is owned (and released) by the last datagram referencing it,
+ * as datagrams are always sent in order. */
+typedef struct udp_datagram_t
+{
+    struct udp_datagram_t *p_next;
+    vlc_tick_t    i_dts;
+    uint32_t      i_flags;
+    size_t        i_size;
+
+    block_t      *p_blocks;
+    block_t     **pp_last;
+
+    unsigned      i_iov;
+    struct iovec  iov[DGRAM_IOV_MAX];
+} udp_datagram_t;
+
 typedef struct
 {
     vlc_tick_t    i_caching;
@@ -117,13 +155,38 @@ typedef struct
     size_t        i_mtu;
 
     vlc_queue_t   queue;
-    block_t      *p_buffer;
+    udp_datagram_t *p_dgram;
+
+    uint64_t      i_packets_sent;
+    uint64_t      i_send_calls;
 
     vlc_thread_t  thread;
 } sout_access_out_sys_t;
 
 #define DEFAULT_PORT 1234
 
+static udp_datagram_t *DatagramNew( vlc_tick_t i_dts )
+{
+    udp_datagram_t *p_dgram = malloc( sizeof( *p_dgram ) );
+    if( unlikely(p_dgram == NULL) )
+        return NULL;
+
+    p_dgram->p_next = NULL;
+    p_dgram->i_dts = i_dts;
+    p_dgram->i_flags = 0;
+    p_dgram->i_size = 0;
+    p_dgram->p_blocks = NULL;
+    p_dgram->pp_last = &p_dgram->p_blocks;
+    p_dgram->i_iov = 0;
+    return p_dgram;
+}
+
+static void DatagramRelease( udp_datagram_t *p_dgram )
+{
+    block_ChainRelease( p_dgram->p_blocks );
+    free( p_dgram );
+}
+
 /*****************************************************************************
  * Open: open the file
  *****************************************************************************/
@@ -209,8 +272,10 @@ static int Open( vlc_object_t *p_this )
     p_sys->i_mtu = var_CreateGetInteger( p_this, "mtu" );
     p_sys->b_mtu_warning = false;
     p_sys->dead = false;
-    vlc_queue_Init(&p_sys->queue, offsetof (block_t, p_next));
-    p_sys->p_buffer = NULL;
+    vlc_queue_Init(&p_sys->queue, offsetof (udp_datagram_t, p_next));
+    p_sys->p_dgram = NULL;
+    p_sys->i_packets_sent = 0;
+    p_sys->i_send_calls = 0;
 
     if( vlc_clone( &p_sys->thread, ThreadWrite, p_access,
                            VLC_THREAD_PRIORITY_HIGHEST ) )
@@ -238,7 +303,13 @@ static void Close( vlc_object_t * p_this )
     vlc_queue_Kill(&p_sys->queue, &p_sys->dead);
     vlc_join( p_sys->thread, NULL );
 
-    if( p_sys->p_buffer ) block_Release( p_sys->p_buffer );
+    if( p_sys->p_dgram ) DatagramRelease( p_sys->p_dgram );
+
+    if( p_sys->i_send_calls > 0 )
+        msg_Dbg( p_access, "sent %"PRIu64" packets in %"PRIu64" system calls "
+                 "(%.2f packets/call)", p_sys->i_packets_sent,
+                 p_sys->i_send_calls,
+                 (double)p_sys->i_packets_sent / p_sys->i_send_calls );
 
     net_Close( p_sys->i_handle );
     free( p_sys );
@@ -263,6 +334,19 @@ static int Control( sout_access_out_t *p_access, int i_query, va_list args )
 /*****************************************************************************
  * Write: standard write on a file descriptor.
  *****************************************************************************/
+static void Flush( sout_access_out_t *p_access, vlc_tick_t now )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+
+    if( p_sys->p_dgram->i_dts + p_sys->i_caching < now )
+    {
+        msg_Dbg( p_access, "late packet for UDP input (%"PRId64 ")",
+                 now - p_sys->p_dgram->i_dts - p_sys->i_caching );
+    }
+    vlc_queue_Enqueue(&p_sys->queue, p_sys->p_dgram);
+    p_sys->p_dgram = NULL;
+}
+
 static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
 {
     sout_access_out_sys_t *p_sys = p_access->p_sys;
@@ -270,76 +354,89 @@ static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
 
     while( p_buffer )
     {
-        block_t *p_next;
+        block_t *p_next = p_buffer->p_next;
         int i_packets = 0;
         vlc_tick_t now = vlc_tick_now();
+        const uint8_t *p_data = p_buffer->p_buffer;
+        size_t i_data = p_buffer->i_buffer;
+        const uint32_t i_flags = p_buffer->i_flags;
 
-        if( !p_sys->b_mtu_warning && p_buffer->i_buffer > p_sys->i_mtu )
+        p_buffer->p_next = NULL;
+
+        if( !p_sys->b_mtu_warning && i_data > p_sys->i_mtu )
         {
             msg_Warn( p_access, "packet size > MTU, you should probably "
                       "increase the MTU" );
             p_sys->b_mtu_warning = true;
         }
 
-        /* Check if there is enough space in the buffer */
-        if( p_sys->p_buffer &&
-            p_sys->p_buffer->i_buffer + p_buffer->i_buffer > p_sys->i_mtu )
+        /* Check if there is enough space in the datagram */
+        if( p_sys->p_dgram &&
+            p_sys->p_dgram->i_size + i_data > p_sys->i_mtu )
+            Flush( p_access, now );
+
+        if( i_data == 0 )
+        {
+            block_Release( p_buffer );
+            p_buffer = p_next;
+            continue;
+        }
+
+        i_len += i_data;
+        if( !p_sys->p_dgram )
         {
-            if( p_sys->p_buffer->i_dts + p_sys->i_caching < now )
+            p_sys->p_dgram = DatagramNew( p_buffer->i_dts );
+            if( !p_sys->p_dgram )
             {
-                msg_Dbg( p_access, "late packet for UDP input (%"PRId64 ")",
-                         now - p_sys->p_buffer->i_dts
-                          - p_sys->i_caching );
+                block_Release( p_buffer );
+                p_buffer = p_next;
+                continue;
             }
-            vlc_queue_Enqueue(&p_sys->queue, p_sys->p_buffer);
-            p_sys->p_buffer = NULL;
         }
 
-        i_len += p_buffer->i_buffer;
-        while( p_buffer->i_buffer )
+        while( i_data )
         {
-            size_t i_payload_size = p_sys->i_mtu;
-            size_t i_write = __MIN( p_buffer->i_buffer, i_payload_size );
+            udp_datagram_t *p_dgram = p_sys->p_dgram;
+            udp_datagram_t *p_dgram_next = NULL;
+            size_t i_write = __MIN( i_data, p_sys->i_mtu );
 
             i_packets++;
 
-            if( !p_sys->p_buffer )
+            p_dgram->iov[p_dgram->i_iov].iov_base = (void *)p_data;
+            p_dgram->iov[p_dgram->i_iov].iov_len = i_write;
+            p_dgram->i_iov++;
+            p_dgram->i_size += i_write;
+            p_data += i_write;
+            i_data -= i_write;
+
+            if( i_data > 0 )
             {
-                p_sys->p_buffer = block_Alloc( p_sys->i_mtu );
-                if( !p_sys->p_buffer ) break;
-                p_sys->p_buffer->i_dts = p_buffer->i_dts;
-                p_sys->p_buffer->i_buffer = 0;
+                /* The block spans several datagrams: allocate the next one
+                 * now, so that the block always has an owner. */
+                p_dgram_next = DatagramNew( p_buffer->i_dts );
+                if( unlikely(p_dgram_next == NULL) )
+                    i_data = 0;
             }
-
-            memcpy( p_sys->p_buffer->p_buffer + p_sys->p_buffer->i_buffer,
-                    p_buffer->p_buffer, i_write );
-
-            p_sys->p_buffer->i_buffer += i_write;
-            p_buffer->p_buffer += i_write;
-            p_buffer->i_buffer -= i_write;
-            if ( p_buffer->i_flags & BLOCK_FLAG_CLOCK )
+            if( i_data == 0 )
             {
-                if ( p_sys->p_buffer->i_flags & BLOCK_FLAG_CLOCK )
-                    msg_Warn( p_access, "putting two PCRs at once" );
-                p_sys->p_buffer->i_flags |= BLOCK_FLAG_CLOCK;
+                /* Last reference to this block: the datagram owns it */
+                block_ChainLastAppend( &p_dgram->pp_last, p_buffer );
             }
 
-            if( p_sys->p_buffer->i_buffer == p_sys->i_mtu || i_packets > 1 )
+            if ( i_flags & BLOCK_FLAG_CLOCK )
             {
-                /* Flush */
-                if( p_sys->p_buffer->i_dts + p_sys->i_caching < now )
-                {
-                    msg_Dbg( p_access, "late packet for udp input (%"PRId64 ")",
-                             vlc_tick_now() - p_sys->p_buffer->i_dts
-                              - p_sys->i_caching );
-                }
-                vlc_queue_Enqueue(&p_sys->queue, p_sys->p_buffer);
-                p_sys->p_buffer = NULL;
+                if ( p_dgram->i_flags & BLOCK_FLAG_CLOCK )
+                    msg_Warn( p_access, "putting two PCRs at once" );
+                p_dgram->i_flags |= BLOCK_FLAG_CLOCK;
             }
+
+            if( p_dgram->i_size == p_sys->i_mtu || i_packets > 1
+             || p_dgram->i_iov == DGRAM_IOV_MAX )
+                Flush( p_access, vlc_tick_now() );
+            if( p_dgram_next != NULL )
+                p_sys->p_dgram = p_dgram_next;
         }
 
-        p_next = p_buffer->p_next;
-        block_Release( p_buffer );
         p_buffer = p_next;
     }
 
@@ -349,6 +446,70 @@ static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
 /*****************************************************************************
  * ThreadWrite: Write a packet on the network at the good time.
  *****************************************************************************/
+static void Send( sout_access_out_t *p_access, udp_datagram_t *p_dgram )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    struct msghdr msg = {
+        .msg_iov = p_dgram->iov,
+        .msg_iovlen = p_dgram->i_iov,
+    };
+
+    if ( sendmsg( p_sys->i_handle, &msg, 0 ) == -1 )
+        msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
+
+    p_sys->i_packets_sent++;
+    p_sys->i_send_calls++;
+}
+
+#ifdef HAVE_SENDMMSG
+/* Sends the given datagram along with every queued datagram due before the
+ * end of the batching window. A datagram carrying a clock reference is never
+ * sent ahead of time. */
+static void SendBatch( sout_access_out_t *p_access, udp_datagram_t *p_dgram,
+                       udp_datagram_t **pp_pending, vlc_tick_t i_window )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    struct mmsghdr msgs[DGRAM_VLEN_MAX];
+    udp_datagram_t *pp_sent[DGRAM_VLEN_MAX];
+    const vlc_tick_t i_deadline = p_dgram->i_dts + i_window;
+    unsigned i_count = 0;
+
+    for( ;; )
+    {
+        memset( &msgs[i_count], 0, sizeof( msgs[i_count] ) );
+        msgs[i_count].msg_hdr.msg_iov = p_dgram->iov;
+        msgs[i_count].msg_hdr.msg_iovlen = p_dgram->i_iov;
+        pp_sent[i_count++] = p_dgram;
+
+        p_dgram = *pp_pending;
+        if( p_dgram == NULL || i_count == DGRAM_VLEN_MAX
+         || p_dgram->i_dts > i_deadline
+         || (p_dgram->i_flags & BLOCK_FLAG_CLOCK) )
+            break;
+        *pp_pending = p_dgram->p_next;
+    }
+
+    for( unsigned i = 0; i < i_count; )
+    {
+        int val = sendmmsg( p_sys->i_handle, &msgs[i], i_count - i, 0 );
+        if( val <= 0 )
+        {
+            msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
+            break;
+        }
+        i += val;
+    }
+
+    /* Release in order: a datagram may reference blocks owned by a later
+     * datagram of the same batch. */
+    for( unsigned i = 0; i < i_count; i++ )
+        DatagramRelease( pp_sent[i] );
+
+    p_sys->i_packets_sent += i_count;
+    p_sys->i_send_calls++;
+}
+#endif
+
 static void* ThreadWrite( void *data )
 {
     sout_access_out_t *p_access = data;
@@ -356,15 +517,33 @@ static void* ThreadWrite( void *data )
     vlc_tick_t i_date_last = -1;
     const unsigned i_group = var_GetInteger( p_access,
                                              SOUT_CFG_PREFIX "group" );
+#ifdef HAVE_SENDMMSG
+    const vlc_tick_t i_window = VLC_TICK_FROM_MS(
+                        var_GetInteger( p_access, SOUT_CFG_PREFIX "batch" ) );
+#endif
     int i_to_send = i_group;
     unsigned i_dropped_packets = 0;
-    block_t *p_pk;
+    udp_datagram_t *p_pending = NULL;
+    udp_datagram_t *p_pk;
 
-    while ((p_pk = vlc_queue_DequeueKillable(&p_sys->queue,
-                                             &p_sys->dead)) != NULL)
+    for( ;; )
     {
         vlc_tick_t    i_date;
 
+        if( p_pending == NULL )
+        {
+            p_pending = vlc_queue_DequeueKillable(&p_sys->queue, &p_sys->dead);
+            if( p_pending == NULL )
+                break;
+        }
+#ifdef HAVE_SENDMMSG
+        if( i_window > 0 && p_pending->p_next == NULL )
+            p_pending->p_next = vlc_queue_DequeueAll(&p_sys->queue);
+#endif
+        p_pk = p_pending;
+        p_pending = p_pk->p_next;
+        p_pk->p_next = NULL;
+
         i_date = p_sys->i_caching + p_pk->i_dts;
         if( i_date_last > 0 )
         {
@@ -374,7 +553,7 @@ static void* ThreadWrite( void *data )
                     msg_Dbg( p_access, "mmh, hole (%"PRId64" > 2s) -> drop",
                              i_date - i_date_last );
 
-                block_Release( p_pk );
+                DatagramRelease( p_pk );
 
                 i_date_last = i_date;
                 i_dropped_packets++;
@@ -388,14 +567,27 @@ static void* ThreadWrite( void *data )
             }
         }
 
-        i_to_send--;
-        if( !i_to_send || (p_pk->i_flags & BLOCK_FLAG_CLOCK) )
+#ifdef HAVE_SENDMMSG
+        if( i_window > 0 )
         {
             vlc_tick_wait( i_date );
-            i_to_send = i_group;
+            i_date_last = i_date;
+            /* Only the first datagram of a batch is checked for holes */
+            SendBatch( p_access, p_pk, &p_pending, i_window );
+        }
+        else
+#endif
+        {
+            i_to_send--;
+            if( !i_to_send || (p_pk->i_flags & BLOCK_FLAG_CLOCK) )
+            {
+                vlc_tick_wait( i_date );
+                i_to_send = i_group;
+            }
+            Send( p_access, p_pk );
+            i_date_last = i_date;
+            DatagramRelease( p_pk );
         }
-        if ( send( p_sys->i_handle, p_pk->p_buffer, p_pk->i_buffer, 0 ) == -1 )
-            msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
 
         if( i_dropped_packets )
         {
@@ -403,8 +595,6 @@ static void* ThreadWrite( void *data )
             i_dropped_packets = 0;
         }
 
-        i_date_last = i_date;
-
 #if 1
         i_date = vlc_tick_now() - i_date;
         if ( i_date > VLC_TICK_FROM_MS(20) )
@@ -413,9 +603,13 @@ static void* ThreadWrite( void *data )
                      i_date );
         }
 #endif
+    }
 
-        block_Release( p_pk );
-
+    while( p_pending != NULL )
+    {
+        p_pk = p_pending;
+        p_pending = p_pk->p_next;
+        DatagramRelease( p_pk );
     }
     return NULL;
 }
@@ -0,0 +1,128 @@
+/*****************************************************************************
+ * metrics.c: Prometheus metrics HTTP export interface
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_interface.h>
+#include <vlc_httpd.h>
+#include <vlc_metrics.h>
+
+#define METRICS_MIME "text/plain; version=0.0.4"
+
+struct intf_sys_t
+{
+    httpd_host_t *host;
+    httpd_file_t *file;
+};
+
+static int Fill(httpd_file_sys_t *opaque, httpd_file_t *file,
+                uint8_t *request, uint8_t **pp_data, int *pi_data)
+{
+    intf_thread_t *intf = (intf_thread_t *)opaque;
+    char *text = vlc_metrics_Collect(intf);
+
+    (void) file; (void) request;
+
+    if (text == NULL)
+    {
+        msg_Err(intf, "cannot collect metrics");
+        *pp_data = NULL;
+        *pi_data = 0;
+        return VLC_ENOMEM;
+    }
+
+    size_t len = strlen(text);
+    if (unlikely(len > INT_MAX))
+        len = 0;
+
+    *pp_data = (uint8_t *)text;
+    *pi_data = len;
+    return VLC_SUCCESS;
+}
+
+static int Open(vlc_object_t *obj)
+{
+    intf_thread_t *intf = (intf_thread_t *)obj;
+    intf_sys_t *sys = vlc_obj_malloc(obj, sizeof (*sys));
+    if (unlikely(sys == NULL))
+        return VLC_ENOMEM;
+
+    char *path = var_InheritString(intf, "metrics-path");
+    if (path == NULL || path[0] != '/')
+    {
+        msg_Err(intf, "invalid metrics path: %s", path ? path : "(null)");
+        free(path);
+        return VLC_EGENERIC;
+    }
+
+    sys->host = vlc_http_HostNew(obj);
+    if (sys->host == NULL)
+    {
+        free(path);
+        return VLC_EGENERIC;
+    }
+
+    sys->file = httpd_FileNew(sys->host, path, METRICS_MIME, NULL, NULL,
+                              Fill, (httpd_file_sys_t *)intf);
+    if (sys->file == NULL)
+    {
+        msg_Err(intf, "cannot serve metrics at %s", path);
+        httpd_HostDelete(sys->host);
+        free(path);
+        return VLC_EGENERIC;
+    }
+
+    msg_Dbg(intf, "serving metrics at %s", path);
+    free(path);
+    intf->p_sys = sys;
+    return VLC_SUCCESS;
+}
+
+static void Close(vlc_object_t *obj)
+{
+    intf_thread_t *intf = (intf_thread_t *)obj;
+    intf_sys_t *sys = intf->p_sys;
+
+    httpd_FileDelete(sys->file);
+    httpd_HostDelete(sys->host);
+}
+
+#define PATH_TEXT N_("Metrics URL path")
+#define PATH_LONGTEXT N_( \
+    "URL path of the metrics, in the Prometheus text format, on the " \
+    "HTTP server (see the http-host and http-port options).")
+
+vlc_module_begin()
+    set_shortname(N_("Metrics"))
+    set_description(N_("Prometheus metrics export"))
+    set_category(CAT_INTERFACE)
+    set_subcategory(SUBCAT_INTERFACE_CONTROL)
+    set_capability("interface", 0)
+    set_callbacks(Open, Close)
+    add_string("metrics-path", "/metrics", PATH_TEXT, PATH_LONGTEXT, true)
+vlc_module_end()
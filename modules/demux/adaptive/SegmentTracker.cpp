@@ -96,6 +96,9 @@ SegmentTracker::SegmentTracker(SharedResources *res,
     setAdaptationLogic(logic_);
     adaptationSet = adaptSet;
     format = StreamFormat::UNKNOWN;
+    int64_t downloads = var_InheritInteger(adaptSet->getPlaylist()->getVLCObject(),
+                                           "adaptive-downloads");
+    maxPrefetched = downloads > 1 ? downloads - 1 : 0;
 }
 
 SegmentTracker::~SegmentTracker()
@@ -170,6 +173,7 @@ void SegmentTracker::reset()
     index_sent = false;
     initializing = true;
     format = StreamFormat::UNKNOWN;
+    dropPrefetchedChunks();
 }
 
 SegmentChunk * SegmentTracker::getNextChunk(bool switch_allowed,
@@ -190,6 +194,17 @@ SegmentChunk * SegmentTracker::getNextChunk(bool switch_allowed,
             switch_allowed = true;
     }
 
+    /* Can't switch in the middle of a segment (HLS partial segments) */
+    if( switch_allowed && curRepresentation )
+    {
+        uint64_t number;
+        bool b_gap;
+        segment = curRepresentation->getNextSegment(BaseRepresentation::INFOTYPE_MEDIA,
+                                                    next, &number, &b_gap);
+        if( segment && !segment->independent )
+            switch_allowed = false;
+    }
+
     if( !switch_allowed ||
        (curRepresentation && !curRepresentation->getAdaptationSet()->isSegmentAligned()) )
         rep = curRepresentation;
@@ -202,6 +217,7 @@ SegmentChunk * SegmentTracker::getNextChunk(bool switch_allowed,
 
     if(rep != curRepresentation)
     {
+        dropPrefetchedChunks();
         notify(SegmentTrackerEvent(curRepresentation, rep));
         prevRep = curRepresentation;
         curRepresentation = rep;
@@ -227,6 +243,20 @@ SegmentChunk * SegmentTracker::getNextChunk(bool switch_allowed,
         next = rep->translateSegmentNumber(next, prevRep);
     }
 
+    /* Catch up with the live edge when lagging beyond the service latency */
+    bool b_catchup = false;
+    const AbstractPlaylist *playlist = rep->getPlaylist();
+    if(!initializing && playlist->isLive() && playlist->maxLatency.Get() &&
+       rep->getMinAheadTime(next) > playlist->maxLatency.Get())
+    {
+        uint64_t livenext = bufferingLogic->getStartSegmentNumber(rep);
+        if(livenext != std::numeric_limits<uint64_t>::max() && livenext > next)
+        {
+            next = livenext;
+            b_catchup = true;
+        }
+    }
+
     curRepresentation->scheduleNextUpdate(next, b_updated);
 
     if(rep->getStreamFormat() != format)
@@ -285,8 +315,14 @@ SegmentChunk * SegmentTracker::getNextChunk(bool switch_allowed,
         /* stop initializing after 1st chunk */
         initializing = false;
     }
+    else if(b_catchup)
+    {
+        b_gap = true;
+    }
 
-    SegmentChunk *chunk = segment->toChunk(resources, connManager, next, rep);
+    SegmentChunk *chunk = getPrefetchedChunk(rep, next);
+    if(!chunk)
+        chunk = segment->toChunk(resources, connManager, next, rep);
 
     /* Notify new segment length for stats / logic */
     if(chunk)
@@ -313,11 +349,67 @@ SegmentChunk * SegmentTracker::getNextChunk(bool switch_allowed,
     {
         curNumber = next;
         next++;
+        prefetchChunks(rep, connManager);
     }
 
     return chunk;
 }
 
+SegmentChunk * SegmentTracker::getPrefetchedChunk(BaseRepresentation *rep, uint64_t number)
+{
+    SegmentChunk *chunk = NULL;
+
+    /* Older or other representation chunks won't be used anymore */
+    while(!prefetched.empty())
+    {
+        Prefetched &entry = prefetched.front();
+        if(entry.rep == rep && entry.number > number)
+            break;
+        if(entry.rep == rep && entry.number == number)
+            chunk = entry.chunk;
+        else
+            delete entry.chunk;
+        prefetched.pop_front();
+        if(chunk)
+            break;
+    }
+    return chunk;
+}
+
+void SegmentTracker::prefetchChunks(BaseRepresentation *rep,
+                                    AbstractConnectionManager *connManager)
+{
+    uint64_t number = next;
+    if(!prefetched.empty())
+        number = prefetched.back().number + 1;
+
+    /* Start downloading the following media segments, if the next selection
+     * was to stay on the same representation, so that several segments are
+     * in flight at once */
+    while(prefetched.size() < maxPrefetched)
+    {
+        bool b_gap;
+        ISegment *segment = rep->getNextSegment(BaseRepresentation::INFOTYPE_MEDIA,
+                                                number, &number, &b_gap);
+        if(!segment || b_gap)
+            break;
+        SegmentChunk *chunk = segment->toChunk(resources, connManager, number, rep);
+        if(!chunk)
+            break;
+        prefetched.push_back({rep, number, chunk});
+        number++;
+    }
+}
+
+void SegmentTracker::dropPrefetchedChunks()
+{
+    while(!prefetched.empty())
+    {
+        delete prefetched.front().chunk;
+        prefetched.pop_front();
+    }
+}
+
 bool SegmentTracker::setPositionByTime(vlc_tick_t time, bool restarted, bool tryonly)
 {
     uint64_t segnumber;
@@ -345,6 +437,7 @@ bool SegmentTracker::setPositionByTime(vlc_tick_t time, bool restarted, bool try
 
 void SegmentTracker::setPositionByNumber(uint64_t segnumber, bool restarted)
 {
+    dropPrefetchedChunks();
     if(restarted)
     {
         initializing = true;
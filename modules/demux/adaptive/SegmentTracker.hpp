@@ -144,6 +144,9 @@ namespace adaptive
         private:
             void setAdaptationLogic(AbstractAdaptationLogic *);
             void notify(const SegmentTrackerEvent &) const;
+            SegmentChunk * getPrefetchedChunk(BaseRepresentation *, uint64_t);
+            void prefetchChunks(BaseRepresentation *, AbstractConnectionManager *);
+            void dropPrefetchedChunks();
             bool first;
             bool initializing;
             bool index_sent;
@@ -157,6 +160,15 @@ namespace adaptive
             BaseAdaptationSet *adaptationSet;
             BaseRepresentation *curRepresentation;
             std::list<SegmentTrackerListenerInterface *> listeners;
+            /* media segments downloaded ahead of the current one */
+            struct Prefetched
+            {
+                BaseRepresentation *rep;
+                uint64_t number;
+                SegmentChunk *chunk;
+            };
+            std::list<Prefetched> prefetched;
+            unsigned maxPrefetched;
     };
 }
 
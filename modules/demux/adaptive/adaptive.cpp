@@ -26,6 +26,7 @@
 # include "config.h"
 #endif
 
+#include <limits.h>
 #include <stdint.h>
 
 #include <vlc_common.h>
@@ -82,6 +83,24 @@ static void Close   (vlc_object_t *);
 #define ADAPT_ACCESS_TEXT N_("Use regular HTTP modules")
 #define ADAPT_ACCESS_LONGTEXT N_("Connect using HTTP access instead of custom HTTP code")
 
+#define ADAPT_HTTP2_TEXT N_("Use HTTP/2")
+#define ADAPT_HTTP2_LONGTEXT N_("Multiplex all requests to a same HTTPS " \
+    "server over a single HTTP/2 connection, when the server supports it.")
+
+#define ADAPT_DOWNLOADS_TEXT N_("Concurrent segment downloads")
+#define ADAPT_DOWNLOADS_LONGTEXT N_("Number of segments of each stream " \
+    "downloaded at once, ahead of playback. More downloads make up for the " \
+    "latency of distant servers.")
+
+#define ADAPT_DOWNLOADSIZE_TEXT N_("Maximum download buffer (KiB)")
+#define ADAPT_DOWNLOADSIZE_LONGTEXT N_("Limits the data of all streams " \
+    "downloaded ahead of playback (0 for no limit).")
+
+#define ADAPT_CACHE_TEXT N_("Segments cache size (MiB)")
+#define ADAPT_CACHE_LONGTEXT N_("Keeps downloaded segments on disk, " \
+    "for seeking back or restarting playback without downloading them " \
+    "again (0 to disable).")
+
 #define ADAPT_LOWLATENCY_TEXT N_("Low latency")
 #define ADAPT_LOWLATENCY_LONGTEXT N_("Overrides low latency parameters")
 
@@ -89,6 +108,7 @@ static const AbstractAdaptationLogic::LogicType pi_logics[] = {
                                 AbstractAdaptationLogic::Default,
                                 AbstractAdaptationLogic::Predictive,
                                 AbstractAdaptationLogic::NearOptimal,
+                                AbstractAdaptationLogic::Hybrid,
                                 AbstractAdaptationLogic::RateBased,
                                 AbstractAdaptationLogic::FixedRate,
                                 AbstractAdaptationLogic::AlwaysLowest,
@@ -98,6 +118,7 @@ static const char *const ppsz_logics_values[] = {
                                 "",
                                 "predictive",
                                 "nearoptimal",
+                                "hybrid",
                                 "rate",
                                 "fixedrate",
                                 "lowest",
@@ -106,6 +127,7 @@ static const char *const ppsz_logics_values[] = {
 static const char *const ppsz_logics[] = { N_("Default"),
                                            N_("Predictive"),
                                            N_("Near Optimal"),
+                                           N_("Buffer and Bandwidth Hybrid"),
                                            N_("Bandwidth Adaptive"),
                                            N_("Fixed Bandwidth"),
                                            N_("Lowest Bandwidth/Quality"),
@@ -137,12 +159,22 @@ vlc_module_begin ()
                      ADAPT_HEIGHT_TEXT, ADAPT_HEIGHT_TEXT, false )
         add_integer( "adaptive-bw",     250, ADAPT_BW_TEXT,     ADAPT_BW_LONGTEXT,     false )
         add_bool   ( "adaptive-use-access", false, ADAPT_ACCESS_TEXT, ADAPT_ACCESS_LONGTEXT, true );
+        add_bool   ( "adaptive-use-http2", true, ADAPT_HTTP2_TEXT, ADAPT_HTTP2_LONGTEXT, true );
         add_integer( "adaptive-livedelay",
                      MS_FROM_VLC_TICK(AbstractBufferingLogic::DEFAULT_LIVE_BUFFERING),
                      ADAPT_BUFFER_TEXT, ADAPT_BUFFER_LONGTEXT, true );
         add_integer( "adaptive-maxbuffer",
                      MS_FROM_VLC_TICK(AbstractBufferingLogic::DEFAULT_MAX_BUFFERING),
                      ADAPT_MAXBUFFER_TEXT, NULL, true );
+        add_integer( "adaptive-downloads", 2,
+                     ADAPT_DOWNLOADS_TEXT, ADAPT_DOWNLOADS_LONGTEXT, true )
+            change_integer_range( 1, 8 )
+        add_integer( "adaptive-maxdownloadsize", 65536,
+                     ADAPT_DOWNLOADSIZE_TEXT, ADAPT_DOWNLOADSIZE_LONGTEXT, true )
+            change_integer_range( 0, INT_MAX / 1024 )
+        add_integer( "adaptive-cache-size", 0,
+                     ADAPT_CACHE_TEXT, ADAPT_CACHE_LONGTEXT, true )
+            change_integer_range( 0, INT_MAX )
         add_integer( "adaptive-lowlatency", -1, ADAPT_LOWLATENCY_TEXT, ADAPT_LOWLATENCY_LONGTEXT, true );
             change_integer_list(rgi_latency, ppsz_latency)
         set_callbacks( Open, Close )
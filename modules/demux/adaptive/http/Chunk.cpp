@@ -29,11 +29,13 @@
 #include "HTTPConnection.hpp"
 #include "HTTPConnectionManager.h"
 #include "Downloader.hpp"
+#include "SegmentCache.hpp"
 
 #include <vlc_common.h>
 #include <vlc_block.h>
 
 #include <algorithm>
+#include <sstream>
 
 using namespace adaptive::http;
 
@@ -237,7 +239,17 @@ std::string HTTPChunkSource::getContentType() const
     if(connection)
         return connection->getContentType();
     else
-        return std::string();
+        return contentType;
+}
+
+void HTTPChunkSource::releaseConnection()
+{
+    if(connection)
+    {
+        contentType = connection->getContentType();
+        connection->setUsed(false);
+        connection = NULL;
+    }
 }
 
 bool HTTPChunkSource::prepare()
@@ -265,13 +277,10 @@ bool HTTPChunkSource::prepare()
         {
             if(requeststatus == RequestStatus::Redirection)
             {
-                HTTPConnection *httpconn = dynamic_cast<HTTPConnection *>(connection);
-                if(httpconn)
-                    connparams = httpconn->getRedirection();
+                connparams = connection->getRedirection();
                 connection->setUsed(false);
                 connection = NULL;
-                if(httpconn)
-                    continue;
+                continue;
             }
             break;
         }
@@ -302,7 +311,12 @@ HTTPChunkBufferedSource::HTTPChunkBufferedSource(const std::string& url, Abstrac
     done = false;
     eof = false;
     held = false;
+    incremental = false;
+    cachewriter = NULL;
     downloadstart = 0;
+    deadline = VLC_TICK_INVALID;
+    downloading = false;
+    finished = false;
 }
 
 HTTPChunkBufferedSource::~HTTPChunkBufferedSource()
@@ -322,6 +336,7 @@ HTTPChunkBufferedSource::~HTTPChunkBufferedSource()
         pp_tail = &p_head;
     }
     buffered = 0;
+    endCaching(false);
     vlc_mutex_unlock(&lock);
 }
 
@@ -344,6 +359,16 @@ void HTTPChunkBufferedSource::release()
     vlc_cond_signal(&avail);
 }
 
+void HTTPChunkBufferedSource::setDeadline(vlc_tick_t t)
+{
+    deadline = t;
+}
+
+void HTTPChunkBufferedSource::setIncremental(bool b)
+{
+    incremental = b;
+}
+
 void HTTPChunkBufferedSource::bufferize(size_t readsize)
 {
     vlc_mutex_lock(&lock);
@@ -356,6 +381,13 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
         return;
     }
 
+    if(done) /* served from the cache */
+    {
+        vlc_cond_signal(&avail);
+        vlc_mutex_unlock(&lock);
+        return;
+    }
+
     if(readsize < HTTPChunkSource::CHUNK_SIZE)
         readsize = HTTPChunkSource::CHUNK_SIZE;
 
@@ -377,7 +409,8 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
         vlc_tick_t time;
     } rate = {0,0};
 
-    ssize_t ret = connection->read(p_block->p_buffer, readsize);
+    ssize_t ret = (incremental) ? connection->readSome(p_block->p_buffer, readsize)
+                                : connection->read(p_block->p_buffer, readsize);
     if(ret <= 0)
     {
         block_Release(p_block);
@@ -387,19 +420,28 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
         rate.size = buffered + consumed;
         rate.time = vlc_tick_now() - downloadstart;
         downloadstart = 0;
+        endCaching(ret == 0 && contentLength && rate.size == contentLength);
+        releaseConnection();
     }
     else
     {
         p_block->i_buffer = (size_t) ret;
+        if(cachewriter)
+            cachewriter->write(p_block->p_buffer, p_block->i_buffer);
         vlc_mutex_locker locker( &lock );
         buffered += p_block->i_buffer;
         block_ChainLastAppend(&pp_tail, p_block);
-        if((size_t) ret < readsize)
+        /* Incremental reads are only short until the end is signaled */
+        if((incremental) ? (contentLength && buffered + consumed >= contentLength)
+                         : (size_t) ret < readsize)
         {
             done = true;
             rate.size = buffered + consumed;
             rate.time = vlc_tick_now() - downloadstart;
             downloadstart = 0;
+            endCaching(contentLength && rate.size == contentLength);
+            /* let other downloads reuse the connection */
+            releaseConnection();
         }
     }
 
@@ -411,16 +453,66 @@ void HTTPChunkBufferedSource::bufferize(size_t readsize)
     vlc_cond_signal(&avail);
 }
 
+static std::string CacheKey(const ConnectionParams &params, const BytesRange &range)
+{
+    std::ostringstream os;
+    os.imbue(std::locale("C"));
+    os << params.getUrl();
+    if(range.isValid())
+        os << '@' << range.getStartByte() << '-' << range.getEndByte();
+    return os.str();
+}
+
 bool HTTPChunkBufferedSource::prepare()
 {
     if(!prepared)
     {
         downloadstart = vlc_tick_now();
-        return HTTPChunkSource::prepare();
+        if(prepareFromCache())
+            return true;
+        if(!HTTPChunkSource::prepare())
+            return false;
+        SegmentCache *cache = connManager->getCache();
+        if(cache && !usesAccess() && !params.isLocal())
+            cachewriter = cache->store(CacheKey(params, bytesRange),
+                                       connection->getContentType(),
+                                       connection->getCacheControl(),
+                                       contentLength);
     }
     return true;
 }
 
+bool HTTPChunkBufferedSource::prepareFromCache()
+{
+    SegmentCache *cache = connManager->getCache();
+    if(!cache || usesAccess() || params.isLocal())
+        return false;
+
+    block_t *p_block = cache->get(CacheKey(params, bytesRange), &contentType);
+    if(!p_block)
+        return false;
+
+    /* No download, and no rate to report */
+    contentLength = p_block->i_buffer;
+    buffered += p_block->i_buffer;
+    block_ChainLastAppend(&pp_tail, p_block);
+    requeststatus = RequestStatus::Success;
+    prepared = true;
+    done = true;
+    return true;
+}
+
+void HTTPChunkBufferedSource::endCaching(bool complete)
+{
+    if(!cachewriter)
+        return;
+    if(complete)
+        connManager->getCache()->commit(cachewriter);
+    else
+        connManager->getCache()->abort(cachewriter);
+    cachewriter = NULL;
+}
+
 bool HTTPChunkBufferedSource::hasMoreData() const
 {
     vlc_mutex_locker locker( &lock );
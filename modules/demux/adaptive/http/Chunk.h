@@ -28,6 +28,7 @@
 #include "BytesRange.hpp"
 #include "ConnectionParams.hpp"
 #include "../ID.hpp"
+#include <atomic>
 #include <vector>
 #include <string>
 #include <stdint.h>
@@ -41,6 +42,7 @@ namespace adaptive
         class AbstractConnection;
         class AbstractConnectionManager;
         class AbstractChunk;
+        class SegmentCacheWriter;
 
         class AbstractChunkSource
         {
@@ -102,6 +104,7 @@ namespace adaptive
 
             protected:
                 virtual bool        prepare();
+                void                releaseConnection();
                 AbstractConnection    *connection;
                 AbstractConnectionManager *connManager;
                 mutable vlc_mutex_t lock;
@@ -109,10 +112,11 @@ namespace adaptive
                 bool                prepared;
                 bool                eof;
                 ID                  sourceid;
+                ConnectionParams    params;
+                std::string         contentType; /* once released */
 
             private:
                 bool init(const std::string &);
-                ConnectionParams    params;
         };
 
         class HTTPChunkBufferedSource : public HTTPChunkSource
@@ -128,21 +132,31 @@ namespace adaptive
                 virtual bool       hasMoreData     () const; /* impl */
                 void               hold();
                 void               release();
+                void               setDeadline(vlc_tick_t); /* before start */
+                void               setIncremental(bool); /* before start */
 
             protected:
                 virtual bool       prepare(); /* reimpl */
                 void               bufferize(size_t);
                 bool               isDone() const;
+                bool               prepareFromCache();
+                void               endCaching(bool);
 
             private:
                 block_t            *p_head; /* read cache buffer */
                 block_t           **pp_tail;
-                size_t              buffered; /* read cache size */
+                std::atomic<size_t> buffered; /* read cache size */
                 bool                done;
                 bool                eof;
                 vlc_tick_t          downloadstart;
                 vlc_cond_t          avail;
                 bool                held;
+                bool                incremental; /* hands out data as it arrives */
+                SegmentCacheWriter *cachewriter;
+                /* scheduling state, protected by the downloader lock */
+                vlc_tick_t          deadline;
+                bool                downloading;
+                bool                finished;
         };
 
         class HTTPChunk : public AbstractChunk
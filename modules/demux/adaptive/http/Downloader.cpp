@@ -25,27 +25,31 @@
 
 #include <vlc_threads.h>
 
-#include <atomic>
+#include <algorithm>
 
 using namespace adaptive::http;
 
-Downloader::Downloader()
+Downloader::Downloader(unsigned workers, size_t maxbuffered_)
 {
     vlc_mutex_init(&lock);
     vlc_cond_init(&waitcond);
     killed = false;
-    thread_handle_valid = false;
+    if(workers > MAX_WORKERS)
+        workers = MAX_WORKERS;
+    maxworkers = workers ? workers : 1;
+    maxbuffered = maxbuffered_;
 }
 
 bool Downloader::start()
 {
-    if(!thread_handle_valid &&
-       vlc_clone(&thread_handle, downloaderThread,
+    vlc_thread_t thread;
+
+    if(!threads.empty())
+        return true;
+    if(vlc_clone(&thread, downloaderThread,
                  static_cast<void *>(this), VLC_THREAD_PRIORITY_INPUT))
-    {
         return false;
-    }
-    thread_handle_valid = true;
+    threads.push_back(thread);
     return true;
 }
 
@@ -53,26 +57,59 @@ Downloader::~Downloader()
 {
     vlc_mutex_lock( &lock );
     killed = true;
-    vlc_cond_signal(&waitcond);
+    vlc_cond_broadcast(&waitcond);
     vlc_mutex_unlock( &lock );
 
-    if(thread_handle_valid)
-        vlc_join(thread_handle, NULL);
+    for(vlc_thread_t &thread : threads)
+        vlc_join(thread, NULL);
 }
+
 void Downloader::schedule(HTTPChunkBufferedSource *source)
 {
     vlc_mutex_lock(&lock);
     source->hold();
-    chunks.push_back(source);
-    vlc_cond_signal(&waitcond);
+
+    /* Earliest playback deadline first, then in scheduling order */
+    auto it = chunks.begin();
+    if(source->deadline != VLC_TICK_INVALID)
+    {
+        while(it != chunks.end() && (*it)->deadline != VLC_TICK_INVALID &&
+              (*it)->deadline <= source->deadline)
+            ++it;
+    }
+    else it = chunks.end();
+    chunks.insert(it, source);
+
+    /* Add a worker if every one might already be busy */
+    size_t pending = 0;
+    for(const HTTPChunkBufferedSource *src : chunks)
+        if(!src->finished)
+            pending++;
+    if(!threads.empty() && threads.size() < maxworkers && pending > threads.size())
+    {
+        vlc_thread_t thread;
+        if(!vlc_clone(&thread, downloaderThread,
+                      static_cast<void *>(this), VLC_THREAD_PRIORITY_INPUT))
+            threads.push_back(thread);
+    }
+
+    vlc_cond_broadcast(&waitcond);
     vlc_mutex_unlock(&lock);
 }
 
 void Downloader::cancel(HTTPChunkBufferedSource *source)
 {
     vlc_mutex_lock(&lock);
-    source->release();
-    chunks.remove(source);
+    /* wait for the current read to complete */
+    while(source->downloading)
+        vlc_cond_wait(&waitcond, &lock);
+    if(std::find(chunks.begin(), chunks.end(), source) != chunks.end())
+    {
+        chunks.remove(source);
+        source->release();
+    }
+    /* buffered data is released, and the order may have changed */
+    vlc_cond_broadcast(&waitcond);
     vlc_mutex_unlock(&lock);
 }
 
@@ -91,27 +128,55 @@ void Downloader::DownloadSource(HTTPChunkBufferedSource *source)
         source->bufferize(HTTPChunkSource::CHUNK_SIZE);
 }
 
+size_t Downloader::getBufferedSize() const
+{
+    size_t total = 0;
+    for(const HTTPChunkBufferedSource *source : chunks)
+        total += source->buffered;
+    return total;
+}
+
+HTTPChunkBufferedSource * Downloader::getNextSource() const
+{
+    bool first = true;
+    for(HTTPChunkBufferedSource *source : chunks)
+    {
+        if(source->finished)
+            continue;
+        /* Over the buffering limit, only the most urgent source can progress,
+         * so that playback can always go on */
+        if(!first && maxbuffered && getBufferedSize() >= maxbuffered)
+            return NULL;
+        if(!source->downloading)
+            return source;
+        first = false;
+    }
+    return NULL;
+}
+
 void Downloader::Run()
 {
     vlc_mutex_lock(&lock);
     while(1)
     {
-        while(chunks.empty() && !killed)
+        HTTPChunkBufferedSource *source = NULL;
+
+        while(!killed && (source = getNextSource()) == NULL)
             vlc_cond_wait(&waitcond, &lock);
 
         if(killed)
             break;
 
-        if(!chunks.empty())
-        {
-            HTTPChunkBufferedSource *source = chunks.front();
-            DownloadSource(source);
-            if(source->isDone())
-            {
-                chunks.pop_front();
-                source->release();
-            }
-        }
+        /* Read without the lock, so that other workers and cancellation
+         * are not blocked by the network */
+        source->downloading = true;
+        vlc_mutex_unlock(&lock);
+        DownloadSource(source);
+        bool finished = source->isDone();
+        vlc_mutex_lock(&lock);
+        source->downloading = false;
+        source->finished = finished;
+        vlc_cond_broadcast(&waitcond);
     }
     vlc_mutex_unlock(&lock);
 }
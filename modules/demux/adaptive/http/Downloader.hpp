@@ -24,6 +24,7 @@
 
 #include <vlc_common.h>
 #include <list>
+#include <vector>
 
 namespace adaptive
 {
@@ -34,21 +35,27 @@ namespace adaptive
         class Downloader
         {
             public:
-                Downloader();
+                Downloader(unsigned = 1, size_t = 0);
                 ~Downloader();
                 bool start();
                 void schedule(HTTPChunkBufferedSource *);
                 void cancel(HTTPChunkBufferedSource *);
 
+                static const unsigned MAX_WORKERS = 8;
+
             private:
                 static void * downloaderThread(void *);
                 void Run();
                 void DownloadSource(HTTPChunkBufferedSource *);
-                vlc_thread_t thread_handle;
+                HTTPChunkBufferedSource * getNextSource() const;
+                size_t getBufferedSize() const;
+                std::vector<vlc_thread_t> threads;
+                unsigned     maxworkers;
+                size_t       maxbuffered;
                 vlc_mutex_t  lock;
                 vlc_cond_t   waitcond;
-                bool         thread_handle_valid;
                 bool         killed;
+                /* sources by playback deadline, until cancelled */
                 std::list<HTTPChunkBufferedSource *> chunks;
         };
 
@@ -28,9 +28,19 @@
 #include "../tools/Helper.h"
 
 #include <cstdio>
+#include <cstddef>
+#include <cstring>
 #include <sstream>
 #include <algorithm>
 #include <vlc_stream.h>
+#include <vlc_block.h>
+
+extern "C"
+{
+    #include "../../../access/http/resource.h"
+    #include "../../../access/http/connmgr.h"
+    #include "../../../access/http/message.h"
+}
 
 using namespace adaptive::http;
 
@@ -56,6 +66,11 @@ bool AbstractConnection::prepare(const ConnectionParams &params_)
     return true;
 }
 
+ssize_t AbstractConnection::readSome(void *p_buffer, size_t len)
+{
+    return read(p_buffer, len);
+}
+
 size_t AbstractConnection::getContentLength() const
 {
     return contentLength;
@@ -66,6 +81,16 @@ const std::string & AbstractConnection::getContentType() const
     return contentType;
 }
 
+const std::string & AbstractConnection::getCacheControl() const
+{
+    return cacheControl;
+}
+
+const ConnectionParams & AbstractConnection::getRedirection() const
+{
+    return locationparams;
+}
+
 HTTPConnection::HTTPConnection(vlc_object_t *p_object_, AuthStorage *auth,
                                Transport *socket_, const ConnectionParams &proxy, bool persistent)
     : AbstractConnection( p_object_ )
@@ -151,6 +176,7 @@ enum RequestStatus
     /* Set new path for this query */
     params.setPath(path);
     locationparams = ConnectionParams();
+    cacheControl = std::string();
 
     msg_Dbg(p_object, "Retrieving %s @%zu", params.getUrl().c_str(),
                        range.isValid() ? range.getStartByte() : 0);
@@ -210,6 +236,18 @@ enum RequestStatus
 }
 
 ssize_t HTTPConnection::read(void *p_buffer, size_t len)
+{
+    return doRead(p_buffer, len, true);
+}
+
+ssize_t HTTPConnection::readSome(void *p_buffer, size_t len)
+{
+    /* Chunked transfers are incrementally produced (low latency CMAF),
+     * do not wait for the next chunk if we already got some data */
+    return doRead(p_buffer, len, false);
+}
+
+ssize_t HTTPConnection::doRead(void *p_buffer, size_t len, bool b_waitall)
 {
     if( !connected() ||
        (!queryOk && bytesRead == 0) )
@@ -227,12 +265,12 @@ ssize_t HTTPConnection::read(void *p_buffer, size_t len)
     if(len > toRead)
         len = toRead;
 
-    ssize_t ret = ( chunked ) ? readChunk(p_buffer, len)
+    ssize_t ret = ( chunked ) ? readChunk(p_buffer, len, b_waitall)
                               : transport->read(p_buffer, len);
     if(ret >= 0)
         bytesRead += ret;
 
-    if(ret < 0 || (size_t)ret < len || /* set EOF */
+    if(ret < 0 || ((size_t)ret < len && (b_waitall || !chunked || chunked_eof)) || /* set EOF */
        (contentLength == bytesRead && connectionClose))
     {
         transport->disconnect();
@@ -312,7 +350,7 @@ enum RequestStatus
     return RequestStatus::Success;
 }
 
-ssize_t HTTPConnection::readChunk(void *p_buffer, size_t len)
+ssize_t HTTPConnection::readChunk(void *p_buffer, size_t len, bool b_waitall)
 {
     size_t copied = 0;
 
@@ -354,6 +392,8 @@ ssize_t HTTPConnection::readChunk(void *p_buffer, size_t len)
             ssize_t in = transport->read(&crlf, 2);
             if(in < 2 || memcmp(crlf, "\r\n", 2))
                 return (copied == 0) ? -1 : copied;
+            if(!b_waitall && copied > 0)
+                break;
         }
     }
 
@@ -407,6 +447,10 @@ void HTTPConnection::onHeader(const std::string &key,
     {
         contentType = value;
     }
+    else if(Helper::icaseEquals(key, "Cache-Control"))
+    {
+        cacheControl = value;
+    }
     else if(Helper::icaseEquals(key, "Location"))
     {
         locationparams = ConnectionParams();
@@ -469,11 +513,6 @@ std::string HTTPConnection::extraRequestHeaders() const
     return ss.str();
 }
 
-const ConnectionParams & HTTPConnection::getRedirection() const
-{
-    return locationparams;
-}
-
 StreamUrlConnection::StreamUrlConnection(vlc_object_t *p_object)
     : AbstractConnection(p_object)
 {
@@ -589,6 +628,313 @@ void StreamUrlConnection::setUsed( bool b )
        reset();
 }
 
+LibVLCHTTPSession::LibVLCHTTPSession(vlc_object_t *p_object, AuthStorage *auth)
+{
+    vlc_mutex_init(&mgr_lock);
+    http_mgr = vlc_http_mgr_create(p_object, auth ? auth->getJar() : NULL);
+    multiplexed = true;
+}
+
+LibVLCHTTPSession::~LibVLCHTTPSession()
+{
+    if(http_mgr)
+        vlc_http_mgr_destroy(http_mgr);
+}
+
+struct vlc_http_mgr * LibVLCHTTPSession::getManager() const
+{
+    return http_mgr;
+}
+
+/* The manager is not thread-safe: requests and streams closing must be
+ * serialized, while the responses payloads can be read concurrently */
+void LibVLCHTTPSession::lock()
+{
+    vlc_mutex_lock(&mgr_lock);
+}
+
+void LibVLCHTTPSession::unlock()
+{
+    vlc_mutex_unlock(&mgr_lock);
+}
+
+bool LibVLCHTTPSession::isMultiplexed() const
+{
+    return multiplexed;
+}
+
+/* The manager has a single connection: if ALPN fell back to HTTP/1.1,
+ * every concurrent request would replace it with a new one.
+ * Must be called locked, after a request. */
+void LibVLCHTTPSession::updateMultiplexed()
+{
+    if(http_mgr && !vlc_http_mgr_is_multiplexed(http_mgr))
+        multiplexed = false;
+}
+
+namespace
+{
+    /* vlc_http_res_get_status() passes the trailing data as opaque */
+    struct LibVLCHTTPResource
+    {
+        struct vlc_http_resource resource;
+        LibVLCHTTPConnection *connection;
+    };
+
+    const struct vlc_http_resource_cbs libvlchttp_callbacks =
+    {
+        LibVLCHTTPConnection::formatRequest,
+        LibVLCHTTPConnection::validateResponse,
+    };
+}
+
+LibVLCHTTPConnection::LibVLCHTTPConnection(vlc_object_t *p_object_,
+                                           LibVLCHTTPSession *session_)
+    : AbstractConnection( p_object_ )
+{
+    session = session_;
+    resource = NULL;
+    pending = NULL;
+    b_eof = false;
+    char *psz_useragent = var_InheritString(p_object_, "http-user-agent");
+    useragent = psz_useragent ? std::string(psz_useragent) : std::string("");
+    free(psz_useragent);
+    char *psz_referer = var_InheritString(p_object_, "http-referrer");
+    referer = psz_referer ? std::string(psz_referer) : std::string("");
+    free(psz_referer);
+}
+
+LibVLCHTTPConnection::~LibVLCHTTPConnection()
+{
+    reset();
+}
+
+void LibVLCHTTPConnection::reset()
+{
+    if(pending)
+        block_Release(pending);
+    pending = NULL;
+    if(resource)
+    {
+        /* closes the stream, or the connection it was using */
+        session->lock();
+        vlc_http_res_destroy(resource);
+        session->unlock();
+    }
+    resource = NULL;
+    b_eof = false;
+    bytesRead = 0;
+    contentLength = 0;
+    contentType = std::string();
+    cacheControl = std::string();
+    bytesRange = BytesRange();
+}
+
+bool LibVLCHTTPConnection::canReuse(const ConnectionParams &params_) const
+{
+    if( !available || params_.usesAccess() || !session->isMultiplexed() )
+        return false;
+    return (params.getHostname() == params_.getHostname() &&
+            params.getScheme() == params_.getScheme() &&
+            params.getPort() == params_.getPort());
+}
+
+int LibVLCHTTPConnection::formatRequest(const struct vlc_http_resource *,
+                                        struct vlc_http_msg *req, void *opaque)
+{
+    const LibVLCHTTPConnection *conn = *static_cast<LibVLCHTTPConnection **>(opaque);
+    vlc_http_msg_add_header(req, "Cache-Control", "no-cache");
+    if(conn->bytesRange.isValid())
+    {
+        if(conn->bytesRange.getEndByte())
+            vlc_http_msg_add_header(req, "Range", "bytes=%zu-%zu",
+                                    conn->bytesRange.getStartByte(),
+                                    conn->bytesRange.getEndByte());
+        else
+            vlc_http_msg_add_header(req, "Range", "bytes=%zu-",
+                                    conn->bytesRange.getStartByte());
+    }
+    return 0;
+}
+
+int LibVLCHTTPConnection::validateResponse(const struct vlc_http_resource *,
+                                           const struct vlc_http_msg *, void *)
+{
+    /* status is checked by request() */
+    return 0;
+}
+
+enum RequestStatus
+    LibVLCHTTPConnection::request(const std::string &path, const BytesRange &range)
+{
+    reset();
+
+    /* Set new path for this query */
+    params.setPath(path);
+    locationparams = ConnectionParams();
+
+    msg_Dbg(p_object, "Retrieving %s @%zu", params.getUrl().c_str(),
+                      range.isValid() ? range.getStartByte() : 0);
+
+    if(!session->getManager())
+        return RequestStatus::GenericError;
+
+    static_assert(offsetof(LibVLCHTTPResource, connection) == sizeof(struct vlc_http_resource),
+                  "callbacks opaque must follow the resource");
+    LibVLCHTTPResource *res = static_cast<LibVLCHTTPResource *>(malloc(sizeof(*res)));
+    if(!res)
+        return RequestStatus::GenericError;
+    res->connection = this;
+    if(vlc_http_res_init(&res->resource, &libvlchttp_callbacks, session->getManager(),
+                         params.getUrl().c_str(),
+                         useragent.empty() ? NULL : useragent.c_str(),
+                         referer.empty() ? NULL : referer.c_str()))
+    {
+        free(res);
+        return RequestStatus::GenericError;
+    }
+    resource = &res->resource;
+    bytesRange = range;
+
+    /* Reuses the origin connection, or creates it (TLS ALPN h2) */
+    session->lock();
+    int status = vlc_http_res_get_status(resource);
+    if(status >= 0)
+        session->updateMultiplexed();
+    session->unlock();
+
+    if(status < 0)
+    {
+        reset();
+        return RequestStatus::GenericError;
+    }
+
+    if(status == 301 || status == 302 || status == 307 || status == 308)
+    {
+        char *psz_location = vlc_http_res_get_redirect(resource);
+        reset();
+        if(psz_location)
+        {
+            locationparams = ConnectionParams(psz_location);
+            free(psz_location);
+            msg_Info(p_object, "%d redirection to %s", status, locationparams.getUrl().c_str());
+            if(locationparams.isLocal() && !params.isLocal())
+            {
+                msg_Err(p_object, "redirection to local rejected");
+                return RequestStatus::GenericError;
+            }
+            return RequestStatus::Redirection;
+        }
+        return RequestStatus::NotFound;
+    }
+    else if(status != 200 && status != 206)
+    {
+        msg_Err(p_object, "Failed reading %s: %d", params.getUrl().c_str(), status);
+        reset();
+        return RequestStatus::NotFound;
+    }
+
+    bytesRange = range;
+    if(range.isValid() && range.getEndByte() > 0)
+    {
+        contentLength = range.getEndByte() - range.getStartByte() + 1;
+    }
+    else
+    {
+        uintmax_t i_size = vlc_http_msg_get_size(resource->response);
+        if(i_size != UINTMAX_MAX)
+            contentLength = i_size;
+    }
+
+    char *psz_type = vlc_http_res_get_type(resource);
+    if(psz_type)
+    {
+        contentType = std::string(psz_type);
+        free(psz_type);
+    }
+
+    const char *psz_cachecontrol = vlc_http_msg_get_header(resource->response, "Cache-Control");
+    if(psz_cachecontrol)
+        cacheControl = std::string(psz_cachecontrol);
+
+    return RequestStatus::Success;
+}
+
+ssize_t LibVLCHTTPConnection::read(void *p_buffer, size_t len)
+{
+    return doRead(p_buffer, len, true);
+}
+
+ssize_t LibVLCHTTPConnection::readSome(void *p_buffer, size_t len)
+{
+    /* Payload arrives by frames/chunks, don't wait for the next one
+     * if we already got some data (low latency CMAF) */
+    return doRead(p_buffer, len, false);
+}
+
+ssize_t LibVLCHTTPConnection::doRead(void *p_buffer, size_t len, bool b_waitall)
+{
+    if( !resource )
+        return VLC_EGENERIC;
+
+    if(len == 0)
+        return VLC_SUCCESS;
+
+    const size_t toRead = (contentLength) ? contentLength - bytesRead : len;
+    if (toRead == 0)
+        return VLC_SUCCESS;
+
+    if(len > toRead)
+        len = toRead;
+
+    size_t copied = 0;
+    while(copied < len)
+    {
+        if(!pending)
+        {
+            if(b_eof || (!b_waitall && copied > 0))
+                break;
+            block_t *p_block = vlc_http_res_read(resource);
+            if(p_block == vlc_http_error)
+            {
+                msg_Err(p_object, "Failed reading %s", params.getUrl().c_str());
+                b_eof = true;
+                if(copied == 0)
+                    return VLC_EGENERIC;
+                break;
+            }
+            else if(p_block == NULL)
+            {
+                b_eof = true;
+                break;
+            }
+            pending = p_block;
+        }
+
+        size_t tocopy = std::min(len - copied, pending->i_buffer);
+        memcpy(static_cast<uint8_t *>(p_buffer) + copied, pending->p_buffer, tocopy);
+        pending->p_buffer += tocopy;
+        pending->i_buffer -= tocopy;
+        copied += tocopy;
+        if(pending->i_buffer == 0)
+        {
+            block_Release(pending);
+            pending = NULL;
+        }
+    }
+
+    bytesRead += copied;
+    return copied;
+}
+
+void LibVLCHTTPConnection::setUsed( bool b )
+{
+    available = !b;
+    /* streams are not reused, only the session connection */
+    if(available)
+        reset();
+}
+
 NativeConnectionFactory::NativeConnectionFactory( AuthStorage *auth )
     : AbstractConnectionFactory()
 {
@@ -646,15 +992,67 @@ AbstractConnection * StreamUrlConnectionFactory::createConnection(vlc_object_t *
     return new (std::nothrow) StreamUrlConnection(p_object);
 }
 
+LibVLCHTTPConnectionFactory::LibVLCHTTPConnectionFactory( AuthStorage *auth )
+    : AbstractConnectionFactory()
+{
+    authStorage = auth;
+}
+
+LibVLCHTTPConnectionFactory::~LibVLCHTTPConnectionFactory()
+{
+    std::map<std::string, LibVLCHTTPSession *>::const_iterator it;
+    for(it = sessions.begin(); it != sessions.end(); ++it)
+        delete (*it).second;
+}
+
+AbstractConnection * LibVLCHTTPConnectionFactory::createConnection(vlc_object_t *p_object,
+                                                             const ConnectionParams &params)
+{
+    if((params.getScheme() != "http" && params.getScheme() != "https") || params.getHostname().empty())
+        return NULL;
+
+    /* libvlc_http managers only handle a single connection, to a single
+     * server: use one per origin so that its requests share it */
+    std::ostringstream os;
+    os.imbue(std::locale("C"));
+    os << params.getScheme() << "://" << params.getHostname() << ":" << params.getPort();
+    const std::string origin = os.str();
+
+    LibVLCHTTPSession *session;
+    std::map<std::string, LibVLCHTTPSession *>::const_iterator it = sessions.find(origin);
+    if(it == sessions.end())
+    {
+        session = new (std::nothrow) LibVLCHTTPSession(p_object, authStorage);
+        if(!session)
+            return NULL;
+        if(!session->getManager())
+        {
+            delete session;
+            return NULL;
+        }
+        sessions.insert(std::pair<std::string, LibVLCHTTPSession *>(origin, session));
+    }
+    else session = (*it).second;
+
+    /* Served over HTTP/1.1: leave it to native connections, which are
+     * pooled, and keep the current ones until they are done */
+    if(!session->isMultiplexed())
+        return NULL;
+
+    return new (std::nothrow) LibVLCHTTPConnection(p_object, session);
+}
+
 ConnectionFactory::ConnectionFactory( AuthStorage *authstorage )
 {
     native = new NativeConnectionFactory( authstorage );
+    libvlchttp = new LibVLCHTTPConnectionFactory( authstorage );
     streamurl = new StreamUrlConnectionFactory();
 }
 
 ConnectionFactory::~ConnectionFactory()
 {
     delete native;
+    delete libvlchttp;
     delete streamurl;
 }
 
@@ -664,6 +1062,17 @@ AbstractConnection * ConnectionFactory::createConnection(vlc_object_t *p_object,
     bool b_streamurl = var_InheritBool(p_object, "adaptive-use-access");
     if(!b_streamurl && !params.usesAccess())
     {
+        /* HTTP/2 is only negotiated over TLS (ALPN), where it allows all
+         * segments and playlists requests to be multiplexed over a single
+         * connection per server. Otherwise, or once the server selected
+         * HTTP/1.1, keep our HTTP/1.1 pipelining. */
+        if(params.getScheme() == "https" &&
+           var_InheritBool(p_object, "adaptive-use-http2"))
+        {
+            AbstractConnection *conn = libvlchttp->createConnection(p_object, params);
+            if(conn)
+                return conn;
+        }
         return native->createConnection(p_object, params);
     }
     else
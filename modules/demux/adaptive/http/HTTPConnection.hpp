@@ -29,6 +29,12 @@
 #include "BytesRange.hpp"
 #include <vlc_common.h>
 #include <string>
+#include <map>
+#include <atomic>
+
+struct vlc_http_mgr;
+struct vlc_http_resource;
+struct vlc_http_msg;
 
 namespace adaptive
 {
@@ -49,17 +55,23 @@ namespace adaptive
                 virtual enum RequestStatus
                                 request     (const std::string& path, const BytesRange & = BytesRange()) = 0;
                 virtual ssize_t read        (void *p_buffer, size_t len) = 0;
+                /* Returns what has arrived, up to len, and 0 at end of content */
+                virtual ssize_t readSome    (void *p_buffer, size_t len);
 
                 virtual size_t  getContentLength() const;
                 virtual const std::string & getContentType() const;
+                virtual const std::string & getCacheControl() const;
+                virtual const ConnectionParams & getRedirection() const;
                 virtual void    setUsed( bool ) = 0;
 
             protected:
                 vlc_object_t      *p_object;
                 ConnectionParams   params;
+                ConnectionParams   locationparams;
                 bool               available;
                 size_t             contentLength;
                 std::string        contentType;
+                std::string        cacheControl;
                 BytesRange         bytesRange;
                 size_t             bytesRead;
         };
@@ -75,9 +87,9 @@ namespace adaptive
                 virtual enum RequestStatus
                                 request     (const std::string& path, const BytesRange & = BytesRange());
                 virtual ssize_t read        (void *p_buffer, size_t len);
+                virtual ssize_t readSome    (void *p_buffer, size_t len);
 
                 void setUsed( bool );
-                const ConnectionParams &getRedirection() const;
                 static const unsigned MAX_REDIRECTS = 3;
 
             protected:
@@ -92,14 +104,14 @@ namespace adaptive
                 virtual std::string extraRequestHeaders() const;
                 virtual std::string buildRequestHeader(const std::string &path) const;
 
-                ssize_t         readChunk   (void *p_buffer, size_t len);
+                ssize_t         doRead      (void *p_buffer, size_t len, bool b_waitall);
+                ssize_t         readChunk   (void *p_buffer, size_t len, bool b_waitall);
                 enum RequestStatus parseReply();
                 std::string readLine();
                 std::string useragent;
                 std::string referer;
 
                 AuthStorage        *authStorage;
-                ConnectionParams    locationparams;
                 ConnectionParams    proxyparams;
                 bool                connectionClose;
                 bool                chunked;
@@ -132,6 +144,58 @@ namespace adaptive
                 stream_t *p_streamurl;
        };
 
+       /* libvlc_http connection manager for a single origin server.
+        * Its connection is shared by all the requests to that server,
+        * which are multiplexed as streams when HTTP/2 is negotiated. */
+       class LibVLCHTTPSession
+       {
+            public:
+                LibVLCHTTPSession(vlc_object_t *, AuthStorage *);
+                ~LibVLCHTTPSession();
+                struct vlc_http_mgr * getManager() const;
+                void lock();
+                void unlock();
+                /* false once the server answered over HTTP/1.1 (ALPN) */
+                bool isMultiplexed() const;
+                void updateMultiplexed();
+
+            private:
+                struct vlc_http_mgr *http_mgr;
+                vlc_mutex_t          mgr_lock;
+                std::atomic<bool>    multiplexed;
+       };
+
+       class LibVLCHTTPConnection : public AbstractConnection
+       {
+            public:
+                LibVLCHTTPConnection(vlc_object_t *, LibVLCHTTPSession *);
+                virtual ~LibVLCHTTPConnection();
+
+                virtual bool    canReuse     (const ConnectionParams &) const;
+                virtual enum RequestStatus
+                                request     (const std::string& path, const BytesRange & = BytesRange());
+                virtual ssize_t read        (void *p_buffer, size_t len);
+                virtual ssize_t readSome    (void *p_buffer, size_t len);
+
+                virtual void    setUsed( bool );
+
+                /* libvlc_http resource callbacks */
+                static int formatRequest(const struct vlc_http_resource *,
+                                         struct vlc_http_msg *, void *);
+                static int validateResponse(const struct vlc_http_resource *,
+                                            const struct vlc_http_msg *, void *);
+
+            protected:
+                void reset();
+                ssize_t doRead(void *p_buffer, size_t len, bool b_waitall);
+                LibVLCHTTPSession  *session;
+                struct vlc_http_resource *resource;
+                block_t            *pending;
+                bool                b_eof;
+                std::string         useragent;
+                std::string         referer;
+       };
+
        class AbstractConnectionFactory
        {
            public:
@@ -158,6 +222,18 @@ namespace adaptive
                virtual AbstractConnection * createConnection(vlc_object_t *, const ConnectionParams &);
        };
 
+       class LibVLCHTTPConnectionFactory : public AbstractConnectionFactory
+       {
+           public:
+               LibVLCHTTPConnectionFactory( AuthStorage * );
+               virtual ~LibVLCHTTPConnectionFactory();
+               virtual AbstractConnection * createConnection(vlc_object_t *, const ConnectionParams &);
+           private:
+               AuthStorage *authStorage;
+               /* by scheme://host:port */
+               std::map<std::string, LibVLCHTTPSession *> sessions;
+       };
+
        class ConnectionFactory : public AbstractConnectionFactory
        {
            public:
@@ -166,6 +242,7 @@ namespace adaptive
                virtual AbstractConnection * createConnection(vlc_object_t *, const ConnectionParams &);
            private:
                NativeConnectionFactory *native;
+               LibVLCHTTPConnectionFactory *libvlchttp;
                StreamUrlConnectionFactory *streamurl;
        };
     }
@@ -30,6 +30,7 @@
 #include "ConnectionParams.hpp"
 #include "Transport.hpp"
 #include "Downloader.hpp"
+#include "SegmentCache.hpp"
 #include <vlc_url.h>
 #include <vlc_http.h>
 
@@ -40,6 +41,7 @@ AbstractConnectionManager::AbstractConnectionManager(vlc_object_t *p_object_)
 {
     p_object = p_object_;
     rateObserver = NULL;
+    cache = NULL;
 }
 
 AbstractConnectionManager::~AbstractConnectionManager()
@@ -58,22 +60,33 @@ void AbstractConnectionManager::setDownloadRateObserver(IDownloadRateObserver *o
     rateObserver = obs;
 }
 
+SegmentCache * AbstractConnectionManager::getCache() const
+{
+    return cache;
+}
+
 
 HTTPConnectionManager::HTTPConnectionManager    (vlc_object_t *p_object_, AuthStorage *storage)
     : AbstractConnectionManager( p_object_ ),
       localAllowed(false)
 {
     vlc_mutex_init(&lock);
-    downloader = new (std::nothrow) Downloader();
-    downloader->start();
+    int64_t maxdownloadsize = var_InheritInteger(p_object, "adaptive-maxdownloadsize");
+    downloader = new (std::nothrow) Downloader(Downloader::MAX_WORKERS,
+                                               maxdownloadsize > 0 ? maxdownloadsize * 1024 : 0);
+    if(downloader)
+        downloader->start();
     factory = new ConnectionFactory(storage);
+    cache = SegmentCache::Acquire(p_object);
 }
 
 HTTPConnectionManager::~HTTPConnectionManager   ()
 {
     delete downloader;
-    delete factory;
+    /* connections can refer to the factory shared sessions */
     this->closeAllConnections();
+    delete factory;
+    SegmentCache::Release(cache);
 }
 
 void HTTPConnectionManager::closeAllConnections      ()
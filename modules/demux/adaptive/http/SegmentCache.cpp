@@ -0,0 +1,415 @@
+/*
+ * SegmentCache.cpp
+ *****************************************************************************
+ * Copyright (C) 2021 - VideoLAN and VLC Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "SegmentCache.hpp"
+#include "../tools/Helper.h"
+
+#include <vlc_block.h>
+#include <vlc_configuration.h>
+#include <vlc_cxx_helpers.hpp>
+#include <vlc_fs.h>
+#include <vlc_hash.h>
+#include <vlc_strings.h>
+#include <vlc_variables.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <sstream>
+#include <vector>
+#include <sys/stat.h>
+
+using namespace adaptive::http;
+
+#define CACHE_VAR "adaptive-segment-cache"
+
+/* guards the shared instance */
+static vlc::threads::mutex instance_lock;
+
+SegmentCacheWriter::SegmentCacheWriter(FILE *stream_, const std::string &tmppath_,
+                                       const std::string &hash_)
+{
+    stream = stream_;
+    tmppath = tmppath_;
+    hash = hash_;
+    size = 0;
+    failed = false;
+}
+
+SegmentCacheWriter::~SegmentCacheWriter()
+{
+    if(stream)
+    {
+        fclose(stream);
+        vlc_unlink(tmppath.c_str());
+    }
+}
+
+bool SegmentCacheWriter::write(const void *p, size_t len)
+{
+    if(failed || fwrite(p, 1, len, stream) != len)
+        failed = true;
+    else
+        size += len;
+    return !failed;
+}
+
+SegmentCache::SegmentCache(vlc_object_t *obj_, const std::string &dir, uint64_t max)
+{
+    obj = obj_;
+    directory = dir;
+    maxSize = max;
+    totalSize = 0;
+    refs = 1;
+    vlc_mutex_init(&lock);
+}
+
+SegmentCache::~SegmentCache()
+{
+}
+
+SegmentCache * SegmentCache::Acquire(vlc_object_t *p_obj)
+{
+    int64_t i_size = var_InheritInteger(p_obj, "adaptive-cache-size");
+    if(i_size <= 0)
+        return NULL;
+
+    vlc_object_t *vlc = VLC_OBJECT(vlc_object_instance(p_obj));
+
+    instance_lock.lock();
+    SegmentCache *cache = static_cast<SegmentCache *>(var_GetAddress(vlc, CACHE_VAR));
+    if(cache)
+    {
+        cache->refs++;
+        instance_lock.unlock();
+        return cache;
+    }
+
+    char *psz_cachedir = config_GetUserDir(VLC_CACHE_DIR);
+    if(!psz_cachedir)
+    {
+        instance_lock.unlock();
+        return NULL;
+    }
+    const std::string dir = std::string(psz_cachedir) + DIR_SEP "adaptive";
+    vlc_mkdir(psz_cachedir, 0700);
+    free(psz_cachedir);
+    if(vlc_mkdir(dir.c_str(), 0700) != 0 && errno != EEXIST)
+    {
+        msg_Warn(p_obj, "cannot create segment cache directory %s", dir.c_str());
+        instance_lock.unlock();
+        return NULL;
+    }
+
+    cache = new (std::nothrow) SegmentCache(vlc, dir, (uint64_t) i_size * 1024 * 1024);
+    if(cache)
+    {
+        cache->scan();
+        var_Create(vlc, CACHE_VAR, VLC_VAR_ADDRESS);
+        var_SetAddress(vlc, CACHE_VAR, cache);
+        msg_Dbg(p_obj, "segment cache %s: %" PRIu64 "/%" PRIu64 " bytes",
+                dir.c_str(), cache->totalSize, cache->maxSize);
+    }
+    instance_lock.unlock();
+    return cache;
+}
+
+void SegmentCache::Release(SegmentCache *cache)
+{
+    if(!cache)
+        return;
+
+    instance_lock.lock();
+    if(--cache->refs == 0)
+    {
+        var_Destroy(cache->obj, CACHE_VAR);
+        delete cache;
+    }
+    instance_lock.unlock();
+}
+
+std::string SegmentCache::getHash(const std::string &key)
+{
+    vlc_hash_md5_t md5;
+    uint8_t digest[VLC_HASH_MD5_DIGEST_SIZE];
+    char hex[VLC_HASH_MD5_DIGEST_HEX_SIZE];
+
+    vlc_hash_md5_Init(&md5);
+    vlc_hash_md5_Update(&md5, key.c_str(), key.length());
+    vlc_hash_md5_Finish(&md5, digest, sizeof(digest));
+    vlc_hex_encode_binary(digest, sizeof(digest), hex);
+    return std::string(hex);
+}
+
+std::string SegmentCache::getPath(const std::string &hash) const
+{
+    return directory + DIR_SEP + hash;
+}
+
+/* Rebuilds the index from a previous session, by storage time */
+void SegmentCache::scan()
+{
+    DIR *dir = vlc_opendir(directory.c_str());
+    if(!dir)
+        return;
+
+    std::vector<std::pair<time_t, std::string>> found;
+    const time_t now = time(NULL);
+    const char *psz_name;
+    while((psz_name = vlc_readdir(dir)) != NULL)
+    {
+        const std::string name(psz_name);
+        if(name.length() < 2 * VLC_HASH_MD5_DIGEST_SIZE || name[0] == '.')
+            continue;
+
+        const std::string path = directory + DIR_SEP + name;
+        struct stat st;
+        if(vlc_stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+            continue;
+
+        if(name.length() == 2 * VLC_HASH_MD5_DIGEST_SIZE)
+        {
+            found.push_back(std::pair<time_t, std::string>(st.st_mtime, name));
+            entries[name] = st.st_size;
+            totalSize += st.st_size;
+        }
+        else if(st.st_mtime + 3600 < now) /* interrupted store */
+        {
+            vlc_unlink(path.c_str());
+        }
+    }
+    closedir(dir);
+
+    std::sort(found.begin(), found.end(),
+              [](const std::pair<time_t, std::string> &a,
+                 const std::pair<time_t, std::string> &b) { return a.first > b.first; });
+    for(const std::pair<time_t, std::string> &entry : found)
+        lru.push_back(entry.second);
+
+    /* the limit can have been lowered */
+    while(totalSize > maxSize && !lru.empty())
+        remove(lru.back());
+}
+
+void SegmentCache::remove(const std::string &hash)
+{
+    std::map<std::string, uint64_t>::iterator it = entries.find(hash);
+    if(it == entries.end())
+        return;
+    vlc_unlink(getPath(hash).c_str());
+    totalSize -= (*it).second;
+    entries.erase(it);
+    lru.remove(hash);
+}
+
+bool SegmentCache::isStorable(const std::string &cacheControl, time_t *expires)
+{
+    *expires = time(NULL) + DEFAULT_LIFETIME;
+
+    std::list<std::string> directives = Helper::tokenize(cacheControl, ',');
+    std::list<std::string>::const_iterator it;
+    for(it = directives.begin(); it != directives.end(); ++it)
+    {
+        const std::string &token = *it;
+        std::size_t start = token.find_first_not_of(" \t");
+        if(start == std::string::npos)
+            continue;
+        std::size_t end = token.find_last_not_of(" \t");
+        const std::string directive = token.substr(start, end - start + 1);
+
+        /* no-cache would require revalidation on each use */
+        if(Helper::icaseEquals(directive, "no-store") ||
+           Helper::icaseEquals(directive, "no-cache"))
+            return false;
+
+        if(directive.length() > 8 &&
+           Helper::icaseEquals(directive.substr(0, 8), "max-age="))
+        {
+            std::istringstream is(directive.substr(8));
+            is.imbue(std::locale("C"));
+            long maxage;
+            is >> maxage;
+            if(is.fail() || maxage <= 0)
+                return false;
+            *expires = time(NULL) + maxage;
+        }
+    }
+    return true;
+}
+
+block_t * SegmentCache::get(const std::string &key, std::string *contentType)
+{
+    const std::string hash = getHash(key);
+
+    vlc_mutex_lock(&lock);
+    if(entries.find(hash) == entries.end())
+    {
+        vlc_mutex_unlock(&lock);
+        return NULL;
+    }
+    FILE *stream = vlc_fopen(getPath(hash).c_str(), "rb");
+    if(!stream)
+    {
+        remove(hash);
+        vlc_mutex_unlock(&lock);
+        return NULL;
+    }
+    lru.remove(hash);
+    lru.push_front(hash);
+    vlc_mutex_unlock(&lock);
+
+    /* key, expiry time and content type lines, then the payload */
+    std::string header[3];
+    uint64_t headersize = 0;
+    char *psz_line = NULL;
+    size_t linesize = 0;
+    unsigned lines = 0;
+    for(; lines < 3; lines++)
+    {
+        ssize_t len = getline(&psz_line, &linesize, stream);
+        if(len <= 0 || psz_line[len - 1] != '\n')
+            break;
+        header[lines] = std::string(psz_line, len - 1);
+        headersize += len;
+    }
+    free(psz_line);
+
+    block_t *p_block = NULL;
+    struct stat st;
+    if(lines == 3 && header[0] == key &&
+       fstat(fileno(stream), &st) == 0 && (uint64_t) st.st_size >= headersize)
+    {
+        std::istringstream is(header[1]);
+        is.imbue(std::locale("C"));
+        int64_t expires = -1;
+        is >> expires;
+        const size_t payload = st.st_size - headersize;
+        if(!is.fail() && expires > time(NULL) && payload > 0 &&
+           (p_block = block_Alloc(payload)) != NULL)
+        {
+            if(fread(p_block->p_buffer, 1, payload, stream) != payload)
+            {
+                block_Release(p_block);
+                p_block = NULL;
+            }
+        }
+    }
+    fclose(stream);
+
+    if(p_block)
+    {
+        *contentType = header[2];
+    }
+    else /* expired or corrupted */
+    {
+        vlc_mutex_lock(&lock);
+        remove(hash);
+        vlc_mutex_unlock(&lock);
+    }
+    return p_block;
+}
+
+SegmentCacheWriter * SegmentCache::store(const std::string &key,
+                                         const std::string &contentType,
+                                         const std::string &cacheControl,
+                                         uint64_t contentLength)
+{
+    time_t expires;
+    if(!isStorable(cacheControl, &expires))
+        return NULL;
+
+    /* would flush most of the cache */
+    if(contentLength == 0 || contentLength > maxSize / 4 ||
+       key.find('\n') != std::string::npos)
+        return NULL;
+
+    const std::string hash = getHash(key);
+    const std::string tmppath = getPath(hash) + ".XXXXXX";
+    std::vector<char> tmpl(tmppath.begin(), tmppath.end());
+    tmpl.push_back('\0');
+
+    int fd = vlc_mkstemp(&tmpl[0]);
+    if(fd == -1)
+        return NULL;
+    FILE *stream = fdopen(fd, "wb");
+    if(!stream)
+    {
+        vlc_close(fd);
+        vlc_unlink(&tmpl[0]);
+        return NULL;
+    }
+
+    SegmentCacheWriter *writer = new (std::nothrow) SegmentCacheWriter(stream, &tmpl[0], hash);
+    if(!writer)
+    {
+        fclose(stream);
+        vlc_unlink(&tmpl[0]);
+        return NULL;
+    }
+
+    std::string type = contentType;
+    std::replace(type.begin(), type.end(), '\n', ' ');
+    std::ostringstream os;
+    os.imbue(std::locale("C"));
+    os << key << '\n' << (int64_t) expires << '\n' << type << '\n';
+    const std::string header = os.str();
+    writer->write(header.c_str(), header.length());
+
+    return writer;
+}
+
+void SegmentCache::commit(SegmentCacheWriter *writer)
+{
+    bool ok = !writer->failed;
+    if(fclose(writer->stream) != 0)
+        ok = false;
+    writer->stream = NULL;
+
+    vlc_mutex_lock(&lock);
+    if(ok && vlc_rename(writer->tmppath.c_str(), getPath(writer->hash).c_str()) == 0)
+    {
+        std::map<std::string, uint64_t>::iterator it = entries.find(writer->hash);
+        if(it != entries.end()) /* replaced */
+        {
+            totalSize -= (*it).second;
+            lru.remove(writer->hash);
+        }
+        entries[writer->hash] = writer->size;
+        lru.push_front(writer->hash);
+        totalSize += writer->size;
+
+        while(totalSize > maxSize && lru.size() > 1)
+            remove(lru.back());
+    }
+    else
+    {
+        vlc_unlink(writer->tmppath.c_str());
+    }
+    vlc_mutex_unlock(&lock);
+
+    delete writer;
+}
+
+void SegmentCache::abort(SegmentCacheWriter *writer)
+{
+    delete writer;
+}
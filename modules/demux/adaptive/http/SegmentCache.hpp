@@ -0,0 +1,101 @@
+/*
+ * SegmentCache.hpp
+ *****************************************************************************
+ * Copyright (C) 2021 - VideoLAN and VLC Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef SEGMENTCACHE_HPP
+#define SEGMENTCACHE_HPP
+
+#include <vlc_common.h>
+
+#include <cstdio>
+#include <ctime>
+#include <map>
+#include <list>
+#include <string>
+
+namespace adaptive
+{
+    namespace http
+    {
+        class SegmentCache;
+
+        /* Stores a segment payload until committed to the cache */
+        class SegmentCacheWriter
+        {
+            friend class SegmentCache;
+
+            public:
+                ~SegmentCacheWriter();
+                bool write(const void *, size_t);
+
+            private:
+                SegmentCacheWriter(FILE *, const std::string &,
+                                   const std::string &);
+                FILE *stream;
+                std::string tmppath;
+                std::string hash;
+                uint64_t size;
+                bool failed;
+        };
+
+        /* Bounded on-disk LRU cache of segments, by URL and byte range.
+         * It persists in the user cache directory, and is shared by all
+         * the inputs of a libvlc instance. */
+        class SegmentCache
+        {
+            public:
+                static SegmentCache * Acquire(vlc_object_t *); /* NULL if disabled */
+                static void Release(SegmentCache *);
+
+                /* Returns the payload of a fresh entry, or NULL */
+                block_t * get(const std::string &key, std::string *contentType);
+                /* Returns NULL if the response must not be stored */
+                SegmentCacheWriter * store(const std::string &key,
+                                           const std::string &contentType,
+                                           const std::string &cacheControl,
+                                           uint64_t contentLength);
+                void commit(SegmentCacheWriter *);
+                void abort(SegmentCacheWriter *);
+
+                static bool isStorable(const std::string &cacheControl, time_t *expires);
+                /* Lifetime of the responses without freshness information, as
+                 * live servers can reuse segment names */
+                static const time_t DEFAULT_LIFETIME = 60;
+
+            private:
+                SegmentCache(vlc_object_t *, const std::string &, uint64_t);
+                ~SegmentCache();
+                void scan();
+                void remove(const std::string &);
+                std::string getPath(const std::string &) const;
+                static std::string getHash(const std::string &);
+
+                vlc_object_t *obj;
+                std::string directory;
+                uint64_t maxSize;
+                uint64_t totalSize;
+                unsigned refs;
+                /* entries sizes by hash, most recently used first */
+                std::map<std::string, uint64_t> entries;
+                std::list<std::string> lru;
+                vlc_mutex_t lock;
+        };
+    }
+}
+
+#endif // SEGMENTCACHE_HPP
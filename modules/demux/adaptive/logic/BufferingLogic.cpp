@@ -129,7 +129,15 @@ vlc_tick_t DefaultBufferingLogic::getMaxBuffering(const AbstractPlaylist *p) con
 vlc_tick_t DefaultBufferingLogic::getLiveDelay(const AbstractPlaylist *p) const
 {
     if(isLowLatency(p))
-        return getMinBuffering(p);
+    {
+        /* Aim at the service latency, within its bounds */
+        vlc_tick_t delay = p->targetLatency.Get();
+        if(p->maxLatency.Get() && delay > p->maxLatency.Get())
+            delay = p->maxLatency.Get();
+        if(delay < p->minLatency.Get())
+            delay = p->minLatency.Get();
+        return std::max(delay, getMinBuffering(p));
+    }
     vlc_tick_t delay = userLiveDelay ? userLiveDelay
                                      : DEFAULT_LIVE_BUFFERING;
     if(p->suggestedPresentationDelay.Get())
@@ -247,6 +255,16 @@ uint64_t DefaultBufferingLogic::getLiveStartSegmentNumber(BaseRepresentation *re
                 if(playbacktime < minavailtime)
                     playbacktime = minavailtime;
             }
+            /* Low latency segments are available before their end,
+             * start with the one containing the time ref */
+            const vlc_tick_t availabilityOffset = rep->inheritAvailabilityTimeOffset();
+            if(availabilityOffset)
+            {
+                start = std::min(mediaSegmentTemplate->getLiveTemplateNumber(playbacktime + duration),
+                                 mediaSegmentTemplate->getLiveTemplateNumber(now + availabilityOffset));
+                return std::max(start, startnumber);
+            }
+
             /* Get completed segment containing the time ref */
             start = mediaSegmentTemplate->getLiveTemplateNumber(playbacktime);
             if (unlikely(start < startnumber))
@@ -323,14 +341,20 @@ uint64_t DefaultBufferingLogic::getLiveStartSegmentNumber(BaseRepresentation *re
         stime_t tobuffer = std::min(maxbufferizable, timescale.ToScaled(i_buffering));
         stime_t skipduration = totallistduration - safeedgeduration - tobuffer ;
         uint64_t start = safestartnumber;
+        auto startit = list.begin();
         for(auto it = list.begin(); it != list.end(); ++it)
         {
             start = (*it)->getSequenceNumber();
+            startit = it;
             if((*it)->duration.Get() > skipduration)
                 break;
             skipduration -= (*it)->duration.Get();
         }
 
+        /* Partial segments can't all be decoded from */
+        while(startit != list.begin() && !(*startit)->independent)
+            start = (*--startit)->getSequenceNumber();
+
         return start;
     }
     else if(segmentBase)
@@ -0,0 +1,284 @@
+/*
+ * HybridAdaptationLogic.cpp
+ *****************************************************************************
+ * Copyright (C) 2021 - VideoLAN Authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "HybridAdaptationLogic.hpp"
+#include "Representationselectors.hpp"
+
+#include "../playlist/BaseAdaptationSet.h"
+#include "../playlist/BaseRepresentation.h"
+#include "../playlist/BasePeriod.h"
+#include "../http/Chunk.h"
+#include "../tools/Debug.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace adaptive::logic;
+using namespace adaptive;
+
+/*
+ * Buffer and throughput hybrid, for unstable and slow networks.
+ *
+ * The representation is selected from a conservative throughput estimate.
+ * Above the minimum buffering, BOLA (Near-Optimal Bitrate Adaptation for
+ * Online Videos, http://arxiv.org/abs/1601.06748) can keep a higher previous
+ * one from the buffering level, so that short drops do not cause switches.
+ * In both modes, a segment must be downloadable in half the buffered time,
+ * so that playback does not stall on a sudden drop.
+ */
+
+#define FAST_HALFLIFE VLC_TICK_FROM_SEC(3)
+#define SLOW_HALFLIFE VLC_TICK_FROM_SEC(8)
+#define SAFETY_FACTOR 0.9
+
+HybridContext::HybridContext()
+    : buffering_min( VLC_TICK_FROM_SEC(6) )
+    , buffering_level( 0 )
+    , buffering_target( VLC_TICK_FROM_SEC(30) )
+    , segment_duration( 0 )
+    , buffer_based( false )
+    , fast( 0 )
+    , slow( 0 )
+    , sampled( 0 )
+{ }
+
+void HybridContext::addSample(unsigned bps, vlc_tick_t time)
+{
+    /* weighted by the download time, so that short transfers matter less */
+    double alpha = std::pow(0.5, (double) time / FAST_HALFLIFE);
+    fast = alpha * fast + (1.0 - alpha) * bps;
+    alpha = std::pow(0.5, (double) time / SLOW_HALFLIFE);
+    slow = alpha * slow + (1.0 - alpha) * bps;
+    sampled += time;
+}
+
+unsigned HybridContext::getEstimate() const
+{
+    if(sampled == 0)
+        return 0;
+    /* unbias the averages from their zero start, and use the most pessimistic */
+    const double f = fast / (1.0 - std::pow(0.5, (double) sampled / FAST_HALFLIFE));
+    const double s = slow / (1.0 - std::pow(0.5, (double) sampled / SLOW_HALFLIFE));
+    return std::min(f, s);
+}
+
+HybridAdaptationLogic::HybridAdaptationLogic(vlc_object_t *obj)
+    : AbstractAdaptationLogic(obj)
+    , usedBps( 0 )
+{
+    vlc_mutex_init(&lock);
+}
+
+HybridAdaptationLogic::~HybridAdaptationLogic()
+{
+}
+
+BaseRepresentation *
+HybridAdaptationLogic::getBufferBased(BaseAdaptationSet *adaptSet, RepresentationSelector &selector,
+                                      const HybridContext &ctx) const
+{
+    BaseRepresentation *lowest = selector.lowest(adaptSet);
+    BaseRepresentation *highest = selector.highest(adaptSet);
+    if(lowest == highest || lowest->getBandwidth() == 0)
+        return highest;
+
+    /* utility is log(S/Smin) + 1, BOLA parameters from the buffering bounds */
+    const double Qmin = secf_from_vlc_tick(ctx.buffering_min);
+    /* the buffer is refilled once there is room for a whole segment */
+    const double Qmax = std::max(secf_from_vlc_tick(ctx.buffering_target - ctx.segment_duration),
+                                 Qmin + 1.0);
+    const double Q = secf_from_vlc_tick(ctx.buffering_level);
+    const double umax = std::log((double) highest->getBandwidth() / lowest->getBandwidth()) + 1.0;
+    const double gp = (umax - 1.0) / (Qmax / Qmin - 1.0);
+    const double V = Qmin / gp;
+
+    BaseRepresentation *ret = NULL;
+    BaseRepresentation *prev = NULL;
+    double argmax = 0;
+    for(BaseRepresentation *rep = lowest; rep && rep != prev; rep = selector.higher(adaptSet, rep))
+    {
+        const double u = std::log((double) rep->getBandwidth() / lowest->getBandwidth()) + 1.0;
+        const double arg = (V * (u + gp) - Q) / rep->getBandwidth();
+        if(ret == NULL || argmax <= arg)
+        {
+            ret = rep;
+            argmax = arg;
+        }
+        prev = rep;
+    }
+    return ret;
+}
+
+BaseRepresentation *HybridAdaptationLogic::getNextRepresentation(BaseAdaptationSet *adaptSet, BaseRepresentation *prevRep)
+{
+    RepresentationSelector selector(maxwidth, maxheight);
+
+    vlc_mutex_lock(&lock);
+
+    std::map<ID, HybridContext>::iterator it = streams.find(adaptSet->getID());
+    if(it == streams.end())
+    {
+        vlc_mutex_unlock(&lock);
+        return selector.lowest(adaptSet);
+    }
+
+    /* Streams share the link, the best estimate is the closest to its rate */
+    unsigned estimate = 0;
+    for(std::map<ID, HybridContext>::const_iterator it2 = streams.begin();
+                                                    it2 != streams.end(); ++it2)
+        estimate = std::max(estimate, (*it2).second.getEstimate());
+    if(estimate == 0)
+    {
+        vlc_mutex_unlock(&lock);
+        return selector.lowest(adaptSet);
+    }
+
+    HybridContext &ctx = (*it).second;
+    if(ctx.buffering_level < ctx.buffering_min)
+        ctx.buffer_based = false;
+    else if(ctx.buffering_level >= ctx.buffering_min + ctx.segment_duration)
+        ctx.buffer_based = true;
+    const HybridContext ctxcopy = ctx;
+
+    const uint64_t bps = getAvailableBw(estimate, prevRep) * SAFETY_FACTOR;
+
+    vlc_mutex_unlock(&lock);
+
+    BaseRepresentation *rep = selector.select(adaptSet, bps);
+    if(prevRep == NULL) /* Starting */
+        return rep;
+
+    if(ctxcopy.buffer_based)
+    {
+        /* Keeps up the previous quality as long as the buffer allows,
+         * instead of following every throughput drop */
+        BaseRepresentation *m = getBufferBased(adaptSet, selector, ctxcopy);
+        if(m->getBandwidth() > prevRep->getBandwidth())
+            m = prevRep;
+        if(m->getBandwidth() > rep->getBandwidth())
+            rep = m;
+    }
+
+    if(ctxcopy.segment_duration > 0)
+    {
+        const uint64_t maxbps = bps * ctxcopy.buffering_level / (2 * ctxcopy.segment_duration);
+        if(rep->getBandwidth() > maxbps)
+            rep = selector.select(adaptSet, maxbps);
+    }
+
+    BwDebug( msg_Info(p_obj, "buffering level %.2f%% (%s) rep %" PRIu64 " kBps %" PRIu64 " kBps",
+             (float) 100 * ctxcopy.buffering_level / ctxcopy.buffering_target,
+             ctxcopy.buffer_based ? "buffer" : "throughput",
+             rep->getBandwidth() / 8000, bps / 8000); );
+
+    return rep;
+}
+
+unsigned HybridAdaptationLogic::getAvailableBw(unsigned i_bw, const BaseRepresentation *curRep) const
+{
+    unsigned i_remain = i_bw;
+    if(i_remain > usedBps)
+        i_remain -= usedBps;
+    else
+        i_remain = 0;
+    if(curRep)
+        i_remain += curRep->getBandwidth();
+    return std::min(i_remain, i_bw);
+}
+
+void HybridAdaptationLogic::updateDownloadRate(const ID &id, size_t dlsize, vlc_tick_t time)
+{
+    if(unlikely(time == 0))
+        return;
+
+    vlc_mutex_lock(&lock);
+    std::map<ID, HybridContext>::iterator it = streams.find(id);
+    if(it != streams.end())
+        (*it).second.addSample(CLOCK_FREQ * dlsize * 8 / time, time);
+    vlc_mutex_unlock(&lock);
+}
+
+void HybridAdaptationLogic::trackerEvent(const SegmentTrackerEvent &event)
+{
+    switch(event.type)
+    {
+    case SegmentTrackerEvent::SWITCHING:
+        {
+            vlc_mutex_lock(&lock);
+            if(event.u.switching.prev)
+                usedBps -= event.u.switching.prev->getBandwidth();
+            if(event.u.switching.next)
+                usedBps += event.u.switching.next->getBandwidth();
+            BwDebug(msg_Info(p_obj, "New total bandwidth usage %u kBps", (usedBps / 8000)));
+            vlc_mutex_unlock(&lock);
+        }
+        break;
+
+    case SegmentTrackerEvent::BUFFERING_STATE:
+        {
+            const ID &id = *event.u.buffering.id;
+            vlc_mutex_lock(&lock);
+            if(event.u.buffering.enabled)
+            {
+                if(streams.find(id) == streams.end())
+                {
+                    HybridContext ctx;
+                    streams.insert(std::pair<ID, HybridContext>(id, ctx));
+                }
+            }
+            else
+            {
+                std::map<ID, HybridContext>::iterator it = streams.find(id);
+                if(it != streams.end())
+                    streams.erase(it);
+            }
+            vlc_mutex_unlock(&lock);
+        }
+        break;
+
+    case SegmentTrackerEvent::BUFFERING_LEVEL_CHANGE:
+        {
+            const ID &id = *event.u.buffering.id;
+            vlc_mutex_lock(&lock);
+            HybridContext &ctx = streams[id];
+            ctx.buffering_min = event.u.buffering_level.minimum;
+            ctx.buffering_level = event.u.buffering_level.current;
+            ctx.buffering_target = event.u.buffering_level.target;
+            vlc_mutex_unlock(&lock);
+        }
+        break;
+
+    case SegmentTrackerEvent::SEGMENT_CHANGE:
+        {
+            const ID &id = *event.u.segment.id;
+            vlc_mutex_lock(&lock);
+            HybridContext &ctx = streams[id];
+            ctx.segment_duration = event.u.segment.duration;
+            vlc_mutex_unlock(&lock);
+        }
+        break;
+
+    default:
+            break;
+    }
+}
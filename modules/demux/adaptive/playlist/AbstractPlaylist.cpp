@@ -47,6 +47,9 @@ AbstractPlaylist::AbstractPlaylist (vlc_object_t *p_object_) :
     maxBufferTime = 0;
     timeShiftBufferDepth.Set( 0 );
     suggestedPresentationDelay.Set( 0 );
+    targetLatency.Set( 0 );
+    minLatency.Set( 0 );
+    maxLatency.Set( 0 );
     b_needsUpdates = true;
 }
 
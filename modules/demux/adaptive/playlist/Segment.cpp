@@ -54,6 +54,7 @@ ISegment::ISegment(const ICanonicalUrl *parent):
     sequence = SEQUENCE_INVALID;
     templated = false;
     discontinuity = false;
+    independent = true;
 }
 
 ISegment::~ISegment()
@@ -89,6 +90,15 @@ SegmentChunk* ISegment::toChunk(SharedResources *res, AbstractConnectionManager
         if(startByte != endByte)
             source->setBytesRange(BytesRange(startByte, endByte));
 
+        /* Still being produced, and sent as chunked transfer */
+        if(!rep->inheritAvailabilityTimeComplete())
+            source->setIncremental(true);
+
+        /* Downloads are prioritised by playback time */
+        vlc_tick_t time, duration;
+        if(rep->getPlaybackTimeDurationBySegmentNumber(index, &time, &duration))
+            source->setDeadline(time);
+
         SegmentChunk *chunk = createChunk(source, rep);
         if(chunk)
         {
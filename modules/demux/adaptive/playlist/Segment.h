@@ -80,6 +80,7 @@ namespace adaptive
                 Property<stime_t>       startTime;
                 Property<stime_t>       duration;
                 bool                    discontinuity;
+                bool                    independent; /* can be decoded/switched from */
 
                 static const int CLASSID_ISEGMENT = 0;
 
@@ -178,7 +178,12 @@ stime_t MediaSegmentTemplate::getMinAheadScaledTime(uint64_t number) const
     if( segmentTimeline )
         return segmentTimeline->getMinAheadScaledTime(number);
 
-    uint64_t current = getLiveTemplateNumber(vlc_tick_from_sec(time(NULL)));
+    vlc_tick_t now = vlc_tick_from_sec(time(NULL));
+    if(parentSegmentInformation)
+        now += parentSegmentInformation->inheritAvailabilityTimeOffset();
+    uint64_t current = getLiveTemplateNumber(now);
+    if(current < number)
+        return 0;
     return (current - number) * inheritDuration();
 }
 
@@ -98,6 +98,7 @@ MPD * IsoffMainParser::parse()
     {
         parseMPDAttributes(mpd, root);
         parseProgramInformation(DOMHelper::getFirstChildElementByName(root, "ProgramInformation"), mpd);
+        parseServiceDescription(DOMHelper::getFirstChildElementByName(root, "ServiceDescription"), mpd);
         parseMPDBaseUrl(mpd, root);
         parsePeriods(mpd, root);
         mpd->debug();
@@ -550,6 +551,24 @@ void IsoffMainParser::parseProgramInformation(Node * node, MPD *mpd)
     }
 }
 
+void IsoffMainParser::parseServiceDescription(Node *node, MPD *mpd)
+{
+    if(!node)
+        return;
+
+    /* Latency is measured against the wall clock, in milliseconds */
+    Node *latency = DOMHelper::getFirstChildElementByName(node, "Latency");
+    if(latency)
+    {
+        if(latency->hasAttribute("target"))
+            mpd->targetLatency.Set(VLC_TICK_FROM_MS(Integer<uint64_t>(latency->getAttributeValue("target"))));
+        if(latency->hasAttribute("min"))
+            mpd->minLatency.Set(VLC_TICK_FROM_MS(Integer<uint64_t>(latency->getAttributeValue("min"))));
+        if(latency->hasAttribute("max"))
+            mpd->maxLatency.Set(VLC_TICK_FROM_MS(Integer<uint64_t>(latency->getAttributeValue("max"))));
+    }
+}
+
 Profile IsoffMainParser::getProfile() const
 {
     Profile res(Profile::Unknown);
@@ -32,6 +32,8 @@ HLSSegment::HLSSegment( ICanonicalUrl *parent, uint64_t seq ) :
 {
     setSequenceNumber(seq);
     utcTime = 0;
+    mediaSequence = seq;
+    partIndex = -1;
 }
 
 HLSSegment::~HLSSegment()
@@ -44,7 +46,7 @@ bool HLSSegment::prepareChunk(SharedResources *res, SegmentChunk *chunk, BaseRep
     {
         if (encryption.iv.size() != 16)
         {
-            uint64_t sequence = getSequenceNumber() - Segment::SEQUENCE_FIRST;
+            uint64_t sequence = mediaSequence;
             encryption.iv.clear();
             encryption.iv.resize(16);
             encryption.iv[15] = (sequence >> 0) & 0xff;
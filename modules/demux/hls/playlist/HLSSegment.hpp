@@ -43,6 +43,8 @@ namespace hls
 
             protected:
                 vlc_tick_t utcTime;
+                uint64_t mediaSequence; /* playlist sequence, can differ from our numbering */
+                int partIndex; /* partial segment number, -1 for whole segments */
                 virtual bool prepareChunk(SharedResources *, SegmentChunk *,
                                           BaseRepresentation *); /* reimpl */
         };
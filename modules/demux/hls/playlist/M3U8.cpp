@@ -67,6 +67,29 @@ bool M3U8::isLive() const
     return b_live;
 }
 
+bool M3U8::isLowLatency() const
+{
+    std::vector<BasePeriod *>::const_iterator itp;
+    for(itp = periods.begin(); itp != periods.end(); ++itp)
+    {
+        const BasePeriod *period = *itp;
+        std::vector<BaseAdaptationSet *>::const_iterator ita;
+        for(ita = period->getAdaptationSets().begin(); ita != period->getAdaptationSets().end(); ++ita)
+        {
+            BaseAdaptationSet *adaptSet = *ita;
+            std::vector<BaseRepresentation *>::iterator itr;
+            for(itr = adaptSet->getRepresentations().begin(); itr != adaptSet->getRepresentations().end(); ++itr)
+            {
+                const Representation *rep = dynamic_cast<const Representation *>(*itr);
+                if(rep->initialized() && rep->isLowLatency())
+                    return true;
+            }
+        }
+    }
+
+    return false;
+}
+
 void M3U8::debug()
 {
     std::vector<BasePeriod *>::const_iterator i;
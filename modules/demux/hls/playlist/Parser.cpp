@@ -151,7 +151,7 @@ void M3U8Parser::createAndFillRepresentation(vlc_object_t *p_obj, BaseAdaptation
 
 bool M3U8Parser::appendSegmentsFromPlaylistURI(vlc_object_t *p_obj, Representation *rep)
 {
-    block_t *p_block = Retrieve::HTTP(resources, rep->getPlaylistUrl().toString());
+    block_t *p_block = Retrieve::HTTP(resources, rep->getPlaylistRequestUrl());
     if(p_block)
     {
         stream_t *substream = vlc_stream_MemoryNew(p_obj, p_block->p_buffer, p_block->i_buffer, true);
@@ -205,6 +205,90 @@ static bool parseEncryption(const AttributesTag *keytag, const Url &playlistUrl,
     }
 }
 
+HLSSegment * M3U8Parser::createPart(Representation *rep, uint64_t sequence, int index,
+                                     const std::string &uri, double duration)
+{
+    HLSSegment *part = new (std::nothrow) HLSSegment(rep, sequence);
+    if(part)
+    {
+        part->partIndex = index;
+        part->setSourceUrl(uri);
+        part->duration.Set(duration * (uint64_t) rep->getTimescale());
+        /* segments are assumed to start on a keyframe */
+        part->independent = (index == 0);
+    }
+    return part;
+}
+
+void M3U8Parser::numberSegments(Representation *rep, SegmentList *list)
+{
+    /* Partial segments are only listed for the last segments, in place of
+     * these, so the playlist sequence can't be our number. Each reload is
+     * numbered from our previous list instead, for the known ones to keep
+     * their number and the new ones to follow without gaps. */
+    auto isAfter = [](const HLSSegment *a, const HLSSegment *b)
+    {
+        if(a->mediaSequence != b->mediaSequence)
+            return a->mediaSequence > b->mediaSequence;
+        return b->partIndex >= 0 && a->partIndex > b->partIndex;
+    };
+
+    const std::vector<ISegment *> &segments = list->getSegments();
+    const SegmentList *previous = rep->inheritSegmentList();
+    const HLSSegment *last = NULL;
+    if(previous && !previous->getSegments().empty())
+        last = dynamic_cast<const HLSSegment *>(previous->getSegments().back());
+    if(segments.empty())
+        return;
+
+    if(!last)
+    {
+        uint64_t number = static_cast<HLSSegment *>(segments.front())->mediaSequence;
+        for(ISegment *seg : segments)
+            seg->setSequenceNumber(number++);
+        return;
+    }
+
+    size_t newer = 0;
+    while(newer < segments.size() &&
+          !isAfter(static_cast<HLSSegment *>(segments[newer]), last))
+        newer++;
+
+    /* Known or older ones, only ordered below our last one */
+    uint64_t number = last->getSequenceNumber() - HLSSegment::SEQUENCE_FIRST;
+    for(size_t i = newer; i > 0; i--)
+    {
+        HLSSegment *seg = static_cast<HLSSegment *>(segments[i - 1]);
+        if(i < newer || seg->mediaSequence != last->mediaSequence ||
+           seg->partIndex != last->partIndex)
+            number = number ? number - 1 : 0;
+        seg->setSequenceNumber(number);
+    }
+
+    /* New ones follow */
+    const HLSSegment *prev = last;
+    number = last->getSequenceNumber() - HLSSegment::SEQUENCE_FIRST;
+    for(size_t i = newer; i < segments.size(); i++)
+    {
+        HLSSegment *seg = static_cast<HLSSegment *>(segments[i]);
+        seg->setSequenceNumber(++number);
+        if(i == newer)
+        {
+            /* we missed some */
+            const bool b_next = (seg->mediaSequence == prev->mediaSequence) ?
+                                  seg->partIndex == prev->partIndex + 1 :
+                                  seg->mediaSequence == prev->mediaSequence + 1 &&
+                                  seg->partIndex <= 0;
+            if(!b_next)
+                seg->discontinuity = true;
+        }
+        /* delta updates can leave out the date reference */
+        if(seg->utcTime == 0 && prev->utcTime)
+            seg->utcTime = prev->utcTime + rep->getTimescale().ToTime(prev->duration.Get());
+        prev = seg;
+    }
+}
+
 void M3U8Parser::parseSegments(vlc_object_t *, Representation *rep, const std::list<Tag *> &tagslist)
 {
     SegmentList *segmentList = new (std::nothrow) SegmentList(rep);
@@ -221,6 +305,12 @@ void M3U8Parser::parseSegments(vlc_object_t *, Representation *rep, const std::l
     const SingleValueTag *ctx_byterange = NULL;
     CommonEncryption encryption;
     const ValuesListTag *ctx_extinf = NULL;
+    /* partial segments of the current segment */
+    std::vector<HLSSegment *> parts;
+    int partIndex = 0;
+    vlc_tick_t nzPartsDuration = 0;
+    std::size_t prevpartbyterangeoffset = 0;
+    const AttributesTag *ctx_preloadhint = NULL;
 
     std::list<Tag *>::const_iterator it;
     for(it = tagslist.begin(); it != tagslist.end(); ++it)
@@ -277,6 +367,20 @@ void M3U8Parser::parseSegments(vlc_object_t *, Representation *rep, const std::l
                     absReferenceTime += nzDuration;
                 }
 
+                /* Listed partial segments replace the segment */
+                partIndex = 0;
+                nzPartsDuration = 0;
+                prevpartbyterangeoffset = 0;
+                if(!parts.empty())
+                {
+                    for(HLSSegment *part : parts)
+                        segmentList->addSegment(part);
+                    parts.clear();
+                    delete segment;
+                    ctx_byterange = NULL;
+                    break;
+                }
+
                 segmentList->addSegment(segment);
 
                 if(ctx_byterange)
@@ -346,6 +450,94 @@ void M3U8Parser::parseSegments(vlc_object_t *, Representation *rep, const std::l
             }
             break;
 
+            case AttributesTag::EXTXPART:
+            {
+                const AttributesTag *parttag = static_cast<const AttributesTag *>(tag);
+                const Attribute *uriAttr = parttag->getAttributeByName("URI");
+                const Attribute *durAttr = parttag->getAttributeByName("DURATION");
+                if(!uriAttr || !durAttr || !rep->partTarget)
+                    break;
+
+                const double duration = durAttr->floatingPoint();
+                const vlc_tick_t nzOffset = nzPartsDuration;
+                nzPartsDuration += vlc_tick_from_sec( duration );
+
+                const Attribute *gapAttr = parttag->getAttributeByName("GAP");
+                if(gapAttr && gapAttr->value == "YES")
+                {
+                    /* unavailable, skip it */
+                    partIndex++;
+                    discontinuity = true;
+                    break;
+                }
+
+                HLSSegment *part = createPart(rep, sequenceNumber, partIndex++,
+                                              uriAttr->quotedString(), duration);
+                if(!part)
+                    break;
+
+                part->startTime.Set(rep->getTimescale().ToScaled(nzStartTime + nzOffset));
+                if(absReferenceTime != VLC_TICK_INVALID)
+                    part->utcTime = absReferenceTime + nzOffset;
+
+                const Attribute *independentAttr = parttag->getAttributeByName("INDEPENDENT");
+                if(independentAttr && independentAttr->value == "YES")
+                    part->independent = true;
+
+                const Attribute *byterangeAttr = parttag->getAttributeByName("BYTERANGE");
+                if(byterangeAttr)
+                {
+                    std::pair<std::size_t,std::size_t> range = byterangeAttr->unescapeQuotes().getByteRange();
+                    if(range.first == 0) /* continues the previous part */
+                        range.first = prevpartbyterangeoffset;
+                    prevpartbyterangeoffset = range.first + range.second;
+                    part->setByteRange(range.first, prevpartbyterangeoffset - 1);
+                }
+
+                if(discontinuity)
+                {
+                    part->discontinuity = true;
+                    discontinuity = false;
+                }
+
+                if(encryption.method != CommonEncryption::Method::NONE)
+                    part->setEncryption(encryption);
+
+                parts.push_back(part);
+            }
+            break;
+
+            case AttributesTag::EXTXPARTINF:
+            {
+                const Attribute *targetAttr = static_cast<const AttributesTag *>(tag)->getAttributeByName("PART-TARGET");
+                if(targetAttr)
+                    rep->partTarget = vlc_tick_from_sec(targetAttr->floatingPoint());
+            }
+            break;
+
+            case AttributesTag::EXTXPRELOADHINT:
+                ctx_preloadhint = static_cast<const AttributesTag *>(tag);
+                break;
+
+            case AttributesTag::EXTXSERVERCONTROL:
+            {
+                const AttributesTag *controltag = static_cast<const AttributesTag *>(tag);
+                const Attribute *attr = controltag->getAttributeByName("CAN-BLOCK-RELOAD");
+                rep->b_canBlockReload = (attr && attr->value == "YES");
+                attr = controltag->getAttributeByName("CAN-SKIP-UNTIL");
+                rep->canSkipUntil = attr ? vlc_tick_from_sec(attr->floatingPoint()) : 0;
+            }
+            break;
+
+            case AttributesTag::EXTXSKIP:
+            {
+                /* Delta update, the oldest segments were left out */
+                const Attribute *skippedAttr = static_cast<const AttributesTag *>(tag)->getAttributeByName("SKIPPED-SEGMENTS");
+                if(skippedAttr)
+                    sequenceNumber += skippedAttr->decimal();
+            }
+            break;
+
             case Tag::EXTXDISCONTINUITY:
                 discontinuity  = true;
                 break;
@@ -356,6 +548,46 @@ void M3U8Parser::parseSegments(vlc_object_t *, Representation *rep, const std::l
         }
     }
 
+    /* Segment still being produced */
+    for(HLSSegment *part : parts)
+        segmentList->addSegment(part);
+
+    if(rep->partTarget)
+    {
+        /* The one the server will make available next, already requestable */
+        const Attribute *uriAttr;
+        if(ctx_preloadhint && ctx_preloadhint->getAttributeByName("TYPE") &&
+           ctx_preloadhint->getAttributeByName("TYPE")->value == "PART" &&
+           (uriAttr = ctx_preloadhint->getAttributeByName("URI")))
+        {
+            HLSSegment *part = createPart(rep, sequenceNumber, partIndex,
+                                          uriAttr->quotedString(),
+                                          secf_from_vlc_tick(rep->partTarget));
+            if(part)
+            {
+                part->startTime.Set(rep->getTimescale().ToScaled(nzStartTime + nzPartsDuration));
+                if(absReferenceTime != VLC_TICK_INVALID)
+                    part->utcTime = absReferenceTime + nzPartsDuration;
+                const Attribute *startAttr = ctx_preloadhint->getAttributeByName("BYTERANGE-START");
+                const Attribute *lengthAttr = ctx_preloadhint->getAttributeByName("BYTERANGE-LENGTH");
+                if(startAttr || lengthAttr)
+                {
+                    const std::size_t start = startAttr ? startAttr->decimal() : 0;
+                    part->setByteRange(start, lengthAttr ? start + lengthAttr->decimal() - 1 : 0);
+                }
+                if(encryption.method != CommonEncryption::Method::NONE)
+                    part->setEncryption(encryption);
+                segmentList->addSegment(part);
+            }
+        }
+
+        rep->nextMediaSequence = sequenceNumber;
+        rep->nextPartIndex = partIndex;
+        rep->lastUpdateTime = vlc_tick_now();
+        rep->b_consistent = false;
+        numberSegments(rep, segmentList);
+    }
+
     if(rep->isLive())
     {
         rep->getPlaylist()->duration.Set(0);
@@ -37,6 +37,7 @@ namespace adaptive
         class MediaSegmentTemplate;
         class BasePeriod;
         class BaseAdaptationSet;
+        class SegmentList;
     }
 }
 
@@ -50,6 +51,7 @@ namespace hls
         class AttributesTag;
         class Tag;
         class Representation;
+        class HLSSegment;
 
         class M3U8Parser
         {
@@ -65,6 +67,8 @@ namespace hls
                 void createAndFillRepresentation(vlc_object_t *, BaseAdaptationSet *,
                                                  const AttributesTag *, const std::list<Tag *>&);
                 void parseSegments(vlc_object_t *, Representation *, const std::list<Tag *>&);
+                HLSSegment * createPart(Representation *, uint64_t, int, const std::string &, double);
+                void numberSegments(Representation *, SegmentList *);
                 std::list<Tag *> parseEntries(stream_t *);
                 adaptive::SharedResources *resources;
         };
@@ -33,6 +33,8 @@
 #include "../../adaptive/playlist/SegmentList.h"
 
 #include <ctime>
+#include <sstream>
+#include <algorithm>
 #include <cassert>
 
 using namespace hls;
@@ -46,6 +48,12 @@ Representation::Representation  ( BaseAdaptationSet *set ) :
     b_failed = false;
     nextUpdateTime = 0;
     targetDuration = 0;
+    partTarget = 0;
+    b_canBlockReload = false;
+    canSkipUntil = 0;
+    nextMediaSequence = 0;
+    nextPartIndex = 0;
+    lastUpdateTime = 0;
     streamFormat = StreamFormat::UNKNOWN;
 }
 
@@ -63,6 +71,11 @@ bool Representation::isLive() const
     return b_live;
 }
 
+bool Representation::isLowLatency() const
+{
+    return b_live && partTarget > 0;
+}
+
 bool Representation::initialized() const
 {
     return b_loaded;
@@ -88,6 +101,39 @@ Url Representation::getPlaylistUrl() const
     }
 }
 
+std::string Representation::getPlaylistRequestUrl() const
+{
+    std::string uri = getPlaylistUrl().toString();
+    if(!b_loaded || !isLive())
+        return uri;
+
+    /* Low latency delivery directives */
+    std::ostringstream directives;
+    directives.imbue(std::locale("C"));
+    if(b_canBlockReload)
+    {
+        /* wait for the next partial segment (or segment) */
+        directives << "_HLS_msn=" << nextMediaSequence;
+        if(partTarget)
+            directives << "&_HLS_part=" << nextPartIndex;
+    }
+    /* only get the changes if ours is recent enough */
+    if(canSkipUntil &&
+       vlc_tick_now() - lastUpdateTime < canSkipUntil / 2)
+    {
+        if(!directives.str().empty())
+            directives << "&";
+        directives << "_HLS_skip=YES";
+    }
+
+    if(!directives.str().empty())
+    {
+        uri += (uri.find('?') == std::string::npos) ? "?" : "&";
+        uri += directives.str();
+    }
+    return uri;
+}
+
 void Representation::debug(vlc_object_t *obj, int indent) const
 {
     BaseRepresentation::debug(obj, indent);
@@ -130,12 +176,25 @@ void Representation::scheduleNextUpdate(uint64_t number, bool b_updated)
             minbuffer /= 2;
     }
 
+    /* Partial segments are added every part target. A blocking reload
+     * returns as soon as the next one is available, so it can be issued
+     * early, once we get close to the end of the list */
+    if(partTarget)
+    {
+        const vlc_tick_t ahead = getMinAheadTime(number);
+        if(ahead > 4 * partTarget)
+            minbuffer = std::min(minbuffer, ahead - 3 * partTarget);
+        else
+            minbuffer = b_canBlockReload ? partTarget / 2 : partTarget;
+    }
+
     nextUpdateTime = now + minbuffer;
 
-    msg_Dbg(playlist->getVLCObject(), "Updated playlist ID %s, next update in %" PRId64 "s",
-            getID().str().c_str(), SEC_FROM_VLC_TICK(nextUpdateTime - now));
+    msg_Dbg(playlist->getVLCObject(), "Updated playlist ID %s, next update in %" PRId64 "ms",
+            getID().str().c_str(), MS_FROM_VLC_TICK(nextUpdateTime - now));
 
-    debug(playlist->getVLCObject(), 0);
+    if(!partTarget)
+        debug(playlist->getVLCObject(), 0);
 }
 
 bool Representation::needsUpdate() const
@@ -45,7 +45,9 @@ namespace hls
 
                 void setPlaylistUrl(const std::string &);
                 Url getPlaylistUrl() const;
+                std::string getPlaylistRequestUrl() const;
                 bool isLive() const;
+                bool isLowLatency() const;
                 bool initialized() const;
                 virtual void scheduleNextUpdate(uint64_t, bool); /* reimpl */
                 virtual bool needsUpdate() const;  /* reimpl */
@@ -61,6 +63,13 @@ namespace hls
                 vlc_tick_t nextUpdateTime;
                 time_t targetDuration;
                 Url playlistUrl;
+                /* Low latency, partial segments and playlist delivery directives */
+                vlc_tick_t partTarget;
+                bool b_canBlockReload;
+                vlc_tick_t canSkipUntil;
+                uint64_t nextMediaSequence; /* next part to be listed */
+                int nextPartIndex;
+                vlc_tick_t lastUpdateTime;
         };
     }
 }
@@ -0,0 +1,604 @@
+/*****************************************************************************
+ * cluster_indexer.cpp : matroska demuxer
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "cluster_indexer.hpp"
+
+#include <vlc_stream.h>
+#include <vlc_configuration.h>
+#include <vlc_interrupt.h>
+#include <vlc_fs.h>
+#include <vlc_hash.h>
+#include <vlc_strings.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <limits>
+#include <sstream>
+
+namespace {
+    enum {
+        ID_SEGMENT         = 0x18538067,
+        ID_EBML            = 0x1A45DFA3,
+        ID_SEEKHEAD        = 0x114D9B74,
+        ID_INFO            = 0x1549A966,
+        ID_TRACKS          = 0x1654AE6B,
+        ID_CUES            = 0x1C53BB6B,
+        ID_TAGS            = 0x1254C367,
+        ID_CHAPTERS        = 0x1043A770,
+        ID_ATTACHMENTS     = 0x1941A469,
+        ID_CLUSTER         = 0x1F43B675,
+        ID_TIMECODE        = 0xE7,
+        ID_SIMPLEBLOCK     = 0xA3,
+        ID_BLOCKGROUP      = 0xA0,
+        ID_BLOCK           = 0xA1,
+        ID_REFERENCEBLOCK  = 0xFB,
+    };
+
+    struct Element
+    {
+        uint32_t id;
+        uint64_t pos;
+        uint64_t data;
+        uint64_t size;
+        bool     b_unknown_size;
+    };
+
+    /* returns the length of the variable size integer starting with i_first */
+    unsigned vint_length( uint8_t i_first )
+    {
+        for( unsigned i = 0; i < 8; i++ )
+        {
+            if( i_first & ( 0x80 >> i ) )
+                return i + 1;
+        }
+        return 0;
+    }
+
+    bool ReadElement( stream_t *s, uint64_t i_pos, Element *p_el )
+    {
+        const uint8_t *p_peek;
+
+        if( vlc_stream_Tell( s ) != i_pos && vlc_stream_Seek( s, i_pos ) )
+            return false;
+
+        ssize_t i_peek = vlc_stream_Peek( s, &p_peek, 12 );
+        if( i_peek < 2 )
+            return false;
+
+        unsigned i_id_len = vint_length( p_peek[0] );
+        if( i_id_len == 0 || i_id_len > 4 || i_peek < i_id_len + 1 )
+            return false;
+
+        unsigned i_size_len = vint_length( p_peek[i_id_len] );
+        if( i_size_len == 0 || i_peek < i_id_len + i_size_len )
+            return false;
+
+        p_el->id = 0;
+        for( unsigned i = 0; i < i_id_len; i++ )
+            p_el->id = ( p_el->id << 8 ) | p_peek[i];
+
+        p_el->size = p_peek[i_id_len] & ( 0xFF >> i_size_len );
+        for( unsigned i = 1; i < i_size_len; i++ )
+            p_el->size = ( p_el->size << 8 ) | p_peek[i_id_len + i];
+
+        p_el->b_unknown_size = p_el->size == ( UINT64_C(1) << ( 7 * i_size_len ) ) - 1;
+        p_el->pos  = i_pos;
+        p_el->data = i_pos + i_id_len + i_size_len;
+        return true;
+    }
+
+    /* Reads the track number and the relative timecode of a (Simple)Block */
+    bool ReadBlockHeader( stream_t *s, Element const& el,
+                          unsigned *pi_track, int16_t *pi_timecode, uint8_t *pi_flags )
+    {
+        const uint8_t *p_peek;
+
+        if( vlc_stream_Tell( s ) != el.data && vlc_stream_Seek( s, el.data ) )
+            return false;
+
+        ssize_t i_peek = vlc_stream_Peek( s, &p_peek, 11 );
+        unsigned i_len = i_peek > 0 ? vint_length( p_peek[0] ) : 0;
+        if( i_len == 0 || i_len > 4 || i_peek < i_len + 3 || el.size < i_len + 3 )
+            return false;
+
+        unsigned i_track = p_peek[0] & ( 0xFF >> i_len );
+        for( unsigned i = 1; i < i_len; i++ )
+            i_track = ( i_track << 8 ) | p_peek[i];
+
+        *pi_track    = i_track;
+        *pi_timecode = (int16_t) GetWBE( &p_peek[i_len] );
+        *pi_flags    = p_peek[i_len + 2];
+        return true;
+    }
+
+    bool ReadUInteger( stream_t *s, Element const& el, uint64_t *pi_value )
+    {
+        uint8_t p_buf[8];
+
+        if( el.size > sizeof(p_buf) ||
+            vlc_stream_Seek( s, el.data ) ||
+            vlc_stream_Read( s, p_buf, el.size ) != (ssize_t) el.size )
+            return false;
+
+        *pi_value = 0;
+        for( size_t i = 0; i < el.size; i++ )
+            *pi_value = ( *pi_value << 8 ) | p_buf[i];
+        return true;
+    }
+
+    /* elements ending a Cluster of unknown size */
+    bool IsTopLevel( uint32_t id )
+    {
+        switch( id )
+        {
+            case ID_SEGMENT:
+            case ID_EBML:
+            case ID_SEEKHEAD:
+            case ID_INFO:
+            case ID_TRACKS:
+            case ID_CUES:
+            case ID_TAGS:
+            case ID_CHAPTERS:
+            case ID_ATTACHMENTS:
+            case ID_CLUSTER:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    const char cache_magic[8] = { 'V', 'L', 'C', 'M', 'K', 'V', 'X', '1' };
+    const size_t cache_header_size = 8 + 8 * 4 + 4 * 2;
+    const size_t cache_cluster_size = 8 * 3;
+    const size_t cache_keyframe_size = 4 + 8 * 2;
+}
+
+namespace mkv {
+
+ClusterIndexer::ClusterIndexer( demux_t *p_demux_, const char *psz_url, uint64_t i_file_size_,
+                                uint64_t i_timescale_, fptr_t i_start_, fptr_t i_end_,
+                                track_ids_t const& tracks_ )
+    :p_demux( p_demux_ )
+    ,url( psz_url )
+    ,i_file_size( i_file_size_ )
+    ,i_timescale( i_timescale_ )
+    ,i_start( i_start_ )
+    ,i_end( i_end_ )
+    ,tracks( tracks_ )
+    ,b_running( false )
+    ,b_abort( false )
+    ,b_done( false )
+    ,b_complete( false )
+    ,b_cache( false )
+    ,b_interrupted( false )
+    ,i_indexed_end( i_start_ )
+    ,i_indexed_pts( VLC_TICK_INVALID )
+    ,i_clusters_sent( 0 )
+    ,i_keyframes_sent( 0 )
+{
+    vlc_mutex_init( &lock );
+    vlc_cond_init( &wait );
+}
+
+ClusterIndexer::~ClusterIndexer()
+{
+    if( b_running )
+    {
+        vlc_mutex_lock( &lock );
+        b_abort = true;
+        vlc_mutex_unlock( &lock );
+
+        vlc_join( thread, NULL );
+    }
+}
+
+bool ClusterIndexer::Start( bool b_cache_ )
+{
+    b_cache = b_cache_;
+
+    if( b_cache && LoadCache() )
+    {
+        msg_Dbg( p_demux, "loaded the index of %zu clusters from the cache", clusters.size() );
+        return true;
+    }
+
+    if( vlc_clone( &thread, IndexerThread, this, VLC_THREAD_PRIORITY_LOW ) )
+        return false;
+
+    b_running = true;
+    return true;
+}
+
+void ClusterIndexer::Interrupt( void *p_data )
+{
+    ClusterIndexer *p_this = static_cast<ClusterIndexer *>( p_data );
+
+    vlc_mutex_locker locker( &p_this->lock );
+    p_this->b_interrupted = true;
+    vlc_cond_signal( &p_this->wait );
+}
+
+bool ClusterIndexer::Get( vlc_tick_t i_pts, clusters_t & new_clusters,
+                          keyframes_t & new_keyframes, fptr_t *pi_end )
+{
+    /* the input thread may stop while a seek waits for the index */
+    b_interrupted = false;
+    vlc_interrupt_register( Interrupt, this );
+    vlc_mutex_lock( &lock );
+
+    while( !b_done && !b_interrupted &&
+           ( i_indexed_pts == VLC_TICK_INVALID || i_indexed_pts <= i_pts ) )
+        vlc_cond_wait( &wait, &lock );
+
+    new_clusters.insert( new_clusters.end(), clusters.begin() + i_clusters_sent, clusters.end() );
+    new_keyframes.insert( new_keyframes.end(), keyframes.begin() + i_keyframes_sent, keyframes.end() );
+    i_clusters_sent = clusters.size();
+    i_keyframes_sent = keyframes.size();
+
+    // nothing is left to search past a complete index
+    *pi_end = b_complete ? std::numeric_limits<fptr_t>::max() - 1 : i_indexed_end;
+
+    const bool b_ret = b_done;
+    vlc_mutex_unlock( &lock );
+    vlc_interrupt_unregister();
+    return b_ret;
+}
+
+void *ClusterIndexer::IndexerThread( void *p_data )
+{
+    static_cast<ClusterIndexer *>( p_data )->IndexerThread();
+    return NULL;
+}
+
+void ClusterIndexer::IndexerThread()
+{
+    bool b_eos = false;
+    vlc_tick_t i_start_time = vlc_tick_now();
+    stream_t *s = vlc_stream_NewURL( p_demux, url.c_str() );
+
+    if( s != NULL && (uint64_t) stream_Size( s ) != i_file_size )
+    {
+        vlc_stream_Delete( s );
+        s = NULL;
+    }
+    if( s == NULL )
+        msg_Warn( p_demux, "cannot index clusters of %s", url.c_str() );
+
+    for( fptr_t i_pos = i_start; s != NULL; )
+    {
+        Element el;
+
+        if( i_pos >= i_end || !ReadElement( s, i_pos, &el ) )
+        {
+            const uint8_t *p_peek;
+            /* recordings may end with a truncated element */
+            b_eos = i_pos >= i_end || i_pos >= (uint64_t) stream_Size( s ) ||
+                    vlc_stream_Peek( s, &p_peek, 12 ) < 12;
+            break;
+        }
+
+        if( el.id == ID_SEGMENT || el.id == ID_EBML )
+        {
+            /* another segment follows */
+            b_eos = true;
+            break;
+        }
+
+        if( el.id != ID_CLUSTER )
+        {
+            if( el.b_unknown_size )
+                break;
+            i_pos = el.data + el.size;
+            continue;
+        }
+
+        Cluster cluster;
+        keyframes_t cluster_keyframes;
+        fptr_t i_next;
+
+        if( !ParseCluster( s, el.pos, el.b_unknown_size,
+                           el.b_unknown_size ? i_end : std::min<fptr_t>( el.data + el.size, i_end ),
+                           cluster, cluster_keyframes, &i_next ) )
+        {
+            if( i_next <= el.data )
+                break;
+            i_pos = i_next;
+            continue;
+        }
+
+        vlc_mutex_locker locker( &lock );
+        if( b_abort )
+            break;
+
+        clusters.push_back( cluster );
+        keyframes.insert( keyframes.end(), cluster_keyframes.begin(), cluster_keyframes.end() );
+        i_indexed_end = i_next;
+        i_indexed_pts = cluster.pts;
+        vlc_cond_signal( &wait );
+
+        i_pos = i_next;
+    }
+
+    if( s != NULL )
+        vlc_stream_Delete( s );
+
+    vlc_mutex_lock( &lock );
+    b_complete = b_eos && !b_abort;
+    b_done = true;
+    vlc_cond_signal( &wait );
+    vlc_mutex_unlock( &lock );
+
+    if( b_complete )
+    {
+        msg_Dbg( p_demux, "indexed %zu clusters in %" PRId64 " ms", clusters.size(),
+                 MS_FROM_VLC_TICK( vlc_tick_now() - i_start_time ) );
+        if( b_cache )
+            StoreCache();
+    }
+}
+
+/* Only the first keyframe of each track is kept per cluster, like in Cues,
+ * as audio tracks are made of keyframes only */
+bool ClusterIndexer::ParseCluster( stream_t *s, fptr_t i_pos, bool b_unknown_size,
+                                   fptr_t i_cluster_end, Cluster & cluster,
+                                   keyframes_t & cluster_keyframes, fptr_t *pi_next ) const
+{
+    Element el;
+    bool b_timecode = false;
+    uint64_t i_timecode = 0;
+    track_ids_t found_tracks;
+
+    if( !ReadElement( s, i_pos, &el ) )
+    {
+        *pi_next = i_pos;
+        return false;
+    }
+
+    fptr_t i_child_pos = el.data;
+    while( i_child_pos < i_cluster_end )
+    {
+        Element child;
+        unsigned i_track = 0;
+        int16_t i_block_timecode = 0;
+        uint8_t i_flags;
+        fptr_t i_block_pos = 0;
+        bool b_key = false;
+
+        if( !ReadElement( s, i_child_pos, &child ) ||
+            ( b_unknown_size && IsTopLevel( child.id ) ) ||
+            child.b_unknown_size )
+            break;
+
+        switch( child.id )
+        {
+            case ID_TIMECODE:
+                b_timecode = ReadUInteger( s, child, &i_timecode );
+                break;
+
+            case ID_SIMPLEBLOCK:
+                i_block_pos = child.pos;
+                b_key = ReadBlockHeader( s, child, &i_track, &i_block_timecode, &i_flags ) &&
+                        ( i_flags & 0x80 );
+                break;
+
+            case ID_BLOCKGROUP:
+            {
+                bool b_reference = false;
+
+                for( fptr_t i_group_pos = child.data; i_group_pos < child.data + child.size; )
+                {
+                    Element group_child;
+
+                    if( !ReadElement( s, i_group_pos, &group_child ) || group_child.b_unknown_size )
+                        break;
+
+                    if( group_child.id == ID_BLOCK &&
+                        ReadBlockHeader( s, group_child, &i_track, &i_block_timecode, &i_flags ) )
+                        i_block_pos = group_child.pos;
+                    else if( group_child.id == ID_REFERENCEBLOCK )
+                        b_reference = true;
+
+                    i_group_pos = group_child.data + group_child.size;
+                }
+                b_key = i_block_pos != 0 && !b_reference;
+                break;
+            }
+        }
+
+        if( b_key && b_timecode &&
+            std::find( tracks.begin(), tracks.end(), i_track ) != tracks.end() &&
+            std::find( found_tracks.begin(), found_tracks.end(), i_track ) == found_tracks.end() )
+        {
+            Keyframe keyframe = {
+                /* track_id */ i_track,
+                /* fpos     */ i_block_pos,
+                /* pts      */ VLC_TICK_FROM_NS( ( (int64_t) i_timecode + i_block_timecode ) * (int64_t) i_timescale ),
+            };
+            cluster_keyframes.push_back( keyframe );
+            found_tracks.push_back( i_track );
+        }
+
+        i_child_pos = child.data + child.size;
+    }
+
+    *pi_next = b_unknown_size ? i_child_pos : el.data + el.size;
+
+    cluster.fpos = el.pos;
+    cluster.pts  = VLC_TICK_FROM_NS( i_timecode * i_timescale );
+    cluster.size = *pi_next - el.pos;
+
+    return b_timecode;
+}
+
+std::string ClusterIndexer::CachePath( bool b_create ) const
+{
+    char *psz_cachedir = config_GetUserDir( VLC_CACHE_DIR );
+    if( psz_cachedir == NULL )
+        return std::string();
+
+    const std::string dir = std::string( psz_cachedir ) + DIR_SEP "mkv";
+    if( b_create )
+    {
+        vlc_mkdir( psz_cachedir, 0700 );
+        if( vlc_mkdir( dir.c_str(), 0700 ) != 0 && errno != EEXIST )
+        {
+            free( psz_cachedir );
+            return std::string();
+        }
+    }
+    free( psz_cachedir );
+
+    std::ostringstream key;
+    key.imbue( std::locale( "C" ) );
+    key << url << '\n' << i_file_size << '\n' << i_start;
+
+    vlc_hash_md5_t md5;
+    uint8_t digest[VLC_HASH_MD5_DIGEST_SIZE];
+    char hex[VLC_HASH_MD5_DIGEST_HEX_SIZE];
+
+    vlc_hash_md5_Init( &md5 );
+    vlc_hash_md5_Update( &md5, key.str().c_str(), key.str().length() );
+    vlc_hash_md5_Finish( &md5, digest, sizeof(digest) );
+    vlc_hex_encode_binary( digest, sizeof(digest), hex );
+
+    return dir + DIR_SEP + hex;
+}
+
+bool ClusterIndexer::LoadCache()
+{
+    const std::string path = CachePath( false );
+    if( path.empty() )
+        return false;
+
+    FILE *stream = vlc_fopen( path.c_str(), "rb" );
+    if( stream == NULL )
+        return false;
+
+    uint8_t p_buf[cache_header_size];
+    bool b_ok = fread( p_buf, 1, cache_header_size, stream ) == cache_header_size &&
+                !memcmp( p_buf, cache_magic, sizeof(cache_magic) ) &&
+                GetQWBE( &p_buf[8] ) == i_file_size &&
+                GetQWBE( &p_buf[16] ) == i_start &&
+                GetQWBE( &p_buf[24] ) == i_end &&
+                GetQWBE( &p_buf[32] ) == i_timescale;
+
+    if( b_ok )
+    {
+        const uint32_t i_clusters = GetDWBE( &p_buf[40] );
+        const uint32_t i_keyframes = GetDWBE( &p_buf[44] );
+
+        /* each entry is at least an element header in the file */
+        b_ok = i_clusters <= ( i_end - i_start ) / 2 && i_keyframes <= ( i_end - i_start ) / 2;
+
+        for( uint32_t i = 0; b_ok && i < i_clusters; i++ )
+        {
+            b_ok = fread( p_buf, 1, cache_cluster_size, stream ) == cache_cluster_size;
+            Cluster cluster = {
+                /* fpos */ GetQWBE( &p_buf[0] ),
+                /* pts  */ (vlc_tick_t) GetQWBE( &p_buf[8] ),
+                /* size */ GetQWBE( &p_buf[16] ),
+            };
+            clusters.push_back( cluster );
+        }
+
+        for( uint32_t i = 0; b_ok && i < i_keyframes; i++ )
+        {
+            b_ok = fread( p_buf, 1, cache_keyframe_size, stream ) == cache_keyframe_size;
+            Keyframe keyframe = {
+                /* track_id */ GetDWBE( &p_buf[0] ),
+                /* fpos     */ GetQWBE( &p_buf[4] ),
+                /* pts      */ (vlc_tick_t) GetQWBE( &p_buf[12] ),
+            };
+            keyframes.push_back( keyframe );
+        }
+    }
+    fclose( stream );
+
+    if( !b_ok )
+    {
+        msg_Warn( p_demux, "discarding stale index cache %s", path.c_str() );
+        vlc_unlink( path.c_str() );
+        clusters.clear();
+        keyframes.clear();
+        return false;
+    }
+
+    b_done = b_complete = true;
+    return true;
+}
+
+void ClusterIndexer::StoreCache()
+{
+    const std::string path = CachePath( true );
+    if( path.empty() )
+        return;
+
+    const std::string tmppath = path + ".XXXXXX";
+    std::vector<char> tmpl( tmppath.begin(), tmppath.end() );
+    tmpl.push_back( '\0' );
+
+    int fd = vlc_mkstemp( &tmpl[0] );
+    if( fd == -1 )
+        return;
+    FILE *stream = fdopen( fd, "wb" );
+    if( stream == NULL )
+    {
+        vlc_close( fd );
+        vlc_unlink( &tmpl[0] );
+        return;
+    }
+
+    uint8_t p_buf[cache_header_size];
+    memcpy( p_buf, cache_magic, sizeof(cache_magic) );
+    SetQWBE( &p_buf[8], i_file_size );
+    SetQWBE( &p_buf[16], i_start );
+    SetQWBE( &p_buf[24], i_end );
+    SetQWBE( &p_buf[32], i_timescale );
+    SetDWBE( &p_buf[40], clusters.size() );
+    SetDWBE( &p_buf[44], keyframes.size() );
+    bool b_ok = fwrite( p_buf, 1, cache_header_size, stream ) == cache_header_size;
+
+    for( clusters_t::const_iterator it = clusters.begin(); b_ok && it != clusters.end(); ++it )
+    {
+        SetQWBE( &p_buf[0], it->fpos );
+        SetQWBE( &p_buf[8], it->pts );
+        SetQWBE( &p_buf[16], it->size );
+        b_ok = fwrite( p_buf, 1, cache_cluster_size, stream ) == cache_cluster_size;
+    }
+
+    for( keyframes_t::const_iterator it = keyframes.begin(); b_ok && it != keyframes.end(); ++it )
+    {
+        SetDWBE( &p_buf[0], it->track_id );
+        SetQWBE( &p_buf[4], it->fpos );
+        SetQWBE( &p_buf[12], it->pts );
+        b_ok = fwrite( p_buf, 1, cache_keyframe_size, stream ) == cache_keyframe_size;
+    }
+
+    if( fclose( stream ) != 0 )
+        b_ok = false;
+
+    if( !b_ok || vlc_rename( &tmpl[0], path.c_str() ) != 0 )
+    {
+        msg_Warn( p_demux, "cannot store the index cache %s", path.c_str() );
+        vlc_unlink( &tmpl[0] );
+    }
+}
+
+} // namespace
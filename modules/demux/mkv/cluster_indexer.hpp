@@ -0,0 +1,120 @@
+/*****************************************************************************
+ * cluster_indexer.hpp : matroska demuxer
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef MKV_CLUSTER_INDEXER_HPP_
+#define MKV_CLUSTER_INDEXER_HPP_
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_demux.h>
+#include <vlc_threads.h>
+
+#include <string>
+#include <vector>
+
+namespace mkv {
+
+/* Builds the index of a segment without Cues, in background.
+ *
+ * Only the cluster headers and the block headers are read, from a stream of
+ * its own, so that the demuxer can seek before the whole file is indexed. */
+class ClusterIndexer
+{
+    public:
+        typedef uint64_t fptr_t;
+        typedef unsigned int track_id_t;
+
+        struct Cluster
+        {
+            fptr_t     fpos;
+            vlc_tick_t pts;
+            fptr_t     size;
+        };
+
+        struct Keyframe
+        {
+            track_id_t track_id;
+            fptr_t     fpos;
+            vlc_tick_t pts;
+        };
+
+        typedef std::vector<Cluster>  clusters_t;
+        typedef std::vector<Keyframe> keyframes_t;
+        typedef std::vector<track_id_t> track_ids_t;
+
+        ClusterIndexer( demux_t *, const char *psz_url, uint64_t i_file_size,
+                        uint64_t i_timescale, fptr_t i_start, fptr_t i_end,
+                        track_ids_t const& );
+        ~ClusterIndexer();
+
+        /* Loads the index from the cache, or starts indexing */
+        bool Start( bool b_cache );
+
+        /* Waits until the index reaches i_pts, then returns the entries found
+         * since the previous call, and the end of the indexed range.
+         * Returns true once everything was returned. The wait is interruptible:
+         * if the calling thread is interrupted, only the entries found so far
+         * are returned. */
+        bool Get( vlc_tick_t i_pts, clusters_t &, keyframes_t &, fptr_t *pi_end );
+        fptr_t start() const { return i_start; }
+
+    private:
+        static void *IndexerThread( void * );
+        static void Interrupt( void * );
+        void IndexerThread();
+        bool ParseCluster( stream_t *, fptr_t i_pos, bool b_unknown_size, fptr_t i_cluster_end,
+                           Cluster &, keyframes_t &, fptr_t *pi_next ) const;
+
+        bool LoadCache();
+        void StoreCache();
+        std::string CachePath( bool b_create ) const;
+
+        demux_t      *p_demux;
+        std::string   url;
+        uint64_t      i_file_size;
+        uint64_t      i_timescale;
+        fptr_t        i_start;
+        fptr_t        i_end;
+        track_ids_t   tracks;
+
+        vlc_thread_t  thread;
+        vlc_mutex_t   lock;
+        vlc_cond_t    wait;
+        bool          b_running;
+        bool          b_abort;
+        bool          b_done;
+        bool          b_complete;
+        bool          b_cache;
+        bool          b_interrupted;
+
+        clusters_t    clusters;
+        keyframes_t   keyframes;
+        fptr_t        i_indexed_end;
+        vlc_tick_t    i_indexed_pts;
+        size_t        i_clusters_sent;
+        size_t        i_keyframes_sent;
+};
+
+} // namespace
+
+#endif /* include-guard */
@@ -685,7 +685,10 @@ bool matroska_segment_c::Preload( )
     b_preloaded = true;
 
     if( cluster )
+    {
         EnsureDuration();
+        StartClusterIndexer();
+    }
 
     return true;
 }
@@ -835,6 +838,8 @@ bool matroska_segment_c::Seek( demux_t &demuxer, vlc_tick_t i_absolute_mk_date,
 
     // find appropriate seekpoints //
 
+    UpdateClusterIndex( i_mk_date );
+
     try {
         seekpoints = _seeker.get_seekpoints( *this, i_mk_date, priority, selected_tracks );
     }
@@ -1003,6 +1008,50 @@ void matroska_segment_c::ComputeTrackPriority()
     }
 }
 
+void matroska_segment_c::StartClusterIndexer()
+{
+    if( b_cues || !sys.b_fastseekable )
+        return;
+
+    vlc_stream_io_callback *io_callback = dynamic_cast<vlc_stream_io_callback *>( &es.I_O() );
+    stream_t *s = io_callback ? io_callback->stream() : NULL;
+    if( s == NULL || s->psz_url == NULL )
+        return;
+
+    uint64_t i_size = stream_Size( s );
+    SegmentSeeker::fptr_t i_end = segment->IsFiniteSize() ? segment->GetEndPosition() : i_size;
+    ClusterIndexer::track_ids_t track_ids;
+
+    for( tracks_map_t::const_iterator it = tracks.begin(); it != tracks.end(); ++it )
+        track_ids.push_back( it->first );
+
+    _indexer.reset( new (std::nothrow) ClusterIndexer( &sys.demuxer, s->psz_url, i_size, i_timescale,
+                                                       cluster->GetElementPosition(), i_end, track_ids ) );
+    if( _indexer && !_indexer->Start( var_InheritBool( &sys.demuxer, "mkv-index-cache" ) ) )
+    {
+        msg_Warn( &sys.demuxer, "cannot index clusters in background" );
+        _indexer.reset();
+    }
+}
+
+void matroska_segment_c::UpdateClusterIndex( vlc_tick_t i_mk_date )
+{
+    if( !_indexer )
+        return;
+
+    ClusterIndexer::clusters_t  clusters;
+    ClusterIndexer::keyframes_t keyframes;
+    SegmentSeeker::fptr_t       i_end;
+
+    // wait for the index to cover the date, rather than scanning for it //
+
+    bool b_done = _indexer->Get( i_mk_date, clusters, keyframes, &i_end );
+    _seeker.add_cluster_index( clusters, keyframes, SegmentSeeker::Range( _indexer->start(), i_end ) );
+
+    if( b_done )
+        _indexer.reset();
+}
+
 void matroska_segment_c::EnsureDuration()
 {
     if ( i_duration > 0 )
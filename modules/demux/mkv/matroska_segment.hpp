@@ -172,8 +172,11 @@ private:
     bool TrackInit( mkv_track_t * p_tk );
     void ComputeTrackPriority();
     void EnsureDuration();
+    void StartClusterIndexer();
+    void UpdateClusterIndex( vlc_tick_t i_mk_date );
 
     SegmentSeeker _seeker;
+    std::unique_ptr<ClusterIndexer> _indexer; /* only without Cues */
 
     friend SegmentSeeker;
 };
@@ -80,6 +80,10 @@ vlc_module_begin ()
             N_("Preload clusters"),
             N_("Find all cluster positions by jumping cluster-to-cluster before playback"), true );
 
+    add_bool( "mkv-index-cache", false,
+            N_("Cache the index of files without cues"),
+            N_("Store the index built for files without cues in the user cache directory, so that seeking is instant when they are opened again."), true );
+
     add_shortcut( "mka", "mkv" )
 vlc_module_end ()
 
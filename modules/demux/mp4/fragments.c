@@ -36,11 +36,14 @@ void MP4_Fragments_Index_Delete( mp4_fragments_index_t *p_index )
 
 mp4_fragments_index_t * MP4_Fragments_Index_New( unsigned i_tracks, unsigned i_num )
 {
-    if( !i_tracks || !i_num || SIZE_MAX / i_num < i_tracks )
+    if( !i_tracks || (i_num && SIZE_MAX / i_num < i_tracks) )
         return NULL;
-    mp4_fragments_index_t *p_index = malloc( sizeof(*p_index) );
+    mp4_fragments_index_t *p_index = calloc( 1, sizeof(*p_index) );
     if( p_index )
     {
+        p_index->i_tracks = i_tracks;
+        if( !i_num ) /* empty, to append to */
+            return p_index;
         p_index->p_times = calloc( (size_t)i_num * i_tracks, sizeof(*p_index->p_times) );
         p_index->pi_pos = calloc( i_num, sizeof(*p_index->pi_pos) );
         if( !p_index->p_times || !p_index->pi_pos )
@@ -49,12 +52,42 @@ mp4_fragments_index_t * MP4_Fragments_Index_New( unsigned i_tracks, unsigned i_n
             return NULL;
         }
         p_index->i_entries = i_num;
-        p_index->i_last_time = 0;
-        p_index->i_tracks = i_tracks;
+        p_index->i_allocated = i_num;
     }
     return p_index;
 }
 
+int MP4_Fragments_Index_Append( mp4_fragments_index_t *p_index, uint64_t i_pos,
+                                const stime_t *p_times )
+{
+    if( p_index->i_entries == p_index->i_allocated )
+    {
+        unsigned i_allocated = p_index->i_allocated ? p_index->i_allocated * 2 : 64;
+        if( i_allocated < p_index->i_allocated ||
+            SIZE_MAX / i_allocated < p_index->i_tracks )
+            return VLC_ENOMEM;
+
+        uint64_t *pi_pos = vlc_reallocarray( p_index->pi_pos, i_allocated,
+                                             sizeof(*pi_pos) );
+        if( !pi_pos )
+            return VLC_ENOMEM;
+        p_index->pi_pos = pi_pos;
+
+        stime_t *p_alloctimes = vlc_reallocarray( p_index->p_times,
+                                    (size_t)i_allocated * p_index->i_tracks,
+                                    sizeof(*p_alloctimes) );
+        if( !p_alloctimes )
+            return VLC_ENOMEM;
+        p_index->p_times = p_alloctimes;
+        p_index->i_allocated = i_allocated;
+    }
+
+    memcpy( &p_index->p_times[(size_t)p_index->i_entries * p_index->i_tracks],
+            p_times, sizeof(*p_times) * p_index->i_tracks );
+    p_index->pi_pos[p_index->i_entries++] = i_pos;
+    return VLC_SUCCESS;
+}
+
 stime_t MP4_Fragment_Index_GetTrackStartTime( mp4_fragments_index_t *p_index,
                                               unsigned i_track_index, uint64_t i_moof_pos )
 {
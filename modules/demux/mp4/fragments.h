@@ -28,12 +28,16 @@ typedef struct mp4_fragments_index_t
     uint64_t *pi_pos;
     stime_t  *p_times; // movie scaled
     unsigned i_entries;
+    unsigned i_allocated;
     stime_t i_last_time; // movie scaled
     unsigned i_tracks;
 } mp4_fragments_index_t;
 
 void MP4_Fragments_Index_Delete( mp4_fragments_index_t *p_index );
 mp4_fragments_index_t * MP4_Fragments_Index_New( unsigned i_tracks, unsigned i_num );
+/* Appends a fragment entry, with the start time of each track */
+int MP4_Fragments_Index_Append( mp4_fragments_index_t *p_index, uint64_t i_pos,
+                                const stime_t *p_times );
 
 stime_t MP4_Fragment_Index_GetTrackStartTime( mp4_fragments_index_t *p_index,
                                               unsigned i_track_index, uint64_t i_moof_pos );
@@ -2910,10 +2910,65 @@ static void MP4_FreeBox_stsz( MP4_Box_t *p_box )
     free( p_box->data.p_stsz->i_entry_size );
 }
 
+/* Sizes tables bigger than this are only read on demand */
+#define MP4_STSZ_DEFER_SIZE (UINT64_C(1) << 18)
+
+static bool MP4_CanDeferTable( stream_t *p_stream, const MP4_Box_t *p_box )
+{
+    /* Only for boxes at their place in the file (not decompressed cmov),
+     * and if reading them later will not hurt playback */
+    const MP4_Box_t *p_father = p_box->p_father;
+    while( p_father && p_father->i_type != ATOM_root )
+        p_father = p_father->p_father;
+    if( p_father == NULL )
+        return false;
+
+    bool b_fastseekable;
+    return vlc_stream_Control( p_stream, STREAM_CAN_FASTSEEK,
+                               &b_fastseekable ) == VLC_SUCCESS &&
+           b_fastseekable;
+}
+
+static int MP4_ReadBox_stsz_deferred( stream_t *p_stream, MP4_Box_t *p_box )
+{
+    uint32_t count;
+
+    MP4_READBOX_ENTER_PARTIAL( MP4_Box_data_stsz_t,
+                               mp4_box_headersize( p_box ) + 12,
+                               MP4_FreeBox_stsz );
+
+    MP4_GETVERSIONFLAGS( p_box->data.p_stsz );
+
+    MP4_GET4BYTES( p_box->data.p_stsz->i_sample_size );
+    MP4_GET4BYTES( count );
+    p_box->data.p_stsz->i_sample_count = count;
+    p_box->data.p_stsz->i_entry_size = NULL;
+
+    if( p_box->data.p_stsz->i_sample_size == 0 )
+    {
+        if( UINT64_C(4) * count > p_box->i_size - header_size - 12 )
+            MP4_READBOX_EXIT( 0 );
+        p_box->data.p_stsz->b_deferred = true;
+    }
+
+#ifdef MP4_VERBOSE
+    msg_Dbg( p_stream, "read box: \"stsz\" sample-size %d sample-count %d "
+                       "(deferred)",
+                      p_box->data.p_stsz->i_sample_size,
+                      p_box->data.p_stsz->i_sample_count );
+
+#endif
+    MP4_READBOX_EXIT( 1 );
+}
+
 static int MP4_ReadBox_stsz( stream_t *p_stream, MP4_Box_t *p_box )
 {
     uint32_t count;
 
+    if( p_box->i_size > MP4_STSZ_DEFER_SIZE &&
+        MP4_CanDeferTable( p_stream, p_box ) )
+        return MP4_ReadBox_stsz_deferred( p_stream, p_box );
+
     MP4_READBOX_ENTER( MP4_Box_data_stsz_t, MP4_FreeBox_stsz );
 
     MP4_GETVERSIONFLAGS( p_box->data.p_stsz );
@@ -5261,6 +5316,43 @@ void MP4_BoxFree( MP4_Box_t *p_box )
     free( p_box );
 }
 
+uint32_t MP4_ReadSampleSizes( stream_t *p_stream, const MP4_Box_t *p_stsz,
+                              uint32_t i_first, uint32_t i_count,
+                              uint32_t *p_sizes )
+{
+    const MP4_Box_data_stsz_t *p_data = p_stsz->data.p_stsz;
+
+    if( p_data->i_sample_size != 0 || i_first >= p_data->i_sample_count )
+        return 0;
+    if( i_count > p_data->i_sample_count - i_first )
+        i_count = p_data->i_sample_count - i_first;
+
+    if( !p_data->b_deferred )
+    {
+        memcpy( p_sizes, &p_data->i_entry_size[i_first],
+                sizeof(uint32_t) * i_count );
+        return i_count;
+    }
+
+    const uint64_t i_pos = p_stsz->i_pos + mp4_box_headersize( p_stsz ) + 12 +
+                           UINT64_C(4) * i_first;
+    if( MP4_Seek( p_stream, i_pos ) != VLC_SUCCESS )
+        return 0;
+
+    /* Sizes are converted in place */
+    uint8_t *p_read = (uint8_t *) p_sizes;
+    ssize_t i_read = vlc_stream_Read( p_stream, p_read,
+                                      sizeof(uint32_t) * i_count );
+    if( i_read < 0 )
+        return 0;
+
+    i_count = i_read / 4;
+    for( uint32_t i = 0; i < i_count; i++ )
+        p_sizes[i] = GetDWBE( &p_read[4 * i] );
+
+    return i_count;
+}
+
 MP4_Box_t *MP4_BoxGetNextChunk( stream_t *s )
 {
     /* p_chunk is a virtual root container for the moof and mdat boxes */
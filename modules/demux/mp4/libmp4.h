@@ -899,6 +899,7 @@ typedef struct MP4_Box_data_stsz_s
     uint32_t i_sample_count;
 
     uint32_t *i_entry_size; /* array , empty if i_sample_size != 0 */
+    bool      b_deferred; /* entries left in the file, see MP4_ReadSampleSizes */
 
 } MP4_Box_data_stsz_t;
 
@@ -1863,7 +1864,7 @@ struct MP4_Box_s
                                 on i_type (or i_usertype) */
 };
 
-static inline size_t mp4_box_headersize( MP4_Box_t *p_box )
+static inline size_t mp4_box_headersize( const MP4_Box_t *p_box )
 {
     return 8
         + ( p_box->i_shortsize == 1 ? 8 : 0 )
@@ -1913,6 +1914,17 @@ MP4_Box_t *MP4_BoxGetNextChunk( stream_t * );
  *****************************************************************************/
 MP4_Box_t *MP4_BoxGetRoot( stream_t * );
 
+/*****************************************************************************
+ * MP4_ReadSampleSizes : read a range of sizes from a stsz box
+ *****************************************************************************
+ *  Big sizes tables of fast seekable streams are not loaded with the box
+ *  (b_deferred), and are then read from the stream, moving its position.
+ *  Returns the number of sizes copied to p_sizes, from i_first.
+ *****************************************************************************/
+uint32_t MP4_ReadSampleSizes( stream_t *, const MP4_Box_t *p_stsz,
+                              uint32_t i_first, uint32_t i_count,
+                              uint32_t *p_sizes );
+
 /*****************************************************************************
  * MP4_BoxNew : Allocates a new MP4 Box with its atom type
  *****************************************************************************
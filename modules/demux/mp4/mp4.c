@@ -90,6 +90,20 @@ static int   DemuxRef( demux_t *p_demux ){ (void)p_demux; return 0;}
 static int   DemuxFrag( demux_t * );
 static int   Control ( demux_t *, int, va_list );
 
+/* Builds the fragments index in background, from another stream */
+typedef struct
+{
+    vlc_thread_t thread;
+    vlc_mutex_t  lock;
+    vlc_cond_t   wait;
+    demux_t     *p_demux;
+    uint64_t     i_size;    /* of the demuxed stream */
+    mp4_fragments_index_t *p_index; /* up to p_index->i_last_time */
+    bool         b_done;
+    bool         b_complete; /* p_index covers all moofs */
+    bool         b_abort;
+} mp4_fragindexer_t;
+
 typedef struct
 {
     MP4_Box_t    *p_root;      /* container for the whole file */
@@ -140,6 +154,7 @@ typedef struct
     } hacks;
 
     mp4_fragments_index_t *p_fragsindex;
+    mp4_fragindexer_t     *p_fragindexer; /* building p_fragsindex */
 } demux_sys_t;
 
 #define DEMUX_INCREMENT VLC_TICK_FROM_MS(250) /* How far the pcr will go, each round */
@@ -159,6 +174,9 @@ static void MP4_TrackClean( es_out_t *, mp4_track_t * );
 
 static void MP4_Block_Send( demux_t *, mp4_track_t *, block_t * );
 
+static int  TrackLoadChunk( demux_t *, mp4_track_t *, uint32_t );
+static void UnloadChunk( mp4_chunk_t * );
+
 static void MP4_TrackSelect  ( demux_t *, mp4_track_t *, bool );
 static int  MP4_TrackSeek   ( demux_t *, mp4_track_t *, vlc_tick_t );
 
@@ -181,6 +199,12 @@ static int  ProbeFragments( demux_t *p_demux, bool b_force, bool *pb_fragmented
 static int  ProbeFragmentsChecked( demux_t *p_demux );
 static int  ProbeIndex( demux_t *p_demux );
 
+static int  FragIndexerStart( demux_t *p_demux );
+static void FragIndexerStop( demux_t *p_demux );
+static bool FragIndexerWait( demux_t *p_demux, stime_t i_time );
+static bool FragIndexerLookup( demux_t *p_demux, vlc_tick_t i_nztime,
+                               unsigned i_track_index, uint64_t *pi_pos );
+
 static int FragCreateTrunIndex( demux_t *, MP4_Box_t *, MP4_Box_t *, stime_t );
 
 static int FragGetMoofBySidxIndex( demux_t *p_demux, vlc_tick_t i_target_time,
@@ -1120,8 +1144,10 @@ static int Open( vlc_object_t * p_this )
             if( !p_sys->b_fragmented /* as unknown */ )
             {
                 /* Probe remaining to check if there's really fragments
-                   or if that file is just ready to append fragments */
-                ProbeFragments( p_demux, (p_sys->i_duration == 0), &p_sys->b_fragmented );
+                   or if that file is just ready to append fragments.
+                   Fast seekable ones are indexed in background */
+                ProbeFragments( p_demux, !p_sys->b_fastseekable && p_sys->i_duration == 0,
+                                &p_sys->b_fragmented );
             }
 
             if( vlc_stream_Seek( p_demux->s, p_sys->p_moov->i_pos ) != VLC_SUCCESS )
@@ -1139,6 +1165,12 @@ static int Open( vlc_object_t * p_this )
     {
         p_demux->pf_demux = DemuxFrag;
         msg_Dbg( p_demux, "Set Fragmented demux mode" );
+
+        /* Without global index, moofs are otherwise scanned on first seek */
+        if( p_sys->b_fastseekable && !p_sys->b_fragments_probed &&
+            !MP4_BoxGet( p_sys->p_root, "sidx" ) &&
+            FragIndexerStart( p_demux ) != VLC_SUCCESS )
+            msg_Warn( p_demux, "can't index fragments in background" );
     }
 
     if( !p_sys->b_seekable && p_demux->pf_demux == Demux )
@@ -1776,7 +1808,8 @@ static void FragTrunSeekToTime( mp4_track_t *p_track, stime_t i_target_time )
         const mp4_run_t *p_run = &p_track->context.runs.p_array[r];
         const MP4_Box_data_trun_t *p_data =
                     p_track->context.runs.p_array[r].p_trun->data.p_trun;
-        if( i_time > i_target_time )
+        /* Keep the last run starting before the target */
+        if( r > 0 && p_run->i_first_dts > i_target_time )
             break;
 
         i_run = r;
@@ -1800,12 +1833,24 @@ static void FragTrunSeekToTime( mp4_track_t *p_track, stime_t i_target_time )
 
             i_time += dur;
             i_pos += len;
+            i_sample = i + 1;
         }
     }
 
+    /* Target after the last sample of a run */
+    if( i_sample == p_track->context.runs.p_array[i_run].p_trun->data.p_trun->i_sample_count &&
+        i_run + 1 < p_track->context.runs.i_count )
+    {
+        i_run++;
+        i_sample = 0;
+        i_pos = p_track->context.runs.p_array[i_run].i_offset;
+        i_time = p_track->context.runs.p_array[i_run].i_first_dts;
+    }
+
     p_track->context.i_trun_sample = i_sample;
     p_track->context.i_trun_sample_pos = i_pos;
     p_track->context.runs.i_current = i_run;
+    p_track->i_time = i_time;
 }
 
 #define INVALID_SEGMENT_TIME  INT64_MAX
@@ -1818,7 +1863,13 @@ static int FragSeekToTime( demux_t *p_demux, vlc_tick_t i_nztime, bool b_accurat
     stime_t  i_segment_time = INVALID_SEGMENT_TIME;
     vlc_tick_t i_sync_time = i_nztime;
 
-    const uint64_t i_duration = __MAX(p_sys->i_duration, p_sys->i_cumulated_duration);
+    uint64_t i_duration = __MAX(p_sys->i_duration, p_sys->i_cumulated_duration);
+    if( !i_duration && p_sys->p_fragindexer )
+    {
+        /* Duration comes with the complete index */
+        FragIndexerWait( p_demux, INT64_MAX );
+        i_duration = __MAX(p_sys->i_duration, p_sys->i_cumulated_duration);
+    }
     if ( !p_sys->i_timescale || !i_duration || !p_sys->b_seekable )
          return VLC_EGENERIC;
 
@@ -1852,6 +1903,10 @@ static int FragSeekToTime( demux_t *p_demux, vlc_tick_t i_nztime, bool b_accurat
             /* Does only provide segment position and a sync sample time */
             msg_Dbg( p_demux, "seeking to sync point %" PRId64, i_sync_time );
         }
+        else if( FragIndexerLookup( p_demux, i_sync_time, i_seek_track_index, &i64 ) )
+        {
+            msg_Dbg( p_demux, "seeking to background index pos %" PRId64, i64 );
+        }
         else if( !p_sys->b_fragments_probed )
         {
             int i_ret = ProbeFragmentsChecked( p_demux );
@@ -1927,6 +1982,11 @@ static int FragSeekToPos( demux_t *p_demux, double f, bool b_accurate )
         return VLC_EGENERIC;
 
     uint64_t i_duration = __MAX(p_sys->i_duration, p_sys->i_cumulated_duration);
+    if( !i_duration && p_sys->p_fragindexer )
+    {
+        FragIndexerWait( p_demux, INT64_MAX );
+        i_duration = __MAX(p_sys->i_duration, p_sys->i_cumulated_duration);
+    }
     if( !i_duration && !p_sys->b_fragments_probed )
     {
         int i_ret = ProbeFragmentsChecked( p_demux );
@@ -2147,6 +2207,7 @@ static void Close ( vlc_object_t * p_this )
 
     msg_Dbg( p_demux, "freeing all memory" );
 
+    FragIndexerStop( p_demux );
     FragResetContext( p_sys );
 
     MP4_BoxFree( p_sys->p_root );
@@ -2265,7 +2326,13 @@ static void LoadChapterApple( demux_t  *p_demux, mp4_track_t *tk )
         }
         if( tk->i_sample+1 >= tk->chunk[tk->i_chunk].i_sample_first +
                               tk->chunk[tk->i_chunk].i_sample_count )
+        {
+            if( tk->i_chunk + 1 >= tk->i_chunk_count ||
+                TrackLoadChunk( p_demux, tk, tk->i_chunk + 1 ) != VLC_SUCCESS )
+                break;
+            UnloadChunk( &tk->chunk[tk->i_chunk] );
             tk->i_chunk++;
+        }
     }
 }
 static void LoadChapter( demux_t  *p_demux )
@@ -2460,25 +2527,105 @@ static int xTTS_CountEntries( demux_t *p_demux, uint32_t *pi_entry /* out */,
     return VLC_SUCCESS;
 }
 
+/* Moves a stts/ctts cursor forward by i_sample_count samples, adding their
+ * values (durations) to *pi_total */
+static void xTTS_Advance( mp4_xtts_cursor_t *p_cursor, uint32_t i_sample_count,
+                          const uint32_t *pi_index_sample_count,
+                          const int32_t *pi_index_value,
+                          const uint32_t i_table_count, int64_t *pi_total )
+{
+    while( i_sample_count > 0 && p_cursor->i_index < i_table_count )
+    {
+        const uint32_t i_avail = p_cursor->i_left ? p_cursor->i_left
+                               : pi_index_sample_count[p_cursor->i_index];
+        const uint32_t i_count = __MIN( i_avail, i_sample_count );
+
+        *pi_total += i_count * pi_index_value[p_cursor->i_index];
+        i_sample_count -= i_count;
+
+        if( i_count == i_avail )
+        {
+            p_cursor->i_index++;
+            p_cursor->i_left = 0;
+        }
+        else
+        {
+            p_cursor->i_left = i_avail - i_count;
+        }
+    }
+}
+
+/* Extracts the stts/ctts entries of i_sample_count samples from a cursor */
+static int xTTS_LoadEntries( demux_t *p_demux, const mp4_xtts_cursor_t *p_cursor,
+                             uint32_t i_sample_count,
+                             const uint32_t *pi_index_sample_count,
+                             const int32_t *pi_index_value, int64_t i_shift,
+                             const uint32_t i_table_count,
+                             uint32_t *pi_entries /* out */,
+                             uint32_t **pp_count /* out */,
+                             uint32_t **pp_value /* out */ )
+{
+    uint32_t i_index = p_cursor->i_index;
+    uint32_t i_left = p_cursor->i_left;
+    uint32_t i_entries = 0;
+
+    int i_ret = xTTS_CountEntries( p_demux, &i_entries, i_index, i_left,
+                                   i_sample_count, pi_index_sample_count,
+                                   i_table_count );
+    if ( i_ret == VLC_EGENERIC )
+        return i_ret;
+
+    uint32_t *p_count = calloc( i_entries, sizeof( uint32_t ) );
+    uint32_t *p_value = calloc( i_entries, sizeof( uint32_t ) );
+    if( i_entries && (!p_count || !p_value) )
+    {
+        free( p_count );
+        free( p_value );
+        msg_Err( p_demux, "can't allocate memory for i_entry=%"PRIu32, i_entries );
+        return VLC_ENOMEM;
+    }
+
+    for( uint32_t i = 0; i < i_entries; i++ )
+    {
+        const uint32_t i_avail = i_left ? i_left : pi_index_sample_count[i_index];
+
+        p_value[i] = pi_index_value[i_index] + i_shift;
+        if ( i_avail > i_sample_count )
+        {
+            p_count[i] = i_sample_count;
+            assert( i == i_entries - 1 );
+            break;
+        }
+        p_count[i] = i_avail;
+        i_sample_count -= i_avail;
+        i_left = 0;
+        i_index++;
+    }
+
+    *pi_entries = i_entries;
+    *pp_count = p_count;
+    *pp_value = p_value;
+    return VLC_SUCCESS;
+}
+
 static int TrackCreateSamplesIndex( demux_t *p_demux,
                                     mp4_track_t *p_demux_track )
 {
-    MP4_Box_t *p_box;
-    MP4_Box_data_stsz_t *stsz;
+    const MP4_Box_t *p_stsz, *p_stts, *p_ctts;
     /* TODO use also stss and stsh table for seeking */
     /* FIXME use edit table */
 
     /* Find stsz
      *  Gives the sample size for each samples. There is also a stz2 table
      *  (compressed form) that we need to implement TODO */
-    p_box = MP4_BoxGet( p_demux_track->p_stbl, "stsz" );
-    if( !p_box )
+    p_stsz = MP4_BoxGet( p_demux_track->p_stbl, "stsz" );
+    if( !p_stsz )
     {
         /* FIXME and stz2 */
         msg_Warn( p_demux, "cannot find STSZ box" );
         return VLC_EGENERIC;
     }
-    stsz = p_box->data.p_stsz;
+    const MP4_Box_data_stsz_t *stsz = BOXDATA(p_stsz);
 
     /* Use stsz table to create a sample number -> sample size table */
     if( p_demux_track->i_sample_count != stsz->i_sample_count )
@@ -2489,25 +2636,24 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
         p_demux_track->i_sample_count = __MIN(p_demux_track->i_sample_count, stsz->i_sample_count);
     }
 
+    p_demux_track->p_stsz = p_stsz;
+    p_demux_track->p_sample_size = NULL;
+    p_demux_track->i_sample_size_first = 0;
+    p_demux_track->i_sample_size_count = 0;
     if( stsz->i_sample_size )
     {
         /* 1: all sample have the same size, so no need to construct a table */
         p_demux_track->i_sample_size = stsz->i_sample_size;
-        p_demux_track->p_sample_size = NULL;
     }
     else
     {
-        /* 2: each sample can have a different size */
+        /* 2: each sample can have a different size, read from the box table,
+         *    or by windows from the file (see TrackLoadSampleSizes) */
         p_demux_track->i_sample_size = 0;
-        p_demux_track->p_sample_size =
-            calloc( p_demux_track->i_sample_count, sizeof( uint32_t ) );
-        if( p_demux_track->p_sample_size == NULL )
-            return VLC_ENOMEM;
-
-        for( uint32_t i_sample = 0; i_sample < p_demux_track->i_sample_count; i_sample++ )
+        if( !stsz->b_deferred )
         {
-            p_demux_track->p_sample_size[i_sample] =
-                    stsz->i_entry_size[i_sample];
+            p_demux_track->p_sample_size = stsz->i_entry_size;
+            p_demux_track->i_sample_size_count = stsz->i_sample_count;
         }
     }
 
@@ -2525,216 +2671,77 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
      * XXX: if we don't want to waste too much memory, we can't expand
      *  the box! so each chunk will contain an "extract" of this table
      *  for fast research (problem with raw stream where a sample is sometime
-     *  just channels*bits_per_sample/8 */
-
-     /* FIXME: refactor STTS & CTTS, STTS having now only few extra lines and
-      *        differing in 2/2 fields and 1 signedness */
+     *  just channels*bits_per_sample/8.
+     *  Those extracts are only built when the chunk is used (TrackLoadChunk),
+     *  so here we only keep the position in the table for each chunk. */
 
     int64_t i_next_dts = 0;
     /* Find stts
      *  Gives mapping between sample and decoding time
      */
-    p_box = MP4_BoxGet( p_demux_track->p_stbl, "stts" );
-    if( !p_box )
+    p_stts = MP4_BoxGet( p_demux_track->p_stbl, "stts" );
+    if( !p_stts )
     {
         msg_Warn( p_demux, "cannot find STTS box" );
         return VLC_EGENERIC;
     }
     else
     {
-        MP4_Box_data_stts_t *stts = p_box->data.p_stts;
+        MP4_Box_data_stts_t *stts = BOXDATA(p_stts);
 
         msg_Warn( p_demux, "STTS table of %"PRIu32" entries", stts->i_entry_count );
 
-        /* Create sample -> dts table per chunk */
-        uint32_t i_index = 0;
-        uint32_t i_current_index_samples_left = 0;
+        mp4_xtts_cursor_t cursor = { 0, 0 };
 
         for( uint32_t i_chunk = 0; i_chunk < p_demux_track->i_chunk_count; i_chunk++ )
         {
             mp4_chunk_t *ck = &p_demux_track->chunk[i_chunk];
-            uint32_t i_sample_count;
 
             /* save first dts */
             ck->i_first_dts = i_next_dts;
+            ck->dts_cursor = cursor;
 
-            /* count how many entries are needed for this chunk
-             * for p_sample_delta_dts and p_sample_count_dts */
-            ck->i_entries_dts = 0;
-
-            int i_ret = xTTS_CountEntries( p_demux, &ck->i_entries_dts, i_index,
-                                           i_current_index_samples_left,
-                                           ck->i_sample_count,
-                                           stts->pi_sample_count,
-                                           stts->i_entry_count );
-            if ( i_ret == VLC_EGENERIC )
-                return i_ret;
+            xTTS_Advance( &cursor, ck->i_sample_count,
+                          stts->pi_sample_count, stts->pi_sample_delta,
+                          stts->i_entry_count, &i_next_dts );
 
-            /* allocate them */
-            ck->p_sample_count_dts = calloc( ck->i_entries_dts, sizeof( uint32_t ) );
-            ck->p_sample_delta_dts = calloc( ck->i_entries_dts, sizeof( uint32_t ) );
-            if( !ck->p_sample_count_dts || !ck->p_sample_delta_dts )
-            {
-                free( ck->p_sample_count_dts );
-                free( ck->p_sample_delta_dts );
-                msg_Err( p_demux, "can't allocate memory for i_entry=%"PRIu32, ck->i_entries_dts );
-                ck->i_entries_dts = 0;
-                return VLC_ENOMEM;
-            }
-
-            /* now copy */
-            i_sample_count = ck->i_sample_count;
-
-            for( uint32_t i = 0; i < ck->i_entries_dts; i++ )
-            {
-                if ( i_current_index_samples_left )
-                {
-                    if ( i_current_index_samples_left > i_sample_count )
-                    {
-                        ck->p_sample_count_dts[i] = i_sample_count;
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        if ( i_sample_count ) ck->i_duration = i_next_dts - ck->i_first_dts;
-                        i_current_index_samples_left -= i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == ck->i_entries_dts - 1 );
-                        break;
-                    }
-                    else
-                    {
-                        ck->p_sample_count_dts[i] = i_current_index_samples_left;
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        if ( i_current_index_samples_left ) ck->i_duration = i_next_dts - ck->i_first_dts;
-                        i_sample_count -= i_current_index_samples_left;
-                        i_current_index_samples_left = 0;
-                        i_index++;
-                    }
-                }
-                else
-                {
-                    if ( stts->pi_sample_count[i_index] > i_sample_count )
-                    {
-                        ck->p_sample_count_dts[i] = i_sample_count;
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        if ( i_sample_count ) ck->i_duration = i_next_dts - ck->i_first_dts;
-                        i_current_index_samples_left = stts->pi_sample_count[i_index] - i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == ck->i_entries_dts - 1 );
-                        // keep building from same index
-                    }
-                    else
-                    {
-                        ck->p_sample_count_dts[i] = stts->pi_sample_count[i_index];
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        if ( stts->pi_sample_count[i_index] ) ck->i_duration = i_next_dts - ck->i_first_dts;
-                        i_sample_count -= stts->pi_sample_count[i_index];
-                        i_index++;
-                    }
-                }
-
-            }
+            ck->i_duration = i_next_dts - ck->i_first_dts;
         }
     }
-
+    p_demux_track->p_stts = p_stts;
 
     /* Find ctts
      *  Gives the delta between decoding time (dts) and composition table (pts)
      */
-    p_box = MP4_BoxGet( p_demux_track->p_stbl, "ctts" );
-    if( p_box && p_box->data.p_ctts )
+    p_ctts = MP4_BoxGet( p_demux_track->p_stbl, "ctts" );
+    if( p_ctts && BOXDATA(p_ctts) )
     {
-        MP4_Box_data_ctts_t *ctts = p_box->data.p_ctts;
+        MP4_Box_data_ctts_t *ctts = BOXDATA(p_ctts);
 
         msg_Warn( p_demux, "CTTS table of %"PRIu32" entries", ctts->i_entry_count );
 
-        int64_t i_cts_shift = 0;
+        p_demux_track->i_cts_shift = 0;
         const MP4_Box_t *p_cslg = MP4_BoxGet( p_demux_track->p_stbl, "cslg" );
         if( p_cslg && BOXDATA(p_cslg) )
-            i_cts_shift = BOXDATA(p_cslg)->ct_to_dts_shift;
+            p_demux_track->i_cts_shift = BOXDATA(p_cslg)->ct_to_dts_shift;
 
-        /* Create pts-dts table per chunk */
-        uint32_t i_index = 0;
-        uint32_t i_current_index_samples_left = 0;
+        mp4_xtts_cursor_t cursor = { 0, 0 };
+        int64_t i_unused = 0;
 
         for( uint32_t i_chunk = 0; i_chunk < p_demux_track->i_chunk_count; i_chunk++ )
         {
             mp4_chunk_t *ck = &p_demux_track->chunk[i_chunk];
-            uint32_t i_sample_count;
-
-            /* count how many entries are needed for this chunk
-             * for p_sample_offset_pts and p_sample_count_pts */
-            ck->i_entries_pts = 0;
-            int i_ret = xTTS_CountEntries( p_demux, &ck->i_entries_pts, i_index,
-                                           i_current_index_samples_left,
-                                           ck->i_sample_count,
-                                           ctts->pi_sample_count,
-                                           ctts->i_entry_count );
-            if ( i_ret == VLC_EGENERIC )
-                return i_ret;
-
-            /* allocate them */
-            ck->p_sample_count_pts = calloc( ck->i_entries_pts, sizeof( uint32_t ) );
-            ck->p_sample_offset_pts = calloc( ck->i_entries_pts, sizeof( int32_t ) );
-            if( !ck->p_sample_count_pts || !ck->p_sample_offset_pts )
-            {
-                free( ck->p_sample_count_pts );
-                free( ck->p_sample_offset_pts );
-                msg_Err( p_demux, "can't allocate memory for i_entry=%"PRIu32, ck->i_entries_pts );
-                ck->i_entries_pts = 0;
-                return VLC_ENOMEM;
-            }
-
-            /* now copy */
-            i_sample_count = ck->i_sample_count;
 
-            for( uint32_t i = 0; i < ck->i_entries_pts; i++ )
-            {
-                if ( i_current_index_samples_left )
-                {
-                    if ( i_current_index_samples_left > i_sample_count )
-                    {
-                        ck->p_sample_count_pts[i] = i_sample_count;
-                        ck->p_sample_offset_pts[i] = ctts->pi_sample_offset[i_index] + i_cts_shift;
-                        i_current_index_samples_left -= i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == ck->i_entries_pts - 1 );
-                        break;
-                    }
-                    else
-                    {
-                        ck->p_sample_count_pts[i] = i_current_index_samples_left;
-                        ck->p_sample_offset_pts[i] = ctts->pi_sample_offset[i_index] + i_cts_shift;
-                        i_sample_count -= i_current_index_samples_left;
-                        i_current_index_samples_left = 0;
-                        i_index++;
-                    }
-                }
-                else
-                {
-                    if ( ctts->pi_sample_count[i_index] > i_sample_count )
-                    {
-                        ck->p_sample_count_pts[i] = i_sample_count;
-                        ck->p_sample_offset_pts[i] = ctts->pi_sample_offset[i_index] + i_cts_shift;
-                        i_current_index_samples_left = ctts->pi_sample_count[i_index] - i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == ck->i_entries_pts - 1 );
-                        // keep building from same index
-                    }
-                    else
-                    {
-                        ck->p_sample_count_pts[i] = ctts->pi_sample_count[i_index];
-                        ck->p_sample_offset_pts[i] = ctts->pi_sample_offset[i_index] + i_cts_shift;
-                        i_sample_count -= ctts->pi_sample_count[i_index];
-                        i_index++;
-                    }
-                }
-
-
-            }
+            ck->pts_cursor = cursor;
+            xTTS_Advance( &cursor, ck->i_sample_count,
+                          ctts->pi_sample_count, ctts->pi_sample_offset,
+                          ctts->i_entry_count, &i_unused );
         }
+        p_demux_track->p_ctts = p_ctts;
+    }
+    else
+    {
+        p_demux_track->p_ctts = NULL;
     }
 
     msg_Dbg( p_demux, "track[Id 0x%x] read %"PRIu32" samples length:%"PRId64"s",
@@ -2744,6 +2751,110 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
     return VLC_SUCCESS;
 }
 
+/* Number of sample sizes read at once, when the table is read on demand */
+#define MP4_SAMPLE_SIZE_WINDOW 4096
+
+/* Ensures the sizes of the chunk samples are available */
+static int TrackLoadSampleSizes( demux_t *p_demux, mp4_track_t *p_track,
+                                 const mp4_chunk_t *ck )
+{
+    if( p_track->i_sample_size ||
+        ck->i_sample_first >= p_track->i_sample_count )
+        return VLC_SUCCESS;
+
+    const uint32_t i_count = __MIN( ck->i_sample_count,
+                                    p_track->i_sample_count - ck->i_sample_first );
+    if( ck->i_sample_first >= p_track->i_sample_size_first &&
+        (uint64_t) ck->i_sample_first - p_track->i_sample_size_first + i_count <=
+        p_track->i_sample_size_count )
+        return VLC_SUCCESS;
+
+    /* Read ahead, for the next chunks */
+    const uint32_t i_window = __MIN( __MAX( i_count, MP4_SAMPLE_SIZE_WINDOW ),
+                                     p_track->i_sample_count - ck->i_sample_first );
+    uint32_t *p_window = vlc_reallocarray( p_track->p_sample_size_window,
+                                           i_window, sizeof(uint32_t) );
+    if( p_window == NULL )
+        return VLC_ENOMEM;
+
+    p_track->p_sample_size_window = p_window;
+    p_track->p_sample_size = p_window;
+    p_track->i_sample_size_first = ck->i_sample_first;
+    p_track->i_sample_size_count =
+        MP4_ReadSampleSizes( p_demux->s, p_track->p_stsz, ck->i_sample_first,
+                             i_window, p_window );
+    if( p_track->i_sample_size_count < i_count )
+    {
+        msg_Err( p_demux, "cannot read samples sizes of track[Id 0x%x]",
+                 p_track->i_track_ID );
+        p_track->i_sample_size_count = 0;
+        return VLC_EGENERIC;
+    }
+
+    return VLC_SUCCESS;
+}
+
+static void UnloadChunk( mp4_chunk_t *ck )
+{
+    free( ck->p_sample_count_dts );
+    free( ck->p_sample_delta_dts );
+    free( ck->p_sample_count_pts );
+    free( ck->p_sample_offset_pts );
+    ck->p_sample_count_dts = NULL;
+    ck->p_sample_delta_dts = NULL;
+    ck->p_sample_count_pts = NULL;
+    ck->p_sample_offset_pts = NULL;
+    ck->i_entries_dts = 0;
+    ck->i_entries_pts = 0;
+    ck->b_loaded = false;
+}
+
+/* Builds the dts/pts tables of a chunk, and reads its samples sizes */
+static int TrackLoadChunk( demux_t *p_demux, mp4_track_t *p_track,
+                           uint32_t i_chunk )
+{
+    if( i_chunk >= p_track->i_chunk_count )
+        return VLC_EGENERIC;
+
+    mp4_chunk_t *ck = &p_track->chunk[i_chunk];
+
+    int i_ret = TrackLoadSampleSizes( p_demux, p_track, ck );
+    if( i_ret != VLC_SUCCESS || ck->b_loaded )
+        return i_ret;
+
+    const MP4_Box_data_stts_t *stts = p_track->BOXDATA(p_stts);
+    uint32_t *p_count, *p_value;
+
+    i_ret = xTTS_LoadEntries( p_demux, &ck->dts_cursor, ck->i_sample_count,
+                              stts->pi_sample_count, stts->pi_sample_delta, 0,
+                              stts->i_entry_count,
+                              &ck->i_entries_dts, &p_count, &p_value );
+    if( i_ret != VLC_SUCCESS )
+        return i_ret;
+    ck->p_sample_count_dts = p_count;
+    ck->p_sample_delta_dts = p_value;
+
+    if( p_track->p_ctts )
+    {
+        const MP4_Box_data_ctts_t *ctts = p_track->BOXDATA(p_ctts);
+
+        i_ret = xTTS_LoadEntries( p_demux, &ck->pts_cursor, ck->i_sample_count,
+                                  ctts->pi_sample_count, ctts->pi_sample_offset,
+                                  p_track->i_cts_shift, ctts->i_entry_count,
+                                  &ck->i_entries_pts, &p_count, &p_value );
+        if( i_ret != VLC_SUCCESS )
+        {
+            UnloadChunk( ck );
+            return i_ret;
+        }
+        ck->p_sample_count_pts = p_count;
+        ck->p_sample_offset_pts = (int32_t *) p_value;
+    }
+
+    ck->b_loaded = true;
+    return VLC_SUCCESS;
+}
+
 
 /**
  * It computes the sample rate for a video track using the given sample
@@ -3094,6 +3205,14 @@ static int TrackTimeToSampleChunk( demux_t *p_demux, mp4_track_t *p_track,
     }
 
     /* *** find sample in the chunk *** */
+    if( TrackLoadChunk( p_demux, p_track, i_chunk ) != VLC_SUCCESS )
+    {
+        msg_Warn( p_demux, "track[Id 0x%x] cannot load chunk %d",
+                  p_track->i_track_ID, i_chunk );
+        return VLC_EGENERIC;
+    }
+    const unsigned int i_loaded_chunk = i_chunk;
+
     i_sample = p_track->chunk[i_chunk].i_sample_first;
     i_dts    = p_track->chunk[i_chunk].i_first_dts;
 
@@ -3155,6 +3274,9 @@ static int TrackTimeToSampleChunk( demux_t *p_demux, mp4_track_t *p_track,
         i_sample = i_sync_sample;
     }
 
+    if( i_loaded_chunk != i_chunk && i_loaded_chunk != p_track->i_chunk )
+        UnloadChunk( &p_track->chunk[i_loaded_chunk] );
+
     *pi_chunk  = i_chunk;
     *pi_sample = i_sample;
 
@@ -3255,6 +3377,18 @@ static int TrackGotoChunkSample( demux_t *p_demux, mp4_track_t *p_track,
     if( TrackUpdateFormat( p_demux, p_track, i_chunk ) != VLC_SUCCESS )
         return VLC_EGENERIC;
 
+    if( TrackLoadChunk( p_demux, p_track, i_chunk ) != VLC_SUCCESS )
+    {
+        msg_Err( p_demux, "cannot load chunk %"PRIu32" of track[Id 0x%x]",
+                 i_chunk, p_track->i_track_ID );
+        p_track->b_selected = false;
+        return VLC_EGENERIC;
+    }
+
+    /* Only the tables of the current chunk are kept */
+    if( p_track->i_chunk != i_chunk && p_track->i_chunk < p_track->i_chunk_count )
+        UnloadChunk( &p_track->chunk[p_track->i_chunk] );
+
     p_track->i_chunk    = i_chunk;
     p_track->chunk[i_chunk].i_sample = i_sample - p_track->chunk[i_chunk].i_sample_first;
     p_track->i_sample   = i_sample;
@@ -3527,16 +3661,15 @@ static void MP4_TrackSetup( demux_t *p_demux, mp4_track_t *p_track,
         return;
     }
 
-    p_track->b_ok = true;
-}
+    if( p_track->i_chunk_count &&
+        TrackLoadChunk( p_demux, p_track, p_track->i_chunk ) != VLC_SUCCESS )
+    {
+        msg_Err( p_demux, "cannot load first chunk of track[Id 0x%x]",
+                 p_track->i_track_ID );
+        return;
+    }
 
-static void DestroyChunk( mp4_chunk_t *ck )
-{
-    free( ck->p_sample_count_dts );
-    free( ck->p_sample_delta_dts );
-    free( ck->p_sample_count_pts );
-    free( ck->p_sample_offset_pts );
-    free( ck->p_sample_size );
+    p_track->b_ok = true;
 }
 
 /****************************************************************************
@@ -3554,12 +3687,11 @@ static void MP4_TrackClean( es_out_t *out, mp4_track_t *p_track )
     if( p_track->chunk )
     {
         for( unsigned int i_chunk = 0; i_chunk < p_track->i_chunk_count; i_chunk++ )
-            DestroyChunk( &p_track->chunk[i_chunk] );
+            UnloadChunk( &p_track->chunk[i_chunk] );
     }
     free( p_track->chunk );
 
-    if( !p_track->i_sample_size )
-        free( p_track->p_sample_size );
+    free( p_track->p_sample_size_window );
 
     if ( p_track->asfinfo.p_frame )
         block_ChainRelease( p_track->asfinfo.p_frame );
@@ -3716,6 +3848,14 @@ static inline uint32_t MP4_GetAudioFrameInfo( const mp4_track_t *p_track,
     return i_samples_per_frame;
 }
 
+/* Size of a sample of the current chunk, when sizes are different */
+static inline uint32_t MP4_TrackSampleSize( const mp4_track_t *p_track,
+                                            uint32_t i_sample )
+{
+    assert( i_sample - p_track->i_sample_size_first < p_track->i_sample_size_count );
+    return p_track->p_sample_size[i_sample - p_track->i_sample_size_first];
+}
+
 static uint32_t MP4_TrackGetReadSize( mp4_track_t *p_track, uint32_t *pi_nb_samples )
 {
     uint32_t i_size = 0;
@@ -3729,7 +3869,7 @@ static uint32_t MP4_TrackGetReadSize( mp4_track_t *p_track, uint32_t *pi_nb_samp
         *pi_nb_samples = 1;
 
         if( p_track->i_sample_size == 0 ) /* all sizes are different */
-            return p_track->p_sample_size[p_track->i_sample];
+            return MP4_TrackSampleSize( p_track, p_track->i_sample );
         else
             return p_track->i_sample_size;
     }
@@ -3767,7 +3907,7 @@ static uint32_t MP4_TrackGetReadSize( mp4_track_t *p_track, uint32_t *pi_nb_samp
         if( p_track->i_sample_size == 0 )
         {
             *pi_nb_samples = 1;
-            return p_track->p_sample_size[p_track->i_sample];
+            return MP4_TrackSampleSize( p_track, p_track->i_sample );
         }
 
         /* If we are compressed but not v2 LPCM frames extensions */
@@ -3777,7 +3917,7 @@ static uint32_t MP4_TrackGetReadSize( mp4_track_t *p_track, uint32_t *pi_nb_samp
             if ( p_track->i_sample_size )
                 return p_track->i_sample_size;
             else
-                return p_track->p_sample_size[p_track->i_sample];
+                return MP4_TrackSampleSize( p_track, p_track->i_sample );
         }
 
         /* More regular V0 cases */
@@ -3856,7 +3996,7 @@ static uint32_t MP4_TrackGetReadSize( mp4_track_t *p_track, uint32_t *pi_nb_samp
                  i<p_track->i_sample_count;
                  i++ )
             {
-                i_size += p_track->p_sample_size[i];
+                i_size += MP4_TrackSampleSize( p_track, i );
                 (*pi_nb_samples)++;
 
                 /* Try to detect compression in ISO */
@@ -3913,7 +4053,7 @@ static uint64_t MP4_TrackGetPos( mp4_track_t *p_track )
         for( i_sample = p_track->chunk[p_track->i_chunk].i_sample_first;
              i_sample < p_track->i_sample; i_sample++ )
         {
-            i_pos += p_track->p_sample_size[i_sample];
+            i_pos += MP4_TrackSampleSize( p_track, i_sample );
         }
     }
 
@@ -4210,6 +4350,48 @@ static bool GetMoofTrackDuration( MP4_Box_t *p_moov, MP4_Box_t *p_moof,
     return true;
 }
 
+/* Sets the movie time of each track at the start of the moof, from its tfdt
+ * or from the previous moofs durations, and moves pi_track_times to its end */
+static void GetMoofTimes( demux_sys_t *p_sys, MP4_Box_t *p_moof, bool b_first,
+                          stime_t *pi_track_times, stime_t *p_times )
+{
+    for( unsigned i=0; i<p_sys->i_tracks; i++ )
+    {
+        MP4_Box_t *p_tfdt = NULL;
+        MP4_Box_t *p_traf = MP4_GetTrafByTrackID( p_moof, p_sys->track[i].i_track_ID );
+        if( p_traf )
+            p_tfdt = MP4_BoxGet( p_traf, "tfdt" );
+
+        if( p_tfdt && BOXDATA(p_tfdt) )
+        {
+            pi_track_times[i] = p_tfdt->data.p_tfdt->i_base_media_decode_time;
+        }
+        else if( b_first ) /* Set first fragment time offset from moov */
+        {
+            stime_t i_duration = GetMoovTrackDuration( p_sys, p_sys->track[i].i_track_ID );
+            pi_track_times[i] = MP4_rescale( i_duration, p_sys->i_timescale, p_sys->track[i].i_timescale );
+        }
+
+        p_times[i] = MP4_rescale( pi_track_times[i], p_sys->track[i].i_timescale, p_sys->i_timescale );
+
+        stime_t i_duration = 0;
+        if( GetMoofTrackDuration( p_sys->p_moov, p_moof, p_sys->track[i].i_track_ID, &i_duration ) )
+            pi_track_times[i] += i_duration;
+    }
+}
+
+static stime_t GetMoofsEndTime( demux_sys_t *p_sys, const stime_t *pi_track_times )
+{
+    stime_t i_end = 0;
+    for( unsigned i=0; i<p_sys->i_tracks; i++ )
+    {
+        stime_t i_movietime = MP4_rescale( pi_track_times[i], p_sys->track[i].i_timescale, p_sys->i_timescale );
+        if( i_end < i_movietime )
+            i_end = i_movietime;
+    }
+    return i_end;
+}
+
 static int ProbeFragments( demux_t *p_demux, bool b_force, bool *pb_fragmented )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
@@ -4222,7 +4404,7 @@ static int ProbeFragments( demux_t *p_demux, bool b_force, bool *pb_fragmented )
     if( !p_vroot )
         return VLC_EGENERIC;
 
-    if( p_sys->b_seekable && (p_sys->b_fastseekable || b_force) )
+    if( p_sys->b_seekable && b_force )
     {
         MP4_ReadBoxContainerChildren( p_demux->s, p_vroot, NULL ); /* Get the rest of the file */
         p_sys->b_fragments_probed = true;
@@ -4254,40 +4436,12 @@ static int ProbeFragments( demux_t *p_demux, bool b_force, bool *pb_fragmented )
                 if( p_moof->i_type != ATOM_moof )
                     continue;
 
-                for( unsigned i=0; i<p_sys->i_tracks; i++ )
-                {
-                    MP4_Box_t *p_tfdt = NULL;
-                    MP4_Box_t *p_traf = MP4_GetTrafByTrackID( p_moof, p_sys->track[i].i_track_ID );
-                    if( p_traf )
-                        p_tfdt = MP4_BoxGet( p_traf, "tfdt" );
-
-                    if( p_tfdt && BOXDATA(p_tfdt) )
-                    {
-                        pi_track_times[i] = p_tfdt->data.p_tfdt->i_base_media_decode_time;
-                    }
-                    else if( index == 0 ) /* Set first fragment time offset from moov */
-                    {
-                        stime_t i_duration = GetMoovTrackDuration( p_sys, p_sys->track[i].i_track_ID );
-                        pi_track_times[i] = MP4_rescale( i_duration, p_sys->i_timescale, p_sys->track[i].i_timescale );
-                    }
-
-                    stime_t i_movietime = MP4_rescale( pi_track_times[i], p_sys->track[i].i_timescale, p_sys->i_timescale );
-                    p_sys->p_fragsindex->p_times[index * p_sys->i_tracks + i] = i_movietime;
-
-                    stime_t i_duration = 0;
-                    if( GetMoofTrackDuration( p_sys->p_moov, p_moof, p_sys->track[i].i_track_ID, &i_duration ) )
-                        pi_track_times[i] += i_duration;
-                }
-
+                GetMoofTimes( p_sys, p_moof, index == 0, pi_track_times,
+                              &p_sys->p_fragsindex->p_times[index * p_sys->i_tracks] );
                 p_sys->p_fragsindex->pi_pos[index++] = p_moof->i_pos;
             }
 
-            for( unsigned i=0; i<p_sys->i_tracks; i++ )
-            {
-                stime_t i_movietime = MP4_rescale( pi_track_times[i], p_sys->track[i].i_timescale, p_sys->i_timescale );
-                if( p_sys->p_fragsindex->i_last_time < i_movietime )
-                    p_sys->p_fragsindex->i_last_time = i_movietime;
-            }
+            p_sys->p_fragsindex->i_last_time = GetMoofsEndTime( p_sys, pi_track_times );
 
             free( pi_track_times );
 #ifdef MP4_VERBOSE
@@ -4360,6 +4514,188 @@ static int ProbeFragmentsChecked( demux_t *p_demux )
     return i_ret;
 }
 
+static void *FragIndexerThread( void *p_data )
+{
+    mp4_fragindexer_t *p_idx = p_data;
+    demux_t *p_demux = p_idx->p_demux;
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const uint32_t stoplist[] = { ATOM_moof, 0 };
+    bool b_complete = false;
+    uint64_t i_size;
+    uint8_t mfro[MP4_MFRO_BOXSIZE];
+
+    /* The demuxer own stream can't be shared */
+    stream_t *s = vlc_stream_NewURL( p_demux, p_demux->psz_url );
+    stime_t *pi_track_times = calloc( p_sys->i_tracks, sizeof(*pi_track_times) );
+    stime_t *p_times = calloc( p_sys->i_tracks, sizeof(*p_times) );
+    if( !s || !pi_track_times || !p_times ||
+        vlc_stream_GetSize( s, &i_size ) != VLC_SUCCESS || i_size != p_idx->i_size )
+        goto end;
+
+    /* Otherwise, the mfra index will be loaded on seek */
+    if( i_size > MP4_MFRO_BOXSIZE &&
+        vlc_stream_Seek( s, i_size - MP4_MFRO_BOXSIZE ) == VLC_SUCCESS &&
+        vlc_stream_Read( s, mfro, MP4_MFRO_BOXSIZE ) == MP4_MFRO_BOXSIZE &&
+        VLC_FOURCC(mfro[4],mfro[5],mfro[6],mfro[7]) == ATOM_mfro )
+        goto end;
+
+    if( vlc_stream_Seek( s, p_sys->p_moov->i_pos + p_sys->p_moov->i_size ) != VLC_SUCCESS )
+        goto end;
+
+    for( bool b_first = true;; b_first = false )
+    {
+        vlc_mutex_lock( &p_idx->lock );
+        const bool b_abort = p_idx->b_abort;
+        vlc_mutex_unlock( &p_idx->lock );
+        if( b_abort )
+            break;
+
+        /* Reads up to the next moof, skipping mdat */
+        MP4_Box_t *p_vroot = MP4_BoxNew( ATOM_root );
+        if( !p_vroot )
+            break;
+        MP4_ReadBoxContainerChildren( s, p_vroot, stoplist );
+
+        MP4_Box_t *p_moof = p_vroot->p_last;
+        if( !p_moof || p_moof->i_type != ATOM_moof )
+        {
+            MP4_BoxFree( p_vroot );
+            b_complete = !b_first;
+            break;
+        }
+
+        GetMoofTimes( p_sys, p_moof, b_first, pi_track_times, p_times );
+
+        vlc_mutex_lock( &p_idx->lock );
+        int i_ret = MP4_Fragments_Index_Append( p_idx->p_index, p_moof->i_pos, p_times );
+        p_idx->p_index->i_last_time = GetMoofsEndTime( p_sys, pi_track_times );
+        vlc_cond_broadcast( &p_idx->wait );
+        vlc_mutex_unlock( &p_idx->lock );
+
+        MP4_BoxFree( p_vroot );
+        if( i_ret != VLC_SUCCESS )
+            break;
+    }
+
+end:
+    if( s )
+        vlc_stream_Delete( s );
+    free( pi_track_times );
+    free( p_times );
+
+    vlc_mutex_lock( &p_idx->lock );
+    p_idx->b_done = true;
+    p_idx->b_complete = b_complete;
+    vlc_cond_broadcast( &p_idx->wait );
+    vlc_mutex_unlock( &p_idx->lock );
+    return NULL;
+}
+
+static int FragIndexerStart( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( !p_demux->psz_url || !p_sys->i_tracks )
+        return VLC_EGENERIC;
+
+    mp4_fragindexer_t *p_idx = calloc( 1, sizeof(*p_idx) );
+    if( !p_idx )
+        return VLC_ENOMEM;
+
+    p_idx->p_demux = p_demux;
+    p_idx->p_index = MP4_Fragments_Index_New( p_sys->i_tracks, 0 );
+    if( !p_idx->p_index ||
+        vlc_stream_GetSize( p_demux->s, &p_idx->i_size ) != VLC_SUCCESS )
+    {
+        MP4_Fragments_Index_Delete( p_idx->p_index );
+        free( p_idx );
+        return VLC_EGENERIC;
+    }
+    vlc_mutex_init( &p_idx->lock );
+    vlc_cond_init( &p_idx->wait );
+
+    if( vlc_clone( &p_idx->thread, FragIndexerThread, p_idx,
+                   VLC_THREAD_PRIORITY_LOW ) )
+    {
+        MP4_Fragments_Index_Delete( p_idx->p_index );
+        free( p_idx );
+        return VLC_EGENERIC;
+    }
+
+    p_sys->p_fragindexer = p_idx;
+    return VLC_SUCCESS;
+}
+
+/* Stops the indexing, and takes its index if it was complete */
+static void FragIndexerStop( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    mp4_fragindexer_t *p_idx = p_sys->p_fragindexer;
+
+    if( !p_idx )
+        return;
+
+    vlc_mutex_lock( &p_idx->lock );
+    p_idx->b_abort = true;
+    vlc_mutex_unlock( &p_idx->lock );
+    vlc_join( p_idx->thread, NULL );
+    p_sys->p_fragindexer = NULL;
+
+    if( p_idx->b_complete && !p_sys->b_fragments_probed )
+    {
+        msg_Dbg( p_demux, "fragments indexed in background, %u moofs",
+                 p_idx->p_index->i_entries );
+        p_sys->p_fragsindex = p_idx->p_index;
+        p_sys->b_fragments_probed = true;
+        if ( !MP4_BoxGet( p_sys->p_moov, "mvex/mehd") )
+            p_sys->i_cumulated_duration = GetCumulatedDuration( p_demux );
+#ifdef MP4_VERBOSE
+        MP4_Fragments_Index_Dump( VLC_OBJECT(p_demux), p_sys->p_fragsindex, p_sys->i_timescale );
+#endif
+    }
+    else
+        MP4_Fragments_Index_Delete( p_idx->p_index );
+    free( p_idx );
+}
+
+/* Waits for the background index to cover the movie time, or to finish.
+ * Returns false, after stopping it, once finished. */
+static bool FragIndexerWait( demux_t *p_demux, stime_t i_time )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    mp4_fragindexer_t *p_idx = p_sys->p_fragindexer;
+
+    if( !p_idx )
+        return false;
+
+    vlc_mutex_lock( &p_idx->lock );
+    while( !p_idx->b_done && i_time >= p_idx->p_index->i_last_time )
+        vlc_cond_wait( &p_idx->wait, &p_idx->lock );
+    const bool b_done = p_idx->b_done;
+    vlc_mutex_unlock( &p_idx->lock );
+
+    if( b_done )
+        FragIndexerStop( p_demux );
+    return !b_done;
+}
+
+static bool FragIndexerLookup( demux_t *p_demux, vlc_tick_t i_nztime,
+                               unsigned i_track_index, uint64_t *pi_pos )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    stime_t i_time = MP4_rescale_qtime( i_nztime, p_sys->i_timescale );
+
+    if( !FragIndexerWait( p_demux, i_time ) )
+        return false;
+
+    mp4_fragindexer_t *p_idx = p_sys->p_fragindexer;
+    vlc_mutex_lock( &p_idx->lock );
+    bool b_found = MP4_Fragments_Index_Lookup( p_idx->p_index, &i_time, pi_pos,
+                                               i_track_index );
+    vlc_mutex_unlock( &p_idx->lock );
+    return b_found;
+}
+
 static void FragResetContext( demux_sys_t *p_sys )
 {
     if( p_sys->context.p_fragment_atom )
@@ -4944,6 +5280,10 @@ static int DemuxFrag( demux_t *p_demux )
         goto end;
     }
 
+    /* Use the background index once finished, for the duration */
+    if( p_sys->p_fragindexer )
+        FragIndexerWait( p_demux, INT64_MIN );
+
     /* check for newly selected/unselected track */
     for( unsigned i_track = 0; i_track < p_sys->i_tracks; i_track++ )
     {
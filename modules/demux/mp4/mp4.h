@@ -30,6 +30,13 @@
 #include "fragments.h"
 #include "../asf/asfpacket.h"
 
+/* Position in a stts/ctts table */
+typedef struct
+{
+    uint32_t i_index;   /* current entry */
+    uint32_t i_left;    /* samples left in that entry, 0 if not started */
+} mp4_xtts_cursor_t;
+
 /* Contain all information about a chunk */
 typedef struct
 {
@@ -55,9 +62,11 @@ typedef struct
     uint32_t     *p_sample_count_pts;
     int32_t      *p_sample_offset_pts;  /* pts-dts */
 
-    uint32_t     *p_sample_size;
-    /* TODO if needed add pts
-        but quickly *add* support for edts and seeking */
+    /* the dts/pts tables above are only built while the chunk is in use,
+     * starting from these positions in stts and ctts */
+    bool              b_loaded;
+    mp4_xtts_cursor_t dts_cursor;
+    mp4_xtts_cursor_t pts_cursor;
 
 } mp4_chunk_t;
 
@@ -142,8 +151,12 @@ typedef struct
     /* sample size, p_sample_size defined only if i_sample_size == 0
         else i_sample_size is size for all sample */
     uint32_t         i_sample_size;
-    uint32_t         *p_sample_size; /* XXX perhaps add file offset if take
-//                                    too much time to do sumations each time*/
+    /* sizes of i_sample_size_count samples from i_sample_size_first,
+     * covering at least the current chunk */
+    const uint32_t  *p_sample_size;
+    uint32_t         i_sample_size_first;
+    uint32_t         i_sample_size_count;
+    uint32_t        *p_sample_size_window; /* when read on demand */
 
     uint32_t     i_sample_first; /* i_sample_first value
                                                    of the next chunk */
@@ -152,6 +165,10 @@ typedef struct
 
     const MP4_Box_t *p_track;
     const MP4_Box_t *p_stbl;  /* will contain all timing information */
+    const MP4_Box_t *p_stsz;  /* sample tables, for chunks loading */
+    const MP4_Box_t *p_stts;
+    const MP4_Box_t *p_ctts;  /* could be NULL */
+    int64_t          i_cts_shift;
     const MP4_Box_t *p_stsd;  /* will contain all data to initialize decoder */
     const MP4_Box_t *p_sample;/* point on actual sdsd */
 
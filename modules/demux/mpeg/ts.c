@@ -34,6 +34,7 @@
 #include <vlc_access.h>    /* DVB-specific things */
 #include <vlc_demux.h>
 #include <vlc_input.h>
+#include <vlc_atomic.h>
 
 #include "ts_pid.h"
 #include "ts_streams.h"
@@ -120,6 +121,11 @@ static void Close ( vlc_object_t * );
 #define TS_OFFSETFIX_TEXT   "Try to fix too early PCR (or late DTS)"
 #define TS_GENERATED_PCR_OFFSET_TEXT "Offset in ms for generated PCR"
 
+#define ZERO_COPY_TEXT N_("Zero-copy packet reads")
+#define ZERO_COPY_LONGTEXT N_( \
+    "Slice TS packets directly out of the blocks delivered by the access " \
+    "instead of copying each packet out of the stream.")
+
 #define PCR_TEXT N_("Trust in-stream PCR")
 #define PCR_LONGTEXT N_("Use the stream PCR as a reference.")
 
@@ -163,6 +169,7 @@ vlc_module_begin ()
     add_bool( "ts-pcr-offsetfix", true, TS_OFFSETFIX_TEXT, NULL, true )
     add_integer_with_range( "ts-generated-pcr-offset", 120, 0, 500,
                             TS_GENERATED_PCR_OFFSET_TEXT, NULL, true )
+    add_bool( "ts-zero-copy", true, ZERO_COPY_TEXT, ZERO_COPY_LONGTEXT, true )
 
     add_obsolete_bool( "ts-silent" );
 
@@ -196,6 +203,9 @@ static bool GatherPESData( demux_t *p_demux, ts_pid_t *, block_t *, size_t );
 static void ProgramSetPCR( demux_t *p_demux, ts_pmt_t *p_prg, stime_t i_pcr );
 
 static block_t* ReadTSPacket( demux_t *p_demux );
+static void ChunkDrop( demux_sys_t *p_sys );
+static uint64_t StreamTell( demux_sys_t *p_sys );
+static int StreamSeek( demux_sys_t *p_sys, uint64_t i_pos );
 static int SeekToTime( demux_t *p_demux, const ts_pmt_t *, stime_t time );
 static void ReadyQueuesPostSeek( demux_t *p_demux );
 static void PCRHandle( demux_t *p_demux, ts_pid_t *, stime_t );
@@ -404,6 +414,9 @@ static int Open( vlc_object_t *p_this )
     p_sys->i_packet_size = i_packet_size;
     p_sys->i_packet_header_size = i_packet_header_size;
     p_sys->i_ts_read = 50;
+    p_sys->chunk.b_enabled = var_InheritBool( p_demux, "ts-zero-copy" );
+    p_sys->chunk.p_chunk = NULL;
+    p_sys->chunk.i_offset = 0;
     p_sys->csa = NULL;
     p_sys->b_start_record = false;
 
@@ -587,6 +600,8 @@ static void Close( vlc_object_t *p_this )
     /* Release all non default pids */
     ts_pid_list_Release( p_demux, &p_sys->pids );
 
+    ChunkDrop( p_sys );
+
     /* Clear up attachments */
     vlc_dictionary_clear( &p_sys->attachments, FreeDictAttachment, NULL );
 
@@ -952,7 +967,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 
         if( (i64 = stream_Size( p_sys->stream) ) > 0 )
         {
-            uint64_t offset = vlc_stream_Tell( p_sys->stream );
+            uint64_t offset = StreamTell( p_sys );
             *pf = (double)offset / (double)i64;
             return VLC_SUCCESS;
         }
@@ -999,7 +1014,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 
         i64 = stream_Size( p_sys->stream );
         if( i64 > 0 &&
-            vlc_stream_Seek( p_sys->stream, (int64_t)(i64 * f) ) == VLC_SUCCESS )
+            StreamSeek( p_sys, (int64_t)(i64 * f) ) == VLC_SUCCESS )
         {
             ReadyQueuesPostSeek( p_demux );
             return VLC_SUCCESS;
@@ -1145,9 +1160,11 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
     }
 
     case DEMUX_SET_TITLE:
+        ChunkDrop( p_sys );
         return vlc_stream_vaControl( p_sys->stream, STREAM_SET_TITLE, args );
 
     case DEMUX_SET_SEEKPOINT:
+        ChunkDrop( p_sys );
         return vlc_stream_vaControl( p_sys->stream, STREAM_SET_SEEKPOINT,
                                      args );
 
@@ -1758,6 +1775,264 @@ static void PESDataChainHandle( vlc_object_t *p_obj, void *priv, block_t *p_data
     ParsePESDataChain( (demux_t *)p_obj, (ts_pid_t *) priv, p_data );
 }
 
+/*****************************************************************************
+ * Zero-copy packet reads:
+ *  blocks returned by the stream are kept in a refcounted chunk and TS packets
+ *  are handed out as custom blocks pointing inside it. The chunk is released
+ *  once the demuxer moved past it and all its packets have been released.
+ *****************************************************************************/
+struct ts_chunk_t
+{
+    vlc_atomic_rc_t rc;
+    block_t        *p_block;
+};
+
+typedef struct
+{
+    block_t     self;
+    ts_chunk_t *p_chunk;
+} ts_chunk_packet_t;
+
+static void ChunkRelease( ts_chunk_t *p_chunk )
+{
+    if( vlc_atomic_rc_dec( &p_chunk->rc ) )
+    {
+        block_Release( p_chunk->p_block );
+        free( p_chunk );
+    }
+}
+
+static void ChunkPacketRelease( block_t *p_block )
+{
+    ts_chunk_packet_t *p_pkt = container_of( p_block, ts_chunk_packet_t, self );
+    ChunkRelease( p_pkt->p_chunk );
+    free( p_pkt );
+}
+
+static const struct vlc_block_callbacks chunk_packet_cbs =
+{
+    ChunkPacketRelease,
+};
+
+static block_t *ChunkPacketNew( ts_chunk_t *p_chunk, uint8_t *p_data, size_t i_data )
+{
+    ts_chunk_packet_t *p_pkt = malloc( sizeof(*p_pkt) );
+    if( unlikely(p_pkt == NULL) )
+        return NULL;
+
+    block_Init( &p_pkt->self, &chunk_packet_cbs, p_data, i_data );
+    vlc_atomic_rc_inc( &p_chunk->rc );
+    p_pkt->p_chunk = p_chunk;
+    return &p_pkt->self;
+}
+
+static void ChunkDrop( demux_sys_t *p_sys )
+{
+    if( p_sys->chunk.p_chunk )
+    {
+        ChunkRelease( p_sys->chunk.p_chunk );
+        p_sys->chunk.p_chunk = NULL;
+    }
+    p_sys->chunk.i_offset = 0;
+}
+
+static size_t ChunkRemaining( const demux_sys_t *p_sys )
+{
+    if( !p_sys->chunk.p_chunk )
+        return 0;
+    return p_sys->chunk.p_chunk->p_block->i_buffer - p_sys->chunk.i_offset;
+}
+
+static uint8_t * ChunkData( const demux_sys_t *p_sys )
+{
+    return p_sys->chunk.p_chunk->p_block->p_buffer + p_sys->chunk.i_offset;
+}
+
+static bool ChunkRefill( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    block_t *p_block;
+
+    ChunkDrop( p_sys );
+
+    for( ;; )
+    {
+        p_block = vlc_stream_ReadBlock( p_sys->stream );
+        if( p_block == NULL )
+        {
+            if( vlc_stream_Eof( p_sys->stream ) )
+                return false;
+            continue;
+        }
+        if( p_block->p_next )
+            p_block = block_ChainGather( p_block );
+        if( p_block && p_block->i_buffer > 0 )
+            break;
+        if( p_block )
+            block_Release( p_block );
+    }
+
+    ts_chunk_t *p_chunk = malloc( sizeof(*p_chunk) );
+    if( unlikely(p_chunk == NULL) )
+    {
+        block_Release( p_block );
+        return false;
+    }
+    vlc_atomic_rc_init( &p_chunk->rc );
+    p_chunk->p_block = p_block;
+    p_sys->chunk.p_chunk = p_chunk;
+    return true;
+}
+
+static block_t * ChunkReadTSPacket( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const size_t i_size = p_sys->i_packet_size;
+
+    if( ChunkRemaining( p_sys ) == 0 && !ChunkRefill( p_demux ) )
+        return NULL;
+
+    /* Fast path: the whole packet lies within the current block */
+    if( ChunkRemaining( p_sys ) >= i_size )
+    {
+        block_t *p_pkt = ChunkPacketNew( p_sys->chunk.p_chunk,
+                                         ChunkData( p_sys ), i_size );
+        if( p_pkt )
+            p_sys->chunk.i_offset += i_size;
+        return p_pkt;
+    }
+
+    /* Packet straddles stream blocks: gather it */
+    block_t *p_pkt = block_Alloc( i_size );
+    if( unlikely(p_pkt == NULL) )
+        return NULL;
+
+    size_t i_copied = 0;
+    while( i_copied < i_size )
+    {
+        if( ChunkRemaining( p_sys ) == 0 && !ChunkRefill( p_demux ) )
+        {
+            p_pkt->i_buffer = i_copied; /* truncated, as vlc_stream_Block() */
+            break;
+        }
+        size_t i_copy = __MIN( i_size - i_copied, ChunkRemaining( p_sys ) );
+        memcpy( &p_pkt->p_buffer[i_copied], ChunkData( p_sys ), i_copy );
+        p_sys->chunk.i_offset += i_copy;
+        i_copied += i_copy;
+    }
+    return p_pkt;
+}
+
+static bool ChunkResync( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    for( ;; )
+    {
+        const size_t i_data = ChunkRemaining( p_sys );
+        if( i_data < p_sys->i_packet_header_size + p_sys->i_packet_size + 1 )
+        {
+            /* Garbage spanning blocks is dropped along with the remainder */
+            if( !ChunkRefill( p_demux ) )
+            {
+                msg_Dbg( p_demux, "eof ?" );
+                return false;
+            }
+            continue;
+        }
+
+        const uint8_t *p_data = ChunkData( p_sys );
+        const size_t i_end = i_data - p_sys->i_packet_header_size - p_sys->i_packet_size;
+        size_t i_skip = 0;
+        while( i_skip < i_end )
+        {
+            if( p_data[i_skip + p_sys->i_packet_header_size] == 0x47 &&
+                p_data[i_skip + p_sys->i_packet_header_size + p_sys->i_packet_size] == 0x47 )
+                break;
+            i_skip++;
+        }
+        msg_Dbg( p_demux, "skipping %zu bytes of garbage", i_skip );
+        p_sys->chunk.i_offset += i_skip;
+        if( i_skip < i_end )
+            return true;
+    }
+}
+
+static uint64_t StreamTell( demux_sys_t *p_sys )
+{
+    /* Data sliced out of the current chunk was not consumed yet */
+    uint64_t i_pos = vlc_stream_Tell( p_sys->stream );
+    size_t i_left = ChunkRemaining( p_sys );
+    return ( i_pos > i_left ) ? i_pos - i_left : 0;
+}
+
+static int StreamSeek( demux_sys_t *p_sys, uint64_t i_pos )
+{
+    ChunkDrop( p_sys );
+    return vlc_stream_Seek( p_sys->stream, i_pos );
+}
+
+void TsFlushReadAhead( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const size_t i_left = ChunkRemaining( p_sys );
+
+    /* Rewind, so that the next stream reads it again */
+    if( i_left > 0 && StreamSeek( p_sys, StreamTell( p_sys ) ) != VLC_SUCCESS )
+        msg_Warn( p_demux, "dropping %zu bytes read ahead", i_left );
+    ChunkDrop( p_sys );
+}
+
+static block_t * StreamReadTSPacket( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( p_sys->chunk.b_enabled )
+        return ChunkReadTSPacket( p_demux );
+    return vlc_stream_Block( p_sys->stream, p_sys->i_packet_size );
+}
+
+static bool StreamResync( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( p_sys->chunk.b_enabled )
+        return ChunkResync( p_demux );
+
+    for( ;; )
+    {
+        const uint8_t *p_peek;
+        int i_peek = 0;
+        unsigned i_skip = 0;
+
+        i_peek = vlc_stream_Peek( p_sys->stream, &p_peek,
+                p_sys->i_packet_size * 10 );
+        if( i_peek < 0 || (unsigned)i_peek < p_sys->i_packet_size + 1 )
+        {
+            msg_Dbg( p_demux, "eof ?" );
+            return false;
+        }
+
+        while( i_skip < i_peek - p_sys->i_packet_size )
+        {
+            if( p_peek[i_skip + p_sys->i_packet_header_size] == 0x47 &&
+                    p_peek[i_skip + p_sys->i_packet_header_size + p_sys->i_packet_size] == 0x47 )
+            {
+                break;
+            }
+            i_skip++;
+        }
+        msg_Dbg( p_demux, "skipping %d bytes of garbage", i_skip );
+        if (vlc_stream_Read( p_sys->stream, NULL, i_skip ) != i_skip)
+            return false;
+
+        if( i_skip < i_peek - p_sys->i_packet_size )
+        {
+            return true;
+        }
+    }
+}
+
 static block_t* ReadTSPacket( demux_t *p_demux )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
@@ -1765,13 +2040,13 @@ static block_t* ReadTSPacket( demux_t *p_demux )
     block_t     *p_pkt;
 
     /* Get a new TS packet */
-    if( !( p_pkt = vlc_stream_Block( p_sys->stream, p_sys->i_packet_size ) ) )
+    if( !( p_pkt = StreamReadTSPacket( p_demux ) ) )
     {
         int64_t size = stream_Size( p_sys->stream );
-        if( size >= 0 && (uint64_t)size == vlc_stream_Tell( p_sys->stream ) )
-            msg_Dbg( p_demux, "EOF at %"PRIu64, vlc_stream_Tell( p_sys->stream ) );
+        if( size >= 0 && (uint64_t)size == StreamTell( p_sys ) )
+            msg_Dbg( p_demux, "EOF at %"PRIu64, StreamTell( p_sys ) );
         else
-            msg_Dbg( p_demux, "Can't read TS packet at %"PRIu64, vlc_stream_Tell(p_sys->stream) );
+            msg_Dbg( p_demux, "Can't read TS packet at %"PRIu64, StreamTell( p_sys ) );
         return NULL;
     }
 
@@ -1793,39 +2068,9 @@ static block_t* ReadTSPacket( demux_t *p_demux )
     {
         msg_Warn( p_demux, "lost synchro" );
         block_Release( p_pkt );
-        for( ;; )
-        {
-            const uint8_t *p_peek;
-            int i_peek = 0;
-            unsigned i_skip = 0;
-
-            i_peek = vlc_stream_Peek( p_sys->stream, &p_peek,
-                    p_sys->i_packet_size * 10 );
-            if( i_peek < 0 || (unsigned)i_peek < p_sys->i_packet_size + 1 )
-            {
-                msg_Dbg( p_demux, "eof ?" );
-                return NULL;
-            }
-
-            while( i_skip < i_peek - p_sys->i_packet_size )
-            {
-                if( p_peek[i_skip + p_sys->i_packet_header_size] == 0x47 &&
-                        p_peek[i_skip + p_sys->i_packet_header_size + p_sys->i_packet_size] == 0x47 )
-                {
-                    break;
-                }
-                i_skip++;
-            }
-            msg_Dbg( p_demux, "skipping %d bytes of garbage", i_skip );
-            if (vlc_stream_Read( p_sys->stream, NULL, i_skip ) != i_skip)
-                return NULL;
-
-            if( i_skip < i_peek - p_sys->i_packet_size )
-            {
-                break;
-            }
-        }
-        if( !( p_pkt = vlc_stream_Block( p_sys->stream, p_sys->i_packet_size ) ) )
+        if( !StreamResync( p_demux ) )
+            return NULL;
+        if( !( p_pkt = StreamReadTSPacket( p_demux ) ) )
         {
             msg_Dbg( p_demux, "eof ?" );
             return NULL;
@@ -1942,13 +2187,13 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, stime_t i_scaled
 
     /* Deal with common but worst binary search case */
     if( p_pmt->pcr.i_first == i_scaledtime && p_sys->b_canseek )
-        return vlc_stream_Seek( p_sys->stream, 0 );
+        return StreamSeek( p_sys, 0 );
 
     const int64_t i_stream_size = stream_Size( p_sys->stream );
     if( !p_sys->b_canfastseek || i_stream_size < p_sys->i_packet_size )
         return VLC_EGENERIC;
 
-    const uint64_t i_initial_pos = vlc_stream_Tell( p_sys->stream );
+    const uint64_t i_initial_pos = StreamTell( p_sys );
 
     /* Find the time position by using binary search algorithm. */
     uint64_t i_head_pos = 0;
@@ -1964,7 +2209,7 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, stime_t i_scaled
         uint64_t i_div = i_splitpos % p_sys->i_packet_size;
         i_splitpos -= i_div;
 
-        if ( vlc_stream_Seek( p_sys->stream, i_splitpos ) != VLC_SUCCESS )
+        if ( StreamSeek( p_sys, i_splitpos ) != VLC_SUCCESS )
             break;
 
         uint64_t i_pos = i_splitpos;
@@ -1978,7 +2223,7 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, stime_t i_scaled
                 break;
             }
             else
-                i_pos = vlc_stream_Tell( p_sys->stream );
+                i_pos = StreamTell( p_sys );
 
             int i_pid = PIDGet( p_pkt );
             ts_pid_t *p_pid = GetPID(p_sys, i_pid);
@@ -2035,7 +2280,7 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, stime_t i_scaled
     if( !b_found )
     {
         msg_Dbg( p_demux, "Seek():cannot find a time position." );
-        if( vlc_stream_Seek( p_sys->stream, i_initial_pos ) != VLC_SUCCESS )
+        if( StreamSeek( p_sys, i_initial_pos ) != VLC_SUCCESS )
             msg_Err( p_demux, "Can't seek back to %" PRIu64, i_initial_pos );
         return VLC_EGENERIC;
     }
@@ -2117,7 +2362,7 @@ static int ProbeChunk( demux_t *p_demux, int i_program, bool b_end, stime_t *pi_
                         if( b_end )
                         {
                             p_pmt->i_last_dts = *pi_pcr;
-                            p_pmt->i_last_dts_byte = vlc_stream_Tell( p_sys->stream );
+                            p_pmt->i_last_dts_byte = StreamTell( p_sys );
                         }
                         /* Start, only keep first */
                         else if( b_pcrresult && p_pmt->pcr.i_first == -1 )
@@ -2145,7 +2390,7 @@ static int ProbeChunk( demux_t *p_demux, int i_program, bool b_end, stime_t *pi_
 int ProbeStart( demux_t *p_demux, int i_program )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
-    const uint64_t i_initial_pos = vlc_stream_Tell( p_sys->stream );
+    const uint64_t i_initial_pos = StreamTell( p_sys );
     int64_t i_stream_size = stream_Size( p_sys->stream );
 
     int i_probe_count = 0;
@@ -2158,7 +2403,7 @@ int ProbeStart( demux_t *p_demux, int i_program )
         i_pos = p_sys->i_packet_size * i_probe_count;
         i_pos = __MIN( i_pos, i_stream_size );
 
-        if( vlc_stream_Seek( p_sys->stream, i_pos ) )
+        if( StreamSeek( p_sys, i_pos ) )
             return VLC_EGENERIC;
 
         ProbeChunk( p_demux, i_program, false, &i_pcr, &b_found );
@@ -2168,7 +2413,7 @@ int ProbeStart( demux_t *p_demux, int i_program )
     } while( i_pos < i_stream_size && !b_found &&
              i_probe_count < PROBE_MAX );
 
-    if( vlc_stream_Seek( p_sys->stream, i_initial_pos ) )
+    if( StreamSeek( p_sys, i_initial_pos ) )
         return VLC_EGENERIC;
 
     return (b_found) ? VLC_SUCCESS : VLC_EGENERIC;
@@ -2177,7 +2422,7 @@ int ProbeStart( demux_t *p_demux, int i_program )
 int ProbeEnd( demux_t *p_demux, int i_program )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
-    const uint64_t i_initial_pos = vlc_stream_Tell( p_sys->stream );
+    const uint64_t i_initial_pos = StreamTell( p_sys );
     int64_t i_stream_size = stream_Size( p_sys->stream );
 
     int i_probe_count = PROBE_CHUNK_COUNT;
@@ -2190,7 +2435,7 @@ int ProbeEnd( demux_t *p_demux, int i_program )
         i_pos = i_stream_size - (p_sys->i_packet_size * i_probe_count);
         i_pos = __MAX( i_pos, 0 );
 
-        if( vlc_stream_Seek( p_sys->stream, i_pos ) )
+        if( StreamSeek( p_sys, i_pos ) )
             return VLC_EGENERIC;
 
         ProbeChunk( p_demux, i_program, true, &i_pcr, &b_found );
@@ -2200,7 +2445,7 @@ int ProbeEnd( demux_t *p_demux, int i_program )
     } while( i_pos > 0 && !b_found &&
              i_probe_count < PROBE_MAX );
 
-    if( vlc_stream_Seek( p_sys->stream, i_initial_pos ) )
+    if( StreamSeek( p_sys, i_initial_pos ) )
         return VLC_EGENERIC;
 
     return (b_found) ? VLC_SUCCESS : VLC_EGENERIC;
@@ -2251,14 +2496,14 @@ static void ProgramSetPCR( demux_t *p_demux, ts_pmt_t *p_pmt, stime_t i_pcr )
         es_out_Control( p_demux->out, ES_OUT_SET_GROUP_PCR, p_pmt->i_number, FROM_SCALE(i_pcr) );
         /* growing files/named fifo handling */
         if( p_sys->b_access_control == false &&
-            vlc_stream_Tell( p_sys->stream ) > p_pmt->i_last_dts_byte )
+            StreamTell( p_sys ) > p_pmt->i_last_dts_byte )
         {
             if( p_pmt->i_last_dts_byte == 0 ) /* first run */
                 p_pmt->i_last_dts_byte = stream_Size( p_sys->stream );
             else
             {
                 p_pmt->i_last_dts = i_pcr;
-                p_pmt->i_last_dts_byte = vlc_stream_Tell( p_sys->stream );
+                p_pmt->i_last_dts_byte = StreamTell( p_sys );
             }
         }
     }
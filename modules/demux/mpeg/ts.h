@@ -24,6 +24,7 @@
     typedef struct arib_instance_t arib_instance_t;
 #endif
 typedef struct csa_t csa_t;
+typedef struct ts_chunk_t ts_chunk_t;
 
 #define TS_USER_PMT_NUMBER (0)
 
@@ -71,6 +72,14 @@ struct demux_sys_t
     /* how many TS packet we read at once */
     unsigned    i_ts_read;
 
+    /* Stream block being sliced into TS packets (zero-copy reads) */
+    struct
+    {
+        bool        b_enabled;
+        ts_chunk_t *p_chunk;
+        size_t      i_offset; /* read offset within the chunk block */
+    } chunk;
+
     bool        b_cc_check;
     bool        b_ignore_time_for_positions;
 
@@ -146,6 +155,9 @@ struct demux_sys_t
 
 void TsChangeStandard( demux_sys_t *, ts_standards_e );
 
+/* Gives back the data read ahead from p_sys->stream, before it is replaced */
+void TsFlushReadAhead( demux_t *p_demux );
+
 bool ProgramIsSelected( demux_sys_t *, uint16_t i_pgrm );
 
 void UpdatePESFilters( demux_t *p_demux, bool b_all );
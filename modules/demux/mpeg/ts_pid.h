@@ -47,6 +47,10 @@ enum
     FLAG_FILTERED = 4
 };
 
+#define PID_INDEX_COLS_BITS 6
+#define PID_INDEX_COLS (1 << PID_INDEX_COLS_BITS)
+#define PID_INDEX_ROWS (8192 >> PID_INDEX_COLS_BITS)
+
 #define SEEN(x) ((x)->i_flags & FLAG_SEEN)
 #define SCRAMBLED(x) ((x).i_flags & FLAG_SCRAMBLED)
 #define PREVPKTKEEPBYTES 16
@@ -93,10 +97,8 @@ struct ts_pid_list_t
     ts_pid_t **pp_all;
     int        i_all;
     int        i_all_alloc;
-    /* last recently used */
-    uint16_t   i_last_pid;
-    ts_pid_t  *p_last;
-
+    /* direct lookup: two level table indexed by pid, allocated on demand */
+    ts_pid_t **pp_index[PID_INDEX_ROWS];
 };
 
 /* opacified pid list */
@@ -26,7 +26,10 @@
 # include "config.h"
 #endif
 
+#include <assert.h>
+
 #include <vlc_common.h>
+#include <vlc_cpu.h>
 
 #include "csa.h"
 
@@ -55,6 +58,21 @@ static void csa_StreamCypher( csa_t *c, int b_init, uint8_t *ck, uint8_t *sb, ui
 
 static void csa_BlockDecypher( uint8_t kk[57], uint8_t ib[8], uint8_t bd[8] );
 static void csa_BlockCypher( uint8_t kk[57], uint8_t bd[8], uint8_t ib[8] );
+static void csa_BlockRoundInit( uint64_t table[256] );
+static void csa_BlockCypherLanes( const uint8_t kk[57], const uint64_t table[256],
+                                  uint8_t *const *pp_data, const int *pi_len,
+                                  int i_count );
+
+static void csa_StreamBatch64( const uint8_t ck[8], uint8_t *const *pp_data,
+                               const int *pi_len, int i_count );
+#if defined(CAN_COMPILE_SSE2) || defined(HAVE_SSE2_INTRINSICS)
+static void csa_StreamBatchSSE2( const uint8_t ck[8], uint8_t *const *pp_data,
+                                 const int *pi_len, int i_count );
+#endif
+#if defined(CAN_COMPILE_AVX2) || defined(HAVE_AVX2_INTRINSICS)
+static void csa_StreamBatchAVX2( const uint8_t ck[8], uint8_t *const *pp_data,
+                                 const int *pi_len, int i_count );
+#endif
 
 /*****************************************************************************
  * csa_New:
@@ -135,6 +153,19 @@ int csa_UseKey( vlc_object_t *p_caller, csa_t *c, bool use_odd )
     return VLC_SUCCESS;
 }
 
+/*****************************************************************************
+ * csa_CopyKeys: copies the control words and the key in use, so that
+ * another thread can scramble with its own cypher state
+ *****************************************************************************/
+void csa_CopyKeys( csa_t *dst, const csa_t *src )
+{
+    memcpy( dst->o_ck, src->o_ck, sizeof(dst->o_ck) );
+    memcpy( dst->e_ck, src->e_ck, sizeof(dst->e_ck) );
+    memcpy( dst->o_kk, src->o_kk, sizeof(dst->o_kk) );
+    memcpy( dst->e_kk, src->e_kk, sizeof(dst->e_kk) );
+    dst->use_odd = src->use_odd;
+}
+
 /*****************************************************************************
  * csa_Decrypt:
  *****************************************************************************/
@@ -307,6 +338,109 @@ void csa_Encrypt( csa_t *c, uint8_t *pkt, int i_pkt_size )
     }
 }
 
+/*****************************************************************************
+ * csa_EncryptBatch: scrambles i_count packets with the current key
+ *****************************************************************************
+ * The output is the same as calling csa_Encrypt on every packet, but the
+ * stream cypher runs bitsliced, over as many packets at once as the CPU
+ * word allows.
+ *****************************************************************************/
+#define CSA_BATCH_MAX 256
+/* below that, the bitsliced stream cypher is slower than the scalar one */
+#define CSA_BATCH_MIN 8
+
+typedef void (*csa_stream_batch_t)( const uint8_t ck[8], uint8_t *const *pp_data,
+                                    const int *pi_len, int i_count );
+
+static void csa_EncryptLanes( csa_t *c, csa_stream_batch_t pf_stream, int i_lanes,
+                              uint8_t **pp_pkts, int i_count, int i_pkt_size )
+{
+    uint8_t *ck = c->use_odd ? c->o_ck : c->e_ck;
+    uint8_t *kk = c->use_odd ? c->o_kk : c->e_kk;
+    uint64_t block_round[256];
+
+    if( i_count >= CSA_BATCH_MIN )
+        csa_BlockRoundInit( block_round );
+
+    while( i_count >= CSA_BATCH_MIN )
+    {
+        uint8_t *pp_data[CSA_BATCH_MAX];
+        int      pi_len[CSA_BATCH_MAX];
+        int      i_batch = __MIN( i_count, i_lanes );
+        int      i_data = 0;
+
+        for( int i = 0; i < i_batch; i++ )
+        {
+            uint8_t *pkt = pp_pkts[i];
+
+            /* set transport scrambling control */
+            pkt[3] |= c->use_odd ? 0xc0 : 0x80;
+
+            int i_hdr = 4;
+            if( pkt[3]&0x20 )
+            {
+                /* skip adaption field */
+                i_hdr += pkt[4] + 1;
+            }
+            const int n = (i_pkt_size - i_hdr) / 8;
+
+            if( n <= 0 )
+            {
+                pkt[3] &= 0x3f;
+                continue;
+            }
+
+            /* the payload goes through the block cypher, then its first
+             * block initializes the stream cypher, whose output is xored
+             * with the rest of the packet */
+            pp_data[i_data] = &pkt[i_hdr];
+            pi_len[i_data] = i_pkt_size - i_hdr - 8;
+            i_data++;
+        }
+
+        if( i_data > 0 )
+        {
+            csa_BlockCypherLanes( kk, block_round, pp_data, pi_len, i_data );
+            pf_stream( ck, pp_data, pi_len, i_data );
+        }
+
+        pp_pkts += i_batch;
+        i_count -= i_batch;
+    }
+
+    for( int i = 0; i < i_count; i++ )
+        csa_Encrypt( c, pp_pkts[i], i_pkt_size );
+}
+
+void csa_EncryptBatch( csa_t *c, uint8_t **pp_pkts, int i_count, int i_pkt_size )
+{
+    csa_stream_batch_t pf_stream;
+    int i_lanes;
+
+#if defined(CAN_COMPILE_AVX2) || defined(HAVE_AVX2_INTRINSICS)
+    if( vlc_CPU_AVX2() )
+    {
+        pf_stream = csa_StreamBatchAVX2;
+        i_lanes = 256;
+    }
+    else
+#endif
+#if defined(CAN_COMPILE_SSE2) || defined(HAVE_SSE2_INTRINSICS)
+    if( vlc_CPU_SSE2() )
+    {
+        pf_stream = csa_StreamBatchSSE2;
+        i_lanes = 128;
+    }
+    else
+#endif
+    {
+        pf_stream = csa_StreamBatch64;
+        i_lanes = 64;
+    }
+
+    csa_EncryptLanes( c, pf_stream, i_lanes, pp_pkts, i_count, i_pkt_size );
+}
+
 /*****************************************************************************
  * Divers
  *****************************************************************************/
@@ -493,6 +627,48 @@ static void csa_StreamCypher( csa_t *c, int b_init, uint8_t *ck, uint8_t *sb, ui
     }
 }
 
+/* truth tables of the high and low output bits of sbox1..sbox7 */
+static const uint32_t csa_sbox_tt[7][2] =
+{
+    { 0x4B368771, 0x78C6B16C },
+    { 0x58B98679, 0xE41B4B63 },
+    { 0x69D25879, 0xE41B1BE4 },
+    { 0x66B492AD, 0x92AD994B },
+    { 0x9C274CF1, 0x35E29E58 },
+    { 0x691BB46C, 0x66D2E61A },
+    { 0xB38C691E, 0x266D9D92 },
+};
+
+#define CSA_BS_WORD         uint64_t
+#define CSA_BS_FUNC(name)   csa_StreamBatch64##name
+#define CSA_BS_TARGET
+#include "csa_bs.h"
+#undef CSA_BS_TARGET
+#undef CSA_BS_FUNC
+#undef CSA_BS_WORD
+
+#if defined(CAN_COMPILE_SSE2) || defined(HAVE_SSE2_INTRINSICS)
+# include <emmintrin.h>
+# define CSA_BS_WORD        __m128i
+# define CSA_BS_FUNC(name)  csa_StreamBatchSSE2##name
+# define CSA_BS_TARGET      __attribute__ ((__target__ ("sse2")))
+# include "csa_bs.h"
+# undef CSA_BS_TARGET
+# undef CSA_BS_FUNC
+# undef CSA_BS_WORD
+#endif
+
+#if defined(CAN_COMPILE_AVX2) || defined(HAVE_AVX2_INTRINSICS)
+# include <immintrin.h>
+# define CSA_BS_WORD        __m256i
+# define CSA_BS_FUNC(name)  csa_StreamBatchAVX2##name
+# define CSA_BS_TARGET      __attribute__ ((__target__ ("avx2")))
+# include "csa_bs.h"
+# undef CSA_BS_TARGET
+# undef CSA_BS_FUNC
+# undef CSA_BS_WORD
+#endif
+
 
 // block - sbox
 static const uint8_t block_sbox[256] =
@@ -610,3 +786,64 @@ static void csa_BlockCypher( uint8_t kk[57], uint8_t bd[8], uint8_t ib[8] )
     }
 }
 
+/* The same block cypher, with R[1]..R[8] in the bytes of a 64 bits word.
+ * One round shifts the register down, xors R[1] into R[2], R[3], R[4] and
+ * R[8], and the sbox and perm outputs of kk[i]^R[8], which are looked up
+ * together, into R[8] and R[6]. */
+static void csa_BlockRoundInit( uint64_t table[256] )
+{
+    for( int i = 0; i < 256; i++ )
+    {
+        const uint64_t sbox_out = block_sbox[i];
+
+        table[i] = (sbox_out << 56) | ((uint64_t)block_perm[sbox_out] << 40);
+    }
+}
+
+/* Runs the block cypher backwards over the packets payloads, as csa_Encrypt
+ * does, in place. The packets are processed together so that the rounds of
+ * different packets overlap. */
+static void csa_BlockCypherLanes( const uint8_t kk[57], const uint64_t table[256],
+                                  uint8_t *const *pp_data, const int *pi_len,
+                                  int i_count )
+{
+    uint64_t R[256], ib[256];
+    int i_blocks = 0;
+
+    assert( i_count <= 256 );
+    for( int l = 0; l < i_count; l++ )
+    {
+        ib[l] = 0;
+        i_blocks = __MAX( i_blocks, (pi_len[l] + 8) / 8 );
+    }
+
+    for( int t = 0; t < i_blocks; t++ )
+    {
+        for( int l = 0; l < i_count; l++ )
+        {
+            const int j = (pi_len[l] + 8) / 8 - 1 - t;
+
+            R[l] = j >= 0 ? GetQWLE( &pp_data[l][8 * j] ) ^ ib[l] : 0;
+        }
+
+        for( int i = 1; i <= 56; i++ )
+            for( int l = 0; l < i_count; l++ )
+            {
+                const uint64_t r = R[l];
+
+                R[l] = (r >> 8) ^ ((r & 0xff) * UINT64_C(0x0100000001010100))
+                     ^ table[kk[i] ^ (r >> 56)];
+            }
+
+        for( int l = 0; l < i_count; l++ )
+        {
+            const int j = (pi_len[l] + 8) / 8 - 1 - t;
+
+            if( j >= 0 )
+            {
+                SetQWLE( &pp_data[l][8 * j], R[l] );
+                ib[l] = R[l];
+            }
+        }
+    }
+}
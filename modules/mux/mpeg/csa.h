@@ -28,16 +28,20 @@ typedef struct csa_t csa_t;
 #define csa_Delete  __csa_Delete
 #define csa_SetCW  __csa_SetCW
 #define csa_UseKey  __csa_UseKey
+#define csa_CopyKeys __csa_CopyKeys
 #define csa_Decrypt __csa_decrypt
 #define csa_Encrypt __csa_encrypt
+#define csa_EncryptBatch __csa_encrypt_batch
 
 csa_t *csa_New( void );
 void   csa_Delete( csa_t * );
 
 int    csa_SetCW( vlc_object_t *p_caller, csa_t *c, char *psz_ck, bool odd );
 int    csa_UseKey( vlc_object_t *p_caller, csa_t *, bool use_odd );
+void   csa_CopyKeys( csa_t *dst, const csa_t *src );
 
 void   csa_Decrypt( csa_t *, uint8_t *pkt, int i_pkt_size );
 void   csa_Encrypt( csa_t *, uint8_t *pkt, int i_pkt_size );
+void   csa_EncryptBatch( csa_t *, uint8_t **pp_pkts, int i_count, int i_pkt_size );
 
 #endif /* _CSA_H */
@@ -0,0 +1,261 @@
+/*****************************************************************************
+ * csa_bs.h: bitsliced CSA stream cypher
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* This file is included by csa.c once per word type, with:
+ *  CSA_BS_WORD:   the word type, one lane (packet) per bit,
+ *  CSA_BS_FUNC:   the name of the generated function,
+ *  CSA_BS_TARGET: the function attributes needed by the word type.
+ *
+ * Every variable of the cypher state is stored as one word per bit, bit l
+ * of each word belonging to the packet of lane l, so that one boolean
+ * operation runs the cypher for all the lanes at once. The s-boxes are
+ * evaluated from their truth tables with multiplexers. */
+
+#define W         CSA_BS_WORD
+#define W_LANES   (8 * (int)sizeof (W))
+#define W_WORDS   (sizeof (W) / sizeof (uint64_t))
+#define CSA_BS_HISTORY 64
+
+/* c ? a : b */
+#define SEL(c, a, b) ((b) ^ (((a) ^ (b)) & (c)))
+
+CSA_BS_TARGET
+static inline void CSA_BS_FUNC(Sbox)( const uint32_t tt[2],
+                                      const W *x4, const W *x3, const W *x2,
+                                      const W *x1, const W *x0,
+                                      W *hi, W *lo )
+{
+    const W zero = { 0 };
+    const W a = *x1, b = *x0;
+    /* all the functions of x1 and x0, indexed by their truth table */
+    const W f2[16] = {
+        zero,      ~(a | b), b & ~a,  ~a,
+        a & ~b,    ~b,       a ^ b,   ~(a & b),
+        a & b,     ~(a ^ b), b,       b | ~a,
+        a,         a | ~b,   a | b,   ~zero,
+    };
+    W *out[2] = { hi, lo };
+
+    for( int o = 0; o < 2; o++ )
+    {
+        W m[8];
+
+        for( int k = 0; k < 8; k++ )
+            m[k] = f2[(tt[o] >> (4 * k)) & 15];
+        for( int k = 0; k < 4; k++ )
+            m[k] = SEL( *x2, m[2*k+1], m[2*k] );
+        for( int k = 0; k < 2; k++ )
+            m[k] = SEL( *x3, m[2*k+1], m[2*k] );
+        *out[o] = SEL( *x4, m[1], m[0] );
+    }
+}
+
+/* Converts 8 bytes between lanes and bit planes: 8 lanes of byte i become
+ * byte i of the 8 planes, and the other way around. */
+static inline uint64_t CSA_BS_FUNC(Transpose)( uint64_t x )
+{
+    uint64_t t;
+
+    t = (x ^ (x >> 7)) & UINT64_C(0x00AA00AA00AA00AA);
+    x ^= t ^ (t << 7);
+    t = (x ^ (x >> 14)) & UINT64_C(0x0000CCCC0000CCCC);
+    x ^= t ^ (t << 14);
+    t = (x ^ (x >> 28)) & UINT64_C(0x00000000F0F0F0F0);
+    x ^= t ^ (t << 28);
+    return x;
+}
+
+/* Runs the stream cypher over up to W_LANES packets: it is initialized with
+ * the 8 bytes at pp_data[l], then its output is xored into the following
+ * pi_len[l] bytes, as csa_Encrypt does. */
+CSA_BS_TARGET
+static void CSA_BS_FUNC()( const uint8_t ck[8], uint8_t *const *pp_data,
+                           const int *pi_len, int i_count )
+{
+    const W zero = { 0 };
+    const W ones = ~zero;
+    /* A[1]..A[10] and B[1]..B[10] slide down their buffers as they are
+     * shifted, and are moved back to the top once at the bottom */
+    W A_buf[CSA_BS_HISTORY + 11][4], B_buf[CSA_BS_HISTORY + 11][4];
+    W (*A)[4] = &A_buf[CSA_BS_HISTORY];
+    W (*B)[4] = &B_buf[CSA_BS_HISTORY];
+    W X[4], Y[4], Z[4], D[4], E[4], F[4];
+    W p, q, r;
+    W sb[8][8];
+    const int i_groups = (i_count + 7) / 8;
+    int i_len = 0;
+
+    assert( i_count > 0 && i_count <= W_LANES );
+    for( int l = 0; l < i_count; l++ )
+        i_len = __MAX( i_len, pi_len[l] );
+
+    /* load the first 32 bits of CK into A[1]..A[8], the last ones into
+     * B[1]..B[8], all the other registers are zeroed */
+    for( int i = 0; i < 4; i++ )
+        for( int b = 0; b < 4; b++ )
+        {
+            A[1+2*i+0][b] = (ck[i] >> (4 + b)) & 1 ? ones : zero;
+            A[1+2*i+1][b] = (ck[i] >> b) & 1 ? ones : zero;
+            B[1+2*i+0][b] = (ck[4+i] >> (4 + b)) & 1 ? ones : zero;
+            B[1+2*i+1][b] = (ck[4+i] >> b) & 1 ? ones : zero;
+        }
+    for( int b = 0; b < 4; b++ )
+    {
+        A[9][b] = A[10][b] = B[9][b] = B[10][b] = zero;
+        X[b] = Y[b] = Z[b] = D[b] = E[b] = F[b] = zero;
+    }
+    p = q = r = zero;
+
+    /* bit planes of the initialization bytes */
+    for( int i = 0; i < 8; i++ )
+    {
+        uint64_t planes[8][W_WORDS];
+
+        memset( planes, 0, sizeof(planes) );
+        for( int g = 0; g < i_groups; g++ )
+        {
+            uint64_t x = 0;
+
+            for( int j = 0; j < 8 && 8 * g + j < i_count; j++ )
+                x |= (uint64_t)pp_data[8*g+j][i] << (8 * j);
+            x = CSA_BS_FUNC(Transpose)( x );
+            for( int b = 0; b < 8; b++ )
+                planes[b][g / 8] |= ((x >> (8 * b)) & 0xff) << (8 * (g % 8));
+        }
+        for( int b = 0; b < 8; b++ )
+            memcpy( &sb[i][b], planes[b], sizeof(W) );
+    }
+
+    /* 8 bytes of initialization, then the stream */
+    for( int i = -8; i < i_len; i++ )
+    {
+        const bool b_init = i < 0;
+        W op[8];
+
+        for( int j = 0; j < 4; j++ )
+        {
+            W s[7][2], extra_B[4], next_A1[4], next_B1[4];
+
+            CSA_BS_FUNC(Sbox)( csa_sbox_tt[0], &A[4][0], &A[1][2], &A[6][1],
+                               &A[7][3], &A[9][0], &s[0][0], &s[0][1] );
+            CSA_BS_FUNC(Sbox)( csa_sbox_tt[1], &A[2][1], &A[3][2], &A[6][3],
+                               &A[7][0], &A[9][1], &s[1][0], &s[1][1] );
+            CSA_BS_FUNC(Sbox)( csa_sbox_tt[2], &A[1][3], &A[2][0], &A[5][1],
+                               &A[5][3], &A[6][2], &s[2][0], &s[2][1] );
+            CSA_BS_FUNC(Sbox)( csa_sbox_tt[3], &A[3][3], &A[1][1], &A[2][3],
+                               &A[4][2], &A[8][0], &s[3][0], &s[3][1] );
+            CSA_BS_FUNC(Sbox)( csa_sbox_tt[4], &A[5][2], &A[4][3], &A[6][0],
+                               &A[8][1], &A[9][2], &s[4][0], &s[4][1] );
+            CSA_BS_FUNC(Sbox)( csa_sbox_tt[5], &A[3][1], &A[4][1], &A[5][0],
+                               &A[7][2], &A[9][3], &s[5][0], &s[5][1] );
+            CSA_BS_FUNC(Sbox)( csa_sbox_tt[6], &A[2][2], &A[3][0], &A[7][1],
+                               &A[8][2], &A[8][3], &s[6][0], &s[6][1] );
+
+            /* 4x4 xor to produce the extra nibble for T3 */
+            extra_B[3] = B[3][0] ^ B[6][1] ^ B[7][2] ^ B[9][3];
+            extra_B[2] = B[6][0] ^ B[8][1] ^ B[3][3] ^ B[4][2];
+            extra_B[1] = B[5][3] ^ B[8][2] ^ B[4][0] ^ B[5][1];
+            extra_B[0] = B[9][2] ^ B[6][3] ^ B[3][1] ^ B[8][0];
+
+            /* T1 and T2, the input byte is only used during initialisation */
+            for( int b = 0; b < 4; b++ )
+            {
+                next_A1[b] = A[10][b] ^ X[b];
+                next_B1[b] = B[7][b] ^ B[10][b] ^ Y[b];
+                if( b_init )
+                {
+                    next_A1[b] ^= D[b] ^ sb[i + 8][(j % 2) ? b : 4 + b];
+                    next_B1[b] ^= sb[i + 8][(j % 2) ? 4 + b : b];
+                }
+            }
+
+            /* if p=1, rotate next_B1 left */
+            W b3 = next_B1[3];
+            for( int b = 3; b > 0; b-- )
+                next_B1[b] = SEL( p, next_B1[b-1], next_B1[b] );
+            next_B1[0] = SEL( p, b3, next_B1[0] );
+
+            /* T3 */
+            for( int b = 0; b < 4; b++ )
+                D[b] = E[b] ^ Z[b] ^ extra_B[b];
+
+            /* T4 = sum, carry of Z + E + r if q=1, E otherwise */
+            W carry = r;
+            for( int b = 0; b < 4; b++ )
+            {
+                const W next_E = F[b];
+                const W sum = Z[b] ^ E[b] ^ carry;
+
+                carry = (Z[b] & E[b]) | (carry & (Z[b] ^ E[b]));
+                F[b] = SEL( q, sum, E[b] );
+                E[b] = next_E;
+            }
+            r = SEL( q, carry, r );
+
+            if( A == A_buf )
+            {
+                memcpy( &A_buf[CSA_BS_HISTORY + 1], &A_buf[1], 10 * sizeof(A[1]) );
+                memcpy( &B_buf[CSA_BS_HISTORY + 1], &B_buf[1], 10 * sizeof(B[1]) );
+                A = &A_buf[CSA_BS_HISTORY];
+                B = &B_buf[CSA_BS_HISTORY];
+            }
+            A--;
+            B--;
+            memcpy( &A[1], next_A1, sizeof(A[1]) );
+            memcpy( &B[1], next_B1, sizeof(B[1]) );
+
+            X[3] = s[3][1]; X[2] = s[2][1]; X[1] = s[1][0]; X[0] = s[0][0];
+            Y[3] = s[5][1]; Y[2] = s[4][1]; Y[1] = s[3][0]; Y[0] = s[2][0];
+            Z[3] = s[1][1]; Z[2] = s[0][1]; Z[1] = s[5][0]; Z[0] = s[4][0];
+            p = s[6][0];
+            q = s[6][1];
+
+            /* 2 output bits are a function of the 4 bits of D */
+            op[7-2*j] = D[3] ^ D[2];
+            op[6-2*j] = D[1] ^ D[0];
+        }
+
+        if( b_init )
+            continue;
+
+        /* back from bit planes to the lanes */
+        uint64_t planes[8][W_WORDS];
+
+        for( int b = 0; b < 8; b++ )
+            memcpy( planes[b], &op[b], sizeof(W) );
+        for( int g = 0; g < i_groups; g++ )
+        {
+            uint64_t x = 0;
+
+            for( int b = 0; b < 8; b++ )
+                x |= ((planes[b][g / 8] >> (8 * (g % 8))) & 0xff) << (8 * b);
+            x = CSA_BS_FUNC(Transpose)( x );
+            for( int j = 0; j < 8 && 8 * g + j < i_count; j++ )
+                if( i < pi_len[8*g+j] )
+                    pp_data[8*g+j][8 + i] ^= x >> (8 * j);
+        }
+    }
+}
+
+#undef SEL
+#undef CSA_BS_HISTORY
+#undef W_WORDS
+#undef W_LANES
+#undef W
@@ -187,6 +187,12 @@ static const char *const ts_standards_list_text[] =
     "The encryption routines subtract the TS-header from the value before " \
     "encrypting." )
 
+#define THREADS_TEXT N_("Packetizing threads")
+#define THREADS_LONGTEXT N_("Number of extra threads building and scrambling " \
+  "the TS packets of the elementary streams in parallel. The PCR stream, " \
+  "the interleaving and the PCR stamping stay on the muxer thread. " \
+  "0 disables threading.")
+
 #define SOUT_CFG_PREFIX "sout-ts-"
 #define MAX_PMT 64       /* Maximum number of programs. FIXME: I just chose an arbitrary number. Where is the maximum in the spec? */
 #define MAX_PMT_PID 64       /* Maximum pids in each pmt.  FIXME: I just chose an arbitrary number. Where is the maximum in the spec? */
@@ -195,6 +201,10 @@ static const char *const ts_standards_list_text[] =
 #endif
 
 #define BLOCK_FLAG_NO_KEYFRAME (1 << BLOCK_FLAG_PRIVATE_SHIFT) /* This is not a key frame for bitrate shaping */
+#define BLOCK_FLAG_ENCRYPTED   (2 << BLOCK_FLAG_PRIVATE_SHIFT) /* TS packet already scrambled */
+
+/* TS packets scrambled at once by the CSA bitsliced cypher */
+#define TS_CSA_BATCH 256
 
 vlc_module_begin ()
     set_description( N_("TS muxer (libdvbpsi)") )
@@ -237,6 +247,9 @@ vlc_module_begin ()
     add_string( SOUT_CFG_PREFIX "csa-use", "1",  CU_TEXT,   CU_LONGTEXT,   true)
     add_integer(SOUT_CFG_PREFIX "csa-pkt", 188,  CPKT_TEXT, CPKT_LONGTEXT, true)
 
+    add_integer_with_range(SOUT_CFG_PREFIX "threads", 0, 0, 32,
+                           THREADS_TEXT, THREADS_LONGTEXT, true)
+
     set_callbacks( Open, Close )
 vlc_module_end ()
 
@@ -249,7 +262,7 @@ static const char *const ppsz_sout_options[] = {
     "netid", "sdtdesc",
     "es-id-pid", "shaping", "pcr", "bmin", "bmax", "use-key-frames",
     "dts-delay", "csa-ck", "csa2-ck", "csa-use", "csa-pkt", "crypt-audio", "crypt-video",
-    "muxpmt", "program-pmt", "alignment",
+    "muxpmt", "program-pmt", "alignment", "threads",
     NULL
 };
 
@@ -326,6 +339,7 @@ static inline void BufferChainClean( sout_buffer_chain_t *c )
 typedef struct
 {
     sout_buffer_chain_t chain_pes;
+    sout_buffer_chain_t chain_ts; /* packets built ahead by the workers */
     vlc_tick_t          i_pes_dts;
     vlc_tick_t          i_pes_length;
     int                 i_pes_used;
@@ -340,6 +354,13 @@ typedef struct
     pes_state_t  state;
 } sout_input_sys_t;
 
+typedef struct
+{
+    sout_mux_t      *p_mux;
+    vlc_thread_t     thread;
+    csa_t           *csa; /* private cypher state */
+} ts_worker_t;
+
 typedef struct
 {
     sout_input_t    *p_pcr_input;
@@ -385,6 +406,23 @@ typedef struct
     int             i_csa_pkt_size;
     bool            b_crypt_audio;
     bool            b_crypt_video;
+
+    /* Parallel packetization of the non PCR streams.
+     * The last worker is the muxer thread itself. */
+    struct
+    {
+        ts_worker_t     *p_workers;
+        unsigned        i_threads;
+        vlc_mutex_t     lock;
+        vlc_cond_t      wait;
+        vlc_cond_t      done;
+        sout_input_t    **pp_jobs;
+        int             i_jobs;
+        int             i_next;
+        int             i_pending;
+        vlc_tick_t      i_max_dts;
+        bool            b_exit;
+    } workers;
 } sout_mux_sys_t;
 
 
@@ -483,6 +521,10 @@ static void GetPMT( sout_mux_t *p_mux, sout_buffer_chain_t *c );
 static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream, bool b_pcr );
 static void TSSetPCR( block_t *p_ts, vlc_tick_t i_dts );
 
+static int  WorkersStart( sout_mux_t *p_mux, unsigned i_threads );
+static void WorkersStop( sout_mux_t *p_mux );
+static void PacketizeStreams( sout_mux_t *p_mux, vlc_tick_t i_max_dts );
+
 static csa_t *csaSetup( vlc_object_t *p_this )
 {
     sout_mux_t *p_mux = (sout_mux_t*)p_this;
@@ -744,6 +786,10 @@ static int Open( vlc_object_t *p_this )
 
     p_sys->csa = csaSetup(p_this);
 
+    unsigned i_threads = var_GetInteger( p_mux, SOUT_CFG_PREFIX "threads" );
+    if( i_threads > 0 && WorkersStart( p_mux, i_threads ) != VLC_SUCCESS )
+        msg_Warn( p_mux, "cannot start packetizing threads, muxing serially" );
+
     p_mux->pf_control   = Control;
     p_mux->pf_addstream = AddStream;
     p_mux->pf_delstream = DelStream;
@@ -763,6 +809,8 @@ static void Close( vlc_object_t * p_this )
     if( p_sys->p_dvbpsi )
         dvbpsi_delete( p_sys->p_dvbpsi );
 
+    WorkersStop( p_mux );
+
     if( p_sys->csa )
     {
         var_DelCallback( p_mux, SOUT_CFG_PREFIX "csa-ck", ChangeKeyCallback, p_mux );
@@ -971,6 +1019,7 @@ static int AddStream( sout_mux_t *p_mux, sout_input_t *p_input )
 
     /* Init pes chain */
     BufferChainInit( &p_stream->state.chain_pes );
+    BufferChainInit( &p_stream->state.chain_ts );
 
     /* We only change PMT version (PAT isn't changed) */
     p_sys->i_pmt_version_number = ( p_sys->i_pmt_version_number + 1 )%32;
@@ -1008,6 +1057,7 @@ static void DelStream( sout_mux_t *p_mux, sout_input_t *p_input )
 
     /* Empty all data in chain_pes */
     BufferChainClean( &p_stream->state.chain_pes );
+    BufferChainClean( &p_stream->state.chain_ts );
 
     pid = var_GetInteger( p_mux, SOUT_CFG_PREFIX "pid-video" );
     if ( pid > 0 && pid == p_stream->ts.i_pid )
@@ -1191,6 +1241,13 @@ static block_t *Encap_J2K( block_t *p_data, const es_format_t *p_fmt )
 }
 
 /* returns true if needs more data */
+static bool IsScrambled( const sout_mux_sys_t *p_sys, const sout_input_t *p_input )
+{
+    return p_sys->csa != NULL &&
+           (p_input->p_fmt->i_cat != AUDIO_ES || p_sys->b_crypt_audio) &&
+           (p_input->p_fmt->i_cat != VIDEO_ES || p_sys->b_crypt_video);
+}
+
 static bool MuxStreams(sout_mux_t *p_mux )
 {
     sout_mux_sys_t  *p_sys = p_mux->p_sys;
@@ -1495,6 +1552,11 @@ static bool MuxStreams(sout_mux_t *p_mux )
     /* msg_Dbg( p_mux, "estimated pck=%d", i_packet_count ); */
 
     const vlc_tick_t i_pcr_dts = p_pcr_stream->state.i_pes_dts;
+
+    /* Build the packets of the other streams ahead, in parallel */
+    if( p_sys->workers.i_threads > 0 )
+        PacketizeStreams( p_mux, i_pcr_dts + i_pcr_length );
+
     for (;;)
     {
         int          i_stream = -1;
@@ -1506,15 +1568,19 @@ static bool MuxStreams(sout_mux_t *p_mux )
         {
             p_stream = (sout_input_sys_t*)p_mux->pp_inputs[i]->p_sys;
 
-            if( p_stream->state.i_pes_dts == 0 )
+            /* Packets built ahead carry the dts the stream had before */
+            vlc_tick_t i_stream_dts = p_stream->state.chain_ts.p_first
+                                    ? p_stream->state.chain_ts.p_first->i_pts
+                                    : p_stream->state.i_pes_dts;
+            if( i_stream_dts == 0 )
             {
                 continue;
             }
 
-            if( i_stream == -1 || p_stream->state.i_pes_dts < i_dts )
+            if( i_stream == -1 || i_stream_dts < i_dts )
             {
                 i_stream = i;
-                i_dts = p_stream->state.i_pes_dts;
+                i_dts = i_stream_dts;
             }
         }
         if( i_stream == -1 || i_dts > i_pcr_dts + i_pcr_length )
@@ -1524,24 +1590,30 @@ static bool MuxStreams(sout_mux_t *p_mux )
         p_stream = (sout_input_sys_t*)p_mux->pp_inputs[i_stream]->p_sys;
         sout_input_t *p_input = p_mux->pp_inputs[i_stream];
 
-        /* do we need to issue pcr */
-        bool b_pcr = false;
-        vlc_tick_t packet_length = i_pcr_length * i_packet_pos / i_packet_count;
-        if( p_stream == p_pcr_stream &&
-            i_pcr_dts + packet_length >=
-            p_sys->i_pcr + p_sys->i_pcr_delay )
+        block_t *p_ts = BufferChainGet( &p_stream->state.chain_ts );
+        if( p_ts != NULL )
         {
-            b_pcr = true;
-            p_sys->i_pcr = i_pcr_dts + packet_length;
+            p_ts->i_pts = VLC_TICK_INVALID;
         }
-
-        /* Build the TS packet */
-        block_t *p_ts = TSNew( p_mux, p_stream, b_pcr );
-        if( p_sys->csa != NULL &&
-             (p_input->p_fmt->i_cat != AUDIO_ES || p_sys->b_crypt_audio) &&
-             (p_input->p_fmt->i_cat != VIDEO_ES || p_sys->b_crypt_video) )
+        else
         {
-            p_ts->i_flags |= BLOCK_FLAG_SCRAMBLED;
+            /* do we need to issue pcr */
+            bool b_pcr = false;
+            vlc_tick_t packet_length = i_pcr_length * i_packet_pos / i_packet_count;
+            if( p_stream == p_pcr_stream &&
+                i_pcr_dts + packet_length >=
+                p_sys->i_pcr + p_sys->i_pcr_delay )
+            {
+                b_pcr = true;
+                p_sys->i_pcr = i_pcr_dts + packet_length;
+            }
+
+            /* Build the TS packet */
+            p_ts = TSNew( p_mux, p_stream, b_pcr );
+            if( IsScrambled( p_sys, p_input ) )
+            {
+                p_ts->i_flags |= BLOCK_FLAG_SCRAMBLED;
+            }
         }
         i_packet_pos++;
 
@@ -1758,6 +1830,30 @@ static void TSSchedule( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
         TSDate( p_mux, &new_chain, i_pcr_length, i_pcr_dts );
 }
 
+/* Scrambles the packets of the chain that are not yet, a batch at a time */
+static void TSScramble( csa_t *csa, int i_pkt_size, block_t *p_ts )
+{
+    uint8_t *pp_pkts[TS_CSA_BATCH];
+    int i_pkts = 0;
+
+    for( ; p_ts != NULL; p_ts = p_ts->p_next )
+    {
+        if( (p_ts->i_flags & (BLOCK_FLAG_SCRAMBLED|BLOCK_FLAG_ENCRYPTED))
+             != BLOCK_FLAG_SCRAMBLED )
+            continue;
+
+        pp_pkts[i_pkts++] = p_ts->p_buffer;
+        p_ts->i_flags |= BLOCK_FLAG_ENCRYPTED;
+        if( i_pkts == TS_CSA_BATCH )
+        {
+            csa_EncryptBatch( csa, pp_pkts, i_pkts, i_pkt_size );
+            i_pkts = 0;
+        }
+    }
+    if( i_pkts > 0 )
+        csa_EncryptBatch( csa, pp_pkts, i_pkts, i_pkt_size );
+}
+
 static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
                     vlc_tick_t i_pcr_length, vlc_tick_t i_pcr_dts )
 {
@@ -1783,6 +1879,13 @@ static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
         i_pcr_length = i_packet_count;
     }
 
+    if( p_sys->csa )
+    {
+        vlc_mutex_lock( &p_sys->csa_lock );
+        TSScramble( p_sys->csa, p_sys->i_csa_pkt_size, p_chain_ts->p_first );
+        vlc_mutex_unlock( &p_sys->csa_lock );
+    }
+
     /* msg_Dbg( p_mux, "real pck=%d", i_packet_count ); */
     for (int i = 0; i < i_packet_count; i++ )
     {
@@ -1797,12 +1900,7 @@ static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
             /* msg_Dbg( p_mux, "pcr=%lld ms", p_ts->i_dts / 1000 ); */
             TSSetPCR( p_ts, p_ts->i_dts - p_sys->first_dts );
         }
-        if( p_ts->i_flags & BLOCK_FLAG_SCRAMBLED )
-        {
-            vlc_mutex_lock( &p_sys->csa_lock );
-            csa_Encrypt( p_sys->csa, p_ts->p_buffer, p_sys->i_csa_pkt_size );
-            vlc_mutex_unlock( &p_sys->csa_lock );
-        }
+        p_ts->i_flags &= ~BLOCK_FLAG_ENCRYPTED;
 
         /* latency */
         p_ts->i_dts += p_sys->i_shaping_delay * 3 / 2;
@@ -1927,6 +2025,205 @@ static void TSSetPCR( block_t *p_ts, vlc_tick_t i_dts )
     p_ts->p_buffer[11] = 0; /* we don't set PCR extension */
 }
 
+/*****************************************************************************
+ * Parallel packetization:
+ *  before interleaving, the TS packets of every non PCR stream that will be
+ *  sent in the current shaping slice are built (and scrambled) by the
+ *  workers. Each packet keeps the stream dts it was built at, so that the
+ *  interleaving, the PCR insertion and the dating on the muxer thread produce
+ *  the same output as the serial muxer.
+ *****************************************************************************/
+static void PacketizeStream( sout_mux_t *p_mux, sout_input_t *p_input,
+                             vlc_tick_t i_max_dts, csa_t *csa )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    sout_input_sys_t *p_stream = (sout_input_sys_t*)p_input->p_sys;
+    const bool b_scrambled = IsScrambled( p_sys, p_input );
+    block_t **pp_new = p_stream->state.chain_ts.pp_last;
+
+    while( p_stream->state.i_pes_dts != 0 &&
+           p_stream->state.i_pes_dts <= i_max_dts )
+    {
+        const vlc_tick_t i_dts = p_stream->state.i_pes_dts;
+        block_t *p_ts = TSNew( p_mux, p_stream, false );
+
+        if( b_scrambled )
+            p_ts->i_flags |= BLOCK_FLAG_SCRAMBLED;
+        /* Interleaving key, reset once dequeued */
+        p_ts->i_pts = i_dts;
+
+        BufferChainAppend( &p_stream->state.chain_ts, p_ts );
+    }
+
+    if( b_scrambled )
+        TSScramble( csa, p_sys->i_csa_pkt_size, *pp_new );
+}
+
+/* Runs queued jobs until there are none left. Called with the lock held. */
+static void PacketizeJobs( sout_mux_t *p_mux, ts_worker_t *p_worker )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+
+    while( p_sys->workers.i_next < p_sys->workers.i_jobs )
+    {
+        sout_input_t *p_input = p_sys->workers.pp_jobs[p_sys->workers.i_next++];
+        const vlc_tick_t i_max_dts = p_sys->workers.i_max_dts;
+
+        vlc_mutex_unlock( &p_sys->workers.lock );
+        PacketizeStream( p_mux, p_input, i_max_dts, p_worker->csa );
+        vlc_mutex_lock( &p_sys->workers.lock );
+
+        if( --p_sys->workers.i_pending == 0 )
+            vlc_cond_signal( &p_sys->workers.done );
+    }
+}
+
+static void *PacketizeThread( void *data )
+{
+    ts_worker_t *p_worker = data;
+    sout_mux_t *p_mux = p_worker->p_mux;
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+
+    vlc_mutex_lock( &p_sys->workers.lock );
+    while( !p_sys->workers.b_exit )
+    {
+        if( p_sys->workers.i_next >= p_sys->workers.i_jobs )
+        {
+            vlc_cond_wait( &p_sys->workers.wait, &p_sys->workers.lock );
+            continue;
+        }
+        PacketizeJobs( p_mux, p_worker );
+    }
+    vlc_mutex_unlock( &p_sys->workers.lock );
+    return NULL;
+}
+
+static void PacketizeStreams( sout_mux_t *p_mux, vlc_tick_t i_max_dts )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    int i_jobs = 0;
+
+    sout_input_t **pp_jobs = realloc( p_sys->workers.pp_jobs,
+                                      sizeof(*pp_jobs) * __MAX(p_mux->i_nb_inputs, 1) );
+    if( unlikely(pp_jobs == NULL) )
+        return; /* the interleaving builds the packets serially */
+    p_sys->workers.pp_jobs = pp_jobs;
+
+    for( int i = 0; i < p_mux->i_nb_inputs; i++ )
+    {
+        sout_input_t *p_input = p_mux->pp_inputs[i];
+        sout_input_sys_t *p_stream = (sout_input_sys_t*)p_input->p_sys;
+
+        if( p_input != p_sys->p_pcr_input &&
+            p_stream->state.i_pes_dts != 0 &&
+            p_stream->state.i_pes_dts <= i_max_dts )
+            pp_jobs[i_jobs++] = p_input;
+    }
+    if( i_jobs == 0 )
+        return;
+
+    /* Keys can't change while the workers scramble */
+    if( p_sys->csa )
+    {
+        vlc_mutex_lock( &p_sys->csa_lock );
+        for( unsigned i = 0; i <= p_sys->workers.i_threads; i++ )
+            csa_CopyKeys( p_sys->workers.p_workers[i].csa, p_sys->csa );
+    }
+
+    vlc_mutex_lock( &p_sys->workers.lock );
+    p_sys->workers.i_jobs = i_jobs;
+    p_sys->workers.i_next = 0;
+    p_sys->workers.i_pending = i_jobs;
+    p_sys->workers.i_max_dts = i_max_dts;
+    vlc_cond_broadcast( &p_sys->workers.wait );
+
+    /* Take a share of the work, then wait for the workers */
+    PacketizeJobs( p_mux, &p_sys->workers.p_workers[p_sys->workers.i_threads] );
+    while( p_sys->workers.i_pending > 0 )
+        vlc_cond_wait( &p_sys->workers.done, &p_sys->workers.lock );
+
+    p_sys->workers.i_jobs = 0;
+    p_sys->workers.i_next = 0;
+    vlc_mutex_unlock( &p_sys->workers.lock );
+
+    if( p_sys->csa )
+        vlc_mutex_unlock( &p_sys->csa_lock );
+}
+
+static int WorkersStart( sout_mux_t *p_mux, unsigned i_threads )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+
+    ts_worker_t *p_workers = calloc( i_threads + 1, sizeof(*p_workers) );
+    if( unlikely(p_workers == NULL) )
+        return VLC_ENOMEM;
+
+    vlc_mutex_init( &p_sys->workers.lock );
+    vlc_cond_init( &p_sys->workers.wait );
+    vlc_cond_init( &p_sys->workers.done );
+    p_sys->workers.p_workers = p_workers;
+    p_sys->workers.pp_jobs = NULL;
+    p_sys->workers.i_jobs = 0;
+    p_sys->workers.i_next = 0;
+    p_sys->workers.i_pending = 0;
+    p_sys->workers.b_exit = false;
+
+    for( unsigned i = 0; i <= i_threads; i++ )
+    {
+        p_workers[i].p_mux = p_mux;
+        if( p_sys->csa && (p_workers[i].csa = csa_New()) == NULL )
+            break;
+
+        /* The last one is the muxer thread */
+        if( i == i_threads ||
+            vlc_clone( &p_workers[i].thread, PacketizeThread, &p_workers[i],
+                       VLC_THREAD_PRIORITY_OUTPUT ) )
+            break;
+        p_sys->workers.i_threads++;
+    }
+
+    /* The muxer thread takes the first slot that has no thread */
+    if( p_sys->workers.i_threads == 0 ||
+        (p_sys->csa && p_workers[p_sys->workers.i_threads].csa == NULL) )
+    {
+        WorkersStop( p_mux );
+        return VLC_EGENERIC;
+    }
+    if( p_sys->workers.i_threads < i_threads )
+        msg_Warn( p_mux, "only %u of %u packetizing threads started",
+                  p_sys->workers.i_threads, i_threads );
+    else
+        msg_Dbg( p_mux, "packetizing with %u threads", i_threads );
+    return VLC_SUCCESS;
+}
+
+static void WorkersStop( sout_mux_t *p_mux )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    ts_worker_t *p_workers = p_sys->workers.p_workers;
+
+    if( p_workers == NULL )
+        return;
+
+    vlc_mutex_lock( &p_sys->workers.lock );
+    p_sys->workers.b_exit = true;
+    vlc_cond_broadcast( &p_sys->workers.wait );
+    vlc_mutex_unlock( &p_sys->workers.lock );
+
+    for( unsigned i = 0; i < p_sys->workers.i_threads; i++ )
+        vlc_join( p_workers[i].thread, NULL );
+
+    /* Slots past the muxer's one were never used */
+    for( unsigned i = 0; i <= p_sys->workers.i_threads; i++ )
+        if( p_workers[i].csa )
+            csa_Delete( p_workers[i].csa );
+
+    free( p_sys->workers.pp_jobs );
+    free( p_workers );
+    p_sys->workers.p_workers = NULL;
+    p_sys->workers.i_threads = 0;
+}
+
 void GetPAT( sout_mux_t *p_mux, sout_buffer_chain_t *c )
 {
     sout_mux_sys_t       *p_sys = p_mux->p_sys;
@@ -231,6 +231,37 @@ static ssize_t AStreamReadBlock(stream_t *s, void *buf, size_t len)
     return i_copy;
 }
 
+/* Hands the cached block at the read pointer over, without copying it */
+static block_t *AStreamReadBlockDirect(stream_t *s, bool *restrict eof)
+{
+    stream_sys_t *sys = s->p_sys;
+
+    if (block_BytestreamRemaining(&sys->cache) == 0
+     && AStreamRefillBlock(s) != VLC_SUCCESS)
+    {
+        *eof = vlc_stream_Eof(s->s);
+        return NULL;
+    }
+
+    /* Drop already consumed blocks, the read pointer is then at the head */
+    block_BytestreamFlush(&sys->cache);
+
+    block_t *block = sys->cache.p_chain;
+    if (block == NULL)
+        return NULL;
+
+    sys->cache.p_chain = sys->cache.p_block = block->p_next;
+    if (sys->cache.p_chain == NULL)
+        sys->cache.pp_last = &sys->cache.p_chain;
+    sys->cache.i_total -= block->i_buffer;
+
+    block->p_buffer += sys->cache.i_block_offset;
+    block->i_buffer -= sys->cache.i_block_offset;
+    sys->cache.i_block_offset = 0;
+    block->p_next = NULL;
+    return block;
+}
+
 /****************************************************************************
  * AStreamControl:
  ****************************************************************************/
@@ -302,6 +333,7 @@ static int Open(vlc_object_t *obj)
     }
 
     s->pf_read = AStreamReadBlock;
+    s->pf_block = AStreamReadBlockDirect;
     s->pf_seek = AStreamSeekBlock;
     s->pf_control = AStreamControl;
     return VLC_SUCCESS;
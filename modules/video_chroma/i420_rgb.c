@@ -68,7 +68,12 @@ static int  Activate   ( vlc_object_t * );
 static void Deactivate ( vlc_object_t * );
 
 vlc_module_begin ()
-#if defined (SSE2)
+#if defined (AVX2)
+    set_description( N_( "AVX2 I420,IYUV,YV12 to "
+                        "RV15,RV16,RV24,RV32 conversions") )
+    set_capability( "video converter", 130 )
+# define vlc_CPU_capable() vlc_CPU_AVX2()
+#elif defined (SSE2)
     set_description( N_( "SSE2 I420,IYUV,YV12 to "
                         "RV15,RV16,RV24,RV32 conversions") )
     set_capability( "video converter", 120 )
@@ -106,6 +111,12 @@ static int Activate( vlc_object_t *p_this )
     {
         return VLC_EGENERIC;
     }
+#ifdef AVX2
+    /* The last pixels of a line are converted with the previous ones */
+    if( p_filter->fmt_in.video.i_x_offset
+      + p_filter->fmt_in.video.i_visible_width < 32 )
+        return VLC_EGENERIC;
+#endif
 
     if( p_filter->fmt_in.video.orientation != p_filter->fmt_out.video.orientation )
     {
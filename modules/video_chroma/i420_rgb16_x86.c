@@ -31,7 +31,10 @@
 #include <vlc_cpu.h>
 
 #include "i420_rgb.h"
-#ifdef SSE2
+#if defined (AVX2)
+# include "i420_rgb_avx2.h"
+# define VLC_TARGET VLC_AVX2
+#elif defined (SSE2)
 # include "i420_rgb_sse2.h"
 # define VLC_TARGET VLC_SSE
 #else
@@ -99,6 +102,83 @@ static void SetOffset( int i_width, int i_height, int i_pic_width,
         *pi_vscale = -1;
 }
 
+#ifdef AVX2
+/*****************************************************************************
+ * AVX2_CONVERT: convert the picture 32 pixels at a time
+ *****************************************************************************
+ * As in the SSE2 versions, the last pixels of a line are converted by
+ * rewinding and converting some pixels again, so lines must be at least 32
+ * pixels wide. Unaligned loads are as fast as aligned ones with AVX2, so only
+ * the stores depend on the alignment.
+ *****************************************************************************/
+#define AVX2_CONVERT( UNPACK, BPP )                                           \
+    const unsigned i_width = p_filter->fmt_in.video.i_x_offset                \
+                           + p_filter->fmt_in.video.i_visible_width;          \
+                                                                              \
+    i_rewind = (-i_width) & 31;                                               \
+    p_buffer = b_hscale ? p_buffer_start : p_pic;                             \
+                                                                              \
+    const bool b_aligned = 0 == (31 & (p_dest->p->i_pitch                     \
+                                     | (intptr_t)p_buffer));                  \
+                                                                              \
+    for( i_y = 0; i_y < (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height); i_y++ ) \
+    {                                                                         \
+        p_pic_start = p_pic;                                                  \
+                                                                              \
+        for( i_x = i_width / 32; i_x--; )                                     \
+        {                                                                     \
+            if( b_aligned )                                                   \
+                AVX2_CALL (                                                   \
+                    AVX2_INIT_32                                              \
+                    AVX2_YUV_MUL                                              \
+                    AVX2_YUV_ADD                                              \
+                    UNPACK##_ALIGNED                                          \
+                );                                                            \
+            else                                                              \
+                AVX2_CALL (                                                   \
+                    AVX2_INIT_32                                              \
+                    AVX2_YUV_MUL                                              \
+                    AVX2_YUV_ADD                                              \
+                    UNPACK##_UNALIGNED                                        \
+                );                                                            \
+            p_y += 32;                                                        \
+            p_u += 16;                                                        \
+            p_v += 16;                                                        \
+            p_buffer += 32;                                                   \
+        }                                                                     \
+                                                                              \
+        if( i_rewind )                                                        \
+        {                                                                     \
+            p_y -= i_rewind;                                                  \
+            p_u -= i_rewind >> 1;                                             \
+            p_v -= i_rewind >> 1;                                             \
+            p_buffer -= i_rewind;                                             \
+            AVX2_CALL (                                                       \
+                AVX2_INIT_32                                                  \
+                AVX2_YUV_MUL                                                  \
+                AVX2_YUV_ADD                                                  \
+                UNPACK##_UNALIGNED                                            \
+            );                                                                \
+            p_y += 32;                                                        \
+            p_u += 16;                                                        \
+            p_v += 16;                                                        \
+        }                                                                     \
+        SCALE_WIDTH;                                                          \
+        SCALE_HEIGHT( 420, BPP );                                             \
+                                                                              \
+        p_y += i_source_margin;                                               \
+        if( i_y % 2 )                                                         \
+        {                                                                     \
+            p_u += i_source_margin_c;                                         \
+            p_v += i_source_margin_c;                                         \
+        }                                                                     \
+        p_buffer = b_hscale ? p_buffer_start : p_pic;                         \
+    }                                                                         \
+                                                                              \
+    /* make sure all AVX2 stores are visible thereafter */                    \
+    AVX2_END
+#endif
+
 VLC_TARGET
 void I420_R5G5B5( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
 {
@@ -161,7 +241,11 @@ void I420_R5G5B5( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
                     (p_filter->fmt_out.video.i_y_offset + p_filter->fmt_out.video.i_visible_height) :
                     (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height);
 
-#ifdef SSE2
+#if defined (AVX2)
+
+    AVX2_CONVERT( AVX2_UNPACK_15, 2 );
+
+#elif defined (SSE2)
 
     i_rewind = (-(p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width)) & 15;
 
@@ -401,7 +485,11 @@ void I420_R5G6B5( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
                     (p_filter->fmt_out.video.i_y_offset + p_filter->fmt_out.video.i_visible_height) :
                     (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height);
 
-#ifdef SSE2
+#if defined (AVX2)
+
+    AVX2_CONVERT( AVX2_UNPACK_16, 2 );
+
+#elif defined (SSE2)
 
     i_rewind = (-(p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width)) & 15;
 
@@ -641,7 +729,11 @@ void I420_A8R8G8B8( filter_t *p_filter, picture_t *p_src,
                     (p_filter->fmt_out.video.i_y_offset + p_filter->fmt_out.video.i_visible_height) :
                     (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height);
 
-#ifdef SSE2
+#if defined (AVX2)
+
+    AVX2_CONVERT( AVX2_UNPACK_32_ARGB, 4 );
+
+#elif defined (SSE2)
 
     i_rewind = (-(p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width)) & 15;
 
@@ -880,7 +972,11 @@ void I420_R8G8B8A8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
                     (p_filter->fmt_out.video.i_y_offset + p_filter->fmt_out.video.i_visible_height) :
                     (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height);
 
-#ifdef SSE2
+#if defined (AVX2)
+
+    AVX2_CONVERT( AVX2_UNPACK_32_RGBA, 4 );
+
+#elif defined (SSE2)
 
     i_rewind = (-(p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width)) & 15;
 
@@ -1119,7 +1215,11 @@ void I420_B8G8R8A8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
                     (p_filter->fmt_out.video.i_y_offset + p_filter->fmt_out.video.i_visible_height) :
                     (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height);
 
-#ifdef SSE2
+#if defined (AVX2)
+
+    AVX2_CONVERT( AVX2_UNPACK_32_BGRA, 4 );
+
+#elif defined (SSE2)
 
     i_rewind = (-(p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width)) & 15;
 
@@ -1358,7 +1458,11 @@ void I420_A8B8G8R8( filter_t *p_filter, picture_t *p_src, picture_t *p_dest )
                     (p_filter->fmt_out.video.i_y_offset + p_filter->fmt_out.video.i_visible_height) :
                     (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height);
 
-#ifdef SSE2
+#if defined (AVX2)
+
+    AVX2_CONVERT( AVX2_UNPACK_32_ABGR, 4 );
+
+#elif defined (SSE2)
 
     i_rewind = (-(p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width)) & 15;
 
@@ -52,6 +52,9 @@
 #elif defined (MODULE_NAME_IS_i420_yuy2_sse2)
 #    define DEST_FOURCC "YUY2,YUNV,YVYU,UYVY,UYNV,Y422,IUYV"
 #    define VLC_TARGET VLC_SSE
+#elif defined (MODULE_NAME_IS_i420_yuy2_avx2)
+#    define DEST_FOURCC "YUY2,YUNV,YVYU,UYVY,UYNV,Y422,IUYV"
+#    define VLC_TARGET VLC_AVX2
 #elif defined (MODULE_NAME_IS_i420_yuy2_altivec)
 #    define DEST_FOURCC "YUY2,YUNV,YVYU,UYVY,UYNV,Y422"
 #    define VLC_TARGET
@@ -93,6 +96,10 @@ vlc_module_begin ()
     set_description( N_("SSE2 conversions from " SRC_FOURCC " to " DEST_FOURCC) )
     set_capability( "video converter", 250 )
 # define vlc_CPU_capable() vlc_CPU_SSE2()
+#elif defined (MODULE_NAME_IS_i420_yuy2_avx2)
+    set_description( N_("AVX2 conversions from " SRC_FOURCC " to " DEST_FOURCC) )
+    set_capability( "video converter", 260 )
+# define vlc_CPU_capable() vlc_CPU_AVX2()
 #elif defined (MODULE_NAME_IS_i420_yuy2_altivec)
     set_description(
             _("AltiVec conversions from " SRC_FOURCC " to " DEST_FOURCC) );
@@ -294,7 +301,7 @@ static void I420_YUY2( filter_t *p_filter, picture_t *p_source,
                                - p_dest->p->i_visible_pitch
                                - ( p_filter->fmt_out.video.i_x_offset * 2 );
 
-#if !defined(MODULE_NAME_IS_i420_yuy2_sse2)
+#if !defined(MODULE_NAME_IS_i420_yuy2_sse2) && !defined(MODULE_NAME_IS_i420_yuy2_avx2)
     for( i_y = (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height) / 2 ; i_y-- ; )
     {
         p_line1 = p_line2;
@@ -334,6 +341,67 @@ static void I420_YUY2( filter_t *p_filter, picture_t *p_source,
     }
 #endif
 
+#elif defined(MODULE_NAME_IS_i420_yuy2_avx2)
+    /*
+    ** AVX2 aligned stores are non-temporal, hence the separate loops
+    */
+
+    if( 0 == (31 & (p_source->p[Y_PLANE].i_pitch|p_dest->p->i_pitch|
+        ((intptr_t)p_line2|(intptr_t)p_y2))) )
+    {
+        /* use AVX2 aligned fetch and non-temporal store */
+        for( i_y = (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height) / 2 ; i_y-- ; )
+        {
+            p_line1 = p_line2;
+            p_line2 += p_dest->p->i_pitch;
+
+            p_y1 = p_y2;
+            p_y2 += p_source->p[Y_PLANE].i_pitch;
+
+            for( i_x = (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) / 32 ; i_x-- ; )
+            {
+                AVX2_CALL( AVX2_YUV420_YUYV_ALIGNED );
+            }
+            for( i_x = ( (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) % 32 ) / 2; i_x-- ; )
+            {
+                C_YUV420_YUYV( );
+            }
+
+            p_y2 += i_source_margin;
+            p_u += i_source_margin_c;
+            p_v += i_source_margin_c;
+            p_line2 += i_dest_margin;
+        }
+    }
+    else
+    {
+        /* use AVX2 unaligned fetch and store */
+        for( i_y = (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height) / 2 ; i_y-- ; )
+        {
+            p_line1 = p_line2;
+            p_line2 += p_dest->p->i_pitch;
+
+            p_y1 = p_y2;
+            p_y2 += p_source->p[Y_PLANE].i_pitch;
+
+            for( i_x = (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) / 32 ; i_x-- ; )
+            {
+                AVX2_CALL( AVX2_YUV420_YUYV_UNALIGNED );
+            }
+            for( i_x = ( (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) % 32 ) / 2; i_x-- ; )
+            {
+                C_YUV420_YUYV( );
+            }
+
+            p_y2 += i_source_margin;
+            p_u += i_source_margin_c;
+            p_v += i_source_margin_c;
+            p_line2 += i_dest_margin;
+        }
+    }
+    /* make sure all AVX2 stores are visible thereafter */
+    AVX2_END;
+
 #else // defined(MODULE_NAME_IS_i420_yuy2_sse2)
     /*
     ** SSE2 128 bits fetch/store instructions are faster
@@ -503,7 +571,7 @@ static void I420_YVYU( filter_t *p_filter, picture_t *p_source,
                                - p_dest->p->i_visible_pitch
                                - ( p_filter->fmt_out.video.i_x_offset * 2 );
 
-#if !defined(MODULE_NAME_IS_i420_yuy2_sse2)
+#if !defined(MODULE_NAME_IS_i420_yuy2_sse2) && !defined(MODULE_NAME_IS_i420_yuy2_avx2)
     for( i_y = (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height) / 2 ; i_y-- ; )
     {
         p_line1 = p_line2;
@@ -543,6 +611,67 @@ static void I420_YVYU( filter_t *p_filter, picture_t *p_source,
     }
 #endif
 
+#elif defined(MODULE_NAME_IS_i420_yuy2_avx2)
+    /*
+    ** AVX2 aligned stores are non-temporal, hence the separate loops
+    */
+
+    if( 0 == (31 & (p_source->p[Y_PLANE].i_pitch|p_dest->p->i_pitch|
+        ((intptr_t)p_line2|(intptr_t)p_y2))) )
+    {
+        /* use AVX2 aligned fetch and non-temporal store */
+        for( i_y = (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height) / 2 ; i_y-- ; )
+        {
+            p_line1 = p_line2;
+            p_line2 += p_dest->p->i_pitch;
+
+            p_y1 = p_y2;
+            p_y2 += p_source->p[Y_PLANE].i_pitch;
+
+            for( i_x = (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) / 32 ; i_x-- ; )
+            {
+                AVX2_CALL( AVX2_YUV420_YVYU_ALIGNED );
+            }
+            for( i_x = ( (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) % 32 ) / 2; i_x-- ; )
+            {
+                C_YUV420_YVYU( );
+            }
+
+            p_y2 += i_source_margin;
+            p_u += i_source_margin_c;
+            p_v += i_source_margin_c;
+            p_line2 += i_dest_margin;
+        }
+    }
+    else
+    {
+        /* use AVX2 unaligned fetch and store */
+        for( i_y = (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height) / 2 ; i_y-- ; )
+        {
+            p_line1 = p_line2;
+            p_line2 += p_dest->p->i_pitch;
+
+            p_y1 = p_y2;
+            p_y2 += p_source->p[Y_PLANE].i_pitch;
+
+            for( i_x = (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) / 32 ; i_x-- ; )
+            {
+                AVX2_CALL( AVX2_YUV420_YVYU_UNALIGNED );
+            }
+            for( i_x = ( (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) % 32 ) / 2; i_x-- ; )
+            {
+                C_YUV420_YVYU( );
+            }
+
+            p_y2 += i_source_margin;
+            p_u += i_source_margin_c;
+            p_v += i_source_margin_c;
+            p_line2 += i_dest_margin;
+        }
+    }
+    /* make sure all AVX2 stores are visible thereafter */
+    AVX2_END;
+
 #else // defined(MODULE_NAME_IS_i420_yuy2_sse2)
     /*
     ** SSE2 128 bits fetch/store instructions are faster
@@ -710,7 +839,7 @@ static void I420_UYVY( filter_t *p_filter, picture_t *p_source,
                                - p_dest->p->i_visible_pitch
                                - ( p_filter->fmt_out.video.i_x_offset * 2 );
 
-#if !defined(MODULE_NAME_IS_i420_yuy2_sse2)
+#if !defined(MODULE_NAME_IS_i420_yuy2_sse2) && !defined(MODULE_NAME_IS_i420_yuy2_avx2)
     for( i_y = (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height) / 2 ; i_y-- ; )
     {
         p_line1 = p_line2;
@@ -750,6 +879,67 @@ static void I420_UYVY( filter_t *p_filter, picture_t *p_source,
     }
 #endif
 
+#elif defined(MODULE_NAME_IS_i420_yuy2_avx2)
+    /*
+    ** AVX2 aligned stores are non-temporal, hence the separate loops
+    */
+
+    if( 0 == (31 & (p_source->p[Y_PLANE].i_pitch|p_dest->p->i_pitch|
+        ((intptr_t)p_line2|(intptr_t)p_y2))) )
+    {
+        /* use AVX2 aligned fetch and non-temporal store */
+        for( i_y = (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height) / 2 ; i_y-- ; )
+        {
+            p_line1 = p_line2;
+            p_line2 += p_dest->p->i_pitch;
+
+            p_y1 = p_y2;
+            p_y2 += p_source->p[Y_PLANE].i_pitch;
+
+            for( i_x = (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) / 32 ; i_x-- ; )
+            {
+                AVX2_CALL( AVX2_YUV420_UYVY_ALIGNED );
+            }
+            for( i_x = ( (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) % 32 ) / 2; i_x-- ; )
+            {
+                C_YUV420_UYVY( );
+            }
+
+            p_y2 += i_source_margin;
+            p_u += i_source_margin_c;
+            p_v += i_source_margin_c;
+            p_line2 += i_dest_margin;
+        }
+    }
+    else
+    {
+        /* use AVX2 unaligned fetch and store */
+        for( i_y = (p_filter->fmt_in.video.i_y_offset + p_filter->fmt_in.video.i_visible_height) / 2 ; i_y-- ; )
+        {
+            p_line1 = p_line2;
+            p_line2 += p_dest->p->i_pitch;
+
+            p_y1 = p_y2;
+            p_y2 += p_source->p[Y_PLANE].i_pitch;
+
+            for( i_x = (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) / 32 ; i_x-- ; )
+            {
+                AVX2_CALL( AVX2_YUV420_UYVY_UNALIGNED );
+            }
+            for( i_x = ( (p_filter->fmt_in.video.i_x_offset + p_filter->fmt_in.video.i_visible_width) % 32 ) / 2; i_x-- ; )
+            {
+                C_YUV420_UYVY( );
+            }
+
+            p_y2 += i_source_margin;
+            p_u += i_source_margin_c;
+            p_v += i_source_margin_c;
+            p_line2 += i_dest_margin;
+        }
+    }
+    /* make sure all AVX2 stores are visible thereafter */
+    AVX2_END;
+
 #else // defined(MODULE_NAME_IS_i420_yuy2_sse2)
     /*
     ** SSE2 128 bits fetch/store instructions are faster
@@ -333,7 +333,7 @@ movdqu    %%xmm1, 16(%1)  # Store high UYVY                             \n\
     xmm4 = _mm_unpacklo_epi8(xmm4, xmm1);           \
     _mm_stream_si128((__m128i*)(p_line2), xmm4);    \
     xmm3 = _mm_unpackhi_epi8(xmm3, xmm1);           \
-    _mm_stream_si128((__m128i*)(p_line1+16), xmm3);
+    _mm_stream_si128((__m128i*)(p_line2+16), xmm3);
 
 #define SSE2_YUV420_YUYV_UNALIGNED                  \
     xmm1 = _mm_loadl_epi64((__m128i *)p_u);         \
@@ -352,7 +352,7 @@ movdqu    %%xmm1, 16(%1)  # Store high UYVY                             \n\
     xmm4 = _mm_unpacklo_epi8(xmm4, xmm1);           \
     _mm_storeu_si128((__m128i*)(p_line2), xmm4);    \
     xmm3 = _mm_unpackhi_epi8(xmm3, xmm1);           \
-    _mm_storeu_si128((__m128i*)(p_line1+16), xmm3);
+    _mm_storeu_si128((__m128i*)(p_line2+16), xmm3);
 
 #define SSE2_YUV420_YVYU_ALIGNED                    \
     xmm1 = _mm_loadl_epi64((__m128i *)p_v);         \
@@ -369,7 +369,7 @@ movdqu    %%xmm1, 16(%1)  # Store high UYVY                             \n\
     xmm4 = _mm_unpacklo_epi8(xmm4, xmm1);           \
     _mm_stream_si128((__m128i*)(p_line2), xmm4);    \
     xmm3 = _mm_unpackhi_epi8(xmm3, xmm1);           \
-    _mm_stream_si128((__m128i*)(p_line1+16), xmm3);
+    _mm_stream_si128((__m128i*)(p_line2+16), xmm3);
 
 #define SSE2_YUV420_YVYU_UNALIGNED                  \
     xmm1 = _mm_loadl_epi64((__m128i *)p_v);         \
@@ -388,7 +388,7 @@ movdqu    %%xmm1, 16(%1)  # Store high UYVY                             \n\
     xmm4 = _mm_unpacklo_epi8(xmm4, xmm1);           \
     _mm_storeu_si128((__m128i*)(p_line2), xmm4);    \
     xmm3 = _mm_unpackhi_epi8(xmm3, xmm1);           \
-    _mm_storeu_si128((__m128i*)(p_line1+16), xmm3);
+    _mm_storeu_si128((__m128i*)(p_line2+16), xmm3);
 
 #define SSE2_YUV420_UYVY_ALIGNED                    \
     xmm1 = _mm_loadl_epi64((__m128i *)p_u);         \
@@ -406,7 +406,7 @@ movdqu    %%xmm1, 16(%1)  # Store high UYVY                             \n\
     xmm4 = _mm_unpacklo_epi8(xmm4, xmm3);           \
     _mm_stream_si128((__m128i*)(p_line2), xmm4);    \
     xmm1 = _mm_unpackhi_epi8(xmm1, xmm3);           \
-    _mm_stream_si128((__m128i*)(p_line1+16), xmm1);
+    _mm_stream_si128((__m128i*)(p_line2+16), xmm1);
 
 #define SSE2_YUV420_UYVY_UNALIGNED                  \
     xmm1 = _mm_loadl_epi64((__m128i *)p_u);         \
@@ -426,7 +426,77 @@ movdqu    %%xmm1, 16(%1)  # Store high UYVY                             \n\
     xmm4 = _mm_unpacklo_epi8(xmm4, xmm3);           \
     _mm_storeu_si128((__m128i*)(p_line2), xmm4);    \
     xmm1 = _mm_unpackhi_epi8(xmm1, xmm3);           \
-    _mm_storeu_si128((__m128i*)(p_line1+16), xmm1);
+    _mm_storeu_si128((__m128i*)(p_line2+16), xmm1);
+
+#endif
+
+#elif defined( MODULE_NAME_IS_i420_yuy2_avx2 )
+
+#if defined(HAVE_AVX2_INTRINSICS)
+
+/* AVX2 intrinsics */
+
+#include <immintrin.h>
+
+#define AVX2_CALL(AVX2_INSTRUCTIONS)            \
+    do {                                        \
+        __m256i ymm0, ymm1, ymm2, ymm3;         \
+        AVX2_INSTRUCTIONS                       \
+        p_line1 += 64; p_line2 += 64;           \
+        p_y1 += 32; p_y2 += 32;                 \
+        p_u += 16; p_v += 16;                   \
+    } while(0)
+
+#define AVX2_END  _mm_sfence()
+
+/* The 16 chroma pairs are interleaved so that the low lane holds those of
+ * the pixels 0 to 15 and the high lane those of the pixels 16 to 31, like
+ * the luma lanes. The unpacked lanes are then put back in order. */
+#define AVX2_LOAD_CHROMA(C1, C2)                                            \
+    ymm0 = _mm256_castsi128_si256(_mm_loadu_si128((__m128i *)C1));          \
+    ymm1 = _mm256_castsi128_si256(_mm_loadu_si128((__m128i *)C2));          \
+    ymm0 = _mm256_permute4x64_epi64(ymm0, 0x50);                            \
+    ymm1 = _mm256_permute4x64_epi64(ymm1, 0x50);                            \
+    ymm0 = _mm256_unpacklo_epi8(ymm0, ymm1);
+
+#define AVX2_STORE_LINE(LINE, STORE)                                        \
+    STORE((__m256i *)(LINE), _mm256_permute2x128_si256(ymm2, ymm3, 0x20));  \
+    STORE((__m256i *)(LINE+32), _mm256_permute2x128_si256(ymm2, ymm3, 0x31));
+
+#define AVX2_YUV420_PACKED_Y(C1, C2, LOAD, STORE)   \
+    AVX2_LOAD_CHROMA(C1, C2)                        \
+    ymm1 = LOAD((__m256i *)p_y1);                   \
+    ymm2 = _mm256_unpacklo_epi8(ymm1, ymm0);        \
+    ymm3 = _mm256_unpackhi_epi8(ymm1, ymm0);        \
+    AVX2_STORE_LINE(p_line1, STORE)                 \
+    ymm1 = LOAD((__m256i *)p_y2);                   \
+    ymm2 = _mm256_unpacklo_epi8(ymm1, ymm0);        \
+    ymm3 = _mm256_unpackhi_epi8(ymm1, ymm0);        \
+    AVX2_STORE_LINE(p_line2, STORE)
+
+#define AVX2_YUV420_PACKED_C(C1, C2, LOAD, STORE)   \
+    AVX2_LOAD_CHROMA(C1, C2)                        \
+    ymm1 = LOAD((__m256i *)p_y1);                   \
+    ymm2 = _mm256_unpacklo_epi8(ymm0, ymm1);        \
+    ymm3 = _mm256_unpackhi_epi8(ymm0, ymm1);        \
+    AVX2_STORE_LINE(p_line1, STORE)                 \
+    ymm1 = LOAD((__m256i *)p_y2);                   \
+    ymm2 = _mm256_unpacklo_epi8(ymm0, ymm1);        \
+    ymm3 = _mm256_unpackhi_epi8(ymm0, ymm1);        \
+    AVX2_STORE_LINE(p_line2, STORE)
+
+#define AVX2_YUV420_YUYV_ALIGNED                                \
+    AVX2_YUV420_PACKED_Y(p_u, p_v, _mm256_load_si256, _mm256_stream_si256)
+#define AVX2_YUV420_YUYV_UNALIGNED                              \
+    AVX2_YUV420_PACKED_Y(p_u, p_v, _mm256_loadu_si256, _mm256_storeu_si256)
+#define AVX2_YUV420_YVYU_ALIGNED                                \
+    AVX2_YUV420_PACKED_Y(p_v, p_u, _mm256_load_si256, _mm256_stream_si256)
+#define AVX2_YUV420_YVYU_UNALIGNED                              \
+    AVX2_YUV420_PACKED_Y(p_v, p_u, _mm256_loadu_si256, _mm256_storeu_si256)
+#define AVX2_YUV420_UYVY_ALIGNED                                \
+    AVX2_YUV420_PACKED_C(p_u, p_v, _mm256_load_si256, _mm256_stream_si256)
+#define AVX2_YUV420_UYVY_UNALIGNED                              \
+    AVX2_YUV420_PACKED_C(p_u, p_v, _mm256_loadu_si256, _mm256_storeu_si256)
 
 #endif
 
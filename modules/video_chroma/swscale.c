@@ -64,6 +64,11 @@ static const char *const ppsz_mode_descriptions[] =
   N_("Area"), N_("Luma bicubic / chroma bilinear"), N_("Gauss"),
   N_("SincR"), N_("Lanczos"), N_("Bicubic spline") };
 
+#define THREADS_TEXT N_("Threads")
+#define THREADS_LONGTEXT N_("Number of horizontal bands of the pictures " \
+    "scaled in parallel on the video filter threads (0 = automatic, " \
+    "1 = disabled).")
+
 vlc_module_begin ()
     set_description( N_("Video scaling filter") )
     set_shortname( N_("Swscale" ) )
@@ -73,6 +78,8 @@ vlc_module_begin ()
     set_callbacks( OpenScaler, CloseScaler )
     add_integer( "swscale-mode", 2, SCALEMODE_TEXT, SCALEMODE_LONGTEXT, true )
         change_integer_list( pi_mode_values, ppsz_mode_descriptions )
+    add_integer( "swscale-threads", 0, THREADS_TEXT, THREADS_LONGTEXT, true )
+        change_integer_range( 0, 64 )
 vlc_module_end ()
 
 /* Version checking */
@@ -81,6 +88,27 @@ vlc_module_end ()
  * Local prototypes
  ****************************************************************************/
 
+/**
+ * Horizontal band of the pictures scaled by its own contexts.
+ *
+ * The input lines of the band are extended with margins, so that the output
+ * lines near the band edges are filtered as in the whole picture. The output
+ * lines, margins included, are scaled into a picture of the band and the
+ * lines of the band proper are then copied to the output picture.
+ */
+typedef struct
+{
+    struct SwsContext *ctx;
+    struct SwsContext *ctxA;
+    picture_t *p_dst;
+    picture_t *p_dst_a;
+    unsigned i_src_y; /* first input line, margin included */
+    unsigned i_src_h; /* input lines, margins included */
+    unsigned i_dst_y; /* first output line of the band */
+    unsigned i_dst_h; /* output lines of the band */
+    unsigned i_margin; /* output lines above the band in p_dst */
+} scaler_band_t;
+
 /**
  * Internal swscale filter structure.
  */
@@ -88,6 +116,7 @@ typedef struct
 {
     SwsFilter *p_filter;
     int i_cpu_mask, i_sws_flags;
+    unsigned i_threads;
 
     video_format_t fmt_in;
     video_format_t fmt_out;
@@ -101,10 +130,15 @@ typedef struct
     int i_extend_factor;
     picture_t *p_src_e;
     picture_t *p_dst_e;
+    bool b_has_a;
     bool b_add_a;
     bool b_copy;
     bool b_swap_uvi;
     bool b_swap_uvo;
+
+    scaler_band_t *p_bands;
+    unsigned i_bands; /* 0 if the whole picture is scaled by ctx */
+    unsigned i_band_lines; /* output lines of the bands but the last one */
 } filter_sys_t;
 
 static picture_t *Filter( filter_t *, picture_t * );
@@ -136,6 +170,11 @@ static int GetSwsCpuMask(void);
 /* SwScaler does not like too small picture */
 #define MINIMUM_WIDTH (32)
 
+/* Smallest band worth its own contexts, in output lines */
+#define BAND_MIN_LINES (32)
+/* Input lines of margin around each band, per unit of downscaling ratio */
+#define BAND_MARGIN (8)
+
 /* XXX is it always 3 even for BIG_ENDIAN (blend.c seems to think so) ? */
 #define OFFSET_A (3)
 
@@ -179,6 +218,13 @@ static int OpenScaler( vlc_object_t *p_this )
     default: p_sys->i_sws_flags = SWS_BICUBIC; i_sws_mode = 2; break;
     }
 
+    p_sys->i_threads = var_CreateGetInteger( p_filter, "swscale-threads" );
+    if( p_sys->i_threads == 0 )
+    {
+        int64_t i_threads = var_InheritInteger( p_filter, "filter-threads" );
+        p_sys->i_threads = i_threads > 0 ? i_threads : vlc_GetCPUCount();
+    }
+
     /* Misc init */
     memset( &p_sys->fmt_in,  0, sizeof(p_sys->fmt_in) );
     memset( &p_sys->fmt_out, 0, sizeof(p_sys->fmt_out) );
@@ -349,6 +395,105 @@ static int GetParameters( ScalerConfiguration *p_cfg,
     return VLC_SUCCESS;
 }
 
+/* Splits the pictures in horizontal bands scaled in parallel */
+static int InitBands( filter_t *p_filter, const ScalerConfiguration *p_cfg )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const video_format_t *p_fmti = &p_filter->fmt_in.video;
+    const video_format_t *p_fmto = &p_filter->fmt_out.video;
+
+    if( p_sys->i_threads < 2 )
+        return VLC_SUCCESS;
+
+    /* The bands are made of units of input and output lines with the ratio
+     * of the whole pictures, so that they are scaled with the same factor */
+    const unsigned i_units = GCD( p_fmti->i_visible_height,
+                                  p_fmto->i_visible_height );
+    const unsigned i_unit_in = p_fmti->i_visible_height / i_units;
+    const unsigned i_unit_out = p_fmto->i_visible_height / i_units;
+
+    /* The band edges must also be edges of the subsampled chroma lines, and
+     * of the 8 lines dithering patterns in the output */
+    unsigned i_den_in = 1, i_den_out = 8;
+    for( unsigned i = 0; i < p_sys->desc_in->plane_count; i++ )
+        i_den_in = __MAX( i_den_in, p_sys->desc_in->p[i].h.den );
+    for( unsigned i = 0; i < p_sys->desc_out->plane_count; i++ )
+        i_den_out = __MAX( i_den_out, p_sys->desc_out->p[i].h.den );
+
+    unsigned i_align = 1;
+    while( ( i_align * i_unit_in ) % i_den_in ||
+           ( i_align * i_unit_out ) % i_den_out )
+        i_align++;
+
+    /* Sizes in units, multiple of the alignment */
+    const unsigned i_ratio = ( p_fmti->i_visible_height
+                             + p_fmto->i_visible_height - 1 )
+                           / p_fmto->i_visible_height;
+    const unsigned i_block_in = i_align * i_unit_in;
+    const unsigned i_margin = i_align * ( ( BAND_MARGIN * i_ratio
+                                            + i_block_in - 1 ) / i_block_in );
+
+    unsigned i_size = ( i_units + p_sys->i_threads - 1 ) / p_sys->i_threads;
+    i_size = __MAX( i_size, ( BAND_MIN_LINES + i_unit_out - 1 ) / i_unit_out );
+    i_size = ( i_size + i_align - 1 ) / i_align * i_align;
+
+    const unsigned i_bands = ( i_units + i_size - 1 ) / i_size;
+    if( i_bands < 2 )
+        return VLC_SUCCESS;
+
+    p_sys->p_bands = calloc( i_bands, sizeof(*p_sys->p_bands) );
+    if( !p_sys->p_bands )
+        return VLC_ENOMEM;
+    p_sys->i_bands = i_bands;
+    p_sys->i_band_lines = i_size * i_unit_out;
+
+    for( unsigned i = 0; i < i_bands; i++ )
+    {
+        scaler_band_t *p_band = &p_sys->p_bands[i];
+        const unsigned i_first = i * i_size;
+        const unsigned i_end = __MIN( i_first + i_size, i_units );
+        const unsigned i_ext_first = i_first > i_margin ? i_first - i_margin : 0;
+        const unsigned i_ext_end = __MIN( i_end + i_margin, i_units );
+        const unsigned i_ext_lines = ( i_ext_end - i_ext_first ) * i_unit_out;
+
+        p_band->i_src_y = i_ext_first * i_unit_in;
+        p_band->i_src_h = ( i_ext_end - i_ext_first ) * i_unit_in;
+        p_band->i_dst_y = i_first * i_unit_out;
+        p_band->i_dst_h = ( i_end - i_first ) * i_unit_out;
+        p_band->i_margin = ( i_first - i_ext_first ) * i_unit_out;
+
+        p_band->ctx = sws_getContext( p_fmti->i_visible_width, p_band->i_src_h,
+                                      p_cfg->i_fmti,
+                                      p_fmto->i_visible_width, i_ext_lines,
+                                      p_cfg->i_fmto,
+                                      p_cfg->i_sws_flags | p_sys->i_cpu_mask,
+                                      p_sys->p_filter, NULL, 0 );
+        p_band->p_dst = picture_New( p_fmto->i_chroma, p_fmto->i_visible_width,
+                                     i_ext_lines, 0, 1 );
+        if( !p_band->ctx || !p_band->p_dst )
+            return VLC_EGENERIC;
+
+        if( p_cfg->b_has_a )
+        {
+            p_band->ctxA = sws_getContext( p_fmti->i_visible_width,
+                                           p_band->i_src_h, AV_PIX_FMT_GRAY8,
+                                           p_fmto->i_visible_width, i_ext_lines,
+                                           AV_PIX_FMT_GRAY8,
+                                           p_cfg->i_sws_flags | p_sys->i_cpu_mask,
+                                           p_sys->p_filter, NULL, 0 );
+            p_band->p_dst_a = picture_New( VLC_CODEC_GREY,
+                                           p_fmto->i_visible_width,
+                                           i_ext_lines, 0, 1 );
+            if( !p_band->ctxA || !p_band->p_dst_a )
+                return VLC_EGENERIC;
+        }
+    }
+
+    msg_Dbg( p_filter, "scaling in %u bands of %u lines", i_bands,
+             p_sys->i_band_lines );
+    return VLC_SUCCESS;
+}
+
 static int Init( filter_t *p_filter )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
@@ -360,7 +505,7 @@ static int Init( filter_t *p_filter )
 
     if( video_format_IsSimilar( p_fmti, &p_sys->fmt_in ) &&
         video_format_IsSimilar( p_fmto, &p_sys->fmt_out ) &&
-        p_sys->ctx )
+        ( p_sys->ctx || p_sys->i_bands ) )
     {
         return VLC_SUCCESS;
     }
@@ -397,7 +542,18 @@ static int Init( filter_t *p_filter )
 
     const unsigned i_fmti_visible_width = p_fmti->i_visible_width * p_sys->i_extend_factor;
     const unsigned i_fmto_visible_width = p_fmto->i_visible_width * p_sys->i_extend_factor;
-    for( int n = 0; n < (cfg.b_has_a ? 2 : 1); n++ )
+    if( p_sys->i_extend_factor == 1 && !cfg.b_copy &&
+        p_fmti->i_chroma != VLC_CODEC_RGBP )
+    {
+        int i_ret = InitBands( p_filter, &cfg );
+        if( i_ret != VLC_SUCCESS )
+        {
+            msg_Err( p_filter, "could not init SwScaler and/or allocate memory" );
+            Clean( p_filter );
+            return i_ret;
+        }
+    }
+    for( int n = 0; n < (cfg.b_has_a ? 2 : 1) && p_sys->i_bands == 0; n++ )
     {
         const int i_fmti = n == 0 ? cfg.i_fmti : AV_PIX_FMT_GRAY8;
         const int i_fmto = n == 0 ? cfg.i_fmto : AV_PIX_FMT_GRAY8;
@@ -412,7 +568,7 @@ static int Init( filter_t *p_filter )
         else
             p_sys->ctxA = ctx;
     }
-    if( p_sys->ctxA )
+    if( cfg.b_has_a )
     {
         p_sys->p_src_a = picture_New( VLC_CODEC_GREY, i_fmti_visible_width, p_fmti->i_visible_height, 0, 1 );
         p_sys->p_dst_a = picture_New( VLC_CODEC_GREY, i_fmto_visible_width, p_fmto->i_visible_height, 0, 1 );
@@ -428,8 +584,9 @@ static int Init( filter_t *p_filter )
             memset( p_sys->p_dst_e->p[0].p_pixels, 0, p_sys->p_dst_e->p[0].i_pitch * p_sys->p_dst_e->p[0].i_lines );
     }
 
-    if( !p_sys->ctx ||
-        ( cfg.b_has_a && ( !p_sys->ctxA || !p_sys->p_src_a || !p_sys->p_dst_a ) ) ||
+    if( ( !p_sys->ctx && p_sys->i_bands == 0 ) ||
+        ( cfg.b_has_a && ( ( !p_sys->ctxA && p_sys->i_bands == 0 ) ||
+                           !p_sys->p_src_a || !p_sys->p_dst_a ) ) ||
         ( p_sys->i_extend_factor != 1 && ( !p_sys->p_src_e || !p_sys->p_dst_e ) ) )
     {
         msg_Err( p_filter, "could not init SwScaler and/or allocate memory" );
@@ -457,6 +614,7 @@ static int Init( filter_t *p_filter )
         p_fmto->i_sar_den = i_sar_den;
     }
 
+    p_sys->b_has_a = cfg.b_has_a;
     p_sys->b_add_a = cfg.b_add_a;
     p_sys->b_copy = cfg.b_copy;
     p_sys->fmt_in  = *p_fmti;
@@ -487,6 +645,23 @@ static void Clean( filter_t *p_filter )
     if( p_sys->ctx )
         sws_freeContext( p_sys->ctx );
 
+    for( unsigned i = 0; i < p_sys->i_bands; i++ )
+    {
+        scaler_band_t *p_band = &p_sys->p_bands[i];
+
+        if( p_band->p_dst )
+            picture_Release( p_band->p_dst );
+        if( p_band->p_dst_a )
+            picture_Release( p_band->p_dst_a );
+        if( p_band->ctxA )
+            sws_freeContext( p_band->ctxA );
+        if( p_band->ctx )
+            sws_freeContext( p_band->ctx );
+    }
+    free( p_sys->p_bands );
+    p_sys->p_bands = NULL;
+    p_sys->i_bands = 0;
+
     /* We have to set it to null has we call be called again :( */
     p_sys->ctx = NULL;
     p_sys->ctxA = NULL;
@@ -584,8 +759,10 @@ static void SwapUV( picture_t *p_dst, const picture_t *p_src )
 }
 
 static void Convert( filter_t *p_filter, struct SwsContext *ctx,
-                     picture_t *p_dst, picture_t *p_src, int i_height,
-                     int i_plane_count, bool b_swap_uvi, bool b_swap_uvo )
+                     picture_t *p_dst, const video_format_t *p_fmt_dst,
+                     picture_t *p_src, const video_format_t *p_fmt_src,
+                     int i_height, int i_plane_count,
+                     bool b_swap_uvi, bool b_swap_uvo )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
     uint8_t palette[AVPALETTE_SIZE];
@@ -593,7 +770,7 @@ static void Convert( filter_t *p_filter, struct SwsContext *ctx,
     const uint8_t *csrc[4];
     int src_stride[4], dst_stride[4];
 
-    GetPixels( src, src_stride, p_sys->desc_in, &p_filter->fmt_in.video,
+    GetPixels( src, src_stride, p_sys->desc_in, p_fmt_src,
                p_src, i_plane_count, b_swap_uvi );
     if( p_filter->fmt_in.video.i_chroma == VLC_CODEC_RGBP )
     {
@@ -605,7 +782,7 @@ static void Convert( filter_t *p_filter, struct SwsContext *ctx,
         src_stride[1] = 4;
     }
 
-    GetPixels( dst, dst_stride, p_sys->desc_out, &p_filter->fmt_out.video,
+    GetPixels( dst, dst_stride, p_sys->desc_out, p_fmt_dst,
                p_dst, i_plane_count, b_swap_uvo );
 
     for (size_t i = 0; i < ARRAY_SIZE(src); i++)
@@ -620,6 +797,100 @@ static void Convert( filter_t *p_filter, struct SwsContext *ctx,
 #endif
 }
 
+typedef struct
+{
+    picture_t *p_dst;
+    picture_t *p_src;
+    int i_plane_count;
+    bool b_alpha;
+    bool b_swap_uvi;
+    bool b_swap_uvo;
+} scaler_slice_t;
+
+static void ConvertBand( filter_t *p_filter, const scaler_band_t *p_band,
+                         const scaler_slice_t *p_slice )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    picture_t *p_tmp = p_slice->b_alpha ? p_band->p_dst_a : p_band->p_dst;
+    const video_format_t *p_fmti = p_slice->b_alpha ? &p_sys->p_src_a->format
+                                                    : &p_filter->fmt_in.video;
+    const video_format_t *p_fmto = p_slice->b_alpha ? &p_sys->p_dst_a->format
+                                                    : &p_filter->fmt_out.video;
+
+    /* Scale the band with its margins */
+    video_format_t fmt_src = *p_fmti;
+    fmt_src.i_y_offset += p_band->i_src_y;
+
+    Convert( p_filter, p_slice->b_alpha ? p_band->ctxA : p_band->ctx,
+             p_tmp, &p_tmp->format, p_slice->p_src, &fmt_src,
+             p_band->i_src_h, p_slice->i_plane_count,
+             p_slice->b_swap_uvi, p_slice->b_swap_uvo );
+
+    /* Copy the lines of the band to the output picture */
+    video_format_t fmt_dst = *p_fmto;
+    fmt_dst.i_y_offset += p_band->i_dst_y;
+    video_format_t fmt_tmp = p_tmp->format;
+    fmt_tmp.i_y_offset = p_band->i_margin;
+
+    uint8_t *dst[4], *src[4];
+    int dst_stride[4], src_stride[4];
+
+    GetPixels( dst, dst_stride, p_sys->desc_out, &fmt_dst, p_slice->p_dst,
+               p_slice->i_plane_count, false );
+    GetPixels( src, src_stride, p_sys->desc_out, &fmt_tmp, p_tmp,
+               p_slice->i_plane_count, false );
+
+    for( int i = 0; i < 4 && dst[i] != NULL; i++ )
+    {
+        const vlc_rational_t h = p_sys->desc_out->p[i].h;
+        const unsigned i_lines = ( p_band->i_dst_h * h.num + h.den - 1 ) / h.den;
+
+        for( unsigned y = 0; y < i_lines; y++ )
+            memcpy( &dst[i][y * dst_stride[i]], &src[i][y * src_stride[i]],
+                    p_tmp->p[i].i_visible_pitch );
+    }
+}
+
+static void ConvertSlice( filter_t *p_filter, void *opaque,
+                          unsigned first, unsigned end )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    /* The slices are made of whole bands */
+    for( unsigned i = first / p_sys->i_band_lines;
+         i < p_sys->i_bands && p_sys->p_bands[i].i_dst_y < end; i++ )
+        ConvertBand( p_filter, &p_sys->p_bands[i], opaque );
+}
+
+static void Scale( filter_t *p_filter, bool b_alpha,
+                   picture_t *p_dst, picture_t *p_src, int i_plane_count,
+                   bool b_swap_uvi, bool b_swap_uvo )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( p_sys->i_bands == 0 )
+    {
+        /* The alpha pictures have no offsets */
+        Convert( p_filter, b_alpha ? p_sys->ctxA : p_sys->ctx,
+                 p_dst, b_alpha ? &p_dst->format : &p_filter->fmt_out.video,
+                 p_src, b_alpha ? &p_src->format : &p_filter->fmt_in.video,
+                 p_filter->fmt_in.video.i_visible_height, i_plane_count,
+                 b_swap_uvi, b_swap_uvo );
+        return;
+    }
+
+    scaler_slice_t slice = {
+        .p_dst = p_dst,
+        .p_src = p_src,
+        .i_plane_count = i_plane_count,
+        .b_alpha = b_alpha,
+        .b_swap_uvi = b_swap_uvi,
+        .b_swap_uvo = b_swap_uvo,
+    };
+    filter_ExecuteSlices( p_filter, p_filter->fmt_out.video.i_visible_height,
+                          p_sys->i_band_lines, ConvertSlice, &slice );
+}
+
 /****************************************************************************
  * Filter: the whole thing
  ****************************************************************************
@@ -665,12 +936,12 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
     else
     {
         /* Even if alpha is unused, swscale expects the pointer to be set */
-        const int n_planes = !p_sys->ctxA && (p_src->i_planes == 4 ||
+        const int n_planes = !p_sys->b_has_a && (p_src->i_planes == 4 ||
                              p_dst->i_planes == 4) ? 4 : 3;
-        Convert( p_filter, p_sys->ctx, p_dst, p_src, p_fmti->i_visible_height,
-                 n_planes, p_sys->b_swap_uvi, p_sys->b_swap_uvo );
+        Scale( p_filter, false, p_dst, p_src, n_planes,
+               p_sys->b_swap_uvi, p_sys->b_swap_uvo );
     }
-    if( p_sys->ctxA )
+    if( p_sys->b_has_a )
     {
         /* We extract the A plane to rescale it, and then we reinject it. */
         if( p_fmti->i_chroma == VLC_CODEC_RGBA || p_fmti->i_chroma == VLC_CODEC_BGRA )
@@ -680,8 +951,8 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
         else
             plane_CopyPixels( p_sys->p_src_a->p, p_src->p+A_PLANE );
 
-        Convert( p_filter, p_sys->ctxA, p_sys->p_dst_a, p_sys->p_src_a,
-                 p_fmti->i_visible_height, 1, false, false );
+        Scale( p_filter, true, p_sys->p_dst_a, p_sys->p_src_a, 1,
+               false, false );
         if( p_fmto->i_chroma == VLC_CODEC_RGBA || p_fmto->i_chroma == VLC_CODEC_BGRA )
             InjectA( p_dst, p_sys->p_dst_a, OFFSET_A );
         else if( p_fmto->i_chroma == VLC_CODEC_ARGB )
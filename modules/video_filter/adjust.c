@@ -240,6 +240,100 @@ static void Destroy( vlc_object_t *p_this )
                      &p_sys->b_brightness_threshold );
 }
 
+typedef struct
+{
+    const picture_t *p_pic;
+    picture_t *p_outpic;
+    const int *pi_luma;
+    int (*pf_process_sat_hue)( picture_t *, picture_t *, int, int, int,
+                               int, int );
+    int i_sin, i_cos, i_sat, i_x, i_y;
+    int i_y_offset; /* packed only */
+} adjust_slice_t;
+
+/* Restricts a picture to the given lines of its first plane */
+static void SlicePicture( picture_t *p_view, const picture_t *p_pic,
+                          unsigned i_first, unsigned i_end )
+{
+    p_view->format = p_pic->format;
+    p_view->i_planes = p_pic->i_planes;
+    for( int i = 0; i < p_pic->i_planes; i++ )
+    {
+        const unsigned i_plane_first = filter_SliceLine( p_pic, i, i_first );
+        const unsigned i_plane_end = filter_SliceLine( p_pic, i, i_end );
+
+        p_view->p[i] = p_pic->p[i];
+        p_view->p[i].p_pixels += i_plane_first * p_pic->p[i].i_pitch;
+        p_view->p[i].i_lines = i_plane_end - i_plane_first;
+        p_view->p[i].i_visible_lines = i_plane_end - i_plane_first;
+    }
+}
+
+static void ProcessSatHueSlice( const adjust_slice_t *p_slice,
+                                unsigned i_first, unsigned i_end )
+{
+    picture_t in = { .i_planes = 0 }, out = { .i_planes = 0 };
+
+    SlicePicture( &in, p_slice->p_pic, i_first, i_end );
+    SlicePicture( &out, p_slice->p_outpic, i_first, i_end );
+
+    /* The only error of the functions is an unsupported packed chroma, which
+     * is checked before slicing */
+    p_slice->pf_process_sat_hue( &in, &out, p_slice->i_sin, p_slice->i_cos,
+                                 p_slice->i_sat, p_slice->i_x, p_slice->i_y );
+}
+
+#define PLANAR_LUMA_SLICE( data_t, i_bytes ) \
+    do \
+    { \
+        const adjust_slice_t *p_slice = opaque; \
+        const picture_t *p_pic = p_slice->p_pic; \
+        picture_t *p_outpic = p_slice->p_outpic; \
+        const int *pi_luma = p_slice->pi_luma; \
+ \
+        for( unsigned i_line = i_first; i_line < i_end; i_line++ ) \
+        { \
+            const data_t *p_in = (const data_t *)&p_pic->p[Y_PLANE].p_pixels[ \
+                                    i_line * p_pic->p[Y_PLANE].i_pitch]; \
+            data_t *p_out = (data_t *)&p_outpic->p[Y_PLANE].p_pixels[ \
+                                    i_line * p_outpic->p[Y_PLANE].i_pitch]; \
+            const data_t *p_line_end = p_in \
+                + p_pic->p[Y_PLANE].i_visible_pitch / (i_bytes) - 8; \
+ \
+            for( ; p_in < p_line_end ; ) \
+            { \
+                /* Do 8 pixels at a time */ \
+                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ]; \
+                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ]; \
+                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ]; \
+                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ]; \
+            } \
+ \
+            p_line_end += 8; \
+ \
+            for( ; p_in < p_line_end ; ) \
+            { \
+                *p_out++ = pi_luma[ *p_in++ ]; \
+            } \
+        } \
+ \
+        ProcessSatHueSlice( p_slice, i_first, i_end ); \
+    } while( 0 )
+
+static void PlanarSlice( filter_t *p_filter, void *opaque,
+                         unsigned i_first, unsigned i_end )
+{
+    VLC_UNUSED(p_filter);
+    PLANAR_LUMA_SLICE( uint8_t, 1 );
+}
+
+static void PlanarSlice16( filter_t *p_filter, void *opaque,
+                           unsigned i_first, unsigned i_end )
+{
+    VLC_UNUSED(p_filter);
+    PLANAR_LUMA_SLICE( uint16_t, 2 );
+}
+
 /*****************************************************************************
  * Run the filter on a Planar YUV picture
  *****************************************************************************/
@@ -333,83 +427,7 @@ static picture_t *FilterPlanar( filter_t *p_filter, picture_t *p_pic )
     }
 
     /*
-     * Do the Y plane
-     */
-    if ( b_16bit )
-    {
-        uint16_t *p_in, *p_in_end, *p_line_end;
-        uint16_t *p_out;
-        p_in = (uint16_t *) p_pic->p[Y_PLANE].p_pixels;
-        p_in_end = p_in + p_pic->p[Y_PLANE].i_visible_lines
-            * (p_pic->p[Y_PLANE].i_pitch >> 1) - 8;
-
-        p_out = (uint16_t *) p_outpic->p[Y_PLANE].p_pixels;
-
-        for( ; p_in < p_in_end ; )
-        {
-            p_line_end = p_in + (p_pic->p[Y_PLANE].i_visible_pitch >> 1) - 8;
-
-            for( ; p_in < p_line_end ; )
-            {
-                /* Do 8 pixels at a time */
-                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
-                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
-                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
-                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
-            }
-
-            p_line_end += 8;
-
-            for( ; p_in < p_line_end ; )
-            {
-                *p_out++ = pi_luma[ *p_in++ ];
-            }
-
-            p_in += (p_pic->p[Y_PLANE].i_pitch >> 1)
-                - (p_pic->p[Y_PLANE].i_visible_pitch >> 1);
-            p_out += (p_outpic->p[Y_PLANE].i_pitch >> 1)
-                - (p_outpic->p[Y_PLANE].i_visible_pitch >> 1);
-        }
-    }
-    else
-    {
-        uint8_t *p_in, *p_in_end, *p_line_end;
-        uint8_t *p_out;
-        p_in = p_pic->p[Y_PLANE].p_pixels;
-        p_in_end = p_in + p_pic->p[Y_PLANE].i_visible_lines
-                 * p_pic->p[Y_PLANE].i_pitch - 8;
-
-        p_out = p_outpic->p[Y_PLANE].p_pixels;
-
-        for( ; p_in < p_in_end ; )
-        {
-            p_line_end = p_in + p_pic->p[Y_PLANE].i_visible_pitch - 8;
-
-            for( ; p_in < p_line_end ; )
-            {
-                /* Do 8 pixels at a time */
-                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
-                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
-                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
-                *p_out++ = pi_luma[ *p_in++ ]; *p_out++ = pi_luma[ *p_in++ ];
-            }
-
-            p_line_end += 8;
-
-            for( ; p_in < p_line_end ; )
-            {
-                *p_out++ = pi_luma[ *p_in++ ];
-            }
-
-            p_in += p_pic->p[Y_PLANE].i_pitch
-                  - p_pic->p[Y_PLANE].i_visible_pitch;
-            p_out += p_outpic->p[Y_PLANE].i_pitch
-                   - p_outpic->p[Y_PLANE].i_visible_pitch;
-        }
-    }
-
-    /*
-     * Do the U and V planes
+     * Do the Y, U and V planes
      */
 
     int i_sin = sinf(f_hue) * f_max;
@@ -419,22 +437,62 @@ static picture_t *FilterPlanar( filter_t *p_filter, picture_t *p_pic )
     int i_x = ( cosf(f_hue) + sinf(f_hue) ) * f_range * i_mid;
     int i_y = ( cosf(f_hue) - sinf(f_hue) ) * f_range * i_mid;
 
-    if ( i_sat > i_range )
-    {
-        /* Currently no errors are implemented in the function, if any are added
-         * check them here */
-        p_sys->pf_process_sat_hue_clip( p_pic, p_outpic, i_sin, i_cos, i_sat,
-                                        i_x, i_y );
-    }
-    else
+    adjust_slice_t slice = {
+        .p_pic = p_pic,
+        .p_outpic = p_outpic,
+        .pi_luma = pi_luma,
+        .pf_process_sat_hue = i_sat > i_range ? p_sys->pf_process_sat_hue_clip
+                                              : p_sys->pf_process_sat_hue,
+        .i_sin = i_sin, .i_cos = i_cos, .i_sat = i_sat,
+        .i_x = i_x, .i_y = i_y,
+    };
+
+    filter_ExecuteSlices( p_filter, p_pic->p[Y_PLANE].i_visible_lines, 2,
+                          b_16bit ? PlanarSlice16 : PlanarSlice, &slice );
+
+    return CopyInfoAndRelease( p_outpic, p_pic );
+}
+
+static void PackedSlice( filter_t *p_filter, void *opaque,
+                         unsigned i_first, unsigned i_end )
+{
+    VLC_UNUSED(p_filter);
+    const adjust_slice_t *p_slice = opaque;
+    const picture_t *p_pic = p_slice->p_pic;
+    picture_t *p_outpic = p_slice->p_outpic;
+    const int *pi_luma = p_slice->pi_luma;
+    const int i_visible_pitch = p_pic->p->i_visible_pitch;
+
+    for( unsigned i_line = i_first; i_line < i_end; i_line++ )
     {
-        /* Currently no errors are implemented in the function, if any are added
-         * check them here */
-        p_sys->pf_process_sat_hue( p_pic, p_outpic, i_sin, i_cos, i_sat,
-                                        i_x, i_y );
+        const uint8_t *p_in = p_pic->p->p_pixels + p_slice->i_y_offset
+                            + i_line * p_pic->p->i_pitch;
+        uint8_t *p_out = p_outpic->p->p_pixels + p_slice->i_y_offset
+                       + i_line * p_outpic->p->i_pitch;
+        const uint8_t *p_line_end = p_in + i_visible_pitch - 8 * 4;
+
+        for( ; p_in < p_line_end ; )
+        {
+            /* Do 8 pixels at a time */
+            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
+            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
+            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
+            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
+            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
+            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
+            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
+            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
+        }
+
+        p_line_end += 8 * 4;
+
+        for( ; p_in < p_line_end ; )
+        {
+            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
+        }
     }
 
-    return CopyInfoAndRelease( p_outpic, p_pic );
+    ProcessSatHueSlice( p_slice, i_first, i_end );
 }
 
 /*****************************************************************************
@@ -446,12 +504,8 @@ static picture_t *FilterPacked( filter_t *p_filter, picture_t *p_pic )
     int pi_gamma[256];
 
     picture_t *p_outpic;
-    uint8_t *p_in, *p_in_end, *p_line_end;
-    uint8_t *p_out;
     int i_y_offset, i_u_offset, i_v_offset;
 
-    int i_pitch, i_visible_pitch;
-
     double  f_hue;
     double  f_gamma;
     int32_t i_cont, i_lum;
@@ -461,9 +515,6 @@ static picture_t *FilterPacked( filter_t *p_filter, picture_t *p_pic )
 
     if( !p_pic ) return NULL;
 
-    i_pitch = p_pic->p->i_pitch;
-    i_visible_pitch = p_pic->p->i_visible_pitch;
-
     if( GetPackedYuvOffsets( p_pic->format.i_chroma, &i_y_offset,
                              &i_u_offset, &i_v_offset ) != VLC_SUCCESS )
     {
@@ -530,44 +581,7 @@ static picture_t *FilterPacked( filter_t *p_filter, picture_t *p_pic )
     }
 
     /*
-     * Do the Y plane
-     */
-
-    p_in = p_pic->p->p_pixels + i_y_offset;
-    p_in_end = p_in + p_pic->p->i_visible_lines * p_pic->p->i_pitch - 8 * 4;
-
-    p_out = p_outpic->p->p_pixels + i_y_offset;
-
-    for( ; p_in < p_in_end ; )
-    {
-        p_line_end = p_in + i_visible_pitch - 8 * 4;
-
-        for( ; p_in < p_line_end ; )
-        {
-            /* Do 8 pixels at a time */
-            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
-            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
-            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
-            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
-            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
-            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
-            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
-            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
-        }
-
-        p_line_end += 8 * 4;
-
-        for( ; p_in < p_line_end ; )
-        {
-            *p_out = pi_luma[ *p_in ]; p_in += 2; p_out += 2;
-        }
-
-        p_in += i_pitch - p_pic->p->i_visible_pitch;
-        p_out += i_pitch - p_outpic->p->i_visible_pitch;
-    }
-
-    /*
-     * Do the U and V planes
+     * Do the Y, U and V planes
      */
 
     i_sin = sin(f_hue) * 256;
@@ -576,32 +590,19 @@ static picture_t *FilterPacked( filter_t *p_filter, picture_t *p_pic )
     i_x = ( cos(f_hue) + sin(f_hue) ) * 32768;
     i_y = ( cos(f_hue) - sin(f_hue) ) * 32768;
 
-    if ( i_sat > 256 )
-    {
-        if ( p_sys->pf_process_sat_hue_clip( p_pic, p_outpic, i_sin, i_cos, i_sat,
-                                             i_x, i_y ) != VLC_SUCCESS )
-        {
-            /* Currently only one error can happen in the function, but if there
-             * will be more of them, this message must go away */
-            msg_Warn( p_filter, "Unsupported input chroma (%4.4s)",
-                      (char*)&(p_pic->format.i_chroma) );
-            picture_Release( p_pic );
-            return NULL;
-        }
-    }
-    else
-    {
-        if ( p_sys->pf_process_sat_hue( p_pic, p_outpic, i_sin, i_cos, i_sat,
-                                        i_x, i_y ) != VLC_SUCCESS )
-        {
-            /* Currently only one error can happen in the function, but if there
-             * will be more of them, this message must go away */
-            msg_Warn( p_filter, "Unsupported input chroma (%4.4s)",
-                      (char*)&(p_pic->format.i_chroma) );
-            picture_Release( p_pic );
-            return NULL;
-        }
-    }
+    adjust_slice_t slice = {
+        .p_pic = p_pic,
+        .p_outpic = p_outpic,
+        .pi_luma = pi_luma,
+        .pf_process_sat_hue = i_sat > 256 ? p_sys->pf_process_sat_hue_clip
+                                          : p_sys->pf_process_sat_hue,
+        .i_sin = i_sin, .i_cos = i_cos, .i_sat = i_sat,
+        .i_x = i_x, .i_y = i_y,
+        .i_y_offset = i_y_offset,
+    };
+
+    filter_ExecuteSlices( p_filter, p_pic->p->i_visible_lines, 1,
+                          PackedSlice, &slice );
 
     return CopyInfoAndRelease( p_outpic, p_pic );
 }
@@ -38,34 +38,57 @@
 
 #include "algo_basic.h"
 
+/* Lines of a plane, processed by slices */
+typedef struct
+{
+    picture_t *p_outpic;
+    picture_t *p_pic;
+    int i_plane;
+    int i_field;
+} basic_slice_t;
+
+#define OUT_LINE( y ) \
+    &p_slice->p_outpic->p[p_slice->i_plane].p_pixels[ \
+        (y) * p_slice->p_outpic->p[p_slice->i_plane].i_pitch]
+#define IN_LINE( y ) \
+    &p_slice->p_pic->p[p_slice->i_plane].p_pixels[ \
+        (y) * p_slice->p_pic->p[p_slice->i_plane].i_pitch]
+#define IN_PITCH p_slice->p_pic->p[p_slice->i_plane].i_pitch
+
+/* Runs a slice callback over the output lines of every plane */
+static void RenderSlices( filter_t *p_filter, picture_t *p_outpic,
+                          picture_t *p_pic, int i_field, filter_slice_cb cb )
+{
+    basic_slice_t slice = {
+        .p_outpic = p_outpic,
+        .p_pic = p_pic,
+        .i_field = i_field,
+    };
+
+    for( slice.i_plane = 0; slice.i_plane < p_pic->i_planes; slice.i_plane++ )
+        filter_ExecuteSlices( p_filter,
+                              p_outpic->p[slice.i_plane].i_visible_lines, 1,
+                              cb, &slice );
+}
+
 /*****************************************************************************
  * RenderDiscard: only keep TOP or BOTTOM field, discard the other.
  *****************************************************************************/
 
-int RenderDiscard( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
+static void DiscardSlice( filter_t *p_filter, void *opaque,
+                          unsigned i_first, unsigned i_end )
 {
     VLC_UNUSED(p_filter);
-    int i_plane;
+    const basic_slice_t *p_slice = opaque;
 
     /* Copy image and skip lines */
-    for( i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
-    {
-        uint8_t *p_in, *p_out_end, *p_out;
-
-        p_in = p_pic->p[i_plane].p_pixels;
-
-        p_out = p_outpic->p[i_plane].p_pixels;
-        p_out_end = p_out + p_outpic->p[i_plane].i_pitch
-                             * p_outpic->p[i_plane].i_visible_lines;
-
-        for( ; p_out < p_out_end ; )
-        {
-            memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
+    for( unsigned y = i_first; y < i_end; y++ )
+        memcpy( OUT_LINE( y ), IN_LINE( 2 * y ), IN_PITCH );
+}
 
-            p_out += p_outpic->p[i_plane].i_pitch;
-            p_in += 2 * p_pic->p[i_plane].i_pitch;
-        }
-    }
+int RenderDiscard( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
+{
+    RenderSlices( p_filter, p_outpic, p_pic, 0, DiscardSlice );
     return VLC_SUCCESS;
 }
 
@@ -73,55 +96,32 @@ int RenderDiscard( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
  * RenderBob: renders a BOB picture - simple copy
  *****************************************************************************/
 
-int RenderBob( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic,
-               int order, int i_field )
+static void BobSlice( filter_t *p_filter, void *opaque,
+                      unsigned i_first, unsigned i_end )
 {
     VLC_UNUSED(p_filter);
-    VLC_UNUSED(order);
-    int i_plane;
+    const basic_slice_t *p_slice = opaque;
+    const unsigned i_lines =
+        p_slice->p_outpic->p[p_slice->i_plane].i_visible_lines;
+    const unsigned i_field = p_slice->i_field;
 
-    /* Copy image and skip lines */
-    for( i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
+    for( unsigned y = i_first; y < i_end; y++ )
     {
-        uint8_t *p_in, *p_out_end, *p_out;
-
-        p_in = p_pic->p[i_plane].p_pixels;
-        p_out = p_outpic->p[i_plane].p_pixels;
-        p_out_end = p_out + p_outpic->p[i_plane].i_pitch
-                             * p_outpic->p[i_plane].i_visible_lines;
-
-        /* For BOTTOM field we need to add the first line */
-        if( i_field == 1 )
-        {
-            memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
-            p_in += p_pic->p[i_plane].i_pitch;
-            p_out += p_outpic->p[i_plane].i_pitch;
-        }
-
-        p_out_end -= 2 * p_outpic->p[i_plane].i_pitch;
-
-        for( ; p_out < p_out_end ; )
-        {
-            memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
-
-            p_out += p_outpic->p[i_plane].i_pitch;
-
-            memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
-
-            p_in += 2 * p_pic->p[i_plane].i_pitch;
-            p_out += p_outpic->p[i_plane].i_pitch;
-        }
+        /* For BOTTOM field we need to add the first line, and for TOP field
+         * the last line. The other lines are doubled. */
+        unsigned i_in = y;
+        if( y >= i_field && y < i_lines - 1 )
+            i_in -= (y - i_field) & 1;
+        memcpy( OUT_LINE( y ), IN_LINE( i_in ), IN_PITCH );
+    }
+}
 
-        memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
+int RenderBob( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic,
+               int order, int i_field )
+{
+    VLC_UNUSED(order);
 
-        /* For TOP field we need to add the last line */
-        if( i_field == 0 )
-        {
-            p_in += p_pic->p[i_plane].i_pitch;
-            p_out += p_outpic->p[i_plane].i_pitch;
-            memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
-        }
-    }
+    RenderSlices( p_filter, p_outpic, p_pic, i_field, BobSlice );
     return VLC_SUCCESS;
 }
 
@@ -129,58 +129,34 @@ int RenderBob( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic,
  * RenderLinear: BOB with linear interpolation
  *****************************************************************************/
 
-int RenderLinear( filter_t *p_filter,
-                  picture_t *p_outpic, picture_t *p_pic, int order, int i_field )
+static void LinearSlice( filter_t *p_filter, void *opaque,
+                         unsigned i_first, unsigned i_end )
 {
-    VLC_UNUSED(order);
-    int i_plane;
-
     filter_sys_t *p_sys = p_filter->p_sys;
+    const basic_slice_t *p_slice = opaque;
+    const unsigned i_lines =
+        p_slice->p_outpic->p[p_slice->i_plane].i_visible_lines;
+    const unsigned i_field = p_slice->i_field;
 
-    /* Copy image and skip lines */
-    for( i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
+    for( unsigned y = i_first; y < i_end; y++ )
     {
-        uint8_t *p_in, *p_out_end, *p_out;
-
-        p_in = p_pic->p[i_plane].p_pixels;
-        p_out = p_outpic->p[i_plane].p_pixels;
-        p_out_end = p_out + p_outpic->p[i_plane].i_pitch
-                             * p_outpic->p[i_plane].i_visible_lines;
-
-        /* For BOTTOM field we need to add the first line */
-        if( i_field == 1 )
-        {
-            memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
-            p_in += p_pic->p[i_plane].i_pitch;
-            p_out += p_outpic->p[i_plane].i_pitch;
-        }
-
-        p_out_end -= 2 * p_outpic->p[i_plane].i_pitch;
-
-        for( ; p_out < p_out_end ; )
-        {
-            memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
-
-            p_out += p_outpic->p[i_plane].i_pitch;
-
-            Merge( p_out, p_in, p_in + 2 * p_pic->p[i_plane].i_pitch,
-                   p_pic->p[i_plane].i_pitch );
-
-            p_in += 2 * p_pic->p[i_plane].i_pitch;
-            p_out += p_outpic->p[i_plane].i_pitch;
-        }
-
-        memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
-
-        /* For TOP field we need to add the last line */
-        if( i_field == 0 )
-        {
-            p_in += p_pic->p[i_plane].i_pitch;
-            p_out += p_outpic->p[i_plane].i_pitch;
-            memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
-        }
+        /* The lines of the other field are interpolated, but the first line
+         * of the BOTTOM field and the last line of the TOP field */
+        if( y < i_field || ((y - i_field) & 1) == 0 || y == i_lines - 1 )
+            memcpy( OUT_LINE( y ), IN_LINE( y ), IN_PITCH );
+        else
+            Merge( OUT_LINE( y ), IN_LINE( y - 1 ), IN_LINE( y + 1 ),
+                   IN_PITCH );
     }
     EndMerge();
+}
+
+int RenderLinear( filter_t *p_filter,
+                  picture_t *p_outpic, picture_t *p_pic, int order, int i_field )
+{
+    VLC_UNUSED(order);
+
+    RenderSlices( p_filter, p_outpic, p_pic, i_field, LinearSlice );
     return VLC_SUCCESS;
 }
 
@@ -188,34 +164,22 @@ int RenderLinear( filter_t *p_filter,
  * RenderMean: Half-resolution blender
  *****************************************************************************/
 
-int RenderMean( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
+static void MeanSlice( filter_t *p_filter, void *opaque,
+                       unsigned i_first, unsigned i_end )
 {
-    int i_plane;
-
     filter_sys_t *p_sys = p_filter->p_sys;
+    const basic_slice_t *p_slice = opaque;
 
-    /* Copy image and skip lines */
-    for( i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
-    {
-        uint8_t *p_in, *p_out_end, *p_out;
-
-        p_in = p_pic->p[i_plane].p_pixels;
-
-        p_out = p_outpic->p[i_plane].p_pixels;
-        p_out_end = p_out + p_outpic->p[i_plane].i_pitch
-                             * p_outpic->p[i_plane].i_visible_lines;
-
-        /* All lines: mean value */
-        for( ; p_out < p_out_end ; )
-        {
-            Merge( p_out, p_in, p_in + p_pic->p[i_plane].i_pitch,
-                   p_pic->p[i_plane].i_pitch );
-
-            p_out += p_outpic->p[i_plane].i_pitch;
-            p_in += 2 * p_pic->p[i_plane].i_pitch;
-        }
-    }
+    /* All lines: mean value */
+    for( unsigned y = i_first; y < i_end; y++ )
+        Merge( OUT_LINE( y ), IN_LINE( 2 * y ), IN_LINE( 2 * y + 1 ),
+               IN_PITCH );
     EndMerge();
+}
+
+int RenderMean( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
+{
+    RenderSlices( p_filter, p_outpic, p_pic, 0, MeanSlice );
     return VLC_SUCCESS;
 }
 
@@ -223,37 +187,25 @@ int RenderMean( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
  * RenderBlend: Full-resolution blender
  *****************************************************************************/
 
-int RenderBlend( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
+static void BlendSlice( filter_t *p_filter, void *opaque,
+                        unsigned i_first, unsigned i_end )
 {
-    int i_plane;
-
     filter_sys_t *p_sys = p_filter->p_sys;
+    const basic_slice_t *p_slice = opaque;
 
-    /* Copy image and skip lines */
-    for( i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
+    for( unsigned y = i_first; y < i_end; y++ )
     {
-        uint8_t *p_in, *p_out_end, *p_out;
-
-        p_in = p_pic->p[i_plane].p_pixels;
-
-        p_out = p_outpic->p[i_plane].p_pixels;
-        p_out_end = p_out + p_outpic->p[i_plane].i_pitch
-                             * p_outpic->p[i_plane].i_visible_lines;
-
-        /* First line: simple copy */
-        memcpy( p_out, p_in, p_pic->p[i_plane].i_pitch );
-        p_out += p_outpic->p[i_plane].i_pitch;
-
-        /* Remaining lines: mean value */
-        for( ; p_out < p_out_end ; )
-        {
-            Merge( p_out, p_in, p_in + p_pic->p[i_plane].i_pitch,
-                   p_pic->p[i_plane].i_pitch );
-
-            p_out += p_outpic->p[i_plane].i_pitch;
-            p_in  += p_pic->p[i_plane].i_pitch;
-        }
+        /* First line: simple copy, remaining lines: mean value */
+        if( y == 0 )
+            memcpy( OUT_LINE( y ), IN_LINE( y ), IN_PITCH );
+        else
+            Merge( OUT_LINE( y ), IN_LINE( y - 1 ), IN_LINE( y ), IN_PITCH );
     }
     EndMerge();
+}
+
+int RenderBlend( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
+{
+    RenderSlices( p_filter, p_outpic, p_pic, 0, BlendSlice );
     return VLC_SUCCESS;
 }
@@ -29,6 +29,10 @@
 #   include <stdalign.h>
 #endif
 
+#ifdef HAVE_AVX2_INTRINSICS
+#   include <immintrin.h>
+#endif
+
 #include <stdint.h>
 #include <assert.h>
 
@@ -271,6 +275,78 @@ static void DarkenFieldMMX( picture_t *p_dst,
 }
 #endif
 
+#ifdef HAVE_AVX2_INTRINSICS
+VLC_AVX2
+static void DarkenFieldAVX2( picture_t *p_dst,
+                             const int i_field, const int i_strength,
+                             bool process_chroma )
+{
+    assert( p_dst != NULL );
+    assert( i_field == 0 || i_field == 1 );
+    assert( i_strength >= 1 && i_strength <= 3 );
+
+    /* Same algorithm as DarkenFieldMMX(), 32 pixels at a time */
+    const uint8_t remove_high_u8 = 0xFF >> i_strength;
+    const __m128i strength = _mm_cvtsi32_si128( i_strength );
+    const __m256i remove_high = _mm256_set1_epi8( remove_high_u8 );
+    const __m256i b128 = _mm256_set1_epi8( (char)0x80 );
+
+    for( int i_plane = Y_PLANE;
+         i_plane < (process_chroma ? p_dst->i_planes : Y_PLANE + 1);
+         i_plane++ )
+    {
+        const int w = p_dst->p[i_plane].i_visible_pitch;
+        const int w32 = w - w % 32;
+        uint8_t *p_out = p_dst->p[i_plane].p_pixels;
+        uint8_t *p_out_end = p_out + p_dst->p[i_plane].i_pitch
+                                   * p_dst->p[i_plane].i_visible_lines;
+
+        /* skip first line for bottom field */
+        if( i_field == 1 )
+            p_out += p_dst->p[i_plane].i_pitch;
+
+        for( ; p_out < p_out_end ; p_out += 2*p_dst->p[i_plane].i_pitch )
+        {
+            int x = 0;
+
+            if( i_plane == Y_PLANE )
+            {
+                for( ; x < w32; x += 32 )
+                {
+                    __m256i v = _mm256_loadu_si256( (__m256i *)&p_out[x] );
+                    v = _mm256_and_si256( _mm256_srl_epi16( v, strength ),
+                                          remove_high );
+                    _mm256_storeu_si256( (__m256i *)&p_out[x], v );
+                }
+
+                for( ; x < w; ++x )
+                    p_out[x] = ( (p_out[x] >> i_strength) & remove_high_u8 );
+            }
+            else
+            {
+                for( ; x < w32; x += 32 )
+                {
+                    __m256i v = _mm256_loadu_si256( (__m256i *)&p_out[x] );
+                    /* max(data - 128, 0) and max(128 - data, 0) */
+                    __m256i pos = _mm256_subs_epu8( v, b128 );
+                    __m256i neg = _mm256_subs_epu8( b128, v );
+
+                    pos = _mm256_and_si256( _mm256_srl_epi16( pos, strength ),
+                                            remove_high );
+                    neg = _mm256_and_si256( _mm256_srl_epi16( neg, strength ),
+                                            remove_high );
+                    v = _mm256_add_epi8( _mm256_sub_epi8( pos, neg ), b128 );
+                    _mm256_storeu_si256( (__m256i *)&p_out[x], v );
+                }
+
+                for( ; x < w; ++x )
+                    p_out[x] = 128 + ( (p_out[x] - 128) / (1 << i_strength) );
+            }
+        }
+    }
+}
+#endif
+
 /*****************************************************************************
  * Public functions
  *****************************************************************************/
@@ -357,6 +433,13 @@ int RenderPhosphor( filter_t *p_filter,
     */
     if( p_sys->phosphor.i_dimmer_strength > 0 )
     {
+#ifdef HAVE_AVX2_INTRINSICS
+        if( vlc_CPU_AVX2() )
+            DarkenFieldAVX2( p_dst, !i_field, p_sys->phosphor.i_dimmer_strength,
+                p_sys->chroma->p[1].h.num == p_sys->chroma->p[1].h.den &&
+                p_sys->chroma->p[2].h.num == p_sys->chroma->p[2].h.den );
+        else
+#endif
 #ifdef CAN_COMPILE_MMXEXT
         if( vlc_CPU_MMXEXT() )
             DarkenFieldMMX( p_dst, !i_field, p_sys->phosphor.i_dimmer_strength,
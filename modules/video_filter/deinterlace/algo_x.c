@@ -28,11 +28,16 @@
 #   include "mmx.h"
 #endif
 
+#ifdef HAVE_AVX2_INTRINSICS
+#   include <immintrin.h>
+#endif
+
 #include <stdint.h>
 
 #include <vlc_common.h>
 #include <vlc_cpu.h>
 #include <vlc_picture.h>
+#include <vlc_filter.h>
 
 #include "deinterlace.h" /* filter_sys_t */
 
@@ -507,17 +512,268 @@ static inline void XDeintBand8x8MMXEXT( uint8_t *dst, int i_dst,
 }
 #endif
 
+#ifdef HAVE_AVX2_INTRINSICS
+/* XDeint32x8DetectAVX2: XDeint8x8Detect of 4 consecutive blocks at once.
+ * Returns the mask of the interlaced blocks.
+ */
+VLC_AVX2
+static inline unsigned XDeint32x8DetectAVX2( uint8_t *src, int i_src )
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i i32 = _mm256_set1_epi32( 32 );
+    __m256i fc = zero;
+
+    /* unpacklo gets the 8-bit pixels of blocks 0 and 2, unpackhi those of
+     * blocks 1 and 3. After two hadds, lanes 0, 1, 4 and 5 hold the sums of
+     * the blocks 0, 1, 2 and 3. */
+    for( int y = 0; y < 7; y += 2 )
+    {
+        __m256i lo[4], hi[4];
+        for( int i = 0; i < 4; i++ )
+        {
+            __m256i r = _mm256_loadu_si256( (const __m256i *)&src[i*i_src] );
+            lo[i] = _mm256_unpacklo_epi8( r, zero );
+            hi[i] = _mm256_unpackhi_epi8( r, zero );
+        }
+
+#define SSD( a, b ) \
+        _mm256_madd_epi16( _mm256_sub_epi16( a, b ), _mm256_sub_epi16( a, b ) )
+        __m256i fr = _mm256_hadd_epi32(
+                _mm256_add_epi32( SSD( lo[0], lo[1] ), SSD( lo[1], lo[2] ) ),
+                _mm256_add_epi32( SSD( hi[0], hi[1] ), SSD( hi[1], hi[2] ) ) );
+        __m256i ff = _mm256_hadd_epi32(
+                _mm256_add_epi32( SSD( lo[0], lo[2] ), SSD( lo[1], lo[3] ) ),
+                _mm256_add_epi32( SSD( hi[0], hi[2] ), SSD( hi[1], hi[3] ) ) );
+#undef SSD
+        fr = _mm256_hadd_epi32( fr, fr );
+        ff = _mm256_hadd_epi32( ff, ff );
+
+        /* ff < 6*fr/8 && fr > 32 */
+        __m256i fr6 = _mm256_srli_epi32( _mm256_add_epi32(
+                _mm256_slli_epi32( fr, 2 ), _mm256_slli_epi32( fr, 1 ) ), 3 );
+        fc = _mm256_or_si256( fc, _mm256_and_si256(
+                _mm256_cmpgt_epi32( fr6, ff ), _mm256_cmpgt_epi32( fr, i32 ) ) );
+
+        src += 2*i_src;
+    }
+
+    unsigned mask = _mm256_movemask_ps( _mm256_castsi256_ps( fc ) );
+    return ( mask & 0x3 ) | ( ( mask >> 2 ) & 0xC );
+}
+
+/* Absolute differences of 32 pixels, unpacked as in XDeint32x8DetectAVX2 */
+VLC_AVX2
+static inline void XDeintAbsDiffAVX2( const uint8_t *a, const uint8_t *b,
+                                      __m256i *lo, __m256i *hi )
+{
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i va = _mm256_loadu_si256( (const __m256i *)a );
+    __m256i vb = _mm256_loadu_si256( (const __m256i *)b );
+    __m256i d = _mm256_or_si256( _mm256_subs_epu8( va, vb ),
+                                 _mm256_subs_epu8( vb, va ) );
+
+    *lo = _mm256_add_epi16( *lo, _mm256_unpacklo_epi8( d, zero ) );
+    *hi = _mm256_add_epi16( *hi, _mm256_unpackhi_epi8( d, zero ) );
+}
+
+/* Average (rounded down) of 32 pixels, unpacked */
+VLC_AVX2
+static inline void XDeintAvgAVX2( const uint8_t *a, const uint8_t *b,
+                                  __m256i *lo, __m256i *hi )
+{
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i va = _mm256_loadu_si256( (const __m256i *)a );
+    __m256i vb = _mm256_loadu_si256( (const __m256i *)b );
+
+    *lo = _mm256_srli_epi16( _mm256_add_epi16( _mm256_unpacklo_epi8( va, zero ),
+                             _mm256_unpacklo_epi8( vb, zero ) ), 1 );
+    *hi = _mm256_srli_epi16( _mm256_add_epi16( _mm256_unpackhi_epi8( va, zero ),
+                             _mm256_unpackhi_epi8( vb, zero ) ), 1 );
+}
+
+/* XDeint32x8AVX2: XDeint8x8Merge or XDeint8x8Field of 4 consecutive blocks,
+ * according to the mask of the interlaced blocks.
+ * Neither the first nor the last block of a line may be included.
+ */
+VLC_AVX2
+static inline void XDeint32x8AVX2( uint8_t *dst, int i_dst,
+                                   uint8_t *src, int i_src, unsigned mask )
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i field = _mm256_set_epi64x( -(int64_t)((mask >> 3) & 1),
+                                             -(int64_t)((mask >> 2) & 1),
+                                             -(int64_t)((mask >> 1) & 1),
+                                             -(int64_t)(mask & 1) );
+
+    for( int y = 0; y < 8; y += 2 )
+    {
+        const uint8_t *src2 = &src[2*i_src];
+        __m256i cur = _mm256_loadu_si256( (const __m256i *)src );
+        __m256i merged = zero, edge = zero;
+
+        _mm256_storeu_si256( (__m256i *)dst, cur );
+        dst += i_dst;
+
+        if( mask != 0xF )
+        {
+            /* Progressive: (src1[x] + 6*src2[x] + src1[i_src1+x] + 4) >> 3 */
+            __m256i mid = _mm256_loadu_si256( (const __m256i *)&src[i_src] );
+            __m256i next = _mm256_loadu_si256( (const __m256i *)src2 );
+            __m256i lo, hi;
+
+#define MERGE( unpack ) \
+            _mm256_srli_epi16( _mm256_add_epi16( _mm256_add_epi16( \
+                _mm256_add_epi16( unpack( cur, zero ), unpack( next, zero ) ), \
+                _mm256_mullo_epi16( unpack( mid, zero ), \
+                                    _mm256_set1_epi16( 6 ) ) ), \
+                _mm256_set1_epi16( 4 ) ), 3 )
+            lo = MERGE( _mm256_unpacklo_epi8 );
+            hi = MERGE( _mm256_unpackhi_epi8 );
+#undef MERGE
+            merged = _mm256_packus_epi16( lo, hi );
+        }
+
+        if( mask != 0 )
+        {
+            /* Interlaced: edge oriented interpolation */
+            __m256i c0l = zero, c0h = zero, c1l = zero, c1h = zero,
+                    c2l = zero, c2h = zero;
+            for( int k = -4; k < 4; k++ )
+            {
+                XDeintAbsDiffAVX2( &src[k],     &src2[k + 2], &c0l, &c0h );
+                XDeintAbsDiffAVX2( &src[k + 1], &src2[k + 1], &c1l, &c1h );
+                XDeintAbsDiffAVX2( &src[k + 2], &src2[k],     &c2l, &c2h );
+            }
+
+            __m256i left_l, left_h, right_l, right_h, mid_l, mid_h;
+            XDeintAvgAVX2( &src[-1], &src2[1],  &left_l,  &left_h );
+            XDeintAvgAVX2( &src[1],  &src2[-1], &right_l, &right_h );
+            XDeintAvgAVX2( &src[0],  &src2[0],  &mid_l,   &mid_h );
+
+            /* c0 < c1 && c1 <= c2, then c2 < c1 && c1 <= c0, else vertical */
+#define EDGE( c0, c1, c2, left, right, mid ) \
+            _mm256_blendv_epi8( _mm256_blendv_epi8( mid, right, \
+                    _mm256_andnot_si256( _mm256_cmpgt_epi16( c1, c0 ), \
+                                         _mm256_cmpgt_epi16( c1, c2 ) ) ), \
+                left, _mm256_andnot_si256( _mm256_cmpgt_epi16( c1, c2 ), \
+                                           _mm256_cmpgt_epi16( c1, c0 ) ) )
+            __m256i lo = EDGE( c0l, c1l, c2l, left_l, right_l, mid_l );
+            __m256i hi = EDGE( c0h, c1h, c2h, left_h, right_h, mid_h );
+#undef EDGE
+            edge = _mm256_packus_epi16( lo, hi );
+        }
+
+        _mm256_storeu_si256( (__m256i *)dst,
+                             _mm256_blendv_epi8( merged, edge, field ) );
+        dst += i_dst;
+        src += 2*i_src;
+    }
+}
+
+VLC_AVX2
+static inline void XDeintBand8x8AVX2( uint8_t *dst, int i_dst,
+                                      uint8_t *src, int i_src,
+                                      const int i_mbx, int i_modx )
+{
+    int x = 0;
+
+    /* The first and the last blocks use XDeint8x8FieldE, and the blocks
+     * in between are processed 4 by 4 */
+    for( ; x < i_mbx; x++ )
+    {
+        if( x > 0 && x + 4 < i_mbx )
+        {
+            XDeint32x8AVX2( dst, i_dst, src, i_src,
+                            XDeint32x8DetectAVX2( src, i_src ) );
+            dst += 32;
+            src += 32;
+            x += 3;
+            continue;
+        }
+
+        if( XDeint8x8DetectC( src, i_src ) )
+        {
+            if( x == 0 || x == i_mbx - 1 )
+                XDeint8x8FieldEC( dst, i_dst, src, i_src );
+            else
+                XDeint8x8FieldC( dst, i_dst, src, i_src );
+        }
+        else
+        {
+            XDeint8x8MergeC( dst, i_dst,
+                             &src[0*i_src], 2*i_src,
+                             &src[1*i_src], 2*i_src );
+        }
+
+        dst += 8;
+        src += 8;
+    }
+
+    if( i_modx )
+        XDeintNxN( dst, i_dst, src, i_src, i_modx, 8 );
+}
+#endif
+
 /*****************************************************************************
  * Public functions
  *****************************************************************************/
 
-int RenderX( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
+typedef struct
 {
-    VLC_UNUSED(p_filter);
+    picture_t *p_outpic;
+    picture_t *p_pic;
     int i_plane;
+    int i_mbx;
+    int i_modx;
+} x_slice_t;
+
+/* Processes the bands of 8 lines [i_first, i_end) of a plane */
+static void XSlice( filter_t *p_filter, void *opaque,
+                    unsigned i_first, unsigned i_end )
+{
+    VLC_UNUSED(p_filter);
+    const x_slice_t *p_slice = opaque;
+    const plane_t *p_dst = &p_slice->p_outpic->p[p_slice->i_plane];
+    const plane_t *p_src = &p_slice->p_pic->p[p_slice->i_plane];
+    const int i_dst = p_dst->i_pitch;
+    const int i_src = p_src->i_pitch;
 #if defined (CAN_COMPILE_MMXEXT)
     const bool mmxext = vlc_CPU_MMXEXT();
 #endif
+#if defined (HAVE_AVX2_INTRINSICS)
+    const bool avx2 = vlc_CPU_AVX2();
+#endif
+
+    for( unsigned y = i_first; y < i_end; y++ )
+    {
+        uint8_t *dst = &p_dst->p_pixels[8*y*i_dst];
+        uint8_t *src = &p_src->p_pixels[8*y*i_src];
+
+#ifdef HAVE_AVX2_INTRINSICS
+        if( avx2 )
+            XDeintBand8x8AVX2( dst, i_dst, src, i_src,
+                               p_slice->i_mbx, p_slice->i_modx );
+        else
+#endif
+#ifdef CAN_COMPILE_MMXEXT
+        if( mmxext )
+            XDeintBand8x8MMXEXT( dst, i_dst, src, i_src,
+                                 p_slice->i_mbx, p_slice->i_modx );
+        else
+#endif
+            XDeintBand8x8C( dst, i_dst, src, i_src,
+                            p_slice->i_mbx, p_slice->i_modx );
+    }
+
+#ifdef CAN_COMPILE_MMXEXT
+    if( mmxext )
+        emms();
+#endif
+}
+
+int RenderX( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
+{
+    int i_plane;
 
     /* Copy image and skip lines */
     for( i_plane = 0 ; i_plane < p_pic->i_planes ; i_plane++ )
@@ -531,26 +787,24 @@ int RenderX( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
         const int i_dst = p_outpic->p[i_plane].i_pitch;
         const int i_src = p_pic->p[i_plane].i_pitch;
 
-        int y, x;
+        int x;
 
-        for( y = 0; y < i_mby; y++ )
-        {
-            uint8_t *dst = &p_outpic->p[i_plane].p_pixels[8*y*i_dst];
-            uint8_t *src = &p_pic->p[i_plane].p_pixels[8*y*i_src];
-
-#ifdef CAN_COMPILE_MMXEXT
-            if( mmxext )
-                XDeintBand8x8MMXEXT( dst, i_dst, src, i_src, i_mbx, i_modx );
-            else
-#endif
-                XDeintBand8x8C( dst, i_dst, src, i_src, i_mbx, i_modx );
-        }
+        /* The bands only write their own lines, so they are independent */
+        x_slice_t slice = {
+            .p_outpic = p_outpic,
+            .p_pic = p_pic,
+            .i_plane = i_plane,
+            .i_mbx = i_mbx,
+            .i_modx = i_modx,
+        };
+        if( i_mby > 0 )
+            filter_ExecuteSlices( p_filter, i_mby, 1, XSlice, &slice );
 
         /* Last line (C only)*/
         if( i_mody )
         {
-            uint8_t *dst = &p_outpic->p[i_plane].p_pixels[8*y*i_dst];
-            uint8_t *src = &p_pic->p[i_plane].p_pixels[8*y*i_src];
+            uint8_t *dst = &p_outpic->p[i_plane].p_pixels[8*i_mby*i_dst];
+            uint8_t *src = &p_pic->p[i_plane].p_pixels[8*i_mby*i_src];
 
             for( x = 0; x < i_mbx; x++ )
             {
@@ -565,9 +819,5 @@ int RenderX( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
         }
     }
 
-#ifdef CAN_COMPILE_MMXEXT
-    if( mmxext )
-        emms();
-#endif
     return VLC_SUCCESS;
 }
@@ -38,6 +38,10 @@
 
 #include "algo_yadif.h"
 
+#ifdef HAVE_AVX2_INTRINSICS
+#   include <immintrin.h>
+#endif
+
 /*****************************************************************************
  * Yadif (Yet Another DeInterlacing Filter).
  *****************************************************************************/
@@ -46,6 +50,273 @@
    Necessary preprocessor macros are defined in common.h. */
 #include "yadif.h"
 
+#ifdef HAVE_AVX2_INTRINSICS
+/* AVX2 versions of the FILTER macro of yadif.h, bit-exact with the C code.
+ * 8-bit pixels are processed 16 at a time in 16-bit lanes, and 16-bit pixels
+ * 8 at a time in 32-bit lanes, so that the sums of differences cannot
+ * overflow. The remainder of the line is done in C. */
+#define YADIF_AVX2_INLINE VLC_AVX2 static inline __attribute__((always_inline))
+
+YADIF_AVX2_INLINE __m256i YadifLoad( const uint8_t *p, int x, bool hbd )
+{
+    if( hbd )
+        return _mm256_cvtepu16_epi32(
+                    _mm_loadu_si128( (const __m128i *)&p[2 * x] ) );
+    return _mm256_cvtepu8_epi16( _mm_loadu_si128( (const __m128i *)&p[x] ) );
+}
+
+YADIF_AVX2_INLINE void YadifStore( uint8_t *p, __m256i v, bool hbd )
+{
+    v = hbd ? _mm256_packus_epi32( v, v ) : _mm256_packus_epi16( v, v );
+    v = _mm256_permute4x64_epi64( v, _MM_SHUFFLE(3, 1, 2, 0) );
+    _mm_storeu_si128( (__m128i *)p, _mm256_castsi256_si128( v ) );
+}
+
+#define YADIF_OP(name, op8, op16) \
+YADIF_AVX2_INLINE __m256i name( __m256i a, __m256i b, bool hbd ) \
+{ \
+    return hbd ? op16( a, b ) : op8( a, b ); \
+}
+YADIF_OP(YadifAdd, _mm256_add_epi16, _mm256_add_epi32)
+YADIF_OP(YadifSub, _mm256_sub_epi16, _mm256_sub_epi32)
+YADIF_OP(YadifMin, _mm256_min_epi16, _mm256_min_epi32)
+YADIF_OP(YadifMax, _mm256_max_epi16, _mm256_max_epi32)
+YADIF_OP(YadifGt,  _mm256_cmpgt_epi16, _mm256_cmpgt_epi32)
+#undef YADIF_OP
+
+YADIF_AVX2_INLINE __m256i YadifAbsDiff( __m256i a, __m256i b, bool hbd )
+{
+    __m256i d = YadifSub( a, b, hbd );
+    return hbd ? _mm256_abs_epi32( d ) : _mm256_abs_epi16( d );
+}
+
+YADIF_AVX2_INLINE __m256i YadifHalf( __m256i a, bool hbd )
+{
+    return hbd ? _mm256_srai_epi32( a, 1 ) : _mm256_srai_epi16( a, 1 );
+}
+
+YADIF_AVX2_INLINE __m256i YadifAvg( __m256i a, __m256i b, bool hbd )
+{
+    return YadifHalf( YadifAdd( a, b, hbd ), hbd );
+}
+
+/* Spatial score of the direction j, as in the CHECK() macro */
+YADIF_AVX2_INLINE __m256i YadifScore( const uint8_t *cur, int x,
+                                      int mrefs, int prefs, int j, bool hbd )
+{
+    const int s = hbd ? 2 : 1;
+    __m256i a = YadifAbsDiff( YadifLoad( cur + s * (mrefs - 1 + j), x, hbd ),
+                              YadifLoad( cur + s * (prefs - 1 - j), x, hbd ),
+                              hbd );
+    __m256i b = YadifAbsDiff( YadifLoad( cur + s * (mrefs + j), x, hbd ),
+                              YadifLoad( cur + s * (prefs - j), x, hbd ), hbd );
+    __m256i c = YadifAbsDiff( YadifLoad( cur + s * (mrefs + 1 + j), x, hbd ),
+                              YadifLoad( cur + s * (prefs + 1 - j), x, hbd ),
+                              hbd );
+    return YadifAdd( YadifAdd( a, b, hbd ), c, hbd );
+}
+
+/* Updates the spatial prediction with the direction j, where enabled */
+YADIF_AVX2_INLINE __m256i YadifCheck( const uint8_t *cur, int x,
+                                      int mrefs, int prefs, int j,
+                                      __m256i enabled,
+                                      __m256i *spatial_score,
+                                      __m256i *spatial_pred, bool hbd )
+{
+    const int s = hbd ? 2 : 1;
+    __m256i score = YadifScore( cur, x, mrefs, prefs, j, hbd );
+    __m256i better = _mm256_and_si256( enabled,
+                                       YadifGt( *spatial_score, score, hbd ) );
+    __m256i pred = YadifAvg( YadifLoad( cur + s * (mrefs + j), x, hbd ),
+                             YadifLoad( cur + s * (prefs - j), x, hbd ), hbd );
+
+    *spatial_score = _mm256_blendv_epi8( *spatial_score, score, better );
+    *spatial_pred = _mm256_blendv_epi8( *spatial_pred, pred, better );
+    return better;
+}
+
+/* prefs and mrefs are in pixels here */
+YADIF_AVX2_INLINE int YadifFilterLineAVX2( uint8_t *dst, const uint8_t *prev,
+                                           const uint8_t *cur,
+                                           const uint8_t *next, int w,
+                                           int prefs, int mrefs, int parity,
+                                           int mode, bool hbd )
+{
+    const int s = hbd ? 2 : 1;
+    const int step = hbd ? 8 : 16;
+    const uint8_t *prev2 = parity ? prev : cur;
+    const uint8_t *next2 = parity ? cur : next;
+    const __m256i all = _mm256_set1_epi32( -1 );
+    const __m256i one = hbd ? _mm256_set1_epi32( 1 ) : _mm256_set1_epi16( 1 );
+    int x;
+
+    for( x = 0; x + step <= w; x += step )
+    {
+        __m256i c = YadifLoad( cur + s * mrefs, x, hbd );
+        __m256i e = YadifLoad( cur + s * prefs, x, hbd );
+        __m256i p2 = YadifLoad( prev2, x, hbd );
+        __m256i n2 = YadifLoad( next2, x, hbd );
+        __m256i d = YadifAvg( p2, n2, hbd );
+
+        __m256i temporal_diff0 = YadifAbsDiff( p2, n2, hbd );
+        __m256i temporal_diff1 = YadifHalf( YadifAdd(
+                YadifAbsDiff( YadifLoad( prev + s * mrefs, x, hbd ), c, hbd ),
+                YadifAbsDiff( YadifLoad( prev + s * prefs, x, hbd ), e, hbd ),
+                hbd ), hbd );
+        __m256i temporal_diff2 = YadifHalf( YadifAdd(
+                YadifAbsDiff( YadifLoad( next + s * mrefs, x, hbd ), c, hbd ),
+                YadifAbsDiff( YadifLoad( next + s * prefs, x, hbd ), e, hbd ),
+                hbd ), hbd );
+        __m256i diff = YadifMax( YadifMax( YadifHalf( temporal_diff0, hbd ),
+                                           temporal_diff1, hbd ),
+                                 temporal_diff2, hbd );
+
+        __m256i spatial_pred = YadifAvg( c, e, hbd );
+        __m256i spatial_score = YadifSub( YadifAdd( YadifAdd(
+                YadifAbsDiff( YadifLoad( cur + s * (mrefs - 1), x, hbd ),
+                              YadifLoad( cur + s * (prefs - 1), x, hbd ), hbd ),
+                YadifAbsDiff( c, e, hbd ), hbd ),
+                YadifAbsDiff( YadifLoad( cur + s * (mrefs + 1), x, hbd ),
+                              YadifLoad( cur + s * (prefs + 1), x, hbd ), hbd ),
+                hbd ), one, hbd );
+
+        /* The second direction is only tried if the first one was better */
+        __m256i better;
+        better = YadifCheck( cur, x, mrefs, prefs, -1, all,
+                             &spatial_score, &spatial_pred, hbd );
+        YadifCheck( cur, x, mrefs, prefs, -2, better,
+                    &spatial_score, &spatial_pred, hbd );
+        better = YadifCheck( cur, x, mrefs, prefs, 1, all,
+                             &spatial_score, &spatial_pred, hbd );
+        YadifCheck( cur, x, mrefs, prefs, 2, better,
+                    &spatial_score, &spatial_pred, hbd );
+
+        if( mode < 2 )
+        {
+            __m256i b = YadifAvg( YadifLoad( prev2 + s * 2 * mrefs, x, hbd ),
+                                  YadifLoad( next2 + s * 2 * mrefs, x, hbd ),
+                                  hbd );
+            __m256i f = YadifAvg( YadifLoad( prev2 + s * 2 * prefs, x, hbd ),
+                                  YadifLoad( next2 + s * 2 * prefs, x, hbd ),
+                                  hbd );
+            __m256i de = YadifSub( d, e, hbd );
+            __m256i dc = YadifSub( d, c, hbd );
+            __m256i bc = YadifSub( b, c, hbd );
+            __m256i fe = YadifSub( f, e, hbd );
+            __m256i max = YadifMax( YadifMax( de, dc, hbd ),
+                                    YadifMin( bc, fe, hbd ), hbd );
+            __m256i min = YadifMin( YadifMin( de, dc, hbd ),
+                                    YadifMax( bc, fe, hbd ), hbd );
+
+            diff = YadifMax( YadifMax( diff, min, hbd ),
+                             YadifSub( _mm256_setzero_si256(), max, hbd ),
+                             hbd );
+        }
+
+        /* diff >= 0, so this clamps spatial_pred to [d - diff, d + diff] */
+        spatial_pred = YadifMax( spatial_pred, YadifSub( d, diff, hbd ), hbd );
+        spatial_pred = YadifMin( spatial_pred, YadifAdd( d, diff, hbd ), hbd );
+        YadifStore( dst + s * x, spatial_pred, hbd );
+    }
+    return x;
+}
+
+VLC_AVX2
+static void yadif_filter_line_avx2( uint8_t *dst, uint8_t *prev, uint8_t *cur,
+                                    uint8_t *next, int w, int prefs,
+                                    int mrefs, int parity, int mode )
+{
+    int x = YadifFilterLineAVX2( dst, prev, cur, next, w, prefs, mrefs,
+                                 parity, mode, false );
+    if( x < w )
+        yadif_filter_line_c( dst + x, prev + x, cur + x, next + x, w - x,
+                             prefs, mrefs, parity, mode );
+}
+
+VLC_AVX2
+static void yadif_filter_line_avx2_16bit( uint8_t *dst, uint8_t *prev,
+                                          uint8_t *cur, uint8_t *next, int w,
+                                          int prefs, int mrefs, int parity,
+                                          int mode )
+{
+    int x = YadifFilterLineAVX2( dst, prev, cur, next, w, prefs / 2,
+                                 mrefs / 2, parity, mode, true );
+    if( x < w )
+        yadif_filter_line_c_16bit( dst + 2 * x, prev + 2 * x, cur + 2 * x,
+                                   next + 2 * x, w - x, prefs, mrefs, parity,
+                                   mode );
+}
+#undef YADIF_AVX2_INLINE
+#endif
+
+typedef void (*yadif_filter_line)(uint8_t *dst, uint8_t *prev, uint8_t *cur,
+                                  uint8_t *next, int w, int prefs, int mrefs,
+                                  int parity, int mode);
+
+/* Lines of a plane, processed by slices */
+typedef struct
+{
+    yadif_filter_line filter;
+    const plane_t *prevp;
+    const plane_t *curp;
+    const plane_t *nextp;
+    plane_t *dstp;
+    int i_width;
+    int i_field;
+    int yadif_parity;
+} yadif_slice_t;
+
+static void YadifSlice( filter_t *p_filter, void *opaque,
+                        unsigned i_first, unsigned i_end )
+{
+    VLC_UNUSED(p_filter);
+    const yadif_slice_t *p_slice = opaque;
+    const plane_t *prevp = p_slice->prevp;
+    const plane_t *curp  = p_slice->curp;
+    const plane_t *nextp = p_slice->nextp;
+    plane_t *dstp        = p_slice->dstp;
+    const int i_field    = p_slice->i_field;
+    const int yadif_parity = p_slice->yadif_parity;
+
+    /* The first and last lines are duplicated from their neighbours */
+    const int y_end = __MIN( (int)i_end, dstp->i_visible_lines - 1 );
+    for( int y = __MAX( (int)i_first, 1 ); y < y_end; y++ )
+    {
+        if( (y % 2) == i_field  ||  yadif_parity == 2 )
+        {
+            memcpy( &dstp->p_pixels[y * dstp->i_pitch],
+                        &curp->p_pixels[y * curp->i_pitch], dstp->i_visible_pitch );
+        }
+        else
+        {
+            int mode;
+            /* Spatial checks only when enough data */
+            mode = (y >= 2 && y < dstp->i_visible_lines - 2) ? 0 : 2;
+
+            assert( prevp->i_pitch == curp->i_pitch && curp->i_pitch == nextp->i_pitch );
+            p_slice->filter( &dstp->p_pixels[y * dstp->i_pitch],
+                             &prevp->p_pixels[y * prevp->i_pitch],
+                             &curp->p_pixels[y * curp->i_pitch],
+                             &nextp->p_pixels[y * nextp->i_pitch],
+                             p_slice->i_width,
+                             y < dstp->i_visible_lines - 2  ? curp->i_pitch : -curp->i_pitch,
+                             y  - 1  ?  -curp->i_pitch : curp->i_pitch,
+                             yadif_parity,
+                             mode );
+        }
+
+        /* We duplicate the first and last lines */
+        if( y == 1 )
+            memcpy(&dstp->p_pixels[(y-1) * dstp->i_pitch],
+                       &dstp->p_pixels[ y    * dstp->i_pitch],
+                       dstp->i_pitch);
+        else if( y == dstp->i_visible_lines - 2 )
+            memcpy(&dstp->p_pixels[(y+1) * dstp->i_pitch],
+                       &dstp->p_pixels[ y    * dstp->i_pitch],
+                       dstp->i_pitch);
+    }
+}
+
 int RenderYadifSingle( filter_t *p_filter, picture_t *p_dst, picture_t *p_src )
 {
     return RenderYadif( p_filter, p_dst, p_src, 0, 0 );
@@ -109,9 +380,13 @@ int RenderYadif( filter_t *p_filter, picture_t *p_dst, picture_t *p_src,
     if( p_prev && p_cur && p_next )
     {
         /* */
-        void (*filter)(uint8_t *dst, uint8_t *prev, uint8_t *cur, uint8_t *next,
-                       int w, int prefs, int mrefs, int parity, int mode);
+        yadif_filter_line filter;
 
+#if defined(HAVE_AVX2_INTRINSICS)
+        if( vlc_CPU_AVX2() )
+            filter = yadif_filter_line_avx2;
+        else
+#endif
 #if defined(HAVE_X86ASM)
         if( vlc_CPU_SSSE3() )
             filter = vlcpriv_yadif_filter_line_ssse3;
@@ -128,50 +403,32 @@ int RenderYadif( filter_t *p_filter, picture_t *p_dst, picture_t *p_src,
             filter = yadif_filter_line_c;
 
         if( p_sys->chroma->pixel_size == 2 )
-            filter = yadif_filter_line_c_16bit;
+        {
+#if defined(HAVE_AVX2_INTRINSICS)
+            if( vlc_CPU_AVX2() )
+                filter = yadif_filter_line_avx2_16bit;
+            else
+#endif
+                filter = yadif_filter_line_c_16bit;
+        }
 
         for( int n = 0; n < p_dst->i_planes; n++ )
         {
-            const plane_t *prevp = &p_prev->p[n];
-            const plane_t *curp  = &p_cur->p[n];
-            const plane_t *nextp = &p_next->p[n];
-            plane_t *dstp        = &p_dst->p[n];
-
-            for( int y = 1; y < dstp->i_visible_lines - 1; y++ )
-            {
-                if( (y % 2) == i_field  ||  yadif_parity == 2 )
-                {
-                    memcpy( &dstp->p_pixels[y * dstp->i_pitch],
-                                &curp->p_pixels[y * curp->i_pitch], dstp->i_visible_pitch );
-                }
-                else
-                {
-                    int mode;
-                    /* Spatial checks only when enough data */
-                    mode = (y >= 2 && y < dstp->i_visible_lines - 2) ? 0 : 2;
-
-                    assert( prevp->i_pitch == curp->i_pitch && curp->i_pitch == nextp->i_pitch );
-                    filter( &dstp->p_pixels[y * dstp->i_pitch],
-                            &prevp->p_pixels[y * prevp->i_pitch],
-                            &curp->p_pixels[y * curp->i_pitch],
-                            &nextp->p_pixels[y * nextp->i_pitch],
-                            dstp->i_visible_pitch,
-                            y < dstp->i_visible_lines - 2  ? curp->i_pitch : -curp->i_pitch,
-                            y  - 1  ?  -curp->i_pitch : curp->i_pitch,
-                            yadif_parity,
-                            mode );
-                }
-
-                /* We duplicate the first and last lines */
-                if( y == 1 )
-                    memcpy(&dstp->p_pixels[(y-1) * dstp->i_pitch],
-                               &dstp->p_pixels[ y    * dstp->i_pitch],
-                               dstp->i_pitch);
-                else if( y == dstp->i_visible_lines - 2 )
-                    memcpy(&dstp->p_pixels[(y+1) * dstp->i_pitch],
-                               &dstp->p_pixels[ y    * dstp->i_pitch],
-                               dstp->i_pitch);
-            }
+            yadif_slice_t slice = {
+                .filter = filter,
+                .prevp  = &p_prev->p[n],
+                .curp   = &p_cur->p[n],
+                .nextp  = &p_next->p[n],
+                .dstp   = &p_dst->p[n],
+                /* The line filters count pixels, not bytes */
+                .i_width = p_dst->p[n].i_visible_pitch / p_sys->chroma->pixel_size,
+                .i_field = i_field,
+                .yadif_parity = yadif_parity,
+            };
+
+            /* Each line only depends on the input pictures */
+            filter_ExecuteSlices( p_filter, p_dst->p[n].i_visible_lines, 1,
+                                  YadifSlice, &slice );
         }
 
         p_sys->context.i_frame_offset = 1; /* p_cur will be rendered at next frame, too */
@@ -41,6 +41,10 @@
 #   include <altivec.h>
 #endif
 
+#if defined(HAVE_AVX2_INTRINSICS) || defined(HAVE_AVX512_INTRINSICS)
+#   include <immintrin.h>
+#endif
+
 /*****************************************************************************
  * Merge (line blending) routines
  *****************************************************************************/
@@ -177,6 +181,135 @@ void Merge16BitSSE2( void *_p_dest, const void *_p_s1, const void *_p_s2,
 
 #endif
 
+/* pavgb and pavgw round up, while the C routines round down: subtracting
+ * the low bit of s1 ^ s2 gives the same results as the C routines. */
+#if defined(HAVE_AVX2_INTRINSICS)
+VLC_AVX2
+void Merge8BitAVX2( void *_p_dest, const void *_p_s1, const void *_p_s2,
+                    size_t i_bytes )
+{
+    uint8_t *p_dest = _p_dest;
+    const uint8_t *p_s1 = _p_s1;
+    const uint8_t *p_s2 = _p_s2;
+    const __m256i one = _mm256_set1_epi8( 1 );
+
+    for( ; i_bytes >= 32; i_bytes -= 32 )
+    {
+        __m256i s1 = _mm256_loadu_si256( (const __m256i *)p_s1 );
+        __m256i s2 = _mm256_loadu_si256( (const __m256i *)p_s2 );
+        __m256i lsb = _mm256_and_si256( _mm256_xor_si256( s1, s2 ), one );
+
+        _mm256_storeu_si256( (__m256i *)p_dest,
+                _mm256_sub_epi8( _mm256_avg_epu8( s1, s2 ), lsb ) );
+        p_dest += 32;
+        p_s1 += 32;
+        p_s2 += 32;
+    }
+
+    for( ; i_bytes > 0; i_bytes-- )
+        *p_dest++ = ( *p_s1++ + *p_s2++ ) >> 1;
+}
+
+VLC_AVX2
+void Merge16BitAVX2( void *_p_dest, const void *_p_s1, const void *_p_s2,
+                     size_t i_bytes )
+{
+    uint16_t *p_dest = _p_dest;
+    const uint16_t *p_s1 = _p_s1;
+    const uint16_t *p_s2 = _p_s2;
+    const __m256i one = _mm256_set1_epi16( 1 );
+
+    size_t i_words = i_bytes / 2;
+    for( ; i_words >= 16; i_words -= 16 )
+    {
+        __m256i s1 = _mm256_loadu_si256( (const __m256i *)p_s1 );
+        __m256i s2 = _mm256_loadu_si256( (const __m256i *)p_s2 );
+        __m256i lsb = _mm256_and_si256( _mm256_xor_si256( s1, s2 ), one );
+
+        _mm256_storeu_si256( (__m256i *)p_dest,
+                _mm256_sub_epi16( _mm256_avg_epu16( s1, s2 ), lsb ) );
+        p_dest += 16;
+        p_s1 += 16;
+        p_s2 += 16;
+    }
+
+    for( ; i_words > 0; i_words-- )
+        *p_dest++ = ( *p_s1++ + *p_s2++ ) >> 1;
+}
+#endif
+
+#if defined(HAVE_AVX512_INTRINSICS)
+VLC_AVX512
+void Merge8BitAVX512( void *_p_dest, const void *_p_s1, const void *_p_s2,
+                      size_t i_bytes )
+{
+    uint8_t *p_dest = _p_dest;
+    const uint8_t *p_s1 = _p_s1;
+    const uint8_t *p_s2 = _p_s2;
+    const __m512i one = _mm512_set1_epi8( 1 );
+
+    for( ; i_bytes >= 64; i_bytes -= 64 )
+    {
+        __m512i s1 = _mm512_loadu_si512( p_s1 );
+        __m512i s2 = _mm512_loadu_si512( p_s2 );
+        __m512i lsb = _mm512_and_si512( _mm512_xor_si512( s1, s2 ), one );
+
+        _mm512_storeu_si512( p_dest,
+                _mm512_sub_epi8( _mm512_avg_epu8( s1, s2 ), lsb ) );
+        p_dest += 64;
+        p_s1 += 64;
+        p_s2 += 64;
+    }
+
+    /* The tail is done with a masked vector, rather than in C */
+    if( i_bytes > 0 )
+    {
+        const __mmask64 mask = ( UINT64_C(1) << i_bytes ) - 1;
+        __m512i s1 = _mm512_maskz_loadu_epi8( mask, p_s1 );
+        __m512i s2 = _mm512_maskz_loadu_epi8( mask, p_s2 );
+        __m512i lsb = _mm512_and_si512( _mm512_xor_si512( s1, s2 ), one );
+
+        _mm512_mask_storeu_epi8( p_dest, mask,
+                _mm512_sub_epi8( _mm512_avg_epu8( s1, s2 ), lsb ) );
+    }
+}
+
+VLC_AVX512
+void Merge16BitAVX512( void *_p_dest, const void *_p_s1, const void *_p_s2,
+                       size_t i_bytes )
+{
+    uint16_t *p_dest = _p_dest;
+    const uint16_t *p_s1 = _p_s1;
+    const uint16_t *p_s2 = _p_s2;
+    const __m512i one = _mm512_set1_epi16( 1 );
+
+    size_t i_words = i_bytes / 2;
+    for( ; i_words >= 32; i_words -= 32 )
+    {
+        __m512i s1 = _mm512_loadu_si512( p_s1 );
+        __m512i s2 = _mm512_loadu_si512( p_s2 );
+        __m512i lsb = _mm512_and_si512( _mm512_xor_si512( s1, s2 ), one );
+
+        _mm512_storeu_si512( p_dest,
+                _mm512_sub_epi16( _mm512_avg_epu16( s1, s2 ), lsb ) );
+        p_dest += 32;
+        p_s1 += 32;
+        p_s2 += 32;
+    }
+
+    if( i_words > 0 )
+    {
+        const __mmask32 mask = ( UINT32_C(1) << i_words ) - 1;
+        __m512i s1 = _mm512_maskz_loadu_epi16( mask, p_s1 );
+        __m512i s2 = _mm512_maskz_loadu_epi16( mask, p_s2 );
+        __m512i lsb = _mm512_and_si512( _mm512_xor_si512( s1, s2 ), one );
+
+        _mm512_mask_storeu_epi16( p_dest, mask,
+                _mm512_sub_epi16( _mm512_avg_epu16( s1, s2 ), lsb ) );
+    }
+}
+#endif
+
 #ifdef CAN_COMPILE_C_ALTIVEC
 void MergeAltivec( void *_p_dest, const void *_p_s1,
                    const void *_p_s2, size_t i_bytes )
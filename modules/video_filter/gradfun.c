@@ -30,6 +30,8 @@
 # include "config.h"
 #endif
 
+#include <assert.h>
+
 #include <vlc_common.h>
 #include <vlc_plugin.h>
 #include <vlc_cpu.h>
@@ -108,6 +110,13 @@ typedef struct
     int              radius;
     const vlc_chroma_description_t *chroma;
     struct vf_priv_s cfg;
+
+    /* Blur buffers of the slices, reused across planes and pictures */
+    vlc_mutex_t      buffers_lock;
+    uint16_t         **buffers; /* the ones not in use */
+    size_t           buffers_free;
+    size_t           buffers_count;
+    size_t           buffer_size;
 } filter_sys_t;
 
 static int Open(vlc_object_t *object)
@@ -126,17 +135,22 @@ static int Open(vlc_object_t *object)
         return VLC_ENOMEM;
 
     vlc_mutex_init(&sys->lock);
+    vlc_mutex_init(&sys->buffers_lock);
+    sys->buffers       = NULL;
+    sys->buffers_free  = 0;
+    sys->buffers_count = 0;
+    /* The first plane is the widest one */
+    sys->buffer_size   = filter_plane_buffer_size(filter->fmt_in.video.i_width,
+                                                  RADIUS_MAX) * sizeof(uint16_t);
     sys->chroma   = chroma;
     sys->strength = var_CreateGetFloatCommand(filter,   CFG_PREFIX "strength");
     sys->radius   = var_CreateGetIntegerCommand(filter, CFG_PREFIX "radius");
     var_AddCallback(filter, CFG_PREFIX "strength", Callback, NULL);
     var_AddCallback(filter, CFG_PREFIX "radius",   Callback, NULL);
-    sys->cfg.buf = NULL;
 
     struct vf_priv_s *cfg = &sys->cfg;
     cfg->thresh      = 0.0;
     cfg->radius      = 0;
-    cfg->buf         = NULL;
 
 #if HAVE_SSE2 && HAVE_6REGS
     if (vlc_CPU_SSE2())
@@ -168,10 +182,71 @@ static void Close(vlc_object_t *object)
 
     var_DelCallback(filter, CFG_PREFIX "radius",   Callback, NULL);
     var_DelCallback(filter, CFG_PREFIX "strength", Callback, NULL);
-    aligned_free(sys->cfg.buf);
+    assert(sys->buffers_free == sys->buffers_count);
+    for (size_t i = 0; i < sys->buffers_count; i++)
+        aligned_free(sys->buffers[i]);
+    free(sys->buffers);
     free(sys);
 }
 
+/* Takes a free slice buffer. One is allocated only if all of them are in
+ * use, so that there are as many as slices processed at once. */
+static uint16_t *GetBuffer(filter_sys_t *sys)
+{
+    uint16_t *buffer = NULL;
+
+    vlc_mutex_lock(&sys->buffers_lock);
+    if (sys->buffers_free > 0) {
+        buffer = sys->buffers[--sys->buffers_free];
+    } else {
+        uint16_t **buffers = realloc(sys->buffers, (sys->buffers_count + 1)
+                                                   * sizeof(*buffers));
+        if (likely(buffers)) {
+            sys->buffers = buffers;
+            buffer = aligned_alloc(16, sys->buffer_size);
+            if (likely(buffer))
+                sys->buffers_count++;
+        }
+    }
+    vlc_mutex_unlock(&sys->buffers_lock);
+    return buffer;
+}
+
+static void PutBuffer(filter_sys_t *sys, uint16_t *buffer)
+{
+    vlc_mutex_lock(&sys->buffers_lock);
+    assert(sys->buffers_free < sys->buffers_count);
+    sys->buffers[sys->buffers_free++] = buffer;
+    vlc_mutex_unlock(&sys->buffers_lock);
+}
+
+typedef struct
+{
+    const plane_t *src;
+    plane_t       *dst;
+    int           w, h, r;
+} gradfun_plane_t;
+
+static void FilterSlice(filter_t *filter, void *opaque,
+                        unsigned first, unsigned end)
+{
+    filter_sys_t *sys = filter->p_sys;
+    const gradfun_plane_t *p = opaque;
+    uint16_t *buffer = GetBuffer(sys);
+
+    if (unlikely(!buffer)) {
+        for (unsigned y = first; y < end; y++)
+            memcpy(&p->dst->p_pixels[y * p->dst->i_pitch],
+                   &p->src->p_pixels[y * p->src->i_pitch],
+                   p->dst->i_visible_pitch);
+        return;
+    }
+    filter_plane(&sys->cfg, buffer, p->dst->p_pixels, p->src->p_pixels,
+                 p->w, p->h, p->dst->i_pitch, p->src->i_pitch, p->r,
+                 first, end);
+    PutBuffer(sys, buffer);
+}
+
 static picture_t *Filter(filter_t *filter, picture_t *src)
 {
     filter_sys_t *sys = filter->p_sys;
@@ -191,11 +266,7 @@ static picture_t *Filter(filter_t *filter, picture_t *src)
     struct vf_priv_s *cfg = &sys->cfg;
 
     cfg->thresh = (1 << 15) / strength;
-    if (cfg->radius != radius) {
-        cfg->radius = radius;
-        cfg->buf    = aligned_alloc(16,
-                                   (((fmt->i_width + 15) & ~15) * (cfg->radius + 1) / 2 + 32) * sizeof(*cfg->buf));
-    }
+    cfg->radius = radius;
 
     for (int i = 0; i < dst->i_planes; i++) {
         const plane_t *srcp = &src->p[i];
@@ -207,9 +278,11 @@ static picture_t *Filter(filter_t *filter, picture_t *src)
         int r = (cfg->radius  * chroma->p[i].w.num / chroma->p[i].w.den +
                  cfg->radius  * chroma->p[i].h.num / chroma->p[i].h.den) / 2;
         r = VLC_CLIP((r + 1) & ~1, RADIUS_MIN, RADIUS_MAX);
-        if (__MIN(w, h) > 2 * r && cfg->buf) {
-            filter_plane(cfg, dstp->p_pixels, srcp->p_pixels,
-                         w, h, dstp->i_pitch, srcp->i_pitch, r);
+        if (__MIN(w, h) > 2 * r) {
+            gradfun_plane_t plane = {
+                .src = srcp, .dst = dstp, .w = w, .h = h, .r = r,
+            };
+            filter_ExecuteSlices(filter, h, 2, FilterSlice, &plane);
         } else {
             plane_CopyPixels(dstp, srcp);
         }
@@ -31,7 +31,6 @@
 struct vf_priv_s {
     int thresh;
     int radius;
-    uint16_t *buf;
     void (*filter_line)(uint8_t *dst, uint8_t *src, uint16_t *dc,
                         int width, int thresh, const uint16_t *dithers);
     void (*blur_line)(uint16_t *dc, uint16_t *buf, uint16_t *buf1,
@@ -222,19 +221,36 @@ static void blur_line_sse2(uint16_t *dc, uint16_t *buf, uint16_t *buf1,
 }
 #endif // HAVE_6REGS && HAVE_SSE2
 
-static void filter_plane(struct vf_priv_s *ctx, uint8_t *dst, uint8_t *src,
-                         int width, int height, int dstride, int sstride, int r)
+/* Size of the buffer of filter_plane(), in elements */
+static size_t filter_plane_buffer_size(int width, int r)
+{
+    return ((width+15)&~15) * (r+1) / 2 + 32;
+}
+
+/* Filters the lines [first, end) of a plane. The blur of a line only depends
+ * on the r pairs of source lines around it, so the state of the first line of
+ * the slice is rebuilt from them, and slices can be filtered in parallel. */
+static void filter_plane(struct vf_priv_s *ctx, uint16_t *buffer,
+                         uint8_t *dst, uint8_t *src,
+                         int width, int height, int dstride, int sstride, int r,
+                         int first, int end)
 {
     int bstride = ((width+15)&~15)/2;
-    int y;
     uint32_t dc_factor = (1<<21)/(r*r);
-    uint16_t *dc = ctx->buf+16;
-    uint16_t *buf = ctx->buf+bstride+32;
+    uint16_t *dc = buffer+16;
+    uint16_t *buf = buffer+bstride+32;
     int thresh = ctx->thresh;
+    /* Last line pair updating the blur */
+    int last = (height-r-1) & ~1;
+    int y = VLC_CLIP(first, r, last);
+    /* Pair of source lines added by the first update */
+    int pair = (y+r)/2;
 
     memset(dc, 0, (bstride+16)*sizeof(*buf));
-    for (y=0; y<r; y++)
-        ctx->blur_line(dc, buf+y*bstride, buf+(y-1)*bstride, src+2*y*sstride, sstride, width/2);
+    for (int p = pair-r; p < pair; p++) {
+        uint16_t *buf1 = p == pair-r ? buf-bstride : buf+((p-1)%r)*bstride;
+        ctx->blur_line(dc, buf+(p%r)*bstride, buf1, src+2*p*sstride, sstride, width/2);
+    }
     for (;;) {
         if (y < height-r) {
             int mod = ((y+r)/2)%r;
@@ -254,13 +270,12 @@ static void filter_plane(struct vf_priv_s *ctx, uint8_t *dst, uint8_t *src,
                 dc[x] = dc[0];
         }
         if (y == r) {
-            for (y=0; y<r; y++)
-                ctx->filter_line(dst+y*dstride, src+y*sstride, dc-r/2, width, thresh, dither[y&7]);
+            for (int i = first; i < r && i < end; i++)
+                ctx->filter_line(dst+i*dstride, src+i*sstride, dc-r/2, width, thresh, dither[i&7]);
         }
-        ctx->filter_line(dst+y*dstride, src+y*sstride, dc-r/2, width, thresh, dither[y&7]);
-        if (++y >= height) break;
-        ctx->filter_line(dst+y*dstride, src+y*sstride, dc-r/2, width, thresh, dither[y&7]);
-        if (++y >= height) break;
+        for (int i = __MAX(y, first); i < y+2 && i < end; i++)
+            ctx->filter_line(dst+i*dstride, src+i*sstride, dc-r/2, width, thresh, dither[i&7]);
+        y += 2;
+        if (y >= end) break;
     }
 }
-
@@ -110,6 +110,7 @@ static int Open(vlc_object_t *this)
     const vlc_fourcc_t fourcc_in  = fmt_in->i_chroma;
     const vlc_fourcc_t fourcc_out = fmt_out->i_chroma;
     int wmax = 0;
+    size_t bands = 0;
 
     const vlc_chroma_description_t *chroma =
             vlc_fourcc_GetChromaDescription(fourcc_in);
@@ -136,9 +137,14 @@ static int Open(vlc_object_t *this)
         sys->w[i] = fmt_in->i_width  * chroma->p[i].w.num / chroma->p[i].w.den;
         if (sys->w[i] > wmax) wmax = sys->w[i];
         sys->h[i] = fmt_out->i_height * chroma->p[i].h.num / chroma->p[i].h.den;
+        bands = __MAX(bands, (size_t)sys->h[i]
+                           * ((sys->w[i] + BAND_WIDTH - 1) / BAND_WIDTH));
     }
     cfg->Line = malloc(wmax*sizeof(unsigned int));
-    if (!cfg->Line) {
+    cfg->Bands = vlc_alloc(bands, sizeof(unsigned int));
+    if (!cfg->Line || !cfg->Bands) {
+        free(cfg->Line);
+        free(cfg->Bands);
         free(sys);
         return VLC_ENOMEM;
     }
@@ -183,12 +189,104 @@ static void Close(vlc_object_t *this)
         free(cfg->Frame[i]);
     }
     free(cfg->Line);
+    free(cfg->Bands);
     free(sys);
 }
 
 /*****************************************************************************
  * Filter
  *****************************************************************************/
+typedef struct
+{
+    const unsigned char *src;
+    unsigned char *dst;
+    unsigned int *line;
+    unsigned int *bands;
+    unsigned short *frame;
+    int w, h, src_pitch, dst_pitch;
+    int *horizontal, *vertical, *temporal;
+} hqdn3d_plane_t;
+
+static void TemporalSlice(filter_t *filter, void *opaque,
+                          unsigned first, unsigned end)
+{
+    const hqdn3d_plane_t *p = opaque;
+    VLC_UNUSED(filter);
+
+    deNoiseTemporal(p->src + first * p->src_pitch,
+                    p->dst + first * p->dst_pitch,
+                    p->frame + first * p->w,
+                    p->w, end - first, p->src_pitch, p->dst_pitch,
+                    p->temporal);
+}
+
+static void HorizontalSlice(filter_t *filter, void *opaque,
+                            unsigned first, unsigned end)
+{
+    const hqdn3d_plane_t *p = opaque;
+    const int bands = (p->w + BAND_WIDTH - 1) / BAND_WIDTH;
+    VLC_UNUSED(filter);
+
+    deNoiseHorizontal(p->src + first * p->src_pitch,
+                      p->bands + first * bands,
+                      p->w, end - first, p->src_pitch, p->horizontal);
+}
+
+static void BandSlice(filter_t *filter, void *opaque,
+                      unsigned first, unsigned end)
+{
+    const hqdn3d_plane_t *p = opaque;
+    VLC_UNUSED(filter);
+
+    deNoiseBand(p->src, p->dst, p->line, p->frame, p->bands,
+                p->w, p->h, p->src_pitch, p->dst_pitch, first, end,
+                p->horizontal, p->vertical, p->temporal);
+}
+
+static int DenoisePlane(filter_t *filter, const plane_t *src, plane_t *dst,
+                        unsigned short **frame, int w, int h,
+                        int *horizontal, int *vertical, int *temporal)
+{
+    filter_sys_t *sys = filter->p_sys;
+    hqdn3d_plane_t p = {
+        .src = src->p_pixels,
+        .dst = dst->p_pixels,
+        .line = sys->cfg.Line,
+        .bands = sys->cfg.Bands,
+        .frame = *frame,
+        .w = w, .h = h,
+        .src_pitch = src->i_pitch,
+        .dst_pitch = dst->i_pitch,
+        .horizontal = horizontal,
+        .vertical = vertical,
+        .temporal = temporal,
+    };
+
+    if (!p.frame) {
+        *frame = p.frame = vlc_alloc(w * h, sizeof(unsigned short));
+        if (!p.frame)
+            return VLC_ENOMEM;
+        for (int y = 0; y < h; y++) {
+            unsigned short *line = &p.frame[y * w];
+            const unsigned char *pixels = &p.src[y * p.src_pitch];
+            for (int x = 0; x < w; x++) line[x] = pixels[x] << 8;
+        }
+    }
+
+    if (!horizontal[0] && !vertical[0]) {
+        filter_ExecuteSlices(filter, h, 1, TemporalSlice, &p);
+        return VLC_SUCCESS;
+    }
+    if (!temporal[0])
+        p.temporal = NULL;
+
+    /* The horizontal low-pass is split by lines, the vertical and temporal
+     * ones by columns */
+    filter_ExecuteSlices(filter, h, 1, HorizontalSlice, &p);
+    filter_ExecuteSlices(filter, w, BAND_WIDTH, BandSlice, &p);
+    return VLC_SUCCESS;
+}
+
 static picture_t *Filter(filter_t *filter, picture_t *src)
 {
     picture_t *dst;
@@ -218,30 +316,18 @@ static picture_t *Filter(filter_t *filter, picture_t *src)
     }
     vlc_mutex_unlock( &sys->coefs_mutex );
 
-    deNoise(src->p[0].p_pixels, dst->p[0].p_pixels,
-            cfg->Line, &cfg->Frame[0], sys->w[0], sys->h[0],
-            src->p[0].i_pitch, dst->p[0].i_pitch,
-            cfg->Coefs[0],
-            cfg->Coefs[0],
-            cfg->Coefs[1]);
-    deNoise(src->p[1].p_pixels, dst->p[1].p_pixels,
-            cfg->Line, &cfg->Frame[1], sys->w[1], sys->h[1],
-            src->p[1].i_pitch, dst->p[1].i_pitch,
-            cfg->Coefs[2],
-            cfg->Coefs[2],
-            cfg->Coefs[3]);
-    deNoise(src->p[2].p_pixels, dst->p[2].p_pixels,
-            cfg->Line, &cfg->Frame[2], sys->w[2], sys->h[2],
-            src->p[2].i_pitch, dst->p[2].i_pitch,
-            cfg->Coefs[2],
-            cfg->Coefs[2],
-            cfg->Coefs[3]);
-
-    if(unlikely(!cfg->Frame[0] || !cfg->Frame[1] || !cfg->Frame[2]))
-    {
-        picture_Release( src );
-        picture_Release( dst );
-        return NULL;
+    for (int i = 0; i < 3; i++) {
+        int *spatial  = cfg->Coefs[i == 0 ? 0 : 2];
+        int *temporal = cfg->Coefs[i == 0 ? 1 : 3];
+
+        if (unlikely(DenoisePlane(filter, &src->p[i], &dst->p[i],
+                                  &cfg->Frame[i], sys->w[i], sys->h[i],
+                                  spatial, spatial, temporal)))
+        {
+            picture_Release( src );
+            picture_Release( dst );
+            return NULL;
+        }
     }
 
     return CopyInfoAndRelease(dst, src);
@@ -30,9 +30,13 @@
 
 //===========================================================================//
 
+/* Width of the column bands processed by deNoiseBand() */
+#define BAND_WIDTH 64
+
 struct vf_priv_s {
         int Coefs[4][512*16];
         unsigned int *Line;
+        unsigned int *Bands;
         unsigned short *Frame[3];
 };
 
@@ -47,7 +51,7 @@ static /*inline*/ unsigned int LowPassMul(unsigned int PrevMul, unsigned int Cur
 }
 
 static void deNoiseTemporal(
-                    unsigned char *Frame,        // mpi->planes[x]
+                    const unsigned char *Frame,  // mpi->planes[x]
                     unsigned char *FrameDest,    // dmpi->planes[x]
                     unsigned short *FrameAnt,
                     int W, int H, int sStride, int dStride,
@@ -67,110 +71,83 @@ static void deNoiseTemporal(
     }
 }
 
-static void deNoiseSpacial(
-                    unsigned char *Frame,        // mpi->planes[x]
-                    unsigned char *FrameDest,    // dmpi->planes[x]
-                    unsigned int *LineAnt,       // vf->priv->Line (width bytes)
-                    int W, int H, int sStride, int dStride,
-                    int *Horizontal, int *Vertical)
+/* Runs the horizontal low-pass over H lines, and stores its state at the
+ * start of every band (Bands: (W+BAND_WIDTH-1)/BAND_WIDTH values per line) */
+static void deNoiseHorizontal(
+                    const unsigned char *Frame,  // mpi->planes[x]
+                    unsigned int *Bands,
+                    int W, int H, int sStride,
+                    int *Horizontal)
 {
-    long sLineOffs = 0, dLineOffs = 0;
+    const int nBands = (W+BAND_WIDTH-1)/BAND_WIDTH;
     unsigned int PixelAnt;
-    unsigned int PixelDst;
-
-    /* First pixel has no left nor top neighbor. */
-    PixelDst = LineAnt[0] = PixelAnt = Frame[0]<<16;
-    FrameDest[0]= ((PixelDst+0x10007FFF)>>16);
-
-    /* First line has no top neighbor, only left. */
-    for (long X = 1; X < W; X++){
-        PixelDst = LineAnt[X] = LowPassMul(PixelAnt, Frame[X]<<16, Horizontal);
-        FrameDest[X]= ((PixelDst+0x10007FFF)>>16);
-    }
-
-    for (long Y = 1; Y < H; Y++){
-        sLineOffs += sStride, dLineOffs += dStride;
-        /* First pixel on each line doesn't have previous pixel */
-        PixelAnt = Frame[sLineOffs]<<16;
-        PixelDst = LineAnt[0] = LowPassMul(LineAnt[0], PixelAnt, Vertical);
-        FrameDest[dLineOffs]= ((PixelDst+0x10007FFF)>>16);
 
-        for (long X = 1; X < W; X++){
-            /* The rest are normal */
-            PixelAnt = LowPassMul(PixelAnt, Frame[sLineOffs+X]<<16, Horizontal);
-            PixelDst = LineAnt[X] = LowPassMul(LineAnt[X], PixelAnt, Vertical);
-            FrameDest[dLineOffs+X]= ((PixelDst+0x10007FFF)>>16);
+    for (long Y = 0; Y < H; Y++){
+        PixelAnt = Frame[0]<<16;
+        for (long X = 1; X < (nBands-1)*BAND_WIDTH; X++){
+            PixelAnt = LowPassMul(PixelAnt, Frame[X]<<16, Horizontal);
+            if ((X+1) % BAND_WIDTH == 0)
+                Bands[(X+1)/BAND_WIDTH] = PixelAnt;
         }
+        Frame += sStride;
+        Bands += nBands;
     }
 }
 
-static void deNoise(unsigned char *Frame,        // mpi->planes[x]
+/* Denoises the columns [X0, X1) of a plane, X0 being a multiple of
+ * BAND_WIDTH. Each column only depends on its own state and on the
+ * horizontal state stored by deNoiseHorizontal(), so that bands can be
+ * processed in parallel. Temporal may be NULL for spatial only denoising. */
+static void deNoiseBand(const unsigned char *Frame, // mpi->planes[x]
                     unsigned char *FrameDest,    // dmpi->planes[x]
-                    unsigned int *LineAnt,      // vf->priv->Line (width bytes)
-                    unsigned short **FrameAntPtr,
+                    unsigned int *LineAnt,       // vf->priv->Line (width bytes)
+                    unsigned short *FrameAnt,
+                    const unsigned int *Bands,
                     int W, int H, int sStride, int dStride,
+                    int X0, int X1,
                     int *Horizontal, int *Vertical, int *Temporal)
 {
-    long sLineOffs = 0, dLineOffs = 0;
+    const int nBands = (W+BAND_WIDTH-1)/BAND_WIDTH;
     unsigned int PixelAnt;
     unsigned int PixelDst;
-    unsigned short* FrameAnt=(*FrameAntPtr);
-
-    if(!FrameAnt){
-        (*FrameAntPtr)=FrameAnt=malloc(W*H*sizeof(unsigned short));
-        if(!FrameAnt)
-            return;
-        for (long Y = 0; Y < H; Y++){
-            unsigned short* dst=&FrameAnt[Y*W];
-            unsigned char* src=Frame+Y*sStride;
-            for (long X = 0; X < W; X++) dst[X]=src[X]<<8;
-        }
-    }
 
-    if(!Horizontal[0] && !Vertical[0]){
-        deNoiseTemporal(Frame, FrameDest, FrameAnt,
-                        W, H, sStride, dStride, Temporal);
-        return;
-    }
-    if(!Temporal[0]){
-        deNoiseSpacial(Frame, FrameDest, LineAnt,
-                       W, H, sStride, dStride, Horizontal, Vertical);
-        return;
-    }
-
-    /* First pixel has no left nor top neighbor. Only previous frame */
-    LineAnt[0] = PixelAnt = Frame[0]<<16;
-    PixelDst = LowPassMul(FrameAnt[0]<<8, PixelAnt, Temporal);
-    FrameAnt[0] = ((PixelDst+0x1000007F)>>8);
-    FrameDest[0]= ((PixelDst+0x10007FFF)>>16);
-
-    /* First line has no top neighbor. Only left one for each pixel and
-     * last frame */
-    for (long X = 1; X < W; X++){
-        LineAnt[X] = PixelAnt = LowPassMul(PixelAnt, Frame[X]<<16, Horizontal);
-        PixelDst = LowPassMul(FrameAnt[X]<<8, PixelAnt, Temporal);
-        FrameAnt[X] = ((PixelDst+0x1000007F)>>8);
-        FrameDest[X]= ((PixelDst+0x10007FFF)>>16);
-    }
+    for (long Y = 0; Y < H; Y++){
+        long X = X0;
+
+        if (X0 == 0){
+            /* First pixel on each line doesn't have previous pixel */
+            PixelAnt = Frame[0]<<16;
+            /* First line has no top neighbor */
+            LineAnt[0] = Y == 0 ? PixelAnt
+                                : LowPassMul(LineAnt[0], PixelAnt, Vertical);
+            PixelDst = LineAnt[0];
+            if (Temporal){
+                PixelDst = LowPassMul(FrameAnt[0]<<8, PixelDst, Temporal);
+                FrameAnt[0] = ((PixelDst+0x1000007F)>>8);
+            }
+            FrameDest[0]= ((PixelDst+0x10007FFF)>>16);
+            X++;
+        }
+        else
+            PixelAnt = Bands[X0/BAND_WIDTH];
 
-    for (long Y = 1; Y < H; Y++){
-        unsigned short* LinePrev=&FrameAnt[Y*W];
-        sLineOffs += sStride, dLineOffs += dStride;
-        /* First pixel on each line doesn't have previous pixel */
-        PixelAnt = Frame[sLineOffs]<<16;
-        LineAnt[0] = LowPassMul(LineAnt[0], PixelAnt, Vertical);
-        PixelDst = LowPassMul(LinePrev[0]<<8, LineAnt[0], Temporal);
-        LinePrev[0] = ((PixelDst+0x1000007F)>>8);
-        FrameDest[dLineOffs]= ((PixelDst+0x10007FFF)>>16);
-
-        for (long X = 1; X < W; X++){
+        for (; X < X1; X++){
             /* The rest are normal */
-            PixelAnt = LowPassMul(PixelAnt, Frame[sLineOffs+X]<<16, Horizontal);
-            LineAnt[X] = LowPassMul(LineAnt[X], PixelAnt, Vertical);
-            PixelDst = LowPassMul(LinePrev[X]<<8, LineAnt[X], Temporal);
-            LinePrev[X] = ((PixelDst+0x1000007F)>>8);
-            FrameDest[dLineOffs+X]= ((PixelDst+0x10007FFF)>>16);
+            PixelAnt = LowPassMul(PixelAnt, Frame[X]<<16, Horizontal);
+            LineAnt[X] = Y == 0 ? PixelAnt
+                                : LowPassMul(LineAnt[X], PixelAnt, Vertical);
+            PixelDst = LineAnt[X];
+            if (Temporal){
+                PixelDst = LowPassMul(FrameAnt[X]<<8, PixelDst, Temporal);
+                FrameAnt[X] = ((PixelDst+0x1000007F)>>8);
+            }
+            FrameDest[X]= ((PixelDst+0x10007FFF)>>16);
         }
+
+        Frame += sStride;
+        FrameDest += dStride;
+        FrameAnt += W;
+        Bands += nBands;
     }
 }
 
@@ -42,11 +42,13 @@
 #include <vlc_dialog.h>
 #include <vlc_modules.h>
 #include <vlc_decoder.h>
+#include <vlc_metrics.h>
 #include <vlc_picture_pool.h>
 
 #include "audio_output/aout_internal.h"
 #include "stream_output/stream_output.h"
 #include "../clock/clock.h"
+#include "../misc/block_ring.h"
 #include "decoder.h"
 #include "resource.h"
 
@@ -94,6 +96,10 @@ struct vlc_input_decoder_t
 
     /* fifo */
     block_fifo_t *p_fifo;
+    /* lock-less input queue (optional), drained before p_fifo. Blocks are
+     * queued in p_fifo instead while it is not empty, to keep the order. */
+    block_ring_t *p_ring;
+    atomic_bool   ring_overflow;
 
     /* Lock for communication with decoder thread */
     vlc_mutex_t lock;
@@ -174,12 +180,27 @@ struct vlc_input_decoder_t
     vlc_mutex_t     mouse_lock;
     vlc_mouse_event mouse_event;
     void           *mouse_opaque;
+
+    /* Metrics */
+    vlc_metrics_source_t *metrics;
+    atomic_uintmax_t stat_decoded;
+    atomic_uintmax_t stat_lost;
+    atomic_uintmax_t stat_late;
+    atomic_uintmax_t stat_output;
 };
 
 /* Pictures which are DECODER_BOGUS_VIDEO_DELAY or more in advance probably have
  * a bogus PTS and won't be displayed */
 #define DECODER_BOGUS_VIDEO_DELAY                ((vlc_tick_t)(DEFAULT_PTS_DELAY * 30))
 
+/* Maximum amount of data in the decoder input queue when not pacing:
+ * 400 MiB, i.e. ~ 50mb/s for 60s */
+#define DECODER_FIFO_MAX_BYTES  (400*1024*1024)
+/* Number of queued blocks the input waits for when pacing */
+#define DECODER_FIFO_PACE_COUNT 10
+/* Capacity of the lock-less input queue, further blocks go to the fifo */
+#define DECODER_RING_SIZE       1024
+
 /* */
 #define DECODER_SPU_VOUT_WAIT_DURATION   VLC_TICK_FROM_MS(200)
 #define BLOCK_FLAG_CORE_PRIVATE_RELOADED (1 << BLOCK_FLAG_CORE_PRIVATE_SHIFT)
@@ -1123,18 +1144,35 @@ static int ModuleThread_PlayVideo( vlc_input_decoder_t *p_owner, picture_t *p_pi
     return VLC_SUCCESS;
 }
 
+static void ModuleThread_UpdateMetrics( vlc_input_decoder_t *p_owner,
+                                        unsigned lost, unsigned late,
+                                        unsigned output )
+{
+    atomic_fetch_add_explicit( &p_owner->stat_decoded, 1,
+                               memory_order_relaxed );
+    atomic_fetch_add_explicit( &p_owner->stat_lost, lost,
+                               memory_order_relaxed );
+    atomic_fetch_add_explicit( &p_owner->stat_late, late,
+                               memory_order_relaxed );
+    atomic_fetch_add_explicit( &p_owner->stat_output, output,
+                               memory_order_relaxed );
+}
+
 static void ModuleThread_UpdateStatVideo( vlc_input_decoder_t *p_owner,
                                           bool lost )
 {
     unsigned displayed = 0;
     unsigned vout_lost = 0;
+    unsigned late = 0;
     if( p_owner->p_vout != NULL )
     {
-        vout_GetResetStatistic( p_owner->p_vout, &displayed, &vout_lost );
+        vout_GetResetStatistic( p_owner->p_vout, &displayed, &vout_lost,
+                                &late );
     }
     if (lost) vout_lost++;
 
-    decoder_Notify(p_owner, on_new_video_stats, 1, vout_lost, displayed);
+    ModuleThread_UpdateMetrics( p_owner, vout_lost, late, displayed );
+    decoder_Notify(p_owner, on_new_video_stats, 1, vout_lost, displayed, late);
 }
 
 static void ModuleThread_QueueVideo( decoder_t *p_dec, picture_t *p_pic )
@@ -1269,6 +1307,7 @@ static void ModuleThread_UpdateStatAudio( vlc_input_decoder_t *p_owner,
     }
     if (lost) aout_lost++;
 
+    ModuleThread_UpdateMetrics( p_owner, aout_lost, 0, played );
     decoder_Notify(p_owner, on_new_audio_stats, 1, aout_lost, played);
 }
 
@@ -1621,6 +1660,117 @@ static void DecoderThread_ChangeDelay( vlc_input_decoder_t *p_owner, vlc_tick_t
     }
 }
 
+/* The following helpers must be called with the fifo locked */
+static size_t DecoderGetCountUnlocked( vlc_input_decoder_t *p_owner )
+{
+    size_t count = vlc_fifo_GetCount( p_owner->p_fifo );
+
+    if( p_owner->p_ring != NULL )
+        count += block_ring_GetCount( p_owner->p_ring );
+    return count;
+}
+
+static size_t DecoderGetBytesUnlocked( vlc_input_decoder_t *p_owner )
+{
+    size_t bytes = vlc_fifo_GetBytes( p_owner->p_fifo );
+
+    if( p_owner->p_ring != NULL )
+        bytes += block_ring_GetBytes( p_owner->p_ring );
+    return bytes;
+}
+
+static bool DecoderIsEmptyUnlocked( vlc_input_decoder_t *p_owner )
+{
+    return vlc_fifo_IsEmpty( p_owner->p_fifo )
+        && ( p_owner->p_ring == NULL
+          || block_ring_IsEmpty( p_owner->p_ring ) );
+}
+
+static block_t *DecoderDequeueUnlocked( vlc_input_decoder_t *p_owner )
+{
+    if( p_owner->p_ring != NULL )
+    {
+        block_t *p_block = block_ring_Pop( p_owner->p_ring );
+        if( p_block != NULL )
+            return p_block;
+    }
+
+    block_t *p_block = vlc_fifo_DequeueUnlocked( p_owner->p_fifo );
+    if( p_owner->p_ring != NULL && vlc_fifo_IsEmpty( p_owner->p_fifo ) )
+        atomic_store_explicit( &p_owner->ring_overflow, false,
+                               memory_order_relaxed );
+    return p_block;
+}
+
+static block_t *DecoderDequeueAllUnlocked( vlc_input_decoder_t *p_owner )
+{
+    block_t *p_chain = NULL;
+
+    if( p_owner->p_ring != NULL )
+    {
+        block_t **pp_last = &p_chain;
+        block_t *p_block;
+
+        while( (p_block = block_ring_Pop( p_owner->p_ring )) != NULL )
+            block_ChainLastAppend( &pp_last, p_block );
+        atomic_store_explicit( &p_owner->ring_overflow, false,
+                               memory_order_relaxed );
+    }
+
+    block_ChainAppend( &p_chain,
+                       vlc_fifo_DequeueAllUnlocked( p_owner->p_fifo ) );
+    return p_chain;
+}
+
+static void DecoderQueueUnlocked( vlc_input_decoder_t *p_owner,
+                                  block_t *p_block )
+{
+    if( p_owner->p_ring != NULL )
+        atomic_store_explicit( &p_owner->ring_overflow, true,
+                               memory_order_relaxed );
+    vlc_fifo_QueueUnlocked( p_owner->p_fifo, p_block );
+}
+
+/**
+ * Queues blocks in the lock-less ring, without locking the fifo unless the
+ * decoder thread might be waiting for input.
+ *
+ * \return the blocks that could not be queued
+ */
+static block_t *DecoderQueueLockless( vlc_input_decoder_t *p_owner,
+                                      block_t *p_block )
+{
+    bool b_wake = false;
+
+    if( atomic_load_explicit( &p_owner->ring_overflow, memory_order_relaxed )
+     || block_ring_GetBytes( p_owner->p_ring ) > DECODER_FIFO_MAX_BYTES )
+        return p_block;
+
+    while( p_block != NULL )
+    {
+        block_t *p_next = p_block->p_next;
+        bool b_was_empty;
+
+        p_block->p_next = NULL;
+        if( block_ring_Push( p_owner->p_ring, p_block, &b_was_empty ) )
+        {
+            p_block->p_next = p_next;
+            break;
+        }
+        b_wake |= b_was_empty;
+        p_block = p_next;
+    }
+
+    if( b_wake )
+    {   /* The decoder thread checks the queue with the fifo locked before
+         * waiting: signaling with the lock held cannot be missed. */
+        vlc_fifo_Lock( p_owner->p_fifo );
+        vlc_fifo_Signal( p_owner->p_fifo );
+        vlc_fifo_Unlock( p_owner->p_fifo );
+    }
+    return p_block;
+}
+
 /**
  * The decoding main loop
  *
@@ -1713,7 +1863,7 @@ static void *DecoderThread( void *p_data )
 
         vlc_cond_signal( &p_owner->wait_fifo );
 
-        block_t *p_block = vlc_fifo_DequeueUnlocked( p_owner->p_fifo );
+        block_t *p_block = DecoderDequeueUnlocked( p_owner );
         if( p_block == NULL )
         {
             if( likely(!p_owner->b_draining) )
@@ -1795,6 +1945,67 @@ static const struct decoder_owner_callbacks dec_spu_cbs =
     .get_attachments = InputThread_GetInputAttachments,
 };
 
+static const struct vlc_metric decoder_metrics[] = {
+#define METRIC_FIFO_BLOCKS  0
+    { "vlc_decoder_fifo_blocks", "Blocks waiting in the decoder input queue",
+      VLC_METRIC_GAUGE },
+#define METRIC_FIFO_BYTES   1
+    { "vlc_decoder_fifo_bytes", "Bytes waiting in the decoder input queue",
+      VLC_METRIC_GAUGE },
+#define METRIC_DECODED      2
+    { "vlc_decoder_decoded_total", "Decoded blocks", VLC_METRIC_COUNTER },
+#define METRIC_LOST         3
+    { "vlc_decoder_lost_total", "Pictures or audio buffers lost",
+      VLC_METRIC_COUNTER },
+#define METRIC_LATE         4
+    { "vlc_decoder_late_total", "Pictures dropped for being late",
+      VLC_METRIC_COUNTER },
+#define METRIC_OUTPUT       5
+    { "vlc_decoder_output_total", "Pictures displayed or audio buffers played",
+      VLC_METRIC_COUNTER },
+};
+
+static void DecoderReportMetrics( void *opaque, vlc_metrics_writer_t *writer )
+{
+    vlc_input_decoder_t *p_owner = opaque;
+    size_t blocks, bytes;
+
+    vlc_fifo_Lock( p_owner->p_fifo );
+    blocks = DecoderGetCountUnlocked( p_owner );
+    bytes = DecoderGetBytesUnlocked( p_owner );
+    vlc_fifo_Unlock( p_owner->p_fifo );
+
+    vlc_metrics_Report( writer, &decoder_metrics[METRIC_FIFO_BLOCKS], blocks );
+    vlc_metrics_Report( writer, &decoder_metrics[METRIC_FIFO_BYTES], bytes );
+#define REPORT(metric, counter) \
+    vlc_metrics_Report( writer, &decoder_metrics[metric], \
+        atomic_load_explicit( &p_owner->counter, memory_order_relaxed ) )
+    REPORT( METRIC_DECODED, stat_decoded );
+    REPORT( METRIC_LOST, stat_lost );
+    REPORT( METRIC_LATE, stat_late );
+    REPORT( METRIC_OUTPUT, stat_output );
+#undef REPORT
+}
+
+static void DecoderRegisterMetrics( vlc_input_decoder_t *p_owner,
+                                    const es_format_t *fmt )
+{
+    static const char *const cats[] = {
+        [UNKNOWN_ES] = "unknown", [VIDEO_ES] = "video", [AUDIO_ES] = "audio",
+        [SPU_ES] = "spu", [DATA_ES] = "data",
+    };
+    char id[11], codec[5];
+
+    snprintf( id, sizeof (id), "%d", fmt->i_id );
+    vlc_fourcc_to_char( fmt->i_codec, codec );
+    codec[4] = '\0';
+
+    p_owner->metrics = vlc_metrics_Register( &p_owner->dec,
+        DecoderReportMetrics, p_owner, "es", id, "codec", codec,
+        "cat", (size_t)fmt->i_cat < ARRAY_SIZE(cats) ? cats[fmt->i_cat]
+                                                     : "unknown", NULL );
+}
+
 /**
  * Create a decoder object
  *
@@ -1834,6 +2045,12 @@ CreateDecoder( vlc_object_t *p_parent,
     p_owner->p_sout_input = NULL;
     p_owner->p_packetizer = NULL;
 
+    p_owner->metrics = NULL;
+    atomic_init( &p_owner->stat_decoded, 0 );
+    atomic_init( &p_owner->stat_lost, 0 );
+    atomic_init( &p_owner->stat_late, 0 );
+    atomic_init( &p_owner->stat_output, 0 );
+
     atomic_init( &p_owner->b_fmt_description, false );
     p_owner->p_description = NULL;
 
@@ -1869,6 +2086,11 @@ CreateDecoder( vlc_object_t *p_parent,
         return NULL;
     }
 
+    p_owner->p_ring = NULL;
+    atomic_init( &p_owner->ring_overflow, false );
+    if( var_InheritBool( p_dec, "decoder-lockless-fifo" ) )
+        p_owner->p_ring = block_ring_New( DECODER_RING_SIZE );
+
     vlc_mutex_init( &p_owner->lock );
     vlc_mutex_init( &p_owner->mouse_lock );
     vlc_cond_init( &p_owner->wait_request );
@@ -1947,6 +2169,9 @@ CreateDecoder( vlc_object_t *p_parent,
         p_owner->cc.pp_decoder[i] = NULL;
     p_owner->cc.p_sout_input = NULL;
     p_owner->cc.b_sout_created = false;
+
+    if( var_InheritBool( p_dec, "stats" ) )
+        DecoderRegisterMetrics( p_owner, fmt );
     return p_owner;
 }
 
@@ -1962,6 +2187,8 @@ static void DeleteDecoder( vlc_input_decoder_t *p_owner )
     msg_Dbg( p_dec, "killing decoder fourcc `%4.4s'",
              (char*)&p_dec->fmt_in.i_codec );
 
+    vlc_metrics_Unregister( p_owner->metrics );
+
     const enum es_format_category_e i_cat =p_dec->fmt_in.i_cat;
     decoder_Clean( p_dec );
     if ( p_owner->out_pool )
@@ -1974,6 +2201,8 @@ static void DeleteDecoder( vlc_input_decoder_t *p_owner )
         vlc_video_context_Release( p_owner->vctx );
 
     /* Free all packets still in the decoder fifo. */
+    if( p_owner->p_ring != NULL )
+        block_ring_Delete( p_owner->p_ring );
     block_FifoRelease( p_owner->p_fifo );
 
     /* Cleanup */
@@ -2214,17 +2443,29 @@ void vlc_input_decoder_Delete( vlc_input_decoder_t *p_owner )
 void vlc_input_decoder_Decode( vlc_input_decoder_t *p_owner, block_t *p_block,
                                bool b_do_pace )
 {
+    if( p_owner->p_ring != NULL )
+    {
+        if( !b_do_pace )
+            p_block = DecoderQueueLockless( p_owner, p_block );
+        else
+        if( !p_owner->b_waiting
+         && block_ring_GetCount( p_owner->p_ring ) < DECODER_FIFO_PACE_COUNT )
+            p_block = DecoderQueueLockless( p_owner, p_block );
+
+        if( p_block == NULL )
+            return;
+    }
+
     vlc_fifo_Lock( p_owner->p_fifo );
     if( !b_do_pace )
     {
         /* FIXME: ideally we would check the time amount of data
          * in the FIFO instead of its size. */
-        /* 400 MiB, i.e. ~ 50mb/s for 60s */
-        if( vlc_fifo_GetBytes( p_owner->p_fifo ) > 400*1024*1024 )
+        if( DecoderGetBytesUnlocked( p_owner ) > DECODER_FIFO_MAX_BYTES )
         {
             msg_Warn( &p_owner->dec, "decoder/packetizer fifo full (data not "
                       "consumed quickly enough), resetting fifo!" );
-            block_ChainRelease( vlc_fifo_DequeueAllUnlocked( p_owner->p_fifo ) );
+            block_ChainRelease( DecoderDequeueAllUnlocked( p_owner ) );
             p_block->i_flags |= BLOCK_FLAG_DISCONTINUITY;
         }
     }
@@ -2233,11 +2474,11 @@ void vlc_input_decoder_Decode( vlc_input_decoder_t *p_owner, block_t *p_block,
     {   /* The FIFO is not consumed when waiting, so pacing would deadlock VLC.
          * Locking is not necessary as b_waiting is only read, not written by
          * the decoder thread. */
-        while( vlc_fifo_GetCount( p_owner->p_fifo ) >= 10 )
+        while( DecoderGetCountUnlocked( p_owner ) >= DECODER_FIFO_PACE_COUNT )
             vlc_fifo_WaitCond( p_owner->p_fifo, &p_owner->wait_fifo );
     }
 
-    vlc_fifo_QueueUnlocked( p_owner->p_fifo, p_block );
+    DecoderQueueUnlocked( p_owner, p_block );
     vlc_fifo_Unlock( p_owner->p_fifo );
 }
 
@@ -2246,7 +2487,7 @@ bool vlc_input_decoder_IsEmpty( vlc_input_decoder_t * p_owner )
     assert( !p_owner->b_waiting );
 
     vlc_fifo_Lock( p_owner->p_fifo );
-    if( !vlc_fifo_IsEmpty( p_owner->p_fifo ) || p_owner->b_draining )
+    if( !DecoderIsEmptyUnlocked( p_owner ) || p_owner->b_draining )
     {
         vlc_fifo_Unlock( p_owner->p_fifo );
         return false;
@@ -2297,7 +2538,7 @@ void vlc_input_decoder_Flush( vlc_input_decoder_t *p_owner )
     vlc_fifo_Lock( p_owner->p_fifo );
 
     /* Empty the fifo */
-    block_ChainRelease( vlc_fifo_DequeueAllUnlocked( p_owner->p_fifo ) );
+    block_ChainRelease( DecoderDequeueAllUnlocked( p_owner ) );
 
     /* Don't need to wait for the DecoderThread to flush. Indeed, if called a
      * second time, this function will clear the FIFO again before anything was
@@ -2495,7 +2736,7 @@ void vlc_input_decoder_Wait( vlc_input_decoder_t *p_owner )
         if( p_owner->paused )
             break;
         vlc_fifo_Lock( p_owner->p_fifo );
-        if( p_owner->b_idle && vlc_fifo_IsEmpty( p_owner->p_fifo ) )
+        if( p_owner->b_idle && DecoderIsEmptyUnlocked( p_owner ) )
         {
             msg_Err( &p_owner->dec, "buffer deadlock prevented" );
             vlc_fifo_Unlock( p_owner->p_fifo );
@@ -2554,7 +2795,10 @@ bool vlc_input_decoder_HasFormatChanged( vlc_input_decoder_t *p_owner,
 
 size_t vlc_input_decoder_GetFifoSize( vlc_input_decoder_t *p_owner )
 {
-    return block_FifoSize( p_owner->p_fifo );
+    vlc_fifo_Lock( p_owner->p_fifo );
+    size_t i_size = DecoderGetBytesUnlocked( p_owner );
+    vlc_fifo_Unlock( p_owner->p_fifo );
+    return i_size;
 }
 
 static bool DecoderHasVbi( decoder_t *dec )
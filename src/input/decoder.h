@@ -40,7 +40,7 @@ struct vlc_input_decoder_callbacks {
 
     void (*on_new_video_stats)(vlc_input_decoder_t *decoder, unsigned decoded,
                                unsigned lost, unsigned displayed,
-                               void *userdata);
+                               unsigned late, void *userdata);
     void (*on_new_audio_stats)(vlc_input_decoder_t *decoder, unsigned decoded,
                                unsigned lost, unsigned played, void *userdata);
 
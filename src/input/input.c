@@ -404,7 +404,11 @@ static input_thread_t *Create( vlc_object_t *p_parent,
 
     /* */
     if( !priv->b_preparsing && var_InheritBool( p_input, "stats" ) )
-        priv->stats = input_stats_Create();
+    {
+        char *psz_uri = input_item_GetURI( p_item );
+        priv->stats = input_stats_Create( VLC_OBJECT(p_input), psz_uri );
+        free( psz_uri );
+    }
     else
         priv->stats = NULL;
 
@@ -31,6 +31,7 @@
 #include <vlc_input.h>
 #include <vlc_viewpoint.h>
 #include <vlc_atomic.h>
+#include <vlc_metrics.h>
 #include <libvlc.h>
 #include "input_interface.h"
 #include "misc/interrupt.h"
@@ -730,9 +731,11 @@ struct input_stats {
     atomic_uintmax_t lost_abuffers;
     atomic_uintmax_t displayed_pictures;
     atomic_uintmax_t lost_pictures;
+    atomic_uintmax_t late_pictures;
+    vlc_metrics_source_t *metrics;
 };
 
-struct input_stats *input_stats_Create(void);
+struct input_stats *input_stats_Create(vlc_object_t *, const char *uri);
 void input_stats_Destroy(struct input_stats *);
 void input_rate_Add(input_rate_t *, uintmax_t);
 void input_stats_Compute(struct input_stats *, input_stats_t*);
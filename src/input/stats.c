@@ -28,6 +28,7 @@
 #include <string.h>
 
 #include <vlc_common.h>
+#include <vlc_url.h>
 #include "input/input_internal.h"
 
 /**
@@ -51,7 +52,101 @@ static float stats_GetRate(const input_rate_t *rate)
         / (float)(rate->samples[0].date - rate->samples[1].date);
 }
 
-struct input_stats *input_stats_Create(void)
+static const struct vlc_metric input_metrics[] = {
+#define METRIC_READ_BYTES           0
+    { "vlc_input_read_bytes_total", "Bytes read by the access",
+      VLC_METRIC_COUNTER },
+#define METRIC_READ_PACKETS         1
+    { "vlc_input_read_packets_total", "Blocks read by the access",
+      VLC_METRIC_COUNTER },
+#define METRIC_INPUT_BITRATE        2
+    { "vlc_input_bitrate_bytes", "Access bitrate in bytes per second",
+      VLC_METRIC_GAUGE },
+#define METRIC_DEMUX_BYTES          3
+    { "vlc_demux_read_bytes_total", "Bytes sent by the demuxer",
+      VLC_METRIC_COUNTER },
+#define METRIC_DEMUX_BITRATE        4
+    { "vlc_demux_bitrate_bytes", "Demuxer bitrate in bytes per second",
+      VLC_METRIC_GAUGE },
+#define METRIC_DEMUX_CORRUPTED      5
+    { "vlc_demux_corrupted_total", "Corrupted blocks sent by the demuxer",
+      VLC_METRIC_COUNTER },
+#define METRIC_DEMUX_DISCONTINUITY  6
+    { "vlc_demux_discontinuities_total", "Discontinuities in the demuxer output",
+      VLC_METRIC_COUNTER },
+#define METRIC_DECODED_VIDEO        7
+    { "vlc_video_decoded_total", "Decoded video blocks",
+      VLC_METRIC_COUNTER },
+#define METRIC_DISPLAYED_PICTURES   8
+    { "vlc_video_displayed_pictures_total", "Displayed pictures",
+      VLC_METRIC_COUNTER },
+#define METRIC_LOST_PICTURES        9
+    { "vlc_video_lost_pictures_total", "Pictures lost before display",
+      VLC_METRIC_COUNTER },
+#define METRIC_LATE_PICTURES        10
+    { "vlc_video_late_pictures_total",
+      "Pictures dropped for being too late to display", VLC_METRIC_COUNTER },
+#define METRIC_DECODED_AUDIO        11
+    { "vlc_audio_decoded_total", "Decoded audio blocks",
+      VLC_METRIC_COUNTER },
+#define METRIC_PLAYED_ABUFFERS      12
+    { "vlc_audio_played_buffers_total", "Played audio buffers",
+      VLC_METRIC_COUNTER },
+#define METRIC_LOST_ABUFFERS        13
+    { "vlc_audio_lost_buffers_total",
+      "Audio buffers lost, dropped or in underrun", VLC_METRIC_COUNTER },
+};
+
+static void input_stats_Report(void *opaque, vlc_metrics_writer_t *writer)
+{
+    struct input_stats *stats = opaque;
+    input_stats_t st;
+
+    input_stats_Compute(stats, &st);
+
+#define REPORT(metric, value) \
+    vlc_metrics_Report(writer, &input_metrics[metric], value)
+    REPORT(METRIC_READ_BYTES, st.i_read_bytes);
+    REPORT(METRIC_READ_PACKETS, st.i_read_packets);
+    REPORT(METRIC_INPUT_BITRATE, st.f_input_bitrate * CLOCK_FREQ);
+    REPORT(METRIC_DEMUX_BYTES, st.i_demux_read_bytes);
+    REPORT(METRIC_DEMUX_BITRATE, st.f_demux_bitrate * CLOCK_FREQ);
+    REPORT(METRIC_DEMUX_CORRUPTED, st.i_demux_corrupted);
+    REPORT(METRIC_DEMUX_DISCONTINUITY, st.i_demux_discontinuity);
+    REPORT(METRIC_DECODED_VIDEO, st.i_decoded_video);
+    REPORT(METRIC_DISPLAYED_PICTURES, st.i_displayed_pictures);
+    REPORT(METRIC_LOST_PICTURES, st.i_lost_pictures);
+    REPORT(METRIC_LATE_PICTURES,
+           atomic_load_explicit(&stats->late_pictures, memory_order_relaxed));
+    REPORT(METRIC_DECODED_AUDIO, st.i_decoded_audio);
+    REPORT(METRIC_PLAYED_ABUFFERS, st.i_played_abuffers);
+    REPORT(METRIC_LOST_ABUFFERS, st.i_lost_abuffers);
+#undef REPORT
+}
+
+/* Metrics can be scraped remotely: strip the credentials and the query,
+ * which may carry access tokens, from the input label */
+static char *input_stats_Label(const char *uri)
+{
+    vlc_url_t url;
+    char *label = NULL;
+
+    if (uri == NULL)
+        return NULL;
+
+    if (vlc_UrlParse(&url, uri) == 0)
+    {
+        url.psz_username = NULL;
+        url.psz_password = NULL;
+        url.psz_option = NULL;
+        url.psz_fragment = NULL;
+        label = vlc_uri_compose(&url);
+    }
+    vlc_UrlClean(&url);
+    return label;
+}
+
+struct input_stats *input_stats_Create(vlc_object_t *obj, const char *uri)
 {
     struct input_stats *stats = malloc(sizeof (*stats));
     if (unlikely(stats == NULL))
@@ -67,11 +162,18 @@ struct input_stats *input_stats_Create(void)
     atomic_init(&stats->lost_abuffers, 0);
     atomic_init(&stats->displayed_pictures, 0);
     atomic_init(&stats->lost_pictures, 0);
+    atomic_init(&stats->late_pictures, 0);
+
+    char *label = input_stats_Label(uri);
+    stats->metrics = vlc_metrics_Register(obj, input_stats_Report, stats,
+                                          "input", label, NULL);
+    free(label);
     return stats;
 }
 
 void input_stats_Destroy(struct input_stats *stats)
 {
+    vlc_metrics_Unregister(stats->metrics);
     free(stats);
 }
 
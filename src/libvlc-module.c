@@ -401,6 +401,11 @@ static const char *const screensaver_texts[] = {
     "picture quality, for instance deinterlacing, or distort " \
     "the video.")
 
+#define FILTER_THREADS_TEXT N_("Video filter threads")
+#define FILTER_THREADS_LONGTEXT N_( \
+    "Number of threads sharing the processing of the pictures in the " \
+    "video filters supporting it (0 = automatic, 1 = disabled).")
+
 #define SNAP_PATH_TEXT N_("Video snapshot directory (or filename)")
 #define SNAP_PATH_LONGTEXT N_( \
     "Directory where the video snapshots will be stored.")
@@ -547,6 +552,18 @@ static const char *const screensaver_texts[] = {
 
 #define CLOCK_MASTER_TEXT N_("Clock master source")
 
+#define BLOCK_SLAB_TEXT N_("Block slab allocator")
+#define BLOCK_SLAB_LONGTEXT N_( \
+    "Allocate data blocks from per-thread caches of fixed size classes " \
+    "instead of the heap. This reduces allocator contention when " \
+    "demultiplexing or multiplexing many small packets." )
+
+#define DEC_LOCKLESS_FIFO_TEXT N_("Lock-less decoder input queue")
+#define DEC_LOCKLESS_FIFO_LONGTEXT N_( \
+    "Feed decoders through a lock-less single producer/single consumer " \
+    "queue. This reduces locking between the input and decoder threads " \
+    "when many elementary streams are decoded." )
+
 static const int pi_clock_master_values[] = {
     VLC_CLOCK_MASTER_AUDIO,
     VLC_CLOCK_MASTER_MONOTONIC,
@@ -883,6 +900,12 @@ static const char *const ppsz_prefres[] = {
     "However allocation of port numbers below 1025 is usually restricted " \
     "by the operating system." )
 
+#define HTTP_STREAM_BUFFER_TEXT N_( "HTTP stream buffer size" )
+#define HTTP_STREAM_BUFFER_LONGTEXT N_( \
+    "Amount of data kept for each stream served over HTTP (in bytes). " \
+    "New clients start from the most recent data, and clients falling " \
+    "further behind skip ahead." )
+
 #define HTTPS_PORT_TEXT N_( "HTTPS server port" )
 #define HTTPS_PORT_LONGTEXT N_( \
     "The HTTPS server will listen on this TCP port. " \
@@ -1742,6 +1765,9 @@ vlc_module_begin ()
     set_subcategory( SUBCAT_VIDEO_VFILTER )
     add_module_list("video-filter", "video filter", NULL,
                     VIDEO_FILTER_TEXT, VIDEO_FILTER_LONGTEXT)
+    add_integer( "filter-threads", 0, FILTER_THREADS_TEXT,
+                 FILTER_THREADS_LONGTEXT, true )
+        change_integer_range( 0, 64 )
 
 #if 0
     add_string( "pixel-ratio", "1", PIXEL_RATIO_TEXT, PIXEL_RATIO_TEXT )
@@ -1899,6 +1925,9 @@ vlc_module_begin ()
         change_integer_range( 1, 65535 )
     add_integer( "https-port", 8443, HTTPS_PORT_TEXT, HTTPS_PORT_LONGTEXT, true )
         change_integer_range( 1, 65535 )
+    add_integer( "http-stream-buffer", 5000000, HTTP_STREAM_BUFFER_TEXT,
+                 HTTP_STREAM_BUFFER_LONGTEXT, true )
+        change_integer_range( 0, INT_MAX )
     add_string( "rtsp-host", NULL, RTSP_HOST_TEXT, RTSP_HOST_LONGTEXT, true )
     add_integer( "rtsp-port", 554, RTSP_PORT_TEXT, RTSP_PORT_LONGTEXT, true )
         change_integer_range( 1, 65535 )
@@ -2018,6 +2047,10 @@ vlc_module_begin ()
 
     add_bool( "network-synchronisation", false, NETSYNC_TEXT,
               NETSYNC_LONGTEXT, true )
+    add_bool( "decoder-lockless-fifo", false, DEC_LOCKLESS_FIFO_TEXT,
+              DEC_LOCKLESS_FIFO_LONGTEXT, true )
+    add_bool( "block-slab", false, BLOCK_SLAB_TEXT,
+              BLOCK_SLAB_LONGTEXT, true )
 
     add_directory("input-record-path", NULL,
                   INPUT_RECORD_PATH_TEXT, INPUT_RECORD_PATH_LONGTEXT)
@@ -58,6 +58,7 @@
 #include <vlc_dialog.h>
 #include <vlc_keystore.h>
 #include <vlc_fs.h>
+#include <vlc_block.h>
 #include <vlc_cpu.h>
 #include <vlc_url.h>
 #include <vlc_modules.h>
@@ -95,6 +96,9 @@ libvlc_int_t * libvlc_InternalCreate( void )
     priv->main_playlist = NULL;
     priv->p_vlm = NULL;
     priv->media_source_provider = NULL;
+    priv->block_slab = false;
+    vlc_metrics_Init( priv );
+    vlc_filter_threads_Init( priv );
 
     vlc_ExitInit( &priv->exit );
 
@@ -205,6 +209,10 @@ int libvlc_InternalInit( libvlc_int_t *p_libvlc, int i_argc,
 
     vlc_CPU_dump( VLC_OBJECT(p_libvlc) );
 
+    priv->block_slab = var_InheritBool( p_libvlc, "block-slab" );
+    if( priv->block_slab )
+        block_slab_Enable();
+
     if( var_InheritBool( p_libvlc, "media-library") )
     {
         priv->p_media_library = libvlc_MlCreate( p_libvlc );
@@ -386,6 +394,10 @@ void libvlc_InternalCleanup( libvlc_int_t *p_libvlc )
         libvlc_MlRelease( priv->p_media_library );
 
     libvlc_InternalActionsClean( p_libvlc );
+    vlc_filter_threads_Destroy( priv );
+
+    if( priv->block_slab )
+        block_slab_Disable();
 
     /* Save the configuration */
     if( !var_InheritBool( p_libvlc, "ignore-config" ) )
@@ -25,6 +25,7 @@
 # define LIBVLC_LIBVLC_H 1
 
 #include <vlc_input_item.h>
+#include <vlc_list.h>
 
 extern const char psz_vlc_changeset[];
 
@@ -194,6 +195,15 @@ typedef struct libvlc_priv_t
     vlc_actions_t *actions; ///< Hotkeys handler
     struct vlc_medialibrary_t *p_media_library; ///< Media library instance
     struct vlc_thumbnailer_t *p_thumbnailer; ///< Lazily instantiated media thumbnailer
+    bool block_slab; ///< Enabled the block slab allocator
+
+    /* Metrics sources */
+    vlc_mutex_t metrics_lock;
+    struct vlc_list metrics;
+
+    /* Slice threads shared by the filters */
+    vlc_mutex_t filter_threads_lock;
+    struct vlc_filter_threads *filter_threads; ///< Lazily created
 
     /* Exit callback */
     vlc_exit_t       exit;
@@ -204,6 +214,13 @@ static inline libvlc_priv_t *libvlc_priv (libvlc_int_t *libvlc)
     return container_of(libvlc, libvlc_priv_t, public_data);
 }
 
+/* Metrics */
+void vlc_metrics_Init(libvlc_priv_t *);
+
+/* Filter slice threads */
+void vlc_filter_threads_Init(libvlc_priv_t *);
+void vlc_filter_threads_Destroy(libvlc_priv_t *);
+
 int intf_InsertItem(libvlc_int_t *, const char *mrl, unsigned optc,
                     const char * const *optv, unsigned flags);
 void intf_DestroyAll( libvlc_int_t * );
@@ -28,6 +28,7 @@
 #include <sys/stat.h>
 #include <assert.h>
 #include <errno.h>
+#include <stdatomic.h>
 #include <unistd.h>
 #include <fcntl.h>
 
@@ -105,6 +106,368 @@ static void BlockMetaCopy( block_t *restrict out, const block_t *in )
 /** Initial reserved header and footer size. */
 #define BLOCK_PADDING      32
 
+static block_t *block_InitAligned(block_t *b,
+                                  const struct vlc_block_callbacks *cbs,
+                                  size_t alloc, size_t size)
+{
+    block_Init(b, cbs, b + 1, alloc - sizeof (*b));
+    static_assert ((BLOCK_PADDING % BLOCK_ALIGN) == 0,
+                   "BLOCK_PADDING must be a multiple of BLOCK_ALIGN");
+    b->p_buffer += BLOCK_PADDING + BLOCK_ALIGN - 1;
+    b->p_buffer = (void *)(((uintptr_t)b->p_buffer) & ~(BLOCK_ALIGN - 1));
+    b->i_buffer = size;
+    return b;
+}
+
+/*
+ * Slab allocator
+ *
+ * Blocks of up to BLOCK_SLAB_MAX bytes are rounded up to a power of two size
+ * class. Released blocks are cached in a per-thread magazine, so that the
+ * common allocate/release cycle does not touch the heap. Blocks are often
+ * allocated and released by different threads (e.g. demux and decoder): a
+ * full magazine returns half of its content to a shared depot, from which
+ * an empty magazine refills. The depot holds a bounded amount of memory per
+ * class, and is drained when the allocator is disabled.
+ */
+#define BLOCK_SLAB_MIN_SHIFT 8 /* 256 bytes */
+#define BLOCK_SLAB_CLASSES   9 /* up to 64 KiB */
+#define BLOCK_SLAB_MAX       (1u << (BLOCK_SLAB_MIN_SHIFT + BLOCK_SLAB_CLASSES - 1))
+#define BLOCK_SLAB_MAGAZINE  32 /* cached blocks per class and thread */
+#define BLOCK_SLAB_DEPOT_SIZE (1u << 20) /* shared bytes per class */
+#define BLOCK_SLAB_STATS_PERIOD 1024
+
+struct block_slab_stats
+{
+    unsigned allocs;
+    unsigned hits;
+    unsigned frees;
+};
+
+struct block_slab_magazine
+{
+    block_t *free[BLOCK_SLAB_CLASSES];
+    unsigned count[BLOCK_SLAB_CLASSES];
+    struct block_slab_stats stats;
+    unsigned ops;
+};
+
+static struct
+{
+    atomic_bool enabled;
+    unsigned refs;
+    /* Created on first use and kept for the process lifetime, as threads may
+     * still hold magazines after the allocator is disabled */
+    bool has_key;
+    vlc_threadvar_t key;
+
+    vlc_mutex_t lock;
+    block_t *free[BLOCK_SLAB_CLASSES];
+    unsigned count[BLOCK_SLAB_CLASSES];
+
+    atomic_ullong allocs;
+    atomic_ullong hits;
+    atomic_ullong depot;
+    atomic_ullong misses;
+    atomic_ullong frees;
+    atomic_ullong returns;
+} block_slab = {
+    .lock = VLC_STATIC_MUTEX,
+};
+
+static void block_slab_Release(block_t *);
+
+/* One set of callbacks per size class: the class is found from the pointer */
+static const struct vlc_block_callbacks block_slab_cbs[BLOCK_SLAB_CLASSES] = {
+    { block_slab_Release }, { block_slab_Release }, { block_slab_Release },
+    { block_slab_Release }, { block_slab_Release }, { block_slab_Release },
+    { block_slab_Release }, { block_slab_Release }, { block_slab_Release },
+};
+
+static size_t block_slab_Size(unsigned cls)
+{
+    return sizeof (block_t) + BLOCK_ALIGN + (2 * BLOCK_PADDING)
+           + ((size_t)1 << (BLOCK_SLAB_MIN_SHIFT + cls));
+}
+
+/* Blocks the depot holds at most for a class */
+static unsigned block_slab_DepotMax(unsigned cls)
+{
+    return BLOCK_SLAB_DEPOT_SIZE >> (BLOCK_SLAB_MIN_SHIFT + cls);
+}
+
+static void block_slab_FreeList(block_t *b)
+{
+    while (b != NULL)
+    {
+        block_t *next = b->p_next;
+
+        free(b);
+        b = next;
+    }
+}
+
+static void block_slab_FlushStats(struct block_slab_magazine *mag)
+{
+    atomic_fetch_add_explicit(&block_slab.allocs, mag->stats.allocs,
+                              memory_order_relaxed);
+    atomic_fetch_add_explicit(&block_slab.hits, mag->stats.hits,
+                              memory_order_relaxed);
+    atomic_fetch_add_explicit(&block_slab.frees, mag->stats.frees,
+                              memory_order_relaxed);
+    memset(&mag->stats, 0, sizeof (mag->stats));
+    mag->ops = 0;
+}
+
+/* Moves n blocks from the magazine to the depot, freeing the excess, or all
+ * of them if the allocator is disabled */
+static void block_slab_Return(struct block_slab_magazine *mag, unsigned cls,
+                              unsigned n)
+{
+    block_t *excess = NULL;
+
+    atomic_fetch_add_explicit(&block_slab.returns, n, memory_order_relaxed);
+
+    vlc_mutex_lock(&block_slab.lock);
+    /* Disabling clears the depot with the lock held */
+    const bool enabled = atomic_load_explicit(&block_slab.enabled,
+                                              memory_order_relaxed);
+    while (n-- > 0)
+    {
+        block_t *b = mag->free[cls];
+
+        mag->free[cls] = b->p_next;
+        mag->count[cls]--;
+
+        if (enabled && block_slab.count[cls] < block_slab_DepotMax(cls))
+        {
+            b->p_next = block_slab.free[cls];
+            block_slab.free[cls] = b;
+            block_slab.count[cls]++;
+        }
+        else
+        {
+            b->p_next = excess;
+            excess = b;
+        }
+    }
+    vlc_mutex_unlock(&block_slab.lock);
+
+    block_slab_FreeList(excess);
+}
+
+/* Empties the magazine */
+static void block_slab_Drain(struct block_slab_magazine *mag)
+{
+    for (unsigned cls = 0; cls < BLOCK_SLAB_CLASSES; cls++)
+        if (mag->count[cls] > 0)
+            block_slab_Return(mag, cls, mag->count[cls]);
+    block_slab_FlushStats(mag);
+}
+
+static void block_slab_Destroy(void *data)
+{
+    struct block_slab_magazine *mag = data;
+
+    block_slab_Drain(mag);
+    free(mag);
+}
+
+static struct block_slab_magazine *block_slab_GetMagazine(void)
+{
+    struct block_slab_magazine *mag = vlc_threadvar_get(block_slab.key);
+
+    if (unlikely(mag == NULL))
+    {
+        mag = calloc(1, sizeof (*mag));
+        if (unlikely(mag == NULL))
+            return NULL;
+        if (vlc_threadvar_set(block_slab.key, mag))
+        {
+            free(mag);
+            return NULL;
+        }
+    }
+    return mag;
+}
+
+static void block_slab_CountOp(struct block_slab_magazine *mag)
+{
+    if (++mag->ops >= BLOCK_SLAB_STATS_PERIOD)
+        block_slab_FlushStats(mag);
+}
+
+static block_t *block_slab_Alloc(size_t size)
+{
+    unsigned cls = 0;
+
+    while (((size_t)1 << (BLOCK_SLAB_MIN_SHIFT + cls)) < size)
+        cls++;
+    assert(cls < BLOCK_SLAB_CLASSES);
+
+    struct block_slab_magazine *mag = block_slab_GetMagazine();
+    block_t *b = NULL;
+
+    if (likely(mag != NULL))
+    {
+        mag->stats.allocs++;
+        block_slab_CountOp(mag);
+
+        if (mag->free[cls] == NULL)
+        {   /* Refill half of the magazine from the depot */
+            unsigned n = 0;
+
+            vlc_mutex_lock(&block_slab.lock);
+            while (n < BLOCK_SLAB_MAGAZINE / 2 && block_slab.free[cls] != NULL)
+            {
+                block_t *d = block_slab.free[cls];
+
+                block_slab.free[cls] = d->p_next;
+                block_slab.count[cls]--;
+                d->p_next = mag->free[cls];
+                mag->free[cls] = d;
+                n++;
+            }
+            vlc_mutex_unlock(&block_slab.lock);
+
+            mag->count[cls] += n;
+            if (n > 0)
+                atomic_fetch_add_explicit(&block_slab.depot, n,
+                                          memory_order_relaxed);
+        }
+        else
+            mag->stats.hits++;
+
+        b = mag->free[cls];
+        if (b != NULL)
+        {
+            mag->free[cls] = b->p_next;
+            mag->count[cls]--;
+        }
+    }
+
+    if (b == NULL)
+    {
+        atomic_fetch_add_explicit(&block_slab.misses, 1, memory_order_relaxed);
+        b = malloc(block_slab_Size(cls));
+        if (unlikely(b == NULL))
+            return NULL;
+    }
+
+    return block_InitAligned(b, &block_slab_cbs[cls], block_slab_Size(cls),
+                             size);
+}
+
+static void block_slab_Release(block_t *block)
+{
+    unsigned cls = block->cbs - block_slab_cbs;
+    struct block_slab_magazine *mag;
+
+    assert(cls < BLOCK_SLAB_CLASSES);
+    assert(block->p_start == (unsigned char *)(block + 1));
+
+    if (unlikely(!atomic_load_explicit(&block_slab.enabled,
+                                       memory_order_acquire)))
+    {   /* Disabled since the allocation: the magazine of the thread, if any,
+         * goes back to the heap too */
+        mag = vlc_threadvar_get(block_slab.key);
+        if (mag != NULL)
+            block_slab_Drain(mag);
+        free(block);
+        return;
+    }
+
+    mag = block_slab_GetMagazine();
+    if (unlikely(mag == NULL))
+    {
+        free(block);
+        return;
+    }
+
+    mag->stats.frees++;
+    block_slab_CountOp(mag);
+
+    if (mag->count[cls] >= BLOCK_SLAB_MAGAZINE)
+        block_slab_Return(mag, cls, BLOCK_SLAB_MAGAZINE / 2);
+
+    block->p_next = mag->free[cls];
+    mag->free[cls] = block;
+    mag->count[cls]++;
+}
+
+void block_slab_Enable(void)
+{
+    vlc_mutex_lock(&block_slab.lock);
+    if (!block_slab.has_key)
+    {
+        if (vlc_threadvar_create(&block_slab.key, block_slab_Destroy))
+        {
+            vlc_mutex_unlock(&block_slab.lock);
+            return;
+        }
+        block_slab.has_key = true;
+    }
+    if (block_slab.refs++ == 0)
+        atomic_store_explicit(&block_slab.enabled, true,
+                              memory_order_release);
+    vlc_mutex_unlock(&block_slab.lock);
+}
+
+void block_slab_Disable(void)
+{
+    struct block_slab_magazine *mag;
+    block_t *depot[BLOCK_SLAB_CLASSES];
+
+    vlc_mutex_lock(&block_slab.lock);
+    if (block_slab.refs == 0 || --block_slab.refs > 0)
+    {   /* Not enabled, or still used by another instance */
+        vlc_mutex_unlock(&block_slab.lock);
+        return;
+    }
+
+    /* From now on, blocks released or returned by any thread are freed */
+    atomic_store_explicit(&block_slab.enabled, false, memory_order_relaxed);
+    for (unsigned cls = 0; cls < BLOCK_SLAB_CLASSES; cls++)
+    {
+        depot[cls] = block_slab.free[cls];
+        block_slab.free[cls] = NULL;
+        block_slab.count[cls] = 0;
+    }
+    vlc_mutex_unlock(&block_slab.lock);
+
+    for (unsigned cls = 0; cls < BLOCK_SLAB_CLASSES; cls++)
+        block_slab_FreeList(depot[cls]);
+
+    /* The calling thread, typically the main one, may never exit. The other
+     * threads empty their magazines on their next release, or on exit. */
+    mag = vlc_threadvar_get(block_slab.key);
+    if (mag != NULL)
+        block_slab_Drain(mag);
+}
+
+void block_slab_GetStats(struct vlc_block_slab_stats *stats)
+{
+    struct block_slab_magazine *mag = NULL;
+
+    if (atomic_load_explicit(&block_slab.enabled, memory_order_acquire))
+        mag = vlc_threadvar_get(block_slab.key);
+    if (mag != NULL) /* account the calling thread exactly */
+        block_slab_FlushStats(mag);
+
+    stats->allocs = atomic_load_explicit(&block_slab.allocs,
+                                         memory_order_relaxed);
+    stats->magazine_hits = atomic_load_explicit(&block_slab.hits,
+                                                memory_order_relaxed);
+    stats->depot_hits = atomic_load_explicit(&block_slab.depot,
+                                             memory_order_relaxed);
+    stats->heap_allocs = atomic_load_explicit(&block_slab.misses,
+                                              memory_order_relaxed);
+    stats->frees = atomic_load_explicit(&block_slab.frees,
+                                        memory_order_relaxed);
+    stats->depot_returns = atomic_load_explicit(&block_slab.returns,
+                                                memory_order_relaxed);
+}
+
 block_t *block_Alloc (size_t size)
 {
     if (unlikely(size >> 27))
@@ -113,6 +476,10 @@ block_t *block_Alloc (size_t size)
         return NULL;
     }
 
+    if (size <= BLOCK_SLAB_MAX
+     && atomic_load_explicit(&block_slab.enabled, memory_order_acquire))
+        return block_slab_Alloc(size);
+
     /* 2 * BLOCK_PADDING: pre + post padding */
     const size_t alloc = sizeof (block_t) + BLOCK_ALIGN + (2 * BLOCK_PADDING)
                        + size;
@@ -123,13 +490,7 @@ block_t *block_Alloc (size_t size)
     if (unlikely(b == NULL))
         return NULL;
 
-    block_Init(b, &block_generic_cbs, b + 1, alloc - sizeof (*b));
-    static_assert ((BLOCK_PADDING % BLOCK_ALIGN) == 0,
-                   "BLOCK_PADDING must be a multiple of BLOCK_ALIGN");
-    b->p_buffer += BLOCK_PADDING + BLOCK_ALIGN - 1;
-    b->p_buffer = (void *)(((uintptr_t)b->p_buffer) & ~(BLOCK_ALIGN - 1));
-    b->i_buffer = size;
-    return b;
+    return block_InitAligned(b, &block_generic_cbs, alloc, size);
 }
 
 void block_Release(block_t *block)
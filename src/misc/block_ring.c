@@ -0,0 +1,139 @@
+/*****************************************************************************
+ * block_ring.c: lock-less single producer/single consumer block queue
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include "block_ring.h"
+
+struct block_ring
+{
+    /* Written by the consumer only */
+    alignas (64) atomic_size_t head;
+    /* Written by the producer only */
+    alignas (64) atomic_size_t tail;
+
+    /* Accounting, updated by both sides */
+    alignas (64) atomic_size_t count;
+    atomic_size_t bytes;
+
+    size_t mask;
+    block_t *slots[];
+};
+
+block_ring_t *block_ring_New(size_t capacity)
+{
+    size_t size = 1;
+
+    while (size < capacity)
+        size <<= 1;
+
+    size_t bytes = sizeof (block_ring_t) + size * sizeof (block_t *);
+    block_ring_t *ring = aligned_alloc(64, (bytes + 63) & ~(size_t)63);
+    if (unlikely(ring == NULL))
+        return NULL;
+
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->count, 0);
+    atomic_init(&ring->bytes, 0);
+    ring->mask = size - 1;
+    return ring;
+}
+
+void block_ring_Delete(block_ring_t *ring)
+{
+    block_t *block;
+
+    while ((block = block_ring_Pop(ring)) != NULL)
+        block_Release(block);
+    aligned_free(ring);
+}
+
+int block_ring_Push(block_ring_t *ring, block_t *block,
+                    bool *restrict was_empty)
+{
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+    assert(block->p_next == NULL);
+
+    if (tail - head > ring->mask)
+        return VLC_EGENERIC; /* full */
+
+    /* Account before publishing, so that the consumer never decrements
+     * the counters below zero. */
+    atomic_fetch_add_explicit(&ring->bytes, block->i_buffer,
+                              memory_order_relaxed);
+    atomic_fetch_add_explicit(&ring->count, 1, memory_order_relaxed);
+
+    ring->slots[tail & ring->mask] = block;
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_seq_cst);
+
+    /* Check the head after publishing the block. If the consumer has not
+     * taken every previous block yet, it will see this one before finding
+     * the ring empty: the tail store is ordered before this head load, and
+     * the head store of the consumer before its tail load. */
+    *was_empty = atomic_load_explicit(&ring->head,
+                                      memory_order_seq_cst) == tail;
+    return VLC_SUCCESS;
+}
+
+block_t *block_ring_Pop(block_ring_t *ring)
+{
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_seq_cst);
+
+    if (head == tail)
+        return NULL;
+
+    block_t *block = ring->slots[head & ring->mask];
+    atomic_store_explicit(&ring->head, head + 1, memory_order_seq_cst);
+
+    atomic_fetch_sub_explicit(&ring->bytes, block->i_buffer,
+                              memory_order_relaxed);
+    atomic_fetch_sub_explicit(&ring->count, 1, memory_order_relaxed);
+    return block;
+}
+
+bool block_ring_IsEmpty(const block_ring_t *ring)
+{
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+    return atomic_load_explicit(&ring->tail, memory_order_seq_cst) == head;
+}
+
+size_t block_ring_GetCount(const block_ring_t *ring)
+{
+    return atomic_load_explicit(&ring->count, memory_order_relaxed);
+}
+
+size_t block_ring_GetBytes(const block_ring_t *ring)
+{
+    return atomic_load_explicit(&ring->bytes, memory_order_relaxed);
+}
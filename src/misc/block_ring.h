@@ -0,0 +1,86 @@
+/*****************************************************************************
+ * block_ring.h: lock-less single producer/single consumer block queue
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_BLOCK_RING_H
+#define VLC_BLOCK_RING_H
+
+/**
+ * Bounded queue of blocks, safe for one producer thread and one consumer
+ * thread without locking.
+ *
+ * Several threads may produce (or consume) as long as they are serialized
+ * by some other mean, e.g. a common lock.
+ *
+ * The count and size accounting matches the one of block_fifo_t. It may
+ * transiently over-estimate the queue content, never under-estimate it.
+ */
+typedef struct block_ring block_ring_t;
+
+/**
+ * Creates a ring.
+ *
+ * \param capacity maximum number of queued blocks (rounded up to a power
+ *                 of two)
+ */
+block_ring_t *block_ring_New(size_t capacity);
+
+/**
+ * Destroys a ring, releasing any block still queued.
+ */
+void block_ring_Delete(block_ring_t *);
+
+/**
+ * Queues a block (producer side).
+ *
+ * The block must not be chained.
+ *
+ * \param was_empty set to true if the consumer had taken every previous
+ *                  block, i.e. if it might have found the ring empty and
+ *                  need to be woken up
+ * \retval VLC_SUCCESS on success
+ * \retval VLC_EGENERIC if the ring is full (the block is not queued)
+ */
+int block_ring_Push(block_ring_t *, block_t *, bool *restrict was_empty);
+
+/**
+ * Dequeues a block (consumer side).
+ *
+ * \return the oldest block, or NULL if the ring is empty
+ */
+block_t *block_ring_Pop(block_ring_t *);
+
+/**
+ * Checks if the ring is empty (consumer side).
+ *
+ * Unlike the count, this is exact with respect to block_ring_Pop().
+ */
+bool block_ring_IsEmpty(const block_ring_t *);
+
+/**
+ * Returns the number of queued blocks.
+ */
+size_t block_ring_GetCount(const block_ring_t *);
+
+/**
+ * Returns the total size in bytes of queued blocks.
+ */
+size_t block_ring_GetBytes(const block_ring_t *);
+
+#endif
@@ -291,6 +291,8 @@ void vlc_CPU_dump (vlc_object_t *obj)
         vlc_memstream_puts(&stream, "AVX ");
     if (vlc_CPU_AVX2())
         vlc_memstream_puts(&stream, "AVX2 ");
+    if (vlc_CPU_AVX512())
+        vlc_memstream_puts(&stream, "AVX-512 ");
     if (vlc_CPU_3dNOW())
         vlc_memstream_puts(&stream, "3DNow! ");
     if (vlc_CPU_XOP())
@@ -176,6 +176,198 @@ void filter_DeleteBlend( vlc_blender_t *p_blend )
     vlc_object_delete(p_blend);
 }
 
+/* Slice threads */
+#include <vlc_list.h>
+
+/* Smallest slice worth a thread switch */
+#define FILTER_SLICE_MIN_LINES 16
+
+struct filter_slice_job
+{
+    filter_t *filter;
+    filter_slice_cb cb;
+    void *opaque;
+    unsigned lines;
+    unsigned slice_lines;
+    unsigned slices;
+    unsigned next; /**< next slice to process */
+    unsigned pending; /**< slices not yet processed */
+    struct vlc_list node;
+};
+
+struct vlc_filter_threads
+{
+    vlc_mutex_t lock;
+    vlc_cond_t wait; /**< signaled when a job is queued */
+    vlc_cond_t done; /**< signaled when the last slice of a job is done */
+    struct vlc_list jobs; /**< jobs with slices left to start */
+    bool closing;
+    unsigned count;
+    vlc_thread_t threads[];
+};
+
+void vlc_filter_threads_Init(libvlc_priv_t *priv)
+{
+    vlc_mutex_init(&priv->filter_threads_lock);
+    priv->filter_threads = NULL;
+}
+
+/* Takes the next slice of the job and processes it, with the lock held */
+static void FilterSliceRun(struct vlc_filter_threads *ft,
+                           struct filter_slice_job *job)
+{
+    unsigned index = job->next++;
+    if (job->next == job->slices)
+        vlc_list_remove(&job->node);
+    vlc_mutex_unlock(&ft->lock);
+
+    unsigned first = index * job->slice_lines;
+    unsigned end = __MIN(first + job->slice_lines, job->lines);
+    job->cb(job->filter, job->opaque, first, end);
+
+    vlc_mutex_lock(&ft->lock);
+    if (--job->pending == 0)
+        vlc_cond_broadcast(&ft->done);
+}
+
+static void *FilterSliceThread(void *data)
+{
+    struct vlc_filter_threads *ft = data;
+
+    vlc_mutex_lock(&ft->lock);
+    while (!ft->closing)
+    {
+        struct filter_slice_job *job =
+            vlc_list_first_entry_or_null(&ft->jobs, struct filter_slice_job,
+                                         node);
+        if (job == NULL)
+            vlc_cond_wait(&ft->wait, &ft->lock);
+        else
+            FilterSliceRun(ft, job);
+    }
+    vlc_mutex_unlock(&ft->lock);
+    return NULL;
+}
+
+static struct vlc_filter_threads *FilterThreadsGet(filter_t *filter)
+{
+    libvlc_int_t *libvlc = vlc_object_instance(filter);
+    libvlc_priv_t *priv = libvlc_priv(libvlc);
+    struct vlc_filter_threads *ft;
+
+    vlc_mutex_lock(&priv->filter_threads_lock);
+    ft = priv->filter_threads;
+    if (ft != NULL)
+        goto out;
+
+    int64_t count = var_InheritInteger(libvlc, "filter-threads");
+    if (count <= 0)
+        count = vlc_GetCPUCount();
+    /* The calling thread processes slices too */
+    if (count <= 1)
+        goto out;
+    count = __MIN(count - 1, 64);
+
+    ft = malloc(sizeof (*ft) + count * sizeof (ft->threads[0]));
+    if (unlikely(ft == NULL))
+        goto out;
+
+    vlc_mutex_init(&ft->lock);
+    vlc_cond_init(&ft->wait);
+    vlc_cond_init(&ft->done);
+    vlc_list_init(&ft->jobs);
+    ft->closing = false;
+    ft->count = 0;
+
+    while (ft->count < count)
+    {
+        if (vlc_clone(&ft->threads[ft->count], FilterSliceThread, ft,
+                      VLC_THREAD_PRIORITY_VIDEO))
+            break;
+        ft->count++;
+    }
+
+    if (ft->count == 0)
+    {
+        free(ft);
+        ft = NULL;
+        goto out;
+    }
+
+    msg_Dbg(libvlc, "using %u filter slice threads", ft->count);
+    priv->filter_threads = ft;
+out:
+    vlc_mutex_unlock(&priv->filter_threads_lock);
+    return ft;
+}
+
+void vlc_filter_threads_Destroy(libvlc_priv_t *priv)
+{
+    struct vlc_filter_threads *ft = priv->filter_threads;
+    if (ft == NULL)
+        return;
+
+    vlc_mutex_lock(&ft->lock);
+    assert(vlc_list_is_empty(&ft->jobs));
+    ft->closing = true;
+    vlc_cond_broadcast(&ft->wait);
+    vlc_mutex_unlock(&ft->lock);
+
+    for (unsigned i = 0; i < ft->count; i++)
+        vlc_join(ft->threads[i], NULL);
+    free(ft);
+    priv->filter_threads = NULL;
+}
+
+void filter_ExecuteSlices(filter_t *filter, unsigned lines, unsigned align,
+                          filter_slice_cb cb, void *opaque)
+{
+    assert(align > 0);
+
+    if (lines == 0)
+        return;
+
+    struct vlc_filter_threads *ft = NULL;
+    if (lines >= 2 * FILTER_SLICE_MIN_LINES)
+        ft = FilterThreadsGet(filter);
+    if (ft == NULL)
+    {
+        cb(filter, opaque, 0, lines);
+        return;
+    }
+
+    unsigned slice_lines = (lines + ft->count) / (ft->count + 1);
+    slice_lines = __MAX(slice_lines, FILTER_SLICE_MIN_LINES);
+    slice_lines = (slice_lines + align - 1) / align * align;
+
+    struct filter_slice_job job = {
+        .filter = filter,
+        .cb = cb,
+        .opaque = opaque,
+        .lines = lines,
+        .slice_lines = slice_lines,
+        .slices = (lines + slice_lines - 1) / slice_lines,
+        .next = 0,
+    };
+    job.pending = job.slices;
+
+    if (job.slices == 1)
+    {
+        cb(filter, opaque, 0, lines);
+        return;
+    }
+
+    vlc_mutex_lock(&ft->lock);
+    vlc_list_append(&job.node, &ft->jobs);
+    vlc_cond_broadcast(&ft->wait);
+
+    while (job.next < job.slices)
+        FilterSliceRun(ft, &job);
+    while (job.pending > 0)
+        vlc_cond_wait(&ft->done, &ft->lock);
+    vlc_mutex_unlock(&ft->lock);
+}
+
 /* */
 #include <vlc_video_splitter.h>
 
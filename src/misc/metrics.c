@@ -0,0 +1,246 @@
+/*****************************************************************************
+ * metrics.c: metrics export
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_charset.h>
+#include <vlc_list.h>
+#include <vlc_memstream.h>
+#include <vlc_metrics.h>
+#include <vlc_vector.h>
+#include "../libvlc.h"
+
+struct vlc_metrics_source
+{
+    libvlc_priv_t *owner;
+    vlc_metrics_cb cb;
+    void *opaque;
+    char *labels; /**< formatted label set, or empty */
+    struct vlc_list node;
+};
+
+struct vlc_metrics_sample
+{
+    const struct vlc_metric *metric;
+    const char *labels;
+    double value;
+};
+
+struct vlc_metrics_writer
+{
+    const vlc_metrics_source_t *source;
+    struct VLC_VECTOR(struct vlc_metrics_sample) samples;
+    bool error;
+};
+
+void vlc_metrics_Init(libvlc_priv_t *priv)
+{
+    vlc_mutex_init(&priv->metrics_lock);
+    vlc_list_init(&priv->metrics);
+}
+
+static void vlc_metrics_PutLabelValue(struct vlc_memstream *ms,
+                                      const char *value)
+{
+    for (const char *p = value; *p != '\0'; p++)
+        switch (*p)
+        {
+            case '\\':
+                vlc_memstream_puts(ms, "\\\\");
+                break;
+            case '"':
+                vlc_memstream_puts(ms, "\\\"");
+                break;
+            case '\n':
+                vlc_memstream_puts(ms, "\\n");
+                break;
+            default:
+                vlc_memstream_putc(ms, *p);
+        }
+}
+
+#undef vlc_metrics_Register
+vlc_metrics_source_t *vlc_metrics_Register(vlc_object_t *obj,
+                                           vlc_metrics_cb cb,
+                                           void *opaque, ...)
+{
+    vlc_metrics_source_t *src = malloc(sizeof (*src));
+    if (unlikely(src == NULL))
+        return NULL;
+
+    struct vlc_memstream ms;
+    const char *name;
+    va_list ap;
+
+    vlc_memstream_open(&ms);
+    va_start(ap, opaque);
+    while ((name = va_arg(ap, const char *)) != NULL)
+    {
+        const char *value = va_arg(ap, const char *);
+
+        if (ms.length > 0)
+            vlc_memstream_putc(&ms, ',');
+        vlc_memstream_printf(&ms, "%s=\"", name);
+        vlc_metrics_PutLabelValue(&ms, value != NULL ? value : "");
+        vlc_memstream_putc(&ms, '"');
+    }
+    va_end(ap);
+
+    if (vlc_memstream_close(&ms))
+    {
+        free(src);
+        return NULL;
+    }
+
+    src->owner = libvlc_priv(vlc_object_instance(obj));
+    src->cb = cb;
+    src->opaque = opaque;
+    src->labels = ms.ptr;
+
+    vlc_mutex_lock(&src->owner->metrics_lock);
+    vlc_list_append(&src->node, &src->owner->metrics);
+    vlc_mutex_unlock(&src->owner->metrics_lock);
+    return src;
+}
+
+void vlc_metrics_Unregister(vlc_metrics_source_t *src)
+{
+    if (src == NULL)
+        return;
+
+    vlc_mutex_lock(&src->owner->metrics_lock);
+    vlc_list_remove(&src->node);
+    vlc_mutex_unlock(&src->owner->metrics_lock);
+
+    free(src->labels);
+    free(src);
+}
+
+void vlc_metrics_Report(vlc_metrics_writer_t *writer,
+                        const struct vlc_metric *metric, double value)
+{
+    struct vlc_metrics_sample sample = {
+        .metric = metric,
+        .labels = writer->source->labels,
+        .value = value,
+    };
+
+    if (!vlc_vector_push(&writer->samples, sample))
+        writer->error = true;
+}
+
+static void vlc_metrics_PutValue(struct vlc_memstream *ms, double value)
+{
+    if (isnan(value))
+        vlc_memstream_puts(ms, "NaN");
+    else if (isinf(value))
+        vlc_memstream_puts(ms, value > 0 ? "+Inf" : "-Inf");
+    else if (value == trunc(value) && fabs(value) < 0x1p53)
+        vlc_memstream_printf(ms, "%"PRId64, (int64_t)value);
+    else
+    {   /* not the user locale */
+        char *str;
+
+        if (us_asprintf(&str, "%.9g", value) >= 0)
+        {
+            vlc_memstream_puts(ms, str);
+            free(str);
+        }
+        else
+            vlc_memstream_puts(ms, "NaN");
+    }
+}
+
+#undef vlc_metrics_Collect
+char *vlc_metrics_Collect(vlc_object_t *obj)
+{
+    libvlc_priv_t *priv = libvlc_priv(vlc_object_instance(obj));
+    vlc_metrics_writer_t writer = { .error = false };
+    vlc_metrics_source_t *src;
+    struct vlc_memstream ms;
+
+    vlc_vector_init(&writer.samples);
+    vlc_memstream_open(&ms);
+
+    vlc_mutex_lock(&priv->metrics_lock);
+    vlc_list_foreach(src, &priv->metrics, node)
+    {
+        writer.source = src;
+        src->cb(src->opaque, &writer);
+    }
+
+    /* All the samples of a metric must be grouped, after its description,
+     * even if several descriptions share its name. The samples are printed
+     * in the order of the first report of each metric, then of the reports. */
+    const size_t count = writer.samples.size;
+    bool *printed = calloc(count ? count : 1, sizeof (*printed));
+    if (unlikely(printed == NULL))
+        writer.error = true;
+
+    for (size_t i = 0; i < count && printed != NULL; i++)
+    {
+        const struct vlc_metric *metric = writer.samples.data[i].metric;
+
+        if (printed[i])
+            continue;
+
+        vlc_memstream_printf(&ms, "# HELP %s %s\n# TYPE %s %s\n",
+                             metric->name, metric->help, metric->name,
+                             metric->type == VLC_METRIC_COUNTER ? "counter"
+                                                                : "gauge");
+        for (size_t j = i; j < count; j++)
+        {
+            const struct vlc_metrics_sample *sample = &writer.samples.data[j];
+
+            if (sample->metric != metric &&
+                strcmp(sample->metric->name, metric->name))
+                continue;
+
+            vlc_memstream_puts(&ms, metric->name);
+            if (sample->labels[0] != '\0')
+                vlc_memstream_printf(&ms, "{%s}", sample->labels);
+            vlc_memstream_putc(&ms, ' ');
+            vlc_metrics_PutValue(&ms, sample->value);
+            vlc_memstream_putc(&ms, '\n');
+            printed[j] = true;
+        }
+    }
+    vlc_mutex_unlock(&priv->metrics_lock);
+
+    free(printed);
+    vlc_vector_destroy(&writer.samples);
+
+    if (vlc_memstream_close(&ms))
+        return NULL;
+    if (writer.error)
+    {
+        free(ms.ptr);
+        return NULL;
+    }
+    return ms.ptr;
+}
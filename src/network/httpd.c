@@ -54,6 +54,11 @@
 #ifdef HAVE_POLL_H
 # include <poll.h>
 #endif
+#if defined(HAVE_SYS_EPOLL_H) && defined(HAVE_EVENTFD)
+# include <sys/epoll.h>
+# include <sys/eventfd.h>
+# define HTTPD_EPOLL 1
+#endif
 
 #if defined(_WIN32)
 #   include <winsock2.h>
@@ -68,8 +73,12 @@
 #define HTTPD_CL_BUFSIZE 10000
 #endif
 
-static void httpd_ClientDestroy(httpd_client_t *cl);
-static void httpd_AppendData(httpd_stream_t *stream, uint8_t *p_data, int i_data);
+/* Maximum number of stream chunks sent at once */
+#define HTTPD_STREAM_IOV 64
+
+typedef struct httpd_chunk_t httpd_chunk_t;
+
+static void httpd_ClientDestroy(httpd_host_t *host, httpd_client_t *cl);
 
 /* each host run in his own thread */
 struct httpd_host_t
@@ -99,6 +108,18 @@ struct httpd_host_t
 
     /* TLS data */
     vlc_tls_server_t *p_tls;
+
+#ifdef HTTPD_EPOLL
+    /* epoll event loop, used instead of poll() if epfd is not -1 */
+    int epfd;
+    int wakefd;
+    atomic_bool wake_armed;
+    httpd_client_t **fd_clients; /* clients by socket descriptor */
+    size_t fd_clients_size;
+    struct vlc_list active; /* clients to run in the next iteration */
+    struct vlc_list waiting; /* stream clients waiting for data */
+    vlc_tick_t sweep_date;
+#endif
 };
 
 
@@ -129,6 +150,7 @@ enum
     HTTPD_CLIENT_SEND_DONE,
 
     HTTPD_CLIENT_WAITING,
+    HTTPD_CLIENT_STREAMING,
 
     HTTPD_CLIENT_DEAD,
 
@@ -161,9 +183,20 @@ struct httpd_client_t
      */
     int64_t i_keyframe_wait_to_pass;
 
+    /* In stream mode, the stream data is sent straight from the shared
+     * chunks, starting at the given offset of the current chunk. */
+    httpd_stream_t *stream;
+    httpd_chunk_t  *chunk;
+    size_t          i_chunk_offset;
+
     /* */
     httpd_message_t query;  /* client -> httpd */
     httpd_message_t answer; /* httpd -> client */
+
+#ifdef HTTPD_EPOLL
+    struct vlc_list run_node; /* in the host active or waiting list */
+    bool b_queued;
+#endif
 };
 
 
@@ -587,6 +620,38 @@ void httpd_RedirectDelete(httpd_redirect_t *rdir)
 /*****************************************************************************
  * High Level Funtions: httpd_stream_t
  *****************************************************************************/
+/*
+ * Stream data is shared by all the clients of a stream: each block sent is
+ * copied once into a chunk, which clients send from directly. A chunk is
+ * referenced by its predecessor (or by the stream if it is the oldest one) and
+ * by the clients currently sending it. Holding a chunk thus keeps all the
+ * following data, which the client has yet to send, alive.
+ */
+struct httpd_chunk_t
+{
+    atomic_uint    refs;
+    httpd_chunk_t *next; /* written with the stream lock held */
+    int64_t        pos;  /* absolute position of the first byte */
+    size_t         size;
+    uint8_t        data[];
+};
+
+static httpd_chunk_t *httpd_ChunkHold(httpd_chunk_t *chunk)
+{
+    atomic_fetch_add(&chunk->refs, 1);
+    return chunk;
+}
+
+static void httpd_ChunkRelease(httpd_chunk_t *chunk)
+{
+    while (chunk != NULL && atomic_fetch_sub(&chunk->refs, 1) == 1) {
+        httpd_chunk_t *next = chunk->next;
+
+        free(chunk);
+        chunk = next;
+    }
+}
+
 struct httpd_stream_t
 {
     vlc_mutex_t lock;
@@ -606,17 +671,53 @@ struct httpd_stream_t
     bool        b_has_keyframes;
     int64_t     i_last_keyframe_seen_pos;
 
-    /* circular buffer */
-    int         i_buffer_size;      /* buffer size, can't be reallocated smaller */
-    uint8_t     *p_buffer;          /* buffer */
-    int64_t     i_buffer_pos;       /* absolute position from beginning */
-    int64_t     i_buffer_last_pos;  /* a new connection will start with that */
+    /* buffered chunks */
+    size_t         i_buffer_size;   /* maximum size of the buffered data */
+    size_t         i_buffer;        /* size of the buffered data */
+    httpd_chunk_t *p_first;         /* oldest chunk, owned by the stream */
+    httpd_chunk_t *p_last;          /* a new connection will start with that */
+    httpd_chunk_t *p_keyframe;      /* last keyframe chunk, if still buffered */
+    int64_t        i_buffer_pos;    /* absolute position from beginning */
 
     /* custom headers */
     size_t        i_http_headers;
     httpd_header * p_http_headers;
 };
 
+/* Moves a stream client to the given chunk */
+static void httpd_StreamClientSet(httpd_client_t *cl, httpd_chunk_t *chunk)
+{
+    httpd_chunk_t *old = cl->chunk;
+
+    /* hold first: the new chunk may only be referenced by the old one */
+    cl->chunk = (chunk != NULL) ? httpd_ChunkHold(chunk) : NULL;
+    cl->i_chunk_offset = 0;
+    httpd_ChunkRelease(old);
+}
+
+/* Positions a stream client before sending, with the stream lock held.
+ * Returns true if there is data to send. */
+static bool httpd_StreamClientSeek(httpd_stream_t *stream, httpd_client_t *cl)
+{
+    if (cl->i_keyframe_wait_to_pass >= 0) {
+        if (stream->i_last_keyframe_seen_pos <= cl->i_keyframe_wait_to_pass)
+            /* still waiting for the next keyframe */
+            return false;
+
+        /* seek to the new keyframe, unless it is already gone */
+        httpd_StreamClientSet(cl, stream->p_keyframe != NULL
+                                  ? stream->p_keyframe : stream->p_last);
+        cl->i_keyframe_wait_to_pass = -1;
+    } else if (cl->chunk == NULL)
+        httpd_StreamClientSet(cl, stream->p_first);
+    else if (cl->chunk->pos < stream->p_first->pos)
+        /* this client isn't fast enough */
+        httpd_StreamClientSet(cl, stream->p_last);
+
+    return cl->chunk != NULL
+        && (cl->i_chunk_offset < cl->chunk->size || cl->chunk->next != NULL);
+}
+
 static int httpd_StreamCallBack(httpd_callback_sys_t *p_sys,
                                  httpd_client_t *cl, httpd_message_t *answer,
                                  const httpd_message_t *query)
@@ -626,120 +727,85 @@ static int httpd_StreamCallBack(httpd_callback_sys_t *p_sys,
     if (!answer || !query || !cl)
         return VLC_SUCCESS;
 
-    if (answer->i_body_offset > 0) {
-        int     i_pos;
+    answer->i_proto  = HTTPD_PROTO_HTTP;
+    answer->i_version= 0;
+    answer->i_type   = HTTPD_MSG_ANSWER;
 
-        if (answer->i_body_offset >= stream->i_buffer_pos)
-            return VLC_EGENERIC;    /* wait, no data available */
+    answer->i_status = 200;
 
-        if (cl->i_keyframe_wait_to_pass >= 0) {
-            if (stream->i_last_keyframe_seen_pos <= cl->i_keyframe_wait_to_pass)
-                /* still waiting for the next keyframe */
-                return VLC_EGENERIC;
+    bool b_has_content_type = false;
+    bool b_has_cache_control = false;
 
-            /* seek to the new keyframe */
-            answer->i_body_offset = stream->i_last_keyframe_seen_pos;
-            cl->i_keyframe_wait_to_pass = -1;
+    vlc_mutex_lock(&stream->lock);
+    for (size_t i = 0; i < stream->i_http_headers; i++)
+        if (strncasecmp(stream->p_http_headers[i].name, "Content-Length", 14)) {
+            httpd_MsgAdd(answer, stream->p_http_headers[i].name, "%s",
+                          stream->p_http_headers[i].value);
+
+            if (!strncasecmp(stream->p_http_headers[i].name, "Content-Type", 12))
+                b_has_content_type = true;
+            else if (!strncasecmp(stream->p_http_headers[i].name, "Cache-Control", 13))
+                b_has_cache_control = true;
         }
+    vlc_mutex_unlock(&stream->lock);
 
-        if (answer->i_body_offset + stream->i_buffer_size < stream->i_buffer_pos)
-            answer->i_body_offset = stream->i_buffer_last_pos; /* this client isn't fast enough */
-
-        i_pos   = answer->i_body_offset % stream->i_buffer_size;
-        int64_t i_write = stream->i_buffer_pos - answer->i_body_offset;
-
-        if (i_write > HTTPD_CL_BUFSIZE)
-            i_write = HTTPD_CL_BUFSIZE;
-        else if (i_write <= 0)
-            return VLC_EGENERIC;    /* wait, no data available */
-
-        /* Don't go past the end of the circular buffer */
-        i_write = __MIN(i_write, stream->i_buffer_size - i_pos);
-
-        /* using HTTPD_MSG_ANSWER -> data available */
-        answer->i_proto  = HTTPD_PROTO_HTTP;
-        answer->i_version= 0;
-        answer->i_type   = HTTPD_MSG_ANSWER;
-
-        answer->i_body = i_write;
-        answer->p_body = xmalloc(i_write);
-        memcpy(answer->p_body, &stream->p_buffer[i_pos], i_write);
-
-        answer->i_body_offset += i_write;
-
-        return VLC_SUCCESS;
-    } else {
-        answer->i_proto  = HTTPD_PROTO_HTTP;
-        answer->i_version= 0;
-        answer->i_type   = HTTPD_MSG_ANSWER;
-
-        answer->i_status = 200;
-
-        bool b_has_content_type = false;
-        bool b_has_cache_control = false;
-
+    if (query->i_type != HTTPD_MSG_HEAD) {
+        cl->b_stream_mode = true;
         vlc_mutex_lock(&stream->lock);
-        for (size_t i = 0; i < stream->i_http_headers; i++)
-            if (strncasecmp(stream->p_http_headers[i].name, "Content-Length", 14)) {
-                httpd_MsgAdd(answer, stream->p_http_headers[i].name, "%s",
-                              stream->p_http_headers[i].value);
-
-                if (!strncasecmp(stream->p_http_headers[i].name, "Content-Type", 12))
-                    b_has_content_type = true;
-                else if (!strncasecmp(stream->p_http_headers[i].name, "Cache-Control", 13))
-                    b_has_cache_control = true;
-            }
-        vlc_mutex_unlock(&stream->lock);
-
-        if (query->i_type != HTTPD_MSG_HEAD) {
-            cl->b_stream_mode = true;
-            vlc_mutex_lock(&stream->lock);
-            /* Send the header */
-            if (stream->i_header > 0) {
-                answer->i_body = stream->i_header;
-                answer->p_body = xmalloc(stream->i_header);
-                memcpy(answer->p_body, stream->p_header, stream->i_header);
-            }
-            answer->i_body_offset = stream->i_buffer_last_pos;
-            if (stream->b_has_keyframes)
-                cl->i_keyframe_wait_to_pass = stream->i_last_keyframe_seen_pos;
-            else
-                cl->i_keyframe_wait_to_pass = -1;
-            vlc_mutex_unlock(&stream->lock);
-        } else {
-            httpd_MsgAdd(answer, "Content-Length", "0");
-            answer->i_body_offset = 0;
+        /* Send the header */
+        if (stream->i_header > 0) {
+            answer->i_body = stream->i_header;
+            answer->p_body = xmalloc(stream->i_header);
+            memcpy(answer->p_body, stream->p_header, stream->i_header);
         }
+        answer->i_body_offset = stream->i_buffer_pos;
+        vlc_mutex_unlock(&stream->lock);
+    } else {
+        httpd_MsgAdd(answer, "Content-Length", "0");
+        answer->i_body_offset = 0;
+    }
 
-        /* FIXME: move to http access_output */
-        if (!strcmp(stream->psz_mime, "video/x-ms-asf-stream")) {
-            bool b_xplaystream = false;
+    /* FIXME: move to http access_output */
+    if (!strcmp(stream->psz_mime, "video/x-ms-asf-stream")) {
+        bool b_xplaystream = false;
 
-            httpd_MsgAdd(answer, "Content-type", "application/octet-stream");
-            httpd_MsgAdd(answer, "Server", "Cougar 4.1.0.3921");
-            httpd_MsgAdd(answer, "Pragma", "no-cache");
-            httpd_MsgAdd(answer, "Pragma", "client-id=%lu",
-                          vlc_mrand48()&0x7fff);
-            httpd_MsgAdd(answer, "Pragma", "features=\"broadcast\"");
+        httpd_MsgAdd(answer, "Content-type", "application/octet-stream");
+        httpd_MsgAdd(answer, "Server", "Cougar 4.1.0.3921");
+        httpd_MsgAdd(answer, "Pragma", "no-cache");
+        httpd_MsgAdd(answer, "Pragma", "client-id=%lu",
+                      vlc_mrand48()&0x7fff);
+        httpd_MsgAdd(answer, "Pragma", "features=\"broadcast\"");
 
-            /* Check if there is a xPlayStrm=1 */
-            for (size_t i = 0; i < query->i_headers; i++)
-                if (!strcasecmp(query->p_headers[i].name,  "Pragma") &&
-                    strstr(query->p_headers[i].value, "xPlayStrm=1"))
-                    b_xplaystream = true;
+        /* Check if there is a xPlayStrm=1 */
+        for (size_t i = 0; i < query->i_headers; i++)
+            if (!strcasecmp(query->p_headers[i].name,  "Pragma") &&
+                strstr(query->p_headers[i].value, "xPlayStrm=1"))
+                b_xplaystream = true;
 
-            if (!b_xplaystream)
-                answer->i_body_offset = 0;
-        } else if (!b_has_content_type)
-            httpd_MsgAdd(answer, "Content-type", "%s", stream->psz_mime);
+        if (!b_xplaystream)
+            answer->i_body_offset = 0;
+    } else if (!b_has_content_type)
+        httpd_MsgAdd(answer, "Content-type", "%s", stream->psz_mime);
 
-        if (!b_has_cache_control)
-            httpd_MsgAdd(answer, "Cache-Control", "no-cache");
+    if (!b_has_cache_control)
+        httpd_MsgAdd(answer, "Cache-Control", "no-cache");
 
-        httpd_MsgAdd(answer, "Connection", "close");
+    httpd_MsgAdd(answer, "Connection", "close");
 
-        return VLC_SUCCESS;
+    if (answer->i_body_offset > 0) {
+        /* The stream data is sent once the answer is, see
+         * httpd_ClientSendStream() */
+        cl->stream = stream;
+        vlc_mutex_lock(&stream->lock);
+        if (stream->b_has_keyframes)
+            cl->i_keyframe_wait_to_pass = stream->i_last_keyframe_seen_pos;
+        else {
+            cl->i_keyframe_wait_to_pass = -1;
+            httpd_StreamClientSet(cl, stream->p_last);
+        }
+        vlc_mutex_unlock(&stream->lock);
     }
+    return VLC_SUCCESS;
 }
 
 httpd_stream_t *httpd_StreamNew(httpd_host_t *host,
@@ -751,7 +817,6 @@ httpd_stream_t *httpd_StreamNew(httpd_host_t *host,
         return NULL;
 
     stream->psz_mime = NULL;
-    stream->p_buffer = NULL;
 
     stream->url = httpd_UrlNew(host, psz_url, psz_user, psz_password);
     if (!stream->url)
@@ -767,16 +832,15 @@ httpd_stream_t *httpd_StreamNew(httpd_host_t *host,
 
     stream->i_header = 0;
     stream->p_header = NULL;
-    stream->i_buffer_size = 5000000;    /* 5 Mo per stream */
-
-    stream->p_buffer = malloc(stream->i_buffer_size);
-    if (stream->p_buffer == NULL)
-        goto error;
+    stream->i_buffer_size = var_InheritInteger(host, "http-stream-buffer");
+    stream->i_buffer = 0;
+    stream->p_first = NULL;
+    stream->p_last = NULL;
+    stream->p_keyframe = NULL;
 
     /* We set to 1 to make life simpler
      * (this way i_body_offset can never be 0) */
     stream->i_buffer_pos = 1;
-    stream->i_buffer_last_pos = 1;
     stream->b_has_keyframes = false;
     stream->i_last_keyframe_seen_pos = 0;
     stream->i_http_headers = 0;
@@ -818,42 +882,70 @@ int httpd_StreamHeader(httpd_stream_t *stream, uint8_t *p_data, int i_data)
     return VLC_SUCCESS;
 }
 
-static void httpd_AppendData(httpd_stream_t *stream, uint8_t *p_data, int i_data)
+/* Drops the oldest chunks beyond the buffer size, but always keeps the last
+ * one. Clients still sending them keep them alive until they are done. */
+static void httpd_StreamTrim(httpd_stream_t *stream)
 {
-    int i_pos = stream->i_buffer_pos % stream->i_buffer_size;
-    int i_count = i_data;
-    while (i_count > 0) {
-        int i_copy = __MIN(i_count, stream->i_buffer_size - i_pos);
-
-        /* Ok, we can't go past the end of our buffer */
-        memcpy(&stream->p_buffer[i_pos], p_data, i_copy);
-
-        i_pos = (i_pos + i_copy) % stream->i_buffer_size;
-        i_count -= i_copy;
-        p_data  += i_copy;
+    while (stream->i_buffer > stream->i_buffer_size
+        && stream->p_first != stream->p_last) {
+        httpd_chunk_t *first = stream->p_first;
+
+        if (stream->p_keyframe == first)
+            stream->p_keyframe = NULL;
+        stream->i_buffer -= first->size;
+        stream->p_first = httpd_ChunkHold(first->next);
+        httpd_ChunkRelease(first);
     }
+}
 
-    stream->i_buffer_pos += i_data;
+/* Wakes the host thread up if stream clients are waiting for data */
+static void httpd_HostWake(httpd_host_t *host)
+{
+#ifdef HTTPD_EPOLL
+    if (host->epfd != -1
+     && atomic_exchange(&host->wake_armed, false))
+        eventfd_write(host->wakefd, 1);
+#else
+    (void) host;
+#endif
 }
 
 int httpd_StreamSend(httpd_stream_t *stream, const block_t *p_block)
 {
-    if (!p_block || !p_block->p_buffer)
+    if (!p_block || !p_block->p_buffer || p_block->i_buffer == 0)
         return VLC_SUCCESS;
 
+    httpd_chunk_t *chunk = malloc(sizeof (*chunk) + p_block->i_buffer);
+    if (unlikely(chunk == NULL))
+        return VLC_ENOMEM;
+
+    atomic_init(&chunk->refs, 1);
+    chunk->next = NULL;
+    chunk->size = p_block->i_buffer;
+    memcpy(chunk->data, p_block->p_buffer, p_block->i_buffer);
+
     vlc_mutex_lock(&stream->lock);
+    chunk->pos = stream->i_buffer_pos;
 
-    /* save this pointer (to be used by new connection) */
-    stream->i_buffer_last_pos = stream->i_buffer_pos;
+    /* the reference belongs to the previous chunk, or to the stream */
+    if (stream->p_last != NULL)
+        stream->p_last->next = chunk;
+    else
+        stream->p_first = chunk;
+    stream->p_last = chunk;
 
     if (p_block->i_flags & BLOCK_FLAG_TYPE_I) {
         stream->b_has_keyframes = true;
-        stream->i_last_keyframe_seen_pos = stream->i_buffer_pos;
+        stream->i_last_keyframe_seen_pos = chunk->pos;
+        stream->p_keyframe = chunk;
     }
 
-    httpd_AppendData(stream, p_block->p_buffer, p_block->i_buffer);
+    stream->i_buffer_pos += chunk->size;
+    stream->i_buffer += chunk->size;
+    httpd_StreamTrim(stream);
 
     vlc_mutex_unlock(&stream->lock);
+    httpd_HostWake(stream->url->host);
     return VLC_SUCCESS;
 }
 
@@ -867,7 +959,7 @@ void httpd_StreamDelete(httpd_stream_t *stream)
     free(stream->p_http_headers);
     free(stream->psz_mime);
     free(stream->p_header);
-    free(stream->p_buffer);
+    httpd_ChunkRelease(stream->p_first);
     free(stream);
 }
 
@@ -919,6 +1011,54 @@ static struct httpd
     struct vlc_list hosts;
 } httpd = { VLC_STATIC_MUTEX, VLC_LIST_INITIALIZER(&httpd.hosts) };
 
+#ifdef HTTPD_EPOLL
+static void httpd_HostEpollInit(httpd_host_t *host)
+{
+    struct epoll_event ev = { .events = EPOLLIN };
+
+    atomic_init(&host->wake_armed, false);
+    host->fd_clients_size = 0;
+    vlc_list_init(&host->active);
+    vlc_list_init(&host->waiting);
+    host->sweep_date = VLC_TICK_0;
+
+    host->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (host->epfd == -1)
+        goto error;
+    host->wakefd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (host->wakefd == -1)
+        goto error;
+
+    ev.data.fd = host->wakefd;
+    if (epoll_ctl(host->epfd, EPOLL_CTL_ADD, host->wakefd, &ev))
+        goto error;
+    for (unsigned i = 0; i < host->nfd; i++) {
+        ev.data.fd = host->fds[i];
+        if (epoll_ctl(host->epfd, EPOLL_CTL_ADD, host->fds[i], &ev))
+            goto error;
+    }
+    return;
+
+error:
+    msg_Warn(host, "cannot use epoll, falling back to poll: %s",
+             vlc_strerror_c(errno));
+    if (host->wakefd != -1)
+        vlc_close(host->wakefd);
+    if (host->epfd != -1)
+        vlc_close(host->epfd);
+    host->wakefd = host->epfd = -1;
+}
+
+static void httpd_HostEpollClean(httpd_host_t *host)
+{
+    if (host->epfd != -1) {
+        vlc_close(host->wakefd);
+        vlc_close(host->epfd);
+    }
+    free(host->fd_clients);
+}
+#endif
+
 static httpd_host_t *httpd_HostCreate(vlc_object_t *p_this,
                                        const char *hostvar,
                                        const char *portvar,
@@ -953,6 +1093,11 @@ static httpd_host_t *httpd_HostCreate(vlc_object_t *p_this,
 
     vlc_mutex_init(&host->lock);
     atomic_init(&host->ref, 1);
+#ifdef HTTPD_EPOLL
+    host->epfd = -1;
+    host->wakefd = -1;
+    host->fd_clients = NULL;
+#endif
 
     char *hostname = var_InheritString(p_this, hostvar);
 
@@ -970,6 +1115,9 @@ static httpd_host_t *httpd_HostCreate(vlc_object_t *p_this,
     host->client_count = 0;
     vlc_list_init(&host->clients);
     host->p_tls    = p_tls;
+#ifdef HTTPD_EPOLL
+    httpd_HostEpollInit(host);
+#endif
 
     /* create the thread */
     if (vlc_clone(&host->thread, httpd_HostThread, host,
@@ -988,6 +1136,9 @@ error:
     vlc_mutex_unlock(&httpd.mutex);
 
     if (host) {
+#ifdef HTTPD_EPOLL
+        httpd_HostEpollClean(host);
+#endif
         net_ListenClose(host->fds);
         vlc_object_delete(host);
     }
@@ -1018,11 +1169,14 @@ void httpd_HostDelete(httpd_host_t *host)
 
     vlc_list_foreach(client, &host->clients, node) {
         msg_Warn(host, "client still connected");
-        httpd_ClientDestroy(client);
+        httpd_ClientDestroy(host, client);
     }
 
     assert(vlc_list_is_empty(&host->urls));
     vlc_tls_ServerDelete(host->p_tls);
+#ifdef HTTPD_EPOLL
+    httpd_HostEpollClean(host);
+#endif
     net_ListenClose(host->fds);
     vlc_object_delete(host);
     vlc_mutex_unlock(&httpd.mutex);
@@ -1119,8 +1273,7 @@ void httpd_UrlDelete(httpd_url_t *url)
 
         /* TODO complete it */
         msg_Warn(host, "force closing connections");
-        host->client_count--;
-        httpd_ClientDestroy(client);
+        httpd_ClientDestroy(host, client);
     }
     free(url);
     vlc_mutex_unlock(&host->lock);
@@ -1205,6 +1358,9 @@ static void httpd_ClientInit(httpd_client_t *cl, vlc_tick_t now)
     cl->p_buffer = xmalloc(cl->i_buffer_size);
     cl->i_keyframe_wait_to_pass = -1;
     cl->b_stream_mode = false;
+    cl->stream = NULL;
+    cl->chunk = NULL;
+    cl->i_chunk_offset = 0;
 
     httpd_MsgInit(&cl->query);
     httpd_MsgInit(&cl->answer);
@@ -1220,9 +1376,23 @@ char* httpd_ServerIP(const httpd_client_t *cl, char *ip, int *port)
     return net_GetSockAddress(vlc_tls_GetFD(cl->sock), ip, port) ? NULL : ip;
 }
 
-static void httpd_ClientDestroy(httpd_client_t *cl)
+static void httpd_ClientDestroy(httpd_host_t *host, httpd_client_t *cl)
 {
+#ifdef HTTPD_EPOLL
+    if (host->epfd != -1) {
+        int fd = vlc_tls_GetFD(cl->sock);
+
+        if ((size_t)fd < host->fd_clients_size && host->fd_clients[fd] == cl) {
+            epoll_ctl(host->epfd, EPOLL_CTL_DEL, fd, NULL);
+            host->fd_clients[fd] = NULL;
+        }
+        if (cl->b_queued)
+            vlc_list_remove(&cl->run_node);
+    }
+#endif
+    host->client_count--;
     vlc_list_remove(&cl->node);
+    httpd_ChunkRelease(cl->chunk);
     vlc_tls_Close(cl->sock);
     httpd_MsgClean(&cl->answer);
     httpd_MsgClean(&cl->query);
@@ -1239,6 +1409,9 @@ static httpd_client_t *httpd_ClientNew(vlc_tls_t *sock, vlc_tick_t now)
 
     cl->sock    = sock;
     cl->url     = NULL;
+#ifdef HTTPD_EPOLL
+    cl->b_queued = false;
+#endif
 
     httpd_ClientInit(cl, now);
     return cl;
@@ -1631,7 +1804,8 @@ static int httpd_ClientSend(httpd_client_t *cl)
     cl->i_buffer += i_len;
 
     if (cl->i_buffer >= cl->i_buffer_size) {
-        if (cl->answer.i_body == 0  && cl->answer.i_body_offset > 0) {
+        if (cl->answer.i_body == 0  && cl->answer.i_body_offset > 0
+         && cl->stream == NULL) {
             /* catch more body data */
             int     i_msg = cl->query.i_type;
             int64_t i_offset = cl->answer.i_body_offset;
@@ -1658,6 +1832,70 @@ static int httpd_ClientSend(httpd_client_t *cl)
     return 0;
 }
 
+/* Sends stream data straight from the shared chunks */
+static int httpd_ClientSendStream(httpd_client_t *cl)
+{
+    httpd_stream_t *stream = cl->stream;
+    httpd_chunk_t *chunks[HTTPD_STREAM_IOV];
+    struct iovec iov[HTTPD_STREAM_IOV];
+    unsigned n = 0;
+
+    vlc_mutex_lock(&stream->lock);
+    if (httpd_StreamClientSeek(stream, cl)) {
+        size_t offset = cl->i_chunk_offset;
+
+        /* The chunks are kept alive by the current one, and their data does
+         * not change: they can be sent without the lock. */
+        for (httpd_chunk_t *c = cl->chunk; c != NULL && n < ARRAY_SIZE(iov);
+             c = c->next) {
+            if (offset < c->size) {
+                chunks[n] = c;
+                iov[n].iov_base = c->data + offset;
+                iov[n].iov_len = c->size - offset;
+                n++;
+            }
+            offset = 0;
+        }
+    }
+    vlc_mutex_unlock(&stream->lock);
+
+    if (n == 0) {
+        cl->i_state = HTTPD_CLIENT_WAITING; /* no data available */
+        return -1;
+    }
+
+    ssize_t i_len = cl->sock->ops->writev(cl->sock, iov, n);
+
+    if (i_len == 0) {
+        cl->i_state = HTTPD_CLIENT_DEAD; /* connection closed */
+        return 0;
+    }
+
+    if (i_len < 0) {
+#if defined(_WIN32)
+        if (WSAGetLastError() == WSAEWOULDBLOCK)
+#else
+        if (errno == EAGAIN)
+#endif
+            return -1;
+
+        /* Connection failed, or hung up (EPIPE) */
+        cl->i_state = HTTPD_CLIENT_DEAD;
+        return 0;
+    }
+
+    /* Move on to the chunk where the data sent ends */
+    unsigned i = 0;
+    while (i < n - 1 && (size_t)i_len >= iov[i].iov_len)
+        i_len -= iov[i++].iov_len;
+
+    size_t offset = chunks[i]->size - iov[i].iov_len + i_len;
+    if (chunks[i] != cl->chunk)
+        httpd_StreamClientSet(cl, chunks[i]);
+    cl->i_chunk_offset = offset;
+    return 0;
+}
+
 static void httpd_ClientTlsHandshake(httpd_host_t *host, httpd_client_t *cl)
 {
     switch (vlc_tls_SessionHandshake(host->p_tls, cl->sock))
@@ -1709,276 +1947,346 @@ auth_failed:
     return false;
 }
 
-static void httpdLoop(httpd_host_t *host)
+/* Runs the state machine of a client. Returns -1 if the client was closed and
+ * destroyed, 0 if it made progress, and 1 if it is waiting for an event. */
+static int httpd_ClientRun(httpd_host_t *host, httpd_client_t *cl,
+                           vlc_tick_t now)
 {
-    struct pollfd ufd[host->nfd + host->client_count];
-    unsigned nfd;
-    for (nfd = 0; nfd < host->nfd; nfd++) {
-        ufd[nfd].fd = host->fds[nfd];
-        ufd[nfd].events = POLLIN;
-        ufd[nfd].revents = 0;
-    }
-
-    vlc_mutex_lock(&host->lock);
-    /* add all socket that should be read/write and close dead connection */
-    vlc_tick_t now = vlc_tick_now();
-    int delay = -1;
-    httpd_client_t *cl;
+    int val = -1;
 
-    int canc = vlc_savecancel();
-    vlc_list_foreach(cl, &host->clients, node) {
-        int val = -1;
-
-        switch (cl->i_state) {
-            case HTTPD_CLIENT_RECEIVING:
-                val = httpd_ClientRecv(cl);
-                break;
-            case HTTPD_CLIENT_SENDING:
-                val = httpd_ClientSend(cl);
-                break;
-            case HTTPD_CLIENT_TLS_HS_IN:
-            case HTTPD_CLIENT_TLS_HS_OUT:
-                httpd_ClientTlsHandshake(host, cl);
-                break;
-        }
+    switch (cl->i_state) {
+        case HTTPD_CLIENT_RECEIVING:
+            val = httpd_ClientRecv(cl);
+            break;
+        case HTTPD_CLIENT_SENDING:
+            val = httpd_ClientSend(cl);
+            break;
+        case HTTPD_CLIENT_STREAMING:
+            val = httpd_ClientSendStream(cl);
+            break;
+        case HTTPD_CLIENT_TLS_HS_IN:
+        case HTTPD_CLIENT_TLS_HS_OUT:
+            httpd_ClientTlsHandshake(host, cl);
+            break;
+    }
 
-        if (cl->i_state == HTTPD_CLIENT_DEAD
-         || (cl->i_activity_timeout > 0
-          && cl->i_activity_date + cl->i_activity_timeout < now)) {
-            host->client_count--;
-            httpd_ClientDestroy(cl);
-            continue;
-        }
+    if (cl->i_state == HTTPD_CLIENT_DEAD
+     || (cl->i_activity_timeout > 0
+      && cl->i_activity_date + cl->i_activity_timeout < now)) {
+        httpd_ClientDestroy(host, cl);
+        return -1;
+    }
 
-        if (val == 0) {
-            cl->i_activity_date = now;
-            delay = 0;
-        }
+    if (val == 0)
+        cl->i_activity_date = now;
+
+    switch (cl->i_state) {
+        case HTTPD_CLIENT_RECEIVE_DONE: {
+            httpd_message_t *answer = &cl->answer;
+            httpd_message_t *query  = &cl->query;
+
+            httpd_MsgInit(answer);
+
+            /* Handle what we received */
+            switch (query->i_type) {
+                case HTTPD_MSG_ANSWER:
+                    cl->url     = NULL;
+                    cl->i_state = HTTPD_CLIENT_DEAD;
+                    break;
+
+                case HTTPD_MSG_OPTIONS:
+                    answer->i_type   = HTTPD_MSG_ANSWER;
+                    answer->i_proto  = query->i_proto;
+                    answer->i_status = 200;
+                    answer->i_body = 0;
+                    answer->p_body = NULL;
+
+                    httpd_MsgAdd(answer, "Server", "VLC/%s", VERSION);
+                    httpd_MsgAdd(answer, "Content-Length", "0");
+
+                    switch(query->i_proto) {
+                    case HTTPD_PROTO_HTTP:
+                        answer->i_version = 1;
+                        httpd_MsgAdd(answer, "Allow", "GET,HEAD,POST,OPTIONS");
+                        break;
 
-        struct pollfd *pufd = ufd + nfd;
-        assert (pufd < ufd + ARRAY_SIZE (ufd));
+                    case HTTPD_PROTO_RTSP:
+                        answer->i_version = 0;
 
-        pufd->events = pufd->revents = 0;
+                        const char *p = httpd_MsgGet(query, "Cseq");
+                        if (p)
+                            httpd_MsgAdd(answer, "Cseq", "%s", p);
+                        p = httpd_MsgGet(query, "Timestamp");
+                        if (p)
+                            httpd_MsgAdd(answer, "Timestamp", "%s", p);
 
-        switch (cl->i_state) {
-            case HTTPD_CLIENT_RECEIVING:
-            case HTTPD_CLIENT_TLS_HS_IN:
-                pufd->events = POLLIN;
-                break;
+                        p = httpd_MsgGet(query, "Require");
+                        if (p) {
+                            answer->i_status = 551;
+                            httpd_MsgAdd(query, "Unsupported", "%s", p);
+                        }
 
-            case HTTPD_CLIENT_SENDING:
-            case HTTPD_CLIENT_TLS_HS_OUT:
-                pufd->events = POLLOUT;
-                break;
+                        httpd_MsgAdd(answer, "Public", "DESCRIBE,SETUP,"
+                                "TEARDOWN,PLAY,PAUSE,GET_PARAMETER");
+                        break;
+                    }
 
-            case HTTPD_CLIENT_RECEIVE_DONE: {
-                httpd_message_t *answer = &cl->answer;
-                httpd_message_t *query  = &cl->query;
+                    if (httpd_MsgGet(&cl->query, "Connection") != NULL)
+                        httpd_MsgAdd(answer, "Connection", "close");
 
-                httpd_MsgInit(answer);
+                    cl->i_buffer = -1;  /* Force the creation of the answer in
+                                         * httpd_ClientSend */
+                    cl->i_state = HTTPD_CLIENT_SENDING;
+                    break;
 
-                /* Handle what we received */
-                switch (query->i_type) {
-                    case HTTPD_MSG_ANSWER:
-                        cl->url     = NULL;
+                case HTTPD_MSG_NONE:
+                    if (query->i_proto == HTTPD_PROTO_NONE) {
+                        cl->url = NULL;
                         cl->i_state = HTTPD_CLIENT_DEAD;
-                        break;
-
-                    case HTTPD_MSG_OPTIONS:
+                    } else {
+                        /* unimplemented */
+                        answer->i_proto  = query->i_proto ;
                         answer->i_type   = HTTPD_MSG_ANSWER;
-                        answer->i_proto  = query->i_proto;
-                        answer->i_status = 200;
-                        answer->i_body = 0;
-                        answer->p_body = NULL;
+                        answer->i_version= 0;
+                        answer->i_status = 501;
 
-                        httpd_MsgAdd(answer, "Server", "VLC/%s", VERSION);
-                        httpd_MsgAdd(answer, "Content-Length", "0");
+                        char *p;
+                        answer->i_body = httpd_HtmlError (&p, 501, NULL);
+                        answer->p_body = (uint8_t *)p;
+                        httpd_MsgAdd(answer, "Content-Length", "%d", answer->i_body);
+                        httpd_MsgAdd(answer, "Connection", "close");
 
-                        switch(query->i_proto) {
-                        case HTTPD_PROTO_HTTP:
-                            answer->i_version = 1;
-                            httpd_MsgAdd(answer, "Allow", "GET,HEAD,POST,OPTIONS");
-                            break;
-
-                        case HTTPD_PROTO_RTSP:
-                            answer->i_version = 0;
+                        cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
+                        cl->i_state = HTTPD_CLIENT_SENDING;
+                    }
+                    break;
 
-                            const char *p = httpd_MsgGet(query, "Cseq");
-                            if (p)
-                                httpd_MsgAdd(answer, "Cseq", "%s", p);
-                            p = httpd_MsgGet(query, "Timestamp");
-                            if (p)
-                                httpd_MsgAdd(answer, "Timestamp", "%s", p);
+                default: {
+                    httpd_url_t *url;
+                    int i_msg = query->i_type;
+                    bool b_auth_failed = false;
 
-                            p = httpd_MsgGet(query, "Require");
-                            if (p) {
-                                answer->i_status = 551;
-                                httpd_MsgAdd(query, "Unsupported", "%s", p);
-                            }
+                    /* Search the url and trigger callbacks */
+                    vlc_list_foreach(url, &host->urls, node) {
+                        if (strcmp(url->psz_url, query->psz_url))
+                            continue;
+                        if (!url->catch[i_msg].cb)
+                            continue;
 
-                            httpd_MsgAdd(answer, "Public", "DESCRIBE,SETUP,"
-                                    "TEARDOWN,PLAY,PAUSE,GET_PARAMETER");
-                            break;
+                        if (answer) {
+                            b_auth_failed = !httpdAuthOk(url->psz_user,
+                               url->psz_password,
+                               httpd_MsgGet(query, "Authorization")); /* BASIC id */
+                            if (b_auth_failed)
+                               break;
                         }
 
-                        if (httpd_MsgGet(&cl->query, "Connection") != NULL)
-                            httpd_MsgAdd(answer, "Connection", "close");
+                        if (url->catch[i_msg].cb(url->catch[i_msg].p_sys, cl, answer, query))
+                            continue;
 
-                        cl->i_buffer = -1;  /* Force the creation of the answer in
-                                             * httpd_ClientSend */
-                        cl->i_state = HTTPD_CLIENT_SENDING;
-                        break;
+                        if (answer->i_proto == HTTPD_PROTO_NONE)
+                            cl->i_buffer = cl->i_buffer_size; /* Raw answer from a CGI */
+                        else
+                            cl->i_buffer = -1;
+
+                        /* only one url can answer */
+                        answer = NULL;
+                        if (!cl->url)
+                            cl->url = url;
+                    }
 
-                    case HTTPD_MSG_NONE:
-                        if (query->i_proto == HTTPD_PROTO_NONE) {
-                            cl->url = NULL;
-                            cl->i_state = HTTPD_CLIENT_DEAD;
-                        } else {
-                            /* unimplemented */
-                            answer->i_proto  = query->i_proto ;
-                            answer->i_type   = HTTPD_MSG_ANSWER;
-                            answer->i_version= 0;
-                            answer->i_status = 501;
-
-                            char *p;
-                            answer->i_body = httpd_HtmlError (&p, 501, NULL);
-                            answer->p_body = (uint8_t *)p;
-                            httpd_MsgAdd(answer, "Content-Length", "%d", answer->i_body);
+                    if (answer) {
+                        answer->i_proto  = query->i_proto;
+                        answer->i_type   = HTTPD_MSG_ANSWER;
+                        answer->i_version= 0;
+
+                       if (b_auth_failed) {
+                            httpd_MsgAdd(answer, "WWW-Authenticate",
+                                    "Basic realm=\"VLC stream\"");
+                            answer->i_status = 401;
+                        } else
+                            answer->i_status = 404; /* no url registered */
+
+                        char *p;
+                        answer->i_body = httpd_HtmlError (&p, answer->i_status,
+                                query->psz_url);
+                        answer->p_body = (uint8_t *)p;
+
+                        cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
+                        httpd_MsgAdd(answer, "Content-Length", "%d", answer->i_body);
+                        httpd_MsgAdd(answer, "Content-Type", "%s", "text/html");
+                        if (httpd_MsgGet(&cl->query, "Connection") != NULL)
                             httpd_MsgAdd(answer, "Connection", "close");
+                    }
 
-                            cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
-                            cl->i_state = HTTPD_CLIENT_SENDING;
-                        }
-                        break;
+                    cl->i_state = HTTPD_CLIENT_SENDING;
+                }
+            }
+            break;
+        }
 
-                    default: {
-                        httpd_url_t *url;
-                        int i_msg = query->i_type;
-                        bool b_auth_failed = false;
-
-                        /* Search the url and trigger callbacks */
-                        vlc_list_foreach(url, &host->urls, node) {
-                            if (strcmp(url->psz_url, query->psz_url))
-                                continue;
-                            if (!url->catch[i_msg].cb)
-                                continue;
-
-                            if (answer) {
-                                b_auth_failed = !httpdAuthOk(url->psz_user,
-                                   url->psz_password,
-                                   httpd_MsgGet(query, "Authorization")); /* BASIC id */
-                                if (b_auth_failed)
-                                   break;
-                            }
-
-                            if (url->catch[i_msg].cb(url->catch[i_msg].p_sys, cl, answer, query))
-                                continue;
-
-                            if (answer->i_proto == HTTPD_PROTO_NONE)
-                                cl->i_buffer = cl->i_buffer_size; /* Raw answer from a CGI */
-                            else
-                                cl->i_buffer = -1;
-
-                            /* only one url can answer */
-                            answer = NULL;
-                            if (!cl->url)
-                                cl->url = url;
-                        }
+        case HTTPD_CLIENT_SEND_DONE:
+            if (!cl->b_stream_mode || cl->answer.i_body_offset == 0) {
+                bool do_close = false;
 
-                        if (answer) {
-                            answer->i_proto  = query->i_proto;
-                            answer->i_type   = HTTPD_MSG_ANSWER;
-                            answer->i_version= 0;
-
-                           if (b_auth_failed) {
-                                httpd_MsgAdd(answer, "WWW-Authenticate",
-                                        "Basic realm=\"VLC stream\"");
-                                answer->i_status = 401;
-                            } else
-                                answer->i_status = 404; /* no url registered */
-
-                            char *p;
-                            answer->i_body = httpd_HtmlError (&p, answer->i_status,
-                                    query->psz_url);
-                            answer->p_body = (uint8_t *)p;
-
-                            cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
-                            httpd_MsgAdd(answer, "Content-Length", "%d", answer->i_body);
-                            httpd_MsgAdd(answer, "Content-Type", "%s", "text/html");
-                            if (httpd_MsgGet(&cl->query, "Connection") != NULL)
-                                httpd_MsgAdd(answer, "Connection", "close");
-                        }
+                cl->url = NULL;
 
-                        cl->i_state = HTTPD_CLIENT_SENDING;
-                    }
+                if (cl->query.i_proto != HTTPD_PROTO_HTTP
+                 || cl->query.i_version > 0)
+                {
+                    const char *psz_connection = httpd_MsgGet(&cl->answer,
+                                                             "Connection");
+                    if (psz_connection != NULL)
+                        do_close = !strcasecmp(psz_connection, "close");
                 }
-                break;
-            }
+                else
+                    do_close = true;
 
-            case HTTPD_CLIENT_SEND_DONE:
-                if (!cl->b_stream_mode || cl->answer.i_body_offset == 0) {
-                    bool do_close = false;
+                if (!do_close) {
+                    httpd_MsgClean(&cl->query);
+                    httpd_MsgInit(&cl->query);
 
-                    cl->url = NULL;
+                    cl->i_buffer = 0;
+                    cl->i_buffer_size = 1000;
+                    free(cl->p_buffer);
+                    // Allocate an extra byte for the null terminating byte
+                    cl->p_buffer = xmalloc(cl->i_buffer_size + 1);
+                    cl->i_state = HTTPD_CLIENT_RECEIVING;
+                } else
+                    cl->i_state = HTTPD_CLIENT_DEAD;
+                httpd_MsgClean(&cl->answer);
+            } else {
+                int64_t i_offset = cl->answer.i_body_offset;
+                httpd_MsgClean(&cl->answer);
 
-                    if (cl->query.i_proto != HTTPD_PROTO_HTTP
-                     || cl->query.i_version > 0)
-                    {
-                        const char *psz_connection = httpd_MsgGet(&cl->answer,
-                                                                 "Connection");
-                        if (psz_connection != NULL)
-                            do_close = !strcasecmp(psz_connection, "close");
-                    }
-                    else
-                        do_close = true;
-
-                    if (!do_close) {
-                        httpd_MsgClean(&cl->query);
-                        httpd_MsgInit(&cl->query);
-
-                        cl->i_buffer = 0;
-                        cl->i_buffer_size = 1000;
-                        free(cl->p_buffer);
-                        // Allocate an extra byte for the null terminating byte
-                        cl->p_buffer = xmalloc(cl->i_buffer_size + 1);
-                        cl->i_state = HTTPD_CLIENT_RECEIVING;
-                    } else
-                        cl->i_state = HTTPD_CLIENT_DEAD;
-                    httpd_MsgClean(&cl->answer);
-                } else {
-                    int64_t i_offset = cl->answer.i_body_offset;
-                    httpd_MsgClean(&cl->answer);
+                cl->answer.i_body_offset = i_offset;
+                free(cl->p_buffer);
+                cl->p_buffer = NULL;
+                cl->i_buffer = 0;
+                cl->i_buffer_size = 0;
 
-                    cl->answer.i_body_offset = i_offset;
-                    free(cl->p_buffer);
-                    cl->p_buffer = NULL;
-                    cl->i_buffer = 0;
-                    cl->i_buffer_size = 0;
+                cl->i_state = HTTPD_CLIENT_WAITING;
+            }
+            break;
 
-                    cl->i_state = HTTPD_CLIENT_WAITING;
-                }
+        case HTTPD_CLIENT_WAITING: {
+            if (cl->stream != NULL) {
+                vlc_mutex_lock(&cl->stream->lock);
+                if (httpd_StreamClientSeek(cl->stream, cl))
+                    cl->i_state = HTTPD_CLIENT_STREAMING;
+                vlc_mutex_unlock(&cl->stream->lock);
                 break;
+            }
 
-            case HTTPD_CLIENT_WAITING: {
-                int64_t i_offset = cl->answer.i_body_offset;
-                int i_msg = cl->query.i_type;
+            int64_t i_offset = cl->answer.i_body_offset;
+            int i_msg = cl->query.i_type;
 
-                httpd_MsgInit(&cl->answer);
-                cl->answer.i_body_offset = i_offset;
+            httpd_MsgInit(&cl->answer);
+            cl->answer.i_body_offset = i_offset;
 
-                cl->url->catch[i_msg].cb(cl->url->catch[i_msg].p_sys, cl,
-                        &cl->answer, &cl->query);
-                if (cl->answer.i_type != HTTPD_MSG_NONE) {
-                    /* we have new data, so re-enter send mode */
-                    cl->i_buffer      = 0;
-                    cl->p_buffer      = cl->answer.p_body;
-                    cl->i_buffer_size = cl->answer.i_body;
-                    cl->answer.p_body = NULL;
-                    cl->answer.i_body = 0;
-                    cl->i_state = HTTPD_CLIENT_SENDING;
-                }
+            cl->url->catch[i_msg].cb(cl->url->catch[i_msg].p_sys, cl,
+                    &cl->answer, &cl->query);
+            if (cl->answer.i_type != HTTPD_MSG_NONE) {
+                /* we have new data, so re-enter send mode */
+                cl->i_buffer      = 0;
+                cl->p_buffer      = cl->answer.p_body;
+                cl->i_buffer_size = cl->answer.i_body;
+                cl->answer.p_body = NULL;
+                cl->answer.i_body = 0;
+                cl->i_state = HTTPD_CLIENT_SENDING;
             }
         }
+    }
+    return val == 0 ? 0 : 1;
+}
+
+/* Accepts a connection on a listening socket */
+static httpd_client_t *httpd_HostAccept(httpd_host_t *host, int fd,
+                                        vlc_tick_t now)
+{
+    fd = vlc_accept (fd, NULL, NULL, true);
+    if (fd == -1)
+        return NULL;
+    setsockopt (fd, SOL_SOCKET, SO_REUSEADDR,
+            &(int){ 1 }, sizeof(int));
+
+    vlc_tls_t *sk = vlc_tls_SocketOpen(fd);
+    if (unlikely(sk == NULL))
+    {
+        vlc_close(fd);
+        return NULL;
+    }
+
+    if (host->p_tls != NULL)
+    {
+        const char *alpn[] = { "http/1.1", NULL };
+        vlc_tls_t *tls;
+
+        tls = vlc_tls_ServerSessionCreate(host->p_tls, sk, alpn);
+        if (tls == NULL)
+        {
+            vlc_tls_SessionDelete(sk);
+            return NULL;
+        }
+        sk = tls;
+    }
+
+    httpd_client_t *cl = httpd_ClientNew(sk, now);
+    if (unlikely(cl == NULL))
+    {
+        vlc_tls_Close(sk);
+        return NULL;
+    }
+
+    if (host->p_tls != NULL)
+        cl->i_state = HTTPD_CLIENT_TLS_HS_OUT;
+
+    host->client_count++;
+    vlc_list_append(&cl->node, &host->clients);
+    return cl;
+}
+
+static void httpdLoop(httpd_host_t *host)
+{
+    struct pollfd ufd[host->nfd + host->client_count];
+    unsigned nfd;
+    for (nfd = 0; nfd < host->nfd; nfd++) {
+        ufd[nfd].fd = host->fds[nfd];
+        ufd[nfd].events = POLLIN;
+        ufd[nfd].revents = 0;
+    }
+
+    vlc_mutex_lock(&host->lock);
+    /* add all socket that should be read/write and close dead connection */
+    vlc_tick_t now = vlc_tick_now();
+    int delay = -1;
+    httpd_client_t *cl;
+
+    int canc = vlc_savecancel();
+    vlc_list_foreach(cl, &host->clients, node) {
+        int val = httpd_ClientRun(host, cl, now);
+        if (val < 0)
+            continue;
+        if (val == 0)
+            delay = 0;
+
+        struct pollfd *pufd = ufd + nfd;
+        assert (pufd < ufd + ARRAY_SIZE (ufd));
+
+        pufd->events = pufd->revents = 0;
+
+        switch (cl->i_state) {
+            case HTTPD_CLIENT_RECEIVING:
+            case HTTPD_CLIENT_TLS_HS_IN:
+                pufd->events = POLLIN;
+                break;
+
+            case HTTPD_CLIENT_SENDING:
+            case HTTPD_CLIENT_STREAMING:
+            case HTTPD_CLIENT_TLS_HS_OUT:
+                pufd->events = POLLOUT;
+                break;
+        }
 
         pufd->fd = vlc_tls_GetPollFD(cl->sock, &pufd->events);
 
@@ -2000,66 +2308,183 @@ static void httpdLoop(httpd_host_t *host)
     canc = vlc_savecancel();
     vlc_mutex_lock(&host->lock);
 
-    /* Handle client sockets */
     now = vlc_tick_now();
-    nfd = host->nfd;
 
     /* Handle server sockets (accept new connections) */
     for (nfd = 0; nfd < host->nfd; nfd++) {
-        int fd = ufd[nfd].fd;
+        assert (ufd[nfd].fd == host->fds[nfd]);
 
-        assert (fd == host->fds[nfd]);
+        if (ufd[nfd].revents != 0)
+            httpd_HostAccept(host, ufd[nfd].fd, now);
+    }
 
-        if (ufd[nfd].revents == 0)
-            continue;
+    vlc_mutex_unlock(&host->lock);
+    vlc_restorecancel(canc);
+}
+
+#ifdef HTTPD_EPOLL
+#define HTTPD_EPOLL_EVENTS 256
+#define HTTPD_EPOLL_ACCEPTS 64
 
-        /* */
-        fd = vlc_accept (fd, NULL, NULL, true);
-        if (fd == -1)
+static void httpd_ClientQueue(httpd_client_t *cl, struct vlc_list *list)
+{
+    if (cl->b_queued)
+        vlc_list_remove(&cl->run_node);
+    vlc_list_append(&cl->run_node, list);
+    cl->b_queued = true;
+}
+
+static int httpd_ClientWatch(httpd_host_t *host, httpd_client_t *cl)
+{
+    int fd = vlc_tls_GetFD(cl->sock);
+
+    if ((size_t)fd >= host->fd_clients_size) {
+        size_t size = __MAX(2 * host->fd_clients_size, (size_t)fd + 1);
+        httpd_client_t **tab = realloc(host->fd_clients, size * sizeof (*tab));
+
+        if (unlikely(tab == NULL))
+            return -1;
+        memset(tab + host->fd_clients_size, 0,
+               (size - host->fd_clients_size) * sizeof (*tab));
+        host->fd_clients = tab;
+        host->fd_clients_size = size;
+    }
+
+    /* Edge-triggered: the client is only run again after an event once it
+     * got EAGAIN, so that idle clients cost nothing. */
+    struct epoll_event ev = {
+        .events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET,
+        .data.fd = fd,
+    };
+    if (epoll_ctl(host->epfd, EPOLL_CTL_ADD, fd, &ev))
+        return -1;
+    host->fd_clients[fd] = cl;
+    return 0;
+}
+
+/* Accepts pending connections on a listening socket */
+static void httpd_HostAcceptEpoll(httpd_host_t *host, int fd, vlc_tick_t now)
+{
+    for (unsigned i = 0; i < HTTPD_EPOLL_ACCEPTS; i++) {
+        httpd_client_t *cl = httpd_HostAccept(host, fd, now);
+        if (cl == NULL)
+            break;
+
+        if (httpd_ClientWatch(host, cl)) {
+            msg_Err(host, "cannot watch client: %s", vlc_strerror_c(errno));
+            httpd_ClientDestroy(host, cl);
             continue;
-        setsockopt (fd, SOL_SOCKET, SO_REUSEADDR,
-                &(int){ 1 }, sizeof(int));
+        }
+        httpd_ClientQueue(cl, &host->active);
+    }
+}
 
-        vlc_tls_t *sk = vlc_tls_SocketOpen(fd);
-        if (unlikely(sk == NULL))
-        {
-            vlc_close(fd);
+static void httpdLoopEpoll(httpd_host_t *host)
+{
+    struct epoll_event ev[HTTPD_EPOLL_EVENTS];
+    int timeout = 1000; /* for the inactivity timeouts */
+    httpd_client_t *cl;
+
+    vlc_mutex_lock(&host->lock);
+    if (!vlc_list_is_empty(&host->active))
+        timeout = 0;
+    vlc_mutex_unlock(&host->lock);
+
+    int n = epoll_wait(host->epfd, ev, ARRAY_SIZE(ev), timeout);
+    if (n < 0) {
+        if (errno != EINTR)
+            msg_Err(host, "polling error: %s", vlc_strerror_c(errno));
+        n = 0;
+    }
+
+    int canc = vlc_savecancel();
+    vlc_mutex_lock(&host->lock);
+
+    vlc_tick_t now = vlc_tick_now();
+
+    for (int i = 0; i < n; i++) {
+        int fd = ev[i].data.fd;
+
+        if (fd == host->wakefd) {
+            eventfd_t dummy;
+
+            eventfd_read(fd, &dummy);
+            vlc_list_foreach(cl, &host->waiting, run_node)
+                httpd_ClientQueue(cl, &host->active);
             continue;
         }
 
-        if (host->p_tls != NULL)
-        {
-            const char *alpn[] = { "http/1.1", NULL };
-            vlc_tls_t *tls;
-
-            tls = vlc_tls_ServerSessionCreate(host->p_tls, sk, alpn);
-            if (tls == NULL)
-            {
-                vlc_tls_SessionDelete(sk);
-                continue;
-            }
-            sk = tls;
+        /* The client may have been closed while the lock was released */
+        if ((size_t)fd < host->fd_clients_size
+         && (cl = host->fd_clients[fd]) != NULL) {
+            httpd_ClientQueue(cl, &host->active);
+            continue;
         }
 
-        cl = httpd_ClientNew(sk, now);
+        for (unsigned j = 0; j < host->nfd; j++)
+            if (fd == host->fds[j])
+                httpd_HostAcceptEpoll(host, fd, now);
+    }
+
+    /* Any data sent from now on must wake the waiting clients up */
+    atomic_store(&host->wake_armed, true);
+
+    /* Only run the clients queued so far */
+    struct vlc_list run;
+
+    if (!vlc_list_is_empty(&host->active)) {
+        vlc_list_replace(&host->active, &run);
+        vlc_list_init(&host->active);
+    } else
+        vlc_list_init(&run);
+
+    while ((cl = vlc_list_first_entry_or_null(&run, httpd_client_t,
+                                              run_node)) != NULL) {
+        const uint8_t state = cl->i_state;
 
-        if (host->p_tls != NULL)
-            cl->i_state = HTTPD_CLIENT_TLS_HS_OUT;
+        vlc_list_remove(&cl->run_node);
+        cl->b_queued = false;
 
-        host->client_count++;
-        vlc_list_append(&cl->node, &host->clients);
+        int val = httpd_ClientRun(host, cl, now);
+        if (val < 0)
+            continue;
+
+        if (cl->i_state == HTTPD_CLIENT_WAITING)
+            httpd_ClientQueue(cl, state == HTTPD_CLIENT_WAITING
+                                  ? &host->waiting : &host->active);
+        else if (val == 0 || cl->i_state != state)
+            httpd_ClientQueue(cl, &host->active);
+        /* otherwise, wait for a socket event */
+    }
+
+    if (now >= host->sweep_date) {
+        vlc_list_foreach(cl, &host->clients, node)
+            if (cl->i_activity_timeout > 0
+             && cl->i_activity_date + cl->i_activity_timeout < now)
+                httpd_ClientDestroy(host, cl);
+        host->sweep_date = now + VLC_TICK_FROM_SEC(1);
     }
 
     vlc_mutex_unlock(&host->lock);
     vlc_restorecancel(canc);
 }
+#endif
 
 static void* httpd_HostThread(void *data)
 {
     httpd_host_t *host = data;
 
     while (atomic_load_explicit(&host->ref, memory_order_relaxed) > 0)
+    {
+#ifdef HTTPD_EPOLL
+        if (host->epfd != -1)
+        {
+            httpdLoopEpoll(host);
+            continue;
+        }
+#endif
         httpdLoop(host);
+    }
     return NULL;
 }
 
@@ -46,6 +46,7 @@
 #include <vlc_block.h>
 #include <vlc_codec.h>
 #include <vlc_modules.h>
+#include <vlc_metrics.h>
 
 #include "input/input_interface.h"
 
@@ -282,6 +283,47 @@ int sout_InputSendBuffer( sout_packetizer_input_t *p_input,
     return i_ret;
 }
 
+typedef struct
+{
+    sout_access_out_t access;
+
+    vlc_metrics_source_t *metrics;
+    atomic_uintmax_t bytes;
+    atomic_uintmax_t blocks;
+    atomic_uintmax_t errors;
+} sout_access_out_priv_t;
+
+static sout_access_out_priv_t *sout_access_out_priv( sout_access_out_t *p_access )
+{
+    return container_of( p_access, sout_access_out_priv_t, access );
+}
+
+static const struct vlc_metric access_out_metrics[] = {
+#define METRIC_WRITTEN_BYTES    0
+    { "vlc_sout_access_written_bytes_total", "Bytes written by the access out",
+      VLC_METRIC_COUNTER },
+#define METRIC_WRITTEN_BLOCKS   1
+    { "vlc_sout_access_written_blocks_total",
+      "Blocks written by the access out", VLC_METRIC_COUNTER },
+#define METRIC_WRITE_ERRORS     2
+    { "vlc_sout_access_write_errors_total", "Access out write errors",
+      VLC_METRIC_COUNTER },
+};
+
+static void sout_AccessOutReportMetrics( void *opaque,
+                                         vlc_metrics_writer_t *writer )
+{
+    sout_access_out_priv_t *priv = opaque;
+
+#define REPORT(metric, counter) \
+    vlc_metrics_Report( writer, &access_out_metrics[metric], \
+        atomic_load_explicit( &priv->counter, memory_order_relaxed ) )
+    REPORT( METRIC_WRITTEN_BYTES, bytes );
+    REPORT( METRIC_WRITTEN_BLOCKS, blocks );
+    REPORT( METRIC_WRITE_ERRORS, errors );
+#undef REPORT
+}
+
 #undef sout_AccessOutNew
 /*****************************************************************************
  * sout_AccessOutNew: allocate a new access out
@@ -289,12 +331,18 @@ int sout_InputSendBuffer( sout_packetizer_input_t *p_input,
 sout_access_out_t *sout_AccessOutNew( vlc_object_t *p_sout,
                                       const char *psz_access, const char *psz_name )
 {
+    sout_access_out_priv_t *priv;
     sout_access_out_t *p_access;
     char              *psz_next;
 
-    p_access = vlc_custom_create( p_sout, sizeof( *p_access ), "access out" );
-    if( !p_access )
+    priv = vlc_custom_create( p_sout, sizeof( *priv ), "access out" );
+    if( !priv )
         return NULL;
+    p_access = &priv->access;
+    priv->metrics = NULL;
+    atomic_init( &priv->bytes, 0 );
+    atomic_init( &priv->blocks, 0 );
+    atomic_init( &priv->errors, 0 );
 
     psz_next = config_ChainCreate( &p_access->psz_access, &p_access->p_cfg,
                                    psz_access );
@@ -321,6 +369,13 @@ error:
         return( NULL );
     }
 
+    if( var_InheritBool( p_access, "stats" ) )
+        priv->metrics = vlc_metrics_Register( p_access,
+                                              sout_AccessOutReportMetrics,
+                                              priv,
+                                              "access", p_access->psz_access,
+                                              "path", p_access->psz_path,
+                                              NULL );
     return p_access;
 }
 /*****************************************************************************
@@ -328,6 +383,8 @@ error:
  *****************************************************************************/
 void sout_AccessOutDelete( sout_access_out_t *p_access )
 {
+    vlc_metrics_Unregister( sout_access_out_priv( p_access )->metrics );
+
     if( p_access->p_module )
     {
         module_unneed( p_access, p_access->p_module );
@@ -365,7 +422,24 @@ ssize_t sout_AccessOutRead( sout_access_out_t *p_access, block_t *p_buffer )
  *****************************************************************************/
 ssize_t sout_AccessOutWrite( sout_access_out_t *p_access, block_t *p_buffer )
 {
-    return p_access->pf_write( p_access, p_buffer );
+    sout_access_out_priv_t *priv = sout_access_out_priv( p_access );
+    size_t i_blocks = 0;
+
+    for( const block_t *p_block = p_buffer; p_block != NULL;
+         p_block = p_block->p_next )
+        i_blocks++;
+
+    ssize_t i_ret = p_access->pf_write( p_access, p_buffer );
+
+    if( i_ret >= 0 )
+    {
+        atomic_fetch_add_explicit( &priv->bytes, i_ret, memory_order_relaxed );
+        atomic_fetch_add_explicit( &priv->blocks, i_blocks,
+                                   memory_order_relaxed );
+    }
+    else
+        atomic_fetch_add_explicit( &priv->errors, 1, memory_order_relaxed );
+    return i_ret;
 }
 
 /**
@@ -0,0 +1,203 @@
+/*****************************************************************************
+ * block_ring.c: test for the lock-less block queue
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#undef NDEBUG
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include "../misc/block_ring.h"
+
+#define COUNT 10000
+
+static void test_block_ring_Basic(void)
+{
+    block_ring_t *ring = block_ring_New(3);
+    bool was_empty;
+
+    assert(ring != NULL);
+    assert(block_ring_Pop(ring) == NULL);
+
+    /* capacity is rounded up to 4 */
+    for (size_t i = 0; i < 4; i++)
+    {
+        block_t *block = block_Alloc(i + 1);
+        assert(block != NULL);
+        assert(block_ring_Push(ring, block, &was_empty) == VLC_SUCCESS);
+        assert(was_empty == (i == 0));
+    }
+    assert(block_ring_GetCount(ring) == 4);
+    assert(block_ring_GetBytes(ring) == 1 + 2 + 3 + 4);
+
+    block_t *full = block_Alloc(1);
+    assert(full != NULL);
+    assert(block_ring_Push(ring, full, &was_empty) != VLC_SUCCESS);
+    block_Release(full);
+
+    block_t *block = block_ring_Pop(ring);
+    assert(block != NULL && block->i_buffer == 1);
+    block_Release(block);
+    assert(block_ring_GetCount(ring) == 3);
+    assert(block_ring_GetBytes(ring) == 2 + 3 + 4);
+
+    /* remaining blocks are released */
+    block_ring_Delete(ring);
+}
+
+struct test_ctx
+{
+    block_ring_t *ring;
+    vlc_sem_t items;
+    vlc_sem_t space;
+};
+
+static void *Producer(void *data)
+{
+    struct test_ctx *ctx = data;
+
+    for (size_t i = 0; i < COUNT; i++)
+    {
+        block_t *block = block_Alloc(sizeof (i));
+        bool was_empty;
+
+        assert(block != NULL);
+        memcpy(block->p_buffer, &i, sizeof (i));
+        vlc_sem_wait(&ctx->space);
+        assert(block_ring_Push(ctx->ring, block, &was_empty) == VLC_SUCCESS);
+        vlc_sem_post(&ctx->items);
+    }
+    return NULL;
+}
+
+static void test_block_ring_Threads(void)
+{
+    struct test_ctx ctx;
+    vlc_thread_t th;
+
+    ctx.ring = block_ring_New(16);
+    assert(ctx.ring != NULL);
+    vlc_sem_init(&ctx.items, 0);
+    vlc_sem_init(&ctx.space, 16);
+    assert(!vlc_clone(&th, Producer, &ctx, VLC_THREAD_PRIORITY_LOW));
+
+    for (size_t i = 0; i < COUNT; i++)
+    {
+        size_t val;
+
+        vlc_sem_wait(&ctx.items);
+        block_t *block = block_ring_Pop(ctx.ring);
+        vlc_sem_post(&ctx.space);
+
+        assert(block != NULL);
+        assert(block->i_buffer == sizeof (val));
+        memcpy(&val, block->p_buffer, sizeof (val));
+        assert(val == i);
+        block_Release(block);
+    }
+
+    vlc_join(th, NULL);
+    assert(block_ring_GetCount(ctx.ring) == 0);
+    assert(block_ring_GetBytes(ctx.ring) == 0);
+    block_ring_Delete(ctx.ring);
+}
+
+/* The consumer waits when the ring is empty, and the producer wakes it up
+ * only if it reports the ring was empty, as the decoder does. */
+struct wakeup_ctx
+{
+    block_ring_t *ring;
+    vlc_sem_t space;
+    vlc_mutex_t lock;
+    vlc_cond_t wait;
+};
+
+static void *WakeupProducer(void *data)
+{
+    struct wakeup_ctx *ctx = data;
+
+    for (size_t i = 0; i < COUNT; i++)
+    {
+        block_t *block = block_Alloc(sizeof (i));
+        bool was_empty;
+
+        assert(block != NULL);
+        memcpy(block->p_buffer, &i, sizeof (i));
+        vlc_sem_wait(&ctx->space);
+        assert(block_ring_Push(ctx->ring, block, &was_empty) == VLC_SUCCESS);
+
+        if (was_empty)
+        {
+            vlc_mutex_lock(&ctx->lock);
+            vlc_cond_signal(&ctx->wait);
+            vlc_mutex_unlock(&ctx->lock);
+        }
+    }
+    return NULL;
+}
+
+static void test_block_ring_Wakeup(void)
+{
+    struct wakeup_ctx ctx;
+    vlc_thread_t th;
+
+    ctx.ring = block_ring_New(4);
+    assert(ctx.ring != NULL);
+    vlc_sem_init(&ctx.space, 4);
+    vlc_mutex_init(&ctx.lock);
+    vlc_cond_init(&ctx.wait);
+    assert(!vlc_clone(&th, WakeupProducer, &ctx, VLC_THREAD_PRIORITY_LOW));
+
+    vlc_mutex_lock(&ctx.lock);
+    for (size_t i = 0; i < COUNT;)
+    {
+        block_t *block = block_ring_Pop(ctx.ring);
+        if (block == NULL)
+        {
+            vlc_cond_wait(&ctx.wait, &ctx.lock);
+            continue;
+        }
+        vlc_sem_post(&ctx.space);
+
+        size_t val;
+
+        memcpy(&val, block->p_buffer, sizeof (val));
+        assert(val == i);
+        block_Release(block);
+        i++;
+    }
+    vlc_mutex_unlock(&ctx.lock);
+
+    vlc_join(th, NULL);
+    assert(block_ring_IsEmpty(ctx.ring));
+    block_ring_Delete(ctx.ring);
+}
+
+int main(void)
+{
+    test_block_ring_Basic();
+    test_block_ring_Threads();
+    test_block_ring_Wakeup();
+    return 0;
+}
@@ -86,11 +86,193 @@ static void test_block (void)
     //assert (block == NULL);
 }
 
+/* The slab size classes are powers of two from 256 bytes to 64 KiB */
+#define SLAB_MIN   256
+#define SLAB_MAX   65536
+/* Blocks of the largest class held by the shared depot (1 MiB) */
+#define SLAB_DEPOT (1048576 / SLAB_MAX)
+
+static void test_block_Size (size_t size)
+{
+    block_t *block = block_Alloc (size);
+    assert (block != NULL);
+    assert (block->i_buffer == size);
+    assert (((uintptr_t)block->p_buffer % 32) == 0);
+    memset (block->p_buffer, 0xAB, size);
+
+    block = block_Realloc (block, 16, size + 32);
+    assert (block != NULL);
+    assert (block->i_buffer == size + 48);
+    if (size > 0)
+        assert (block->p_buffer[16] == 0xAB);
+    block_Release (block);
+}
+
+#define REMOTE_COUNT (4 * SLAB_DEPOT)
+
+static void *test_block_Consumer (void *data)
+{
+    block_t **blocks = data;
+
+    /* The magazine of this thread overflows to the depot, and the depot
+     * frees what it cannot hold */
+    for (unsigned i = 0; i < REMOTE_COUNT; i++)
+        block_Release (blocks[i]);
+    return NULL;
+}
+
+static void test_block_Slab (void)
+{
+    struct vlc_block_slab_stats stats, before;
+
+    block_slab_Enable ();
+
+    test_block_Size (0);
+    for (size_t size = SLAB_MIN; size <= SLAB_MAX; size *= 2)
+    {
+        /* Below, at and past every size class */
+        test_block_Size (size - 1);
+        test_block_Size (size);
+        test_block_Size (size + 1);
+
+        /* A released block is reused for any size of its class only */
+        block_t *block = block_Alloc (size);
+        assert (block != NULL);
+        block_t *first = block;
+        block_Release (block);
+
+        block = block_Alloc (size / 2 + 1);
+        assert (block == first);
+        block_t *next = block_Alloc (size + 1);
+        assert (next != NULL && next != first);
+        block_Release (next);
+        block_Release (block);
+    }
+
+    /* Blocks released by another thread come back through the depot */
+    block_t *blocks[REMOTE_COUNT];
+    vlc_thread_t th;
+
+    for (unsigned i = 0; i < REMOTE_COUNT; i++)
+    {
+        blocks[i] = block_Alloc (SLAB_MAX);
+        assert (blocks[i] != NULL);
+    }
+    block_slab_GetStats (&before);
+    assert (!vlc_clone (&th, test_block_Consumer, blocks,
+                        VLC_THREAD_PRIORITY_LOW));
+    vlc_join (th, NULL);
+
+    block_slab_GetStats (&stats);
+    assert (stats.frees - before.frees == REMOTE_COUNT);
+    assert (stats.depot_returns > before.depot_returns);
+
+    before = stats;
+    for (unsigned i = 0; i < REMOTE_COUNT; i++)
+    {
+        blocks[i] = block_Alloc (SLAB_MAX);
+        assert (blocks[i] != NULL);
+        memset (blocks[i]->p_buffer, 0xCD, SLAB_MAX);
+    }
+    block_slab_GetStats (&stats);
+    assert (stats.allocs - before.allocs == REMOTE_COUNT);
+    assert (stats.depot_hits > before.depot_hits);
+    assert (stats.depot_hits - before.depot_hits <= SLAB_DEPOT);
+    assert (stats.heap_allocs > before.heap_allocs);
+    for (unsigned i = 0; i < REMOTE_COUNT; i++)
+        block_Release (blocks[i]);
+}
+
+static void test_block_SlabDisable (void)
+{
+    struct vlc_block_slab_stats stats, before;
+
+    /* Blocks outlive the allocator */
+    block_t *block = block_Alloc (SLAB_MIN);
+    assert (block != NULL);
+    block_slab_Disable ();
+    block_Release (block);
+
+    block_slab_GetStats (&before);
+    block = block_Alloc (SLAB_MIN);
+    assert (block != NULL);
+    block_Release (block);
+    block_slab_GetStats (&stats);
+    assert (stats.allocs == before.allocs);
+}
+
+struct slab_thread
+{
+    vlc_sem_t cached;
+    vlc_sem_t disabled;
+};
+
+static void *test_block_SlabThread (void *data)
+{
+    struct slab_thread *t = data;
+    block_t *blocks[8];
+
+    /* Fill the magazine of this thread */
+    for (unsigned i = 0; i < ARRAY_SIZE(blocks); i++)
+    {
+        blocks[i] = block_Alloc (SLAB_MIN);
+        assert (blocks[i] != NULL);
+    }
+    for (unsigned i = 1; i < ARRAY_SIZE(blocks); i++)
+        block_Release (blocks[i]);
+    vlc_sem_post (&t->cached);
+
+    /* The magazine is emptied on the first release once disabled */
+    vlc_sem_wait (&t->disabled);
+    block_Release (blocks[0]);
+
+    block_t *block = block_Alloc (SLAB_MIN);
+    assert (block != NULL);
+    block_Release (block);
+    return NULL;
+}
+
+static void test_block_SlabDisableThread (void)
+{
+    struct vlc_block_slab_stats stats, before;
+    struct slab_thread t;
+    vlc_thread_t th;
+
+    vlc_sem_init (&t.cached, 0);
+    vlc_sem_init (&t.disabled, 0);
+
+    block_slab_Enable ();
+    assert (!vlc_clone (&th, test_block_SlabThread, &t,
+                        VLC_THREAD_PRIORITY_LOW));
+    vlc_sem_wait (&t.cached);
+    block_slab_Disable ();
+    block_slab_GetStats (&before);
+    vlc_sem_post (&t.disabled);
+    vlc_join (th, NULL);
+
+    block_slab_GetStats (&stats);
+    assert (stats.depot_returns > before.depot_returns);
+
+    /* Enabled again, with the same thread key */
+    block_slab_Enable ();
+    before = stats;
+    block_t *block = block_Alloc (SLAB_MIN);
+    assert (block != NULL);
+    block_Release (block);
+    block_slab_GetStats (&stats);
+    assert (stats.allocs == before.allocs + 1);
+    block_slab_Disable ();
+}
+
 int main (void)
 {
     test_block_File(false);
     test_block_File(true);
     test_block ();
+    test_block_Slab ();
+    test_block ();
+    test_block_SlabDisable ();
+    test_block_SlabDisableThread ();
     return 0;
 }
 
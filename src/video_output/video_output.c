@@ -215,10 +215,10 @@ static void vout_UpdateWindowSizeLocked(vout_thread_t *vout)
 
 /* */
 void vout_GetResetStatistic(vout_thread_t *vout, unsigned *restrict displayed,
-                            unsigned *restrict lost)
+                            unsigned *restrict lost, unsigned *restrict late)
 {
     assert(!vout->p->dummy);
-    vout_statistic_GetReset( &vout->p->statistic, displayed, lost );
+    vout_statistic_GetReset( &vout->p->statistic, displayed, lost, late );
 }
 
 bool vout_IsEmpty(vout_thread_t *vout)
@@ -920,7 +920,7 @@ static int ThreadDisplayPreparePicture(vout_thread_t *vout, bool reuse,
                     if (late > late_threshold) {
                         msg_Warn(vout, "picture is too late to be displayed (missing %"PRId64" ms)", MS_FROM_VLC_TICK(late));
                         picture_Release(decoded);
-                        vout_statistic_AddLost(&vout->p->statistic, 1);
+                        vout_statistic_AddLate(&vout->p->statistic, 1);
                         continue;
                     } else if (late > 0) {
                         msg_Dbg(vout, "picture might be displayed late (missing %"PRId64" ms)", MS_FROM_VLC_TICK(late));
@@ -328,7 +328,7 @@ void vout_MouseState(vout_thread_t *, const vlc_mouse_t *);
  * This function will return and reset internal statistics.
  */
 void vout_GetResetStatistic( vout_thread_t *p_vout, unsigned *pi_displayed,
-                             unsigned *pi_lost );
+                             unsigned *pi_lost, unsigned *pi_late );
 
 /**
  * This function will force to display the next picture while paused
@@ -39,6 +39,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 #include <unistd.h>
 #include <signal.h>
 
@@ -87,9 +88,10 @@ static inline void test_init (void)
     }
     if (alarm_timeout != 0)
     {
-        struct sigaction sig = {
-            .sa_handler = on_timeout,
-        };
+        struct sigaction sig;
+
+        memset(&sig, 0, sizeof (sig));
+        sig.sa_handler = on_timeout;
         sigaction(SIGALRM, &sig, NULL);
         alarm (alarm_timeout);
     }
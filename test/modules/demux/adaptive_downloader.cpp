@@ -0,0 +1,299 @@
+/*****************************************************************************
+ * adaptive_downloader.cpp: adaptive segments concurrent downloads test
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <algorithm>
+#include <string>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_tls.h>
+#include <vlc_variables.h>
+
+#include "../modules/demux/adaptive/http/AuthStorage.hpp"
+#include "../modules/demux/adaptive/http/Chunk.h"
+#include "../modules/demux/adaptive/http/HTTPConnection.hpp"
+#include "../modules/demux/adaptive/http/HTTPConnectionManager.h"
+#include "../modules/demux/adaptive/http/SegmentCache.hpp"
+
+#include "adaptive_server.hpp"
+
+using namespace adaptive;
+using namespace adaptive::http;
+
+const char vlc_module_name[] = "test_adaptive_downloader";
+
+/* Fetches segments from a local HTTP server, which answers every request
+ * after a delay, as a distant server would, one segment at a time, then
+ * several segments ahead. The segments contents are checked, and
+ * bench_modules_demux_adaptive_downloader prints the time of each way.
+ * A low latency segment is also read while the server produces it.
+ * The same is done through a shared libvlc_http session, over HTTP/2 if
+ * a TLS server can be created, and over HTTP/1.1, where requests must not
+ * share the session connection.
+ * Segments are then read again from the on-disk cache, unless the server
+ * forbids storing them. */
+
+/* Drops downloads in progress, as on seek, then reads another segment */
+static void Cancel(vlc_object_t *obj, unsigned port)
+{
+    AuthStorage auth(obj);
+    HTTPConnectionManager manager(obj, &auth);
+    HTTPChunkBufferedSource *sources[4];
+
+    for (unsigned i = 0; i < ARRAY_SIZE(sources); i++)
+        sources[i] = StartSegment(&manager, port, i);
+    /* Scheduled out of order, but read first */
+    HTTPChunkBufferedSource *source = StartSegment(&manager, port, 0);
+    CheckSegment(source, 0);
+    delete source;
+
+    for (unsigned i = 0; i < ARRAY_SIZE(sources); i++)
+        delete sources[i];
+
+    source = StartSegment(&manager, port, 5);
+    CheckSegment(source, 5);
+    delete source;
+}
+
+/* Reads a segment while it is being produced */
+static void Incremental(vlc_object_t *obj, unsigned port)
+{
+    AuthStorage auth(obj);
+    HTTPConnectionManager manager(obj, &auth);
+    const std::string url = "http://127.0.0.1:" + std::to_string(port) +
+                            "/chunked/3";
+    HTTPChunkBufferedSource *source =
+        new HTTPChunkBufferedSource(url, &manager, ID("test"));
+    source->setIncremental(true);
+    manager.start(source);
+
+    size_t offset = 0;
+    block_t *block;
+    while ((block = source->readBlock()) != NULL)
+    {
+        for (size_t i = 0; i < block->i_buffer; i++)
+            assert(block->p_buffer[i] == SegmentByte(3, offset + i));
+        offset += block->i_buffer;
+        block_Release(block);
+        fragments_read = offset / FRAGMENT_SIZE;
+    }
+
+    assert(offset == FRAGMENT_SIZE * FRAGMENT_COUNT);
+    assert(!fragments_late);
+    assert(source->getContentType() == "video/mp4");
+    delete source;
+}
+
+/* Reads two segments at once, then a low latency one, from one session.
+ * Its connections are only reused if requests are multiplexed (h2). */
+static void Session(vlc_object_t *obj, const std::string &origin,
+                    bool multiplexed)
+{
+    LibVLCHTTPSession session(obj, NULL);
+    LibVLCHTTPConnection first(obj, &session), second(obj, &session);
+    const ConnectionParams params(origin + "/");
+    uint8_t buf[HTTPChunkSource::CHUNK_SIZE];
+
+    assert(session.getManager() != NULL);
+    assert(first.prepare(params) && second.prepare(params));
+    assert(!first.canReuse(params));
+    assert(first.request("/1") == RequestStatus::Success);
+    assert(second.request("/2") == RequestStatus::Success);
+    assert(first.getContentLength() == SEGMENT_SIZE);
+    assert(second.getContentType() == "video/mp2t");
+    assert(session.isMultiplexed() == multiplexed);
+
+    for (size_t offset = 0; offset < SEGMENT_SIZE; offset += sizeof (buf))
+    {
+        const size_t len = std::min(sizeof (buf), SEGMENT_SIZE - offset);
+        LibVLCHTTPConnection *conns[2] = { &first, &second };
+        for (unsigned i = 0; i < 2; i++)
+        {
+            ssize_t val = conns[i]->read(buf, sizeof (buf));
+            assert(val == (ssize_t)len);
+            for (size_t j = 0; j < len; j++)
+                assert(buf[j] == SegmentByte(1 + i, offset + j));
+        }
+    }
+    assert(first.read(buf, sizeof (buf)) == 0);
+    first.setUsed(false);
+    assert(first.canReuse(params) == multiplexed);
+
+    fragments_read = 0;
+    assert(second.request("/chunked/4") == RequestStatus::Success);
+    assert(second.getContentLength() == 0);
+    size_t offset = 0;
+    ssize_t val;
+    while ((val = second.readSome(buf, sizeof (buf))) > 0)
+    {
+        for (ssize_t j = 0; j < val; j++)
+            assert(buf[j] == SegmentByte(4, offset + j));
+        offset += val;
+        fragments_read = offset / FRAGMENT_SIZE;
+    }
+    assert(offset == FRAGMENT_SIZE * FRAGMENT_COUNT);
+    assert(!fragments_late);
+    second.setUsed(false);
+}
+
+/* Once a server selected http/1.1, its requests go to native connections */
+static void Fallback(vlc_object_t *obj, const std::string &origin)
+{
+    LibVLCHTTPConnectionFactory factory(NULL);
+    const ConnectionParams params(origin + "/");
+    uint8_t buf[HTTPChunkSource::CHUNK_SIZE];
+
+    AbstractConnection *conn = factory.createConnection(obj, params);
+    assert(conn != NULL);
+    assert(conn->prepare(params));
+    assert(conn->request("/6") == RequestStatus::Success);
+
+    size_t offset = 0;
+    ssize_t val;
+    while ((val = conn->read(buf, sizeof (buf))) > 0)
+    {
+        for (ssize_t j = 0; j < val; j++)
+            assert(buf[j] == SegmentByte(6, offset + j));
+        offset += val;
+    }
+    assert(offset == SEGMENT_SIZE);
+    conn->setUsed(false);
+
+    assert(!conn->canReuse(params));
+    assert(factory.createConnection(obj, params) == NULL);
+    delete conn;
+}
+
+/* Reads segments twice, with a new manager each time */
+static void Cache(vlc_object_t *obj, unsigned port)
+{
+    const unsigned numbers[] = { 7, NOSTORE_SEGMENT };
+
+    var_Create(obj, "adaptive-cache-size", VLC_VAR_INTEGER);
+    var_SetInteger(obj, "adaptive-cache-size", 16);
+
+    for (unsigned pass = 0; pass < 2; pass++)
+    {
+        AuthStorage auth(obj);
+        HTTPConnectionManager manager(obj, &auth);
+        assert(manager.getCache() != NULL);
+
+        for (unsigned number : numbers)
+        {
+            const unsigned count = served[number];
+            HTTPChunkBufferedSource *source = StartSegment(&manager, port, number);
+            CheckSegment(source, number);
+            delete source;
+            const bool cached = pass > 0 && number != NOSTORE_SEGMENT;
+            assert(served[number] == count + (cached ? 0 : 1));
+        }
+    }
+
+    var_Destroy(obj, "adaptive-cache-size");
+}
+
+/* Responses are stored for as long as Cache-Control allows, and for a
+ * short while without it, as live servers can reuse segment names */
+static void Storable(void)
+{
+    const time_t now = time(NULL);
+    time_t expires;
+
+    assert(SegmentCache::isStorable("", &expires));
+    assert(expires >= now + SegmentCache::DEFAULT_LIFETIME);
+    assert(expires <= time(NULL) + SegmentCache::DEFAULT_LIFETIME);
+
+    assert(SegmentCache::isStorable("public, max-age=3600", &expires));
+    assert(expires >= now + 3600 && expires <= time(NULL) + 3600);
+
+    assert(!SegmentCache::isStorable("no-store", &expires));
+    assert(!SegmentCache::isStorable("max-age=60, No-Cache", &expires));
+    assert(!SegmentCache::isStorable("max-age=0", &expires));
+}
+
+#define CERTDIR SRCDIR "/samples/certs"
+#define CERTFILE CERTDIR "/certkey.pem"
+
+/* Over TLS, with ALPN offering h2 then http/1.1 only */
+static void Secure(vlc_object_t *obj)
+{
+    vlc_tls_server_t *creds = vlc_tls_ServerCreate(obj, CERTFILE, NULL);
+    if (creds == NULL)
+    {
+        test_log("no TLS server, skipping HTTPS tests\n");
+        return;
+    }
+
+    var_Create(obj, "gnutls-system-trust", VLC_VAR_BOOL);
+    var_SetBool(obj, "gnutls-system-trust", false);
+    var_Create(obj, "gnutls-dir-trust", VLC_VAR_STRING);
+    var_SetString(obj, "gnutls-dir-trust", CERTDIR);
+
+    struct server srv;
+    ServerStart(&srv, creds, true);
+    Session(obj, "https://localhost:" + std::to_string(srv.port), true);
+    ServerStop(&srv);
+    /* All requests multiplexed over a single connection */
+    assert(srv.accepted == 1);
+
+    ServerStart(&srv, creds, false);
+    Session(obj, "https://localhost:" + std::to_string(srv.port), false);
+    Fallback(obj, "https://localhost:" + std::to_string(srv.port));
+    ServerStop(&srv);
+
+    var_Destroy(obj, "gnutls-dir-trust");
+    var_Destroy(obj, "gnutls-system-trust");
+    vlc_tls_ServerDelete(creds);
+}
+
+int main(void)
+{
+    test_init();
+
+    /* Keeps the segment cache out of the user directory */
+    char cachedir[] = "/tmp/vlc-test-adaptive-XXXXXX";
+    assert(mkdtemp(cachedir) != NULL);
+    setenv("XDG_CACHE_HOME", cachedir, 1);
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+
+    struct server srv;
+    ServerStart(&srv, NULL, false);
+
+    Fetch(obj, srv.port, 12, 1);
+    Fetch(obj, srv.port, 12, 4);
+    Cancel(obj, srv.port);
+    Incremental(obj, srv.port);
+    Session(obj, "http://127.0.0.1:" + std::to_string(srv.port), false);
+    Storable();
+    Cache(obj, srv.port);
+    Secure(obj);
+
+    ServerStop(&srv);
+    libvlc_release(vlc);
+    RemoveDir(cachedir);
+    return 0;
+}
@@ -0,0 +1,70 @@
+/*****************************************************************************
+ * adaptive_downloader_bench.cpp: adaptive segments concurrent downloads bench
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <cinttypes>
+#include <cstdio>
+
+#include <vlc_common.h>
+#include <vlc_tick.h>
+
+#include "adaptive_server.hpp"
+
+const char vlc_module_name[] = "bench_adaptive_downloader";
+
+/* Prints how much faster segments are read from a distant server with four
+ * downloads ahead than one at a time. See adaptive_downloader.cpp for the
+ * test. */
+
+#define COUNT 100
+
+int main(void)
+{
+    test_init();
+    alarm(0);
+
+    /* Keeps the segment cache out of the user directory */
+    char cachedir[] = "/tmp/vlc-bench-adaptive-XXXXXX";
+    assert(mkdtemp(cachedir) != NULL);
+    setenv("XDG_CACHE_HOME", cachedir, 1);
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+
+    struct server srv;
+    ServerStart(&srv, NULL, false);
+
+    const vlc_tick_t serial = Fetch(obj, srv.port, COUNT, 1);
+    const vlc_tick_t ahead = Fetch(obj, srv.port, COUNT, 4);
+
+    printf("%u segments of %u bytes, %" PRId64 " ms latency: "
+           "%.2fx faster with four downloads ahead\n", COUNT,
+           (unsigned)SEGMENT_SIZE, MS_FROM_VLC_TICK(SERVER_LATENCY),
+           (double)serial / ahead);
+
+    ServerStop(&srv);
+    libvlc_release(vlc);
+    RemoveDir(cachedir);
+    return 0;
+}
@@ -0,0 +1,327 @@
+/*****************************************************************************
+ * adaptive_logic.cpp: adaptive logics simulation
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <string>
+#include <vector>
+
+#include <vlc_common.h>
+
+#include "../modules/demux/adaptive/playlist/AbstractPlaylist.hpp"
+#include "../modules/demux/adaptive/playlist/BasePeriod.h"
+#include "../modules/demux/adaptive/playlist/BaseAdaptationSet.h"
+#include "../modules/demux/adaptive/playlist/BaseRepresentation.h"
+#include "../modules/demux/adaptive/logic/AbstractAdaptationLogic.h"
+#include "../modules/demux/adaptive/logic/RateBasedAdaptationLogic.h"
+#include "../modules/demux/adaptive/logic/PredictiveAdaptationLogic.hpp"
+#include "../modules/demux/adaptive/logic/NearOptimalAdaptationLogic.hpp"
+#include "../modules/demux/adaptive/logic/HybridAdaptationLogic.hpp"
+#include "../modules/demux/adaptive/SegmentTracker.hpp"
+
+using namespace adaptive;
+using namespace adaptive::playlist;
+using namespace adaptive::logic;
+
+const char vlc_module_name[] = "test_adaptive_logic";
+
+/* Plays a synthetic on-demand presentation with each adaptive logic, over
+ * bandwidth traces, without any network: segments download times are
+ * computed from the traces. The number and duration of playback stalls, the
+ * average bitrate and the number of switches are printed. The hybrid logic
+ * must not stall on the built-in traces.
+ *
+ * Recorded traces can be given as arguments, as text files with one sample
+ * per line: the sample duration in milliseconds, then the throughput in
+ * kbit/s. */
+
+#define SEGMENT_DURATION VLC_TICK_FROM_SEC(4)
+#define SEGMENT_COUNT 150
+#define MIN_BUFFERING VLC_TICK_FROM_SEC(6)
+#define MAX_BUFFERING VLC_TICK_FROM_SEC(30)
+#define REQUEST_LATENCY VLC_TICK_FROM_MS(100)
+
+static const unsigned ladder[] = { /* kbit/s */
+    200, 400, 700, 1000, 1500, 2500, 4000,
+};
+
+struct trace
+{
+    std::string name;
+    std::vector<std::pair<vlc_tick_t, unsigned>> samples; /* duration, kbit/s */
+};
+
+struct result
+{
+    unsigned stalls;
+    vlc_tick_t stalled;
+    vlc_tick_t startup;
+    unsigned switches;
+    uint64_t bitrate;
+};
+
+class SyntheticPlaylist : public AbstractPlaylist
+{
+    public:
+        SyntheticPlaylist(vlc_object_t *obj) : AbstractPlaylist(obj)
+        {
+            BasePeriod *period = new BasePeriod(this);
+            BaseAdaptationSet *set = new BaseAdaptationSet(period);
+            set->setID(ID("video"));
+            for (size_t i = 0; i < ARRAY_SIZE(ladder); i++)
+            {
+                BaseRepresentation *rep = new BaseRepresentation(set);
+                rep->setID(ID(std::to_string(ladder[i])));
+                rep->setBandwidth(ladder[i] * 1000);
+                set->addRepresentation(rep);
+            }
+            period->addAdaptationSet(set);
+            addPeriod(period);
+        }
+
+        virtual bool isLive() const { return false; }
+        virtual void debug() {}
+
+        BaseAdaptationSet *getAdaptationSet()
+        {
+            return getFirstPeriod()->getAdaptationSets().front();
+        }
+};
+
+/* Returns the time to download size bytes from the given time */
+static vlc_tick_t Download(const struct trace &trace, vlc_tick_t start,
+                           uint64_t size)
+{
+    vlc_tick_t period = 0;
+    for (const auto &sample : trace.samples)
+        period += sample.first;
+
+    /* Find the sample at the start time, the trace is looped */
+    vlc_tick_t time = start + REQUEST_LATENCY;
+    vlc_tick_t offset = time % period;
+    size_t i = 0;
+    while (offset >= trace.samples[i].first)
+        offset -= trace.samples[i++].first;
+
+    double bits = size * 8.;
+    for (;;)
+    {
+        const vlc_tick_t left = trace.samples[i].first - offset;
+        const double rate = trace.samples[i].second * 1000.; /* bit/s */
+        const double sent = rate * secf_from_vlc_tick(left);
+
+        if (sent >= bits)
+            return time + vlc_tick_from_sec(bits / rate) - start;
+        bits -= sent;
+        time += left;
+        offset = 0;
+        i = (i + 1) % trace.samples.size();
+    }
+}
+
+static struct result Simulate(AbstractAdaptationLogic *logic,
+                              BaseAdaptationSet *set,
+                              const struct trace &trace)
+{
+    struct result res = { 0, 0, 0, 0, 0 };
+    BaseRepresentation *prev = NULL;
+    vlc_tick_t time = 0;
+    vlc_tick_t level = 0; /* buffered duration */
+    bool playing = false, started = false;
+
+    logic->trackerEvent(SegmentTrackerEvent(set->getID(), true));
+
+    for (unsigned n = 0; n < SEGMENT_COUNT; n++)
+    {
+        /* Wait for playback to make room for the next segment */
+        if (level + SEGMENT_DURATION > MAX_BUFFERING)
+        {
+            const vlc_tick_t wait = level + SEGMENT_DURATION - MAX_BUFFERING;
+            assert(playing);
+            time += wait;
+            level -= wait;
+        }
+
+        logic->trackerEvent(SegmentTrackerEvent(set->getID(), MIN_BUFFERING,
+                                                level, MAX_BUFFERING));
+        BaseRepresentation *rep = logic->getNextRepresentation(set, prev);
+        assert(rep != NULL);
+        if (rep != prev)
+        {
+            logic->trackerEvent(SegmentTrackerEvent(prev, rep));
+            if (prev != NULL)
+                res.switches++;
+            prev = rep;
+        }
+
+        const uint64_t size = rep->getBandwidth() / 8 *
+                              SEGMENT_DURATION / CLOCK_FREQ;
+        const vlc_tick_t elapsed = Download(trace, time, size);
+        logic->updateDownloadRate(set->getID(), size, elapsed);
+        logic->trackerEvent(SegmentTrackerEvent(set->getID(), SEGMENT_DURATION));
+        res.bitrate += rep->getBandwidth();
+
+        time += elapsed;
+        if (playing)
+        {
+            if (elapsed > level)
+            {
+                res.stalls++;
+                res.stalled += elapsed - level;
+                level = 0;
+                playing = false;
+            }
+            else
+                level -= elapsed;
+        }
+        else if (started)
+            res.stalled += elapsed;
+        level += SEGMENT_DURATION;
+
+        if (!playing && (level >= MIN_BUFFERING || n + 1 == SEGMENT_COUNT))
+        {
+            playing = true;
+            if (!started)
+                res.startup = time;
+            started = true;
+        }
+    }
+
+    logic->trackerEvent(SegmentTrackerEvent(set->getID(), false));
+    res.bitrate /= SEGMENT_COUNT;
+    return res;
+}
+
+/* Mobile network like, with a few outages */
+static struct trace CellularTrace(void)
+{
+    struct trace trace;
+    uint32_t seed = 1;
+    double rate = 800;
+
+    trace.name = "cellular";
+    for (unsigned i = 0; i < 600; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        rate *= 0.7 + ((seed >> 16) & 0x7fff) / 32768. * 0.6;
+        rate += (800 - rate) / 8;
+        rate = VLC_CLIP(rate, 150, 2500);
+        trace.samples.emplace_back(VLC_TICK_FROM_SEC(1),
+                                   (i % 90 >= 87) ? 50 : (unsigned)rate);
+    }
+    return trace;
+}
+
+static bool LoadTrace(const char *path, struct trace *trace)
+{
+    FILE *stream = fopen(path, "rt");
+    if (stream == NULL)
+        return false;
+
+    double ms, kbps;
+    trace->name = path;
+    while (fscanf(stream, "%lf %lf", &ms, &kbps) == 2)
+        if (ms > 0)
+            trace->samples.emplace_back(VLC_TICK_FROM_MS(ms), kbps);
+    fclose(stream);
+    return !trace->samples.empty();
+}
+
+static const char *const logics[] = {
+    "rate", "predictive", "nearoptimal", "hybrid",
+};
+
+static AbstractAdaptationLogic *CreateLogic(vlc_object_t *obj, unsigned i)
+{
+    switch (i)
+    {
+        case 0:
+            return new RateBasedAdaptationLogic(obj);
+        case 1:
+            return new PredictiveAdaptationLogic(obj);
+        case 2:
+            return new NearOptimalAdaptationLogic(obj);
+        default:
+            return new HybridAdaptationLogic(obj);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+
+    std::vector<struct trace> traces(3);
+    const size_t builtins = traces.size();
+    traces[0].name = "steady";
+    traces[0].samples.emplace_back(VLC_TICK_FROM_SEC(1), 3000);
+    traces[1].name = "steps";
+    traces[1].samples.emplace_back(VLC_TICK_FROM_SEC(60), 4000);
+    traces[1].samples.emplace_back(VLC_TICK_FROM_SEC(60), 800);
+    traces[1].samples.emplace_back(VLC_TICK_FROM_SEC(60), 2000);
+    traces[1].samples.emplace_back(VLC_TICK_FROM_SEC(60), 300);
+    traces[2] = CellularTrace();
+    for (int i = 1; i < argc; i++)
+    {
+        struct trace trace;
+        if (!LoadTrace(argv[i], &trace))
+        {
+            fprintf(stderr, "cannot load trace %s\n", argv[i]);
+            libvlc_release(vlc);
+            return 1;
+        }
+        traces.push_back(trace);
+    }
+
+    SyntheticPlaylist playlist(obj);
+    BaseAdaptationSet *set = playlist.getAdaptationSet();
+
+    printf("%-12s %-12s %6s %8s %8s %9s %9s\n", "trace", "logic", "stalls",
+           "stalled", "startup", "switches", "kbit/s");
+    for (size_t t = 0; t < traces.size(); t++)
+    {
+        const struct trace &trace = traces[t];
+        struct result results[ARRAY_SIZE(logics)];
+
+        for (unsigned i = 0; i < ARRAY_SIZE(logics); i++)
+        {
+            AbstractAdaptationLogic *logic = CreateLogic(obj, i);
+            results[i] = Simulate(logic, set, trace);
+            delete logic;
+
+            printf("%-12s %-12s %6u %7.1fs %7.1fs %9u %9" PRIu64 "\n",
+                   trace.name.c_str(), logics[i], results[i].stalls,
+                   secf_from_vlc_tick(results[i].stalled),
+                   secf_from_vlc_tick(results[i].startup),
+                   results[i].switches, results[i].bitrate / 1000);
+        }
+
+        if (t < builtins)
+            assert(results[ARRAY_SIZE(logics) - 1].stalls == 0);
+    }
+
+    libvlc_release(vlc);
+    return 0;
+}
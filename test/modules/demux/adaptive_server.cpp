@@ -0,0 +1,678 @@
+/*****************************************************************************
+ * adaptive_server.cpp: local HTTP segments server
+ *****************************************************************************
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <vector>
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_threads.h>
+#include <vlc_tls.h>
+
+extern "C"
+{
+    #include "../modules/access/http/h2frame.h"
+}
+
+#include "../modules/demux/adaptive/http/AuthStorage.hpp"
+#include "../modules/demux/adaptive/http/Chunk.h"
+#include "../modules/demux/adaptive/http/HTTPConnectionManager.h"
+
+#include "adaptive_server.hpp"
+
+using namespace adaptive;
+using namespace adaptive::http;
+
+std::atomic<unsigned> fragments_read;
+std::atomic<bool> fragments_late;
+std::atomic<unsigned> served[NOSTORE_SEGMENT + 1];
+
+uint8_t SegmentByte(unsigned number, size_t offset)
+{
+    return number * 7 + offset / 3;
+}
+
+static bool SendAll(vlc_tls_t *tls, const void *buf, size_t len)
+{
+    return vlc_tls_Write(tls, buf, len) == (ssize_t)len;
+}
+
+/* Waits until the client has read the previous fragments */
+static void WaitFragments(unsigned count)
+{
+    const vlc_tick_t deadline = vlc_tick_now() + FRAGMENT_TIMEOUT;
+
+    while (fragments_read < count)
+    {
+        if (vlc_tick_now() > deadline)
+        {
+            fragments_late = true;
+            break;
+        }
+        vlc_tick_wait(vlc_tick_now() + VLC_TICK_FROM_MS(10));
+    }
+}
+
+/* Sends each fragment once the client has read the previous one */
+static bool SendFragments(vlc_tls_t *tls, unsigned number)
+{
+    std::vector<uint8_t> body(FRAGMENT_SIZE);
+    char buf[64];
+
+    const char header[] = "HTTP/1.1 200 OK\r\n"
+                          "Content-Type: video/mp4\r\n"
+                          "Transfer-Encoding: chunked\r\n\r\n";
+    if (!SendAll(tls, header, strlen(header)))
+        return false;
+
+    for (unsigned i = 0; i < FRAGMENT_COUNT; i++)
+    {
+        WaitFragments(i);
+
+        for (size_t j = 0; j < body.size(); j++)
+            body[j] = SegmentByte(number, i * FRAGMENT_SIZE + j);
+        int len = snprintf(buf, sizeof (buf), "%zx\r\n", body.size());
+        if (!SendAll(tls, buf, len) ||
+            !SendAll(tls, body.data(), body.size()) ||
+            !SendAll(tls, "\r\n", 2))
+            return false;
+    }
+    return SendAll(tls, "0\r\n\r\n", 5);
+}
+
+/* Serves keep-alive requests for /<number> on one connection */
+static void H1Connection(vlc_tls_t *tls)
+{
+    std::string request;
+    std::vector<uint8_t> body(SEGMENT_SIZE);
+    char buf[1024];
+
+    for (;;)
+    {
+        size_t end = request.find("\r\n\r\n");
+        if (end == std::string::npos)
+        {
+            ssize_t val = vlc_tls_Read(tls, buf, sizeof (buf), false);
+            if (val <= 0)
+                break;
+            request.append(buf, val);
+            continue;
+        }
+
+        unsigned number;
+        if (sscanf(request.c_str(), "GET /chunked/%u HTTP/1.1\r\n", &number) == 1)
+        {
+            request.erase(0, end + 4);
+            if (!SendFragments(tls, number))
+                break;
+            continue;
+        }
+
+        int val = sscanf(request.c_str(), "GET /%u HTTP/1.1\r\n", &number);
+        assert(val == 1);
+        request.erase(0, end + 4);
+        /* Counted before the client can finish reading the response */
+        if (number <= NOSTORE_SEGMENT)
+            served[number]++;
+
+        vlc_tick_wait(vlc_tick_now() + SERVER_LATENCY);
+
+        for (size_t i = 0; i < body.size(); i++)
+            body[i] = SegmentByte(number, i);
+
+        int len = snprintf(buf, sizeof (buf), "HTTP/1.1 200 OK\r\n"
+                           "Content-Type: video/mp2t\r\n"
+                           "Cache-Control: %s\r\n"
+                           "Content-Length: %zu\r\n\r\n",
+                           number == NOSTORE_SEGMENT ? "no-store" : "max-age=60",
+                           body.size());
+        if (!SendAll(tls, buf, len) ||
+            !SendAll(tls, body.data(), body.size()))
+            break;
+    }
+}
+
+/* HTTP/2 requests are answered in order, once their headers are received */
+struct h2_server;
+
+struct h2_stream
+{
+    struct h2_server *srv;
+    uint32_t id;
+    std::string path;
+    int64_t window;
+    bool complete;
+    bool reset;
+};
+
+struct h2_server
+{
+    vlc_tls_t *tls;
+    struct vlc_h2_parser *parser;
+    std::list<struct h2_stream> streams;
+    uint32_t last_id;
+    uint32_t init_window;
+    int64_t window;
+    bool failed;
+};
+
+static bool H2Send(struct h2_server *srv, struct vlc_h2_frame *f)
+{
+    if (f == NULL)
+        return false;
+
+    bool ok = SendAll(srv->tls, f->data, vlc_h2_frame_size(f));
+    free(f);
+    return ok;
+}
+
+static void H2Setting(void *ctx, uint_fast16_t id, uint_fast32_t value)
+{
+    struct h2_server *srv = static_cast<struct h2_server *>(ctx);
+
+    if (id == VLC_H2_SETTING_INITIAL_WINDOW_SIZE)
+    {
+        for (struct h2_stream &s : srv->streams)
+            s.window += (int64_t)value - srv->init_window;
+        srv->init_window = value;
+    }
+}
+
+static int H2SettingsDone(void *ctx)
+{
+    struct h2_server *srv = static_cast<struct h2_server *>(ctx);
+
+    return H2Send(srv, vlc_h2_frame_settings_ack()) ? 0 : -1;
+}
+
+static int H2Ping(void *ctx, uint_fast64_t opaque)
+{
+    struct h2_server *srv = static_cast<struct h2_server *>(ctx);
+
+    return H2Send(srv, vlc_h2_frame_pong(opaque)) ? 0 : -1;
+}
+
+static void H2Error(void *ctx, uint_fast32_t code)
+{
+    struct h2_server *srv = static_cast<struct h2_server *>(ctx);
+
+    fprintf(stderr, "HTTP/2 server error: %s\n", vlc_h2_strerror(code));
+    srv->failed = true;
+}
+
+static int H2Reset(void *ctx, uint_fast32_t last_seq, uint_fast32_t code)
+{
+    /* GOAWAY: the client closes the connection */
+    (void) ctx; (void) last_seq; (void) code;
+    return 0;
+}
+
+static void H2WindowStatus(void *ctx, uint32_t *rcwd)
+{
+    /* Requests have no body */
+    (void) ctx; (void) rcwd;
+}
+
+static void H2WindowUpdate(void *ctx, uint_fast32_t credit)
+{
+    struct h2_server *srv = static_cast<struct h2_server *>(ctx);
+
+    srv->window += credit;
+}
+
+static void *H2StreamLookup(void *ctx, uint_fast32_t id)
+{
+    struct h2_server *srv = static_cast<struct h2_server *>(ctx);
+
+    for (struct h2_stream &s : srv->streams)
+        if (s.id == id)
+            return &s;
+
+    if ((id & 1) == 0 || id <= srv->last_id)
+        return NULL; /* answered or reset */
+
+    struct h2_stream s;
+    s.srv = srv;
+    s.id = id;
+    s.window = srv->init_window;
+    s.complete = false;
+    s.reset = false;
+    srv->streams.push_back(s);
+    srv->last_id = id;
+    return &srv->streams.back();
+}
+
+static int H2StreamError(void *ctx, uint_fast32_t id, uint_fast32_t code)
+{
+    struct h2_server *srv = static_cast<struct h2_server *>(ctx);
+
+    return H2Send(srv, vlc_h2_frame_rst_stream(id, code)) ? 0 : -1;
+}
+
+static void H2StreamHeaders(void *ctx, unsigned count,
+                            const char *const headers[][2])
+{
+    struct h2_stream *s = static_cast<struct h2_stream *>(ctx);
+
+    for (unsigned i = 0; i < count; i++)
+        if (strcmp(headers[i][0], ":path") == 0)
+            s->path = headers[i][1];
+}
+
+static int H2StreamData(void *ctx, struct vlc_h2_frame *f)
+{
+    (void) ctx;
+    free(f);
+    return 0;
+}
+
+static void H2StreamEnd(void *ctx)
+{
+    struct h2_stream *s = static_cast<struct h2_stream *>(ctx);
+
+    s->complete = true;
+}
+
+static int H2StreamReset(void *ctx, uint_fast32_t code)
+{
+    struct h2_stream *s = static_cast<struct h2_stream *>(ctx);
+
+    (void) code;
+    s->reset = true;
+    return 0;
+}
+
+static void H2StreamWindowUpdate(void *ctx, uint_fast32_t credit)
+{
+    struct h2_stream *s = static_cast<struct h2_stream *>(ctx);
+
+    s->window += credit;
+}
+
+static const struct vlc_h2_parser_cbs h2_callbacks =
+{
+    H2Setting,
+    H2SettingsDone,
+    H2Ping,
+    H2Error,
+    H2Reset,
+    H2WindowStatus,
+    H2WindowUpdate,
+    H2StreamLookup,
+    H2StreamError,
+    H2StreamHeaders,
+    H2StreamData,
+    H2StreamEnd,
+    H2StreamReset,
+    H2StreamWindowUpdate,
+};
+
+/* Receives and parses one frame from the client */
+static bool H2Receive(struct h2_server *srv)
+{
+    uint8_t header[9];
+
+    if (vlc_tls_Read(srv->tls, header, sizeof (header), true) != sizeof (header))
+        return false;
+
+    const size_t len = (header[0] << 16) | (header[1] << 8) | header[2];
+    struct vlc_h2_frame *f =
+        static_cast<struct vlc_h2_frame *>(malloc(sizeof (*f) + 9 + len));
+    assert(f != NULL);
+    f->next = NULL;
+    memcpy(f->data, header, sizeof (header));
+    if (len > 0 && vlc_tls_Read(srv->tls, f->data + 9, len, true) != (ssize_t)len)
+    {
+        free(f);
+        return false;
+    }
+    return vlc_h2_parse(srv->parser, f) == 0 && !srv->failed;
+}
+
+/* Sends DATA frames as fast as the congestion windows allow */
+static bool H2SendData(struct h2_server *srv, struct h2_stream *s,
+                       const uint8_t *buf, size_t len, bool eos)
+{
+    do
+    {
+        const int64_t credit = std::min(srv->window, s->window);
+        if (len > 0 && credit <= 0)
+        {
+            if (!H2Receive(srv))
+                return false;
+            if (s->reset)
+                return true;
+            continue;
+        }
+
+        size_t n = std::min(len, (size_t)VLC_H2_DEFAULT_MAX_FRAME);
+        if (n > 0)
+            n = std::min(n, (size_t)credit);
+        if (!H2Send(srv, vlc_h2_frame_data(s->id, buf, n, eos && n == len)))
+            return false;
+        srv->window -= n;
+        s->window -= n;
+        buf += n;
+        len -= n;
+    }
+    while (len > 0);
+    return true;
+}
+
+static bool H2Respond(struct h2_server *srv, struct h2_stream *s)
+{
+    unsigned number;
+
+    if (sscanf(s->path.c_str(), "/chunked/%u", &number) == 1)
+    {
+        std::vector<uint8_t> body(FRAGMENT_SIZE);
+        const char *const headers[][2] = {
+            { ":status", "200" },
+            { "content-type", "video/mp4" },
+        };
+
+        if (!H2Send(srv, vlc_h2_frame_headers(s->id, VLC_H2_DEFAULT_MAX_FRAME,
+                                              false, ARRAY_SIZE(headers),
+                                              headers)))
+            return false;
+
+        for (unsigned i = 0; i < FRAGMENT_COUNT; i++)
+        {
+            WaitFragments(i);
+
+            for (size_t j = 0; j < body.size(); j++)
+                body[j] = SegmentByte(number, i * FRAGMENT_SIZE + j);
+            if (!H2SendData(srv, s, body.data(), body.size(), false))
+                return false;
+            if (s->reset)
+                return true;
+        }
+        return H2SendData(srv, s, body.data(), 0, true);
+    }
+
+    int val = sscanf(s->path.c_str(), "/%u", &number);
+    assert(val == 1);
+    if (number <= NOSTORE_SEGMENT)
+        served[number]++;
+
+    std::vector<uint8_t> body(SEGMENT_SIZE);
+    for (size_t i = 0; i < body.size(); i++)
+        body[i] = SegmentByte(number, i);
+
+    const std::string length = std::to_string(body.size());
+    const char *const headers[][2] = {
+        { ":status", "200" },
+        { "content-type", "video/mp2t" },
+        { "cache-control",
+          number == NOSTORE_SEGMENT ? "no-store" : "max-age=60" },
+        { "content-length", length.c_str() },
+    };
+
+    return H2Send(srv, vlc_h2_frame_headers(s->id, VLC_H2_DEFAULT_MAX_FRAME,
+                                            false, ARRAY_SIZE(headers),
+                                            headers))
+        && H2SendData(srv, s, body.data(), body.size(), true);
+}
+
+/* Serves concurrent HTTP/2 requests on one connection */
+static void H2Connection(vlc_tls_t *tls)
+{
+    static const char preface[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+    /* Empty SETTINGS: the protocol defaults */
+    static const uint8_t settings[9] = { 0, 0, 0, 0x04, 0, 0, 0, 0, 0 };
+    char buf[sizeof (preface) - 1];
+
+    if (vlc_tls_Read(tls, buf, sizeof (buf), true) != sizeof (buf) ||
+        memcmp(buf, preface, sizeof (buf)) ||
+        !SendAll(tls, settings, sizeof (settings)))
+        return;
+
+    struct h2_server srv;
+    srv.tls = tls;
+    srv.parser = vlc_h2_parse_init(&srv, &h2_callbacks);
+    assert(srv.parser != NULL);
+    srv.last_id = 0;
+    srv.init_window = VLC_H2_DEFAULT_INIT_WINDOW;
+    srv.window = VLC_H2_DEFAULT_INIT_WINDOW;
+    srv.failed = false;
+
+    bool ok = true;
+    while (ok && H2Receive(&srv))
+        while (ok && !srv.streams.empty() &&
+               (srv.streams.front().complete || srv.streams.front().reset))
+        {
+            struct h2_stream *s = &srv.streams.front();
+            if (!s->reset)
+                ok = H2Respond(&srv, s);
+            srv.streams.pop_front();
+        }
+
+    vlc_h2_parse_destroy(srv.parser);
+}
+
+static bool Handshake(vlc_tls_server_t *creds, vlc_tls_t *tls)
+{
+    int val;
+
+    while ((val = vlc_tls_SessionHandshake(creds, tls)) > 0)
+    {
+        struct pollfd ufd;
+
+        ufd.events = (val == 1) ? POLLIN : POLLOUT;
+        ufd.fd = vlc_tls_GetPollFD(tls, &ufd.events);
+        poll(&ufd, 1, -1);
+    }
+    return val == 0;
+}
+
+static void *Connection(void *data)
+{
+    struct connection *conn = static_cast<struct connection *>(data);
+    struct server *srv = conn->srv;
+    static const char *const h2_alpn[] = { "h2", NULL };
+    static const char *const h1_alpn[] = { "http/1.1", NULL };
+
+    vlc_tls_t *tls = vlc_tls_SocketOpen(conn->fd);
+    if (tls == NULL)
+    {
+        close(conn->fd);
+        return NULL;
+    }
+
+    if (srv->creds != NULL)
+    {
+        vlc_tls_t *session =
+            vlc_tls_ServerSessionCreate(srv->creds, tls,
+                                        srv->h2 ? h2_alpn : h1_alpn);
+        if (session == NULL)
+        {
+            vlc_tls_Close(tls);
+            return NULL;
+        }
+        tls = session;
+        if (!Handshake(srv->creds, tls))
+        {
+            vlc_tls_Close(tls);
+            return NULL;
+        }
+    }
+
+    if (srv->h2)
+        H2Connection(tls);
+    else
+        H1Connection(tls);
+    vlc_tls_Close(tls);
+    return NULL;
+}
+
+static void *Server(void *data)
+{
+    struct server *srv = static_cast<struct server *>(data);
+
+    for (;;)
+    {
+        int fd = accept(srv->fd, NULL, NULL);
+        if (fd == -1)
+            break;
+        srv->accepted++;
+
+        vlc_mutex_lock(&srv->lock);
+        if (srv->connections.size() < MAX_CONNECTIONS)
+        {
+            struct connection conn;
+            conn.srv = srv;
+            conn.fd = fd;
+            srv->connections.push_back(conn);
+            if (vlc_clone(&srv->connections.back().thread, Connection,
+                          &srv->connections.back(),
+                          VLC_THREAD_PRIORITY_LOW) != 0)
+            {
+                srv->connections.pop_back();
+                close(fd);
+            }
+        }
+        else
+            close(fd);
+        vlc_mutex_unlock(&srv->lock);
+    }
+    return NULL;
+}
+
+void ServerStart(struct server *srv, vlc_tls_server_t *creds, bool h2)
+{
+    struct sockaddr_in addr;
+    socklen_t addrlen = sizeof (addr);
+
+    memset(&addr, 0, sizeof (addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    srv->fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    assert(srv->fd != -1);
+    assert(bind(srv->fd, (struct sockaddr *)&addr, sizeof (addr)) == 0);
+    assert(listen(srv->fd, MAX_CONNECTIONS) == 0);
+    assert(getsockname(srv->fd, (struct sockaddr *)&addr, &addrlen) == 0);
+    srv->port = ntohs(addr.sin_port);
+    srv->creds = creds;
+    srv->h2 = h2;
+    srv->accepted = 0;
+
+    vlc_mutex_init(&srv->lock);
+    assert(vlc_clone(&srv->thread, Server, srv,
+                     VLC_THREAD_PRIORITY_LOW) == 0);
+}
+
+void ServerStop(struct server *srv)
+{
+    /* The clients have closed their connections by now */
+    shutdown(srv->fd, SHUT_RDWR);
+    vlc_join(srv->thread, NULL);
+    close(srv->fd);
+
+    for (struct connection &conn : srv->connections)
+        vlc_join(conn.thread, NULL);
+    srv->connections.clear();
+}
+
+void CheckSegment(HTTPChunkBufferedSource *source, unsigned number)
+{
+    size_t offset = 0;
+    block_t *block;
+
+    while ((block = source->readBlock()) != NULL)
+    {
+        for (size_t i = 0; i < block->i_buffer; i++)
+            assert(block->p_buffer[i] == SegmentByte(number, offset + i));
+        offset += block->i_buffer;
+        block_Release(block);
+    }
+
+    assert(offset == SEGMENT_SIZE);
+    assert(source->getContentType() == "video/mp2t");
+}
+
+HTTPChunkBufferedSource *StartSegment(HTTPConnectionManager *manager,
+                                      unsigned port, unsigned number)
+{
+    const std::string url = "http://127.0.0.1:" + std::to_string(port) +
+                            "/" + std::to_string(number);
+    HTTPChunkBufferedSource *source =
+        new HTTPChunkBufferedSource(url, manager, ID("test"));
+    source->setDeadline(VLC_TICK_0 + number * SEGMENT_DURATION);
+    manager->start(source);
+    return source;
+}
+
+vlc_tick_t Fetch(vlc_object_t *obj, unsigned port, unsigned count,
+                 unsigned depth)
+{
+    AuthStorage auth(obj);
+    HTTPConnectionManager manager(obj, &auth);
+    std::deque<HTTPChunkBufferedSource *> queue;
+    unsigned next = 0;
+
+    const vlc_tick_t start = vlc_tick_now();
+
+    for (unsigned number = 0; number < count; number++)
+    {
+        while (next < count && queue.size() < depth)
+            queue.push_back(StartSegment(&manager, port, next++));
+
+        HTTPChunkBufferedSource *source = queue.front();
+        queue.pop_front();
+        CheckSegment(source, number);
+        delete source;
+    }
+
+    return vlc_tick_now() - start;
+}
+
+void RemoveDir(const std::string &path)
+{
+    DIR *dir = opendir(path.c_str());
+    if (dir != NULL)
+    {
+        struct dirent *ent;
+        while ((ent = readdir(dir)) != NULL)
+            if (strcmp(ent->d_name, ".") && strcmp(ent->d_name, ".."))
+            {
+                const std::string child = path + "/" + ent->d_name;
+                if (unlink(child.c_str()) != 0)
+                    RemoveDir(child);
+            }
+        closedir(dir);
+    }
+    rmdir(path.c_str());
+}
@@ -0,0 +1,97 @@
+/*****************************************************************************
+ * adaptive_server.hpp: local HTTP segments server
+ *****************************************************************************
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifndef VLC_TEST_ADAPTIVE_SERVER_HPP
+#define VLC_TEST_ADAPTIVE_SERVER_HPP
+
+#include <atomic>
+#include <list>
+#include <string>
+
+#include <vlc_common.h>
+#include <vlc_threads.h>
+#include <vlc_tls.h>
+
+#include "../modules/demux/adaptive/http/Chunk.h"
+#include "../modules/demux/adaptive/http/HTTPConnectionManager.h"
+
+/* The server answers every request for /<number> after a delay, as a distant
+ * server would, over HTTP/1.1 or HTTP/2, and produces /chunked/<number>
+ * low latency segments as the client reads them. */
+
+#define SEGMENT_SIZE (4 * adaptive::http::HTTPChunkSource::CHUNK_SIZE + 1234)
+#define SEGMENT_DURATION VLC_TICK_FROM_SEC(2)
+#define SERVER_LATENCY VLC_TICK_FROM_MS(40)
+#define MAX_CONNECTIONS 64
+/* Low latency segments are sent as produced, as chunked transfers */
+#define FRAGMENT_SIZE 1000
+#define FRAGMENT_COUNT 4
+#define FRAGMENT_TIMEOUT VLC_TICK_FROM_SEC(5)
+/* Served with Cache-Control: no-store */
+#define NOSTORE_SEGMENT 9
+
+/* Low latency fragments read by the client, and whether the server timed
+ * out waiting for it */
+extern std::atomic<unsigned> fragments_read;
+extern std::atomic<bool> fragments_late;
+/* Segment requests served, by number */
+extern std::atomic<unsigned> served[NOSTORE_SEGMENT + 1];
+
+struct server;
+
+struct connection
+{
+    struct server *srv;
+    int fd;
+    vlc_thread_t thread;
+};
+
+struct server
+{
+    int fd;
+    unsigned port;
+    vlc_tls_server_t *creds; /* NULL for plain HTTP */
+    bool h2; /* ALPN offers h2 only, otherwise http/1.1 only */
+    vlc_thread_t thread;
+    vlc_mutex_t lock;
+    std::list<struct connection> connections;
+    std::atomic<unsigned> accepted;
+};
+
+uint8_t SegmentByte(unsigned number, size_t offset);
+
+/* Serves over TLS if creds is not NULL, with ALPN offering h2 if h2 is
+ * true, or http/1.1 only */
+void ServerStart(struct server *srv, vlc_tls_server_t *creds, bool h2);
+void ServerStop(struct server *srv);
+
+void CheckSegment(adaptive::http::HTTPChunkBufferedSource *source,
+                  unsigned number);
+adaptive::http::HTTPChunkBufferedSource *
+StartSegment(adaptive::http::HTTPConnectionManager *manager,
+             unsigned port, unsigned number);
+/* Reads the segments in order, with up to depth of them downloading, and
+ * returns the time it took */
+vlc_tick_t Fetch(vlc_object_t *obj, unsigned port, unsigned count,
+                 unsigned depth);
+/* Removes a directory and its contents */
+void RemoveDir(const std::string &path);
+
+#endif
@@ -0,0 +1,335 @@
+/*****************************************************************************
+ * hls_lowlatency.cpp: low latency HLS playlists test
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <vlc_common.h>
+#include <vlc_stream.h>
+#include <vlc_threads.h>
+
+#include "../modules/demux/adaptive/SharedResources.hpp"
+#include "../modules/demux/adaptive/playlist/BasePeriod.h"
+#include "../modules/demux/adaptive/playlist/BaseAdaptationSet.h"
+#include "../modules/demux/adaptive/playlist/SegmentList.h"
+#include "../modules/demux/adaptive/logic/BufferingLogic.hpp"
+#include "../modules/demux/hls/playlist/M3U8.hpp"
+#include "../modules/demux/hls/playlist/Parser.hpp"
+#include "../modules/demux/hls/playlist/Representation.hpp"
+#include "../modules/demux/hls/playlist/HLSSegment.hpp"
+
+using namespace adaptive;
+using namespace adaptive::logic;
+using namespace hls::playlist;
+
+const char vlc_module_name[] = "test_hls_lowlatency";
+
+/* Parses a low latency media playlist, then reloads it twice from a local
+ * HTTP server, as a blocking reload then as a delta update. The requests
+ * delivery directives, the partial segments numbering, the preload hint
+ * replacement and the start position are checked. */
+
+static const char media_playlist[] =
+    "#EXTM3U\n"
+    "#EXT-X-VERSION:9\n"
+    "#EXT-X-TARGETDURATION:4\n"
+    "#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES,PART-HOLD-BACK=3.0,CAN-SKIP-UNTIL=24.0\n"
+    "#EXT-X-PART-INF:PART-TARGET=1.0\n"
+    "#EXT-X-MEDIA-SEQUENCE:100\n"
+    "#EXT-X-PROGRAM-DATE-TIME:2021-01-01T00:00:00.000Z\n"
+    "#EXTINF:4.0,\n"
+    "seg100.mp4\n"
+    "#EXTINF:4.0,\n"
+    "seg101.mp4\n"
+    "#EXT-X-PART:DURATION=1.0,URI=\"seg102.0.mp4\",INDEPENDENT=YES\n"
+    "#EXT-X-PART:DURATION=1.0,URI=\"seg102.1.mp4\"\n"
+    "#EXT-X-PART:DURATION=1.0,URI=\"seg102.2.mp4\",INDEPENDENT=YES\n"
+    "#EXT-X-PART:DURATION=1.0,URI=\"seg102.3.mp4\"\n"
+    "#EXTINF:4.0,\n"
+    "seg102.mp4\n"
+    "#EXT-X-PART:DURATION=1.0,URI=\"seg103.0.mp4\",INDEPENDENT=YES\n"
+    "#EXT-X-PART:DURATION=1.0,URI=\"seg103.1.mp4\"\n"
+    "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"seg103.2.mp4\"\n";
+
+static const char *const updates[] = {
+    /* segment 103 completed, with a shorter part than the hint one */
+    "#EXTM3U\n"
+    "#EXT-X-VERSION:9\n"
+    "#EXT-X-TARGETDURATION:4\n"
+    "#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES,PART-HOLD-BACK=3.0,CAN-SKIP-UNTIL=24.0\n"
+    "#EXT-X-PART-INF:PART-TARGET=1.0\n"
+    "#EXT-X-MEDIA-SEQUENCE:101\n"
+    "#EXT-X-PROGRAM-DATE-TIME:2021-01-01T00:00:04.000Z\n"
+    "#EXTINF:4.0,\n"
+    "seg101.mp4\n"
+    "#EXT-X-PART:DURATION=1.0,URI=\"seg102.0.mp4\",INDEPENDENT=YES\n"
+    "#EXT-X-PART:DURATION=1.0,URI=\"seg102.1.mp4\"\n"
+    "#EXT-X-PART:DURATION=1.0,URI=\"seg102.2.mp4\",INDEPENDENT=YES\n"
+    "#EXT-X-PART:DURATION=1.0,URI=\"seg102.3.mp4\"\n"
+    "#EXTINF:4.0,\n"
+    "seg102.mp4\n"
+    "#EXT-X-PART:DURATION=1.0,URI=\"seg103.0.mp4\",INDEPENDENT=YES\n"
+    "#EXT-X-PART:DURATION=1.0,URI=\"seg103.1.mp4\"\n"
+    "#EXT-X-PART:DURATION=0.9,URI=\"seg103.2.mp4\"\n"
+    "#EXT-X-PART:DURATION=1.0,URI=\"seg103.3.mp4\"\n"
+    "#EXTINF:3.9,\n"
+    "seg103.mp4\n"
+    "#EXT-X-PART:DURATION=1.0,URI=\"seg104.0.mp4\",INDEPENDENT=YES\n"
+    "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"seg104.1.mp4\"\n",
+    /* delta update, without the date reference */
+    "#EXTM3U\n"
+    "#EXT-X-VERSION:9\n"
+    "#EXT-X-TARGETDURATION:4\n"
+    "#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES,PART-HOLD-BACK=3.0,CAN-SKIP-UNTIL=24.0\n"
+    "#EXT-X-PART-INF:PART-TARGET=1.0\n"
+    "#EXT-X-MEDIA-SEQUENCE:102\n"
+    "#EXT-X-SKIP:SKIPPED-SEGMENTS=1\n"
+    "#EXT-X-PART:DURATION=1.0,URI=\"seg103.0.mp4\",INDEPENDENT=YES\n"
+    "#EXT-X-PART:DURATION=1.0,URI=\"seg103.1.mp4\"\n"
+    "#EXT-X-PART:DURATION=0.9,URI=\"seg103.2.mp4\"\n"
+    "#EXT-X-PART:DURATION=1.0,URI=\"seg103.3.mp4\"\n"
+    "#EXTINF:3.9,\n"
+    "seg103.mp4\n"
+    "#EXT-X-PART:DURATION=1.0,URI=\"seg104.0.mp4\",INDEPENDENT=YES\n"
+    "#EXT-X-PART:DURATION=1.0,URI=\"seg104.1.mp4\"\n"
+    "#EXT-X-PART:DURATION=1.0,URI=\"seg104.2.mp4\"\n"
+    "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"seg104.3.mp4\"\n",
+};
+
+struct server
+{
+    int fd;
+    unsigned port;
+    vlc_thread_t thread;
+    std::vector<std::string> requests;
+};
+
+static bool SendAll(int fd, const void *buf, size_t len)
+{
+    const char *p = static_cast<const char *>(buf);
+
+    while (len > 0)
+    {
+        ssize_t val = send(fd, p, len, MSG_NOSIGNAL);
+        if (val <= 0)
+            return false;
+        p += val;
+        len -= val;
+    }
+    return true;
+}
+
+/* Answers the requests with the playlist updates, in order */
+static void *Server(void *data)
+{
+    struct server *srv = static_cast<struct server *>(data);
+    char buf[1024];
+
+    for (;;)
+    {
+        int fd = accept(srv->fd, NULL, NULL);
+        if (fd == -1)
+            break;
+
+        std::string request;
+        for (;;)
+        {
+            size_t end = request.find("\r\n\r\n");
+            if (end == std::string::npos)
+            {
+                ssize_t val = recv(fd, buf, sizeof (buf), 0);
+                if (val <= 0)
+                    break;
+                request.append(buf, val);
+                continue;
+            }
+
+            srv->requests.push_back(request.substr(0, request.find("\r\n")));
+            request.erase(0, end + 4);
+
+            size_t count = srv->requests.size();
+            assert(count <= ARRAY_SIZE(updates));
+            const char *body = updates[count - 1];
+            int len = snprintf(buf, sizeof (buf), "HTTP/1.1 200 OK\r\n"
+                               "Content-Type: application/vnd.apple.mpegurl\r\n"
+                               "Content-Length: %zu\r\n\r\n", strlen(body));
+            if (!SendAll(fd, buf, len) || !SendAll(fd, body, strlen(body)))
+                break;
+        }
+        close(fd);
+    }
+    return NULL;
+}
+
+static void ServerStart(struct server *srv)
+{
+    struct sockaddr_in addr;
+    socklen_t addrlen = sizeof (addr);
+
+    memset(&addr, 0, sizeof (addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    srv->fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    assert(srv->fd != -1);
+    assert(bind(srv->fd, (struct sockaddr *)&addr, sizeof (addr)) == 0);
+    assert(listen(srv->fd, 4) == 0);
+    assert(getsockname(srv->fd, (struct sockaddr *)&addr, &addrlen) == 0);
+    srv->port = ntohs(addr.sin_port);
+
+    assert(vlc_clone(&srv->thread, Server, srv,
+                     VLC_THREAD_PRIORITY_LOW) == 0);
+}
+
+static void ServerStop(struct server *srv)
+{
+    shutdown(srv->fd, SHUT_RDWR);
+    vlc_join(srv->thread, NULL);
+    close(srv->fd);
+}
+
+/* Checks the list against the expected URIs, which must be numbered without
+ * gaps, and returns the segments */
+static std::vector<ISegment *> CheckSegments(Representation *rep,
+                                             const char *const *uris,
+                                             size_t count)
+{
+    const std::vector<ISegment *> &list = rep->inheritSegmentList()->getSegments();
+
+    assert(list.size() == count);
+    for (size_t i = 0; i < count; i++)
+    {
+        const std::string url = list[i]->getUrlSegment().toString();
+        assert(url.size() >= strlen(uris[i]));
+        assert(url.compare(url.size() - strlen(uris[i]), std::string::npos,
+                           uris[i]) == 0);
+        assert(list[i]->getSequenceNumber() == list[0]->getSequenceNumber() + i);
+        assert(!list[i]->discontinuity);
+    }
+    return list;
+}
+
+static void test_parse(vlc_object_t *obj, SharedResources *res, unsigned port)
+{
+    const std::string url = "http://127.0.0.1:" + std::to_string(port) +
+                            "/live.m3u8";
+
+    stream_t *s = vlc_stream_MemoryNew(obj, (uint8_t *)media_playlist,
+                                       strlen(media_playlist), true);
+    assert(s != NULL);
+    M3U8Parser parser(res);
+    M3U8 *m3u8 = parser.parse(obj, s, url);
+    vlc_stream_Delete(s);
+    assert(m3u8 != NULL);
+
+    Representation *rep = dynamic_cast<Representation *>(
+        m3u8->getFirstPeriod()->getAdaptationSets().front()->getRepresentations().front());
+    assert(rep != NULL);
+    assert(rep->isLowLatency());
+    assert(m3u8->isLowLatency());
+
+    /* whole segments, then the listed parts, then the hint */
+    static const char *const uris[] = {
+        "seg100.mp4", "seg101.mp4",
+        "seg102.0.mp4", "seg102.1.mp4", "seg102.2.mp4", "seg102.3.mp4",
+        "seg103.0.mp4", "seg103.1.mp4", "seg103.2.mp4",
+    };
+    std::vector<ISegment *> list = CheckSegments(rep, uris, ARRAY_SIZE(uris));
+    static const bool independent[] = {
+        true, true, true, false, true, false, true, false, false,
+    };
+    for (size_t i = 0; i < list.size(); i++)
+        assert(list[i]->independent == independent[i]);
+    const uint64_t first = list[0]->getSequenceNumber();
+
+    /* about 2 seconds from the end, on an independent part */
+    DefaultBufferingLogic buffering;
+    assert(buffering.getStartSegmentNumber(rep) == first + 6);
+
+    /* Blocking reload of the next part, as a delta update as ours is recent */
+    assert(rep->getPlaylistRequestUrl() ==
+           url + "?_HLS_msn=103&_HLS_part=2&_HLS_skip=YES");
+    /* which the server can still answer with a full playlist */
+    assert(parser.appendSegmentsFromPlaylistURI(obj, rep));
+
+    static const char *const uris2[] = {
+        "seg101.mp4",
+        "seg102.0.mp4", "seg102.1.mp4", "seg102.2.mp4", "seg102.3.mp4",
+        "seg103.0.mp4", "seg103.1.mp4", "seg103.2.mp4", "seg103.3.mp4",
+        "seg104.0.mp4", "seg104.1.mp4",
+    };
+    list = CheckSegments(rep, uris2, ARRAY_SIZE(uris2));
+    assert(list[0]->getSequenceNumber() == first + 1);
+    /* the hint duration got updated */
+    assert(list[7]->duration.Get() == 90);
+
+    /* Then an actual delta update */
+    assert(parser.appendSegmentsFromPlaylistURI(obj, rep));
+    static const char *const uris3[] = {
+        "seg103.0.mp4", "seg103.1.mp4", "seg103.2.mp4", "seg103.3.mp4",
+        "seg104.0.mp4", "seg104.1.mp4", "seg104.2.mp4", "seg104.3.mp4",
+    };
+    list = CheckSegments(rep, uris3, ARRAY_SIZE(uris3));
+    assert(list[0]->getSequenceNumber() == first + 6);
+
+    /* the date reference carries on */
+    const HLSSegment *last = dynamic_cast<HLSSegment *>(list[6]);
+    assert(last != NULL);
+    const HLSSegment *start = dynamic_cast<HLSSegment *>(list[0]);
+    assert(last->getUTCTime() - start->getUTCTime() == VLC_TICK_FROM_MS(5900));
+
+    delete m3u8;
+}
+
+int main(void)
+{
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+
+    struct server srv;
+    ServerStart(&srv);
+
+    SharedResources *res = new SharedResources(obj, true);
+    test_parse(obj, res, srv.port);
+    delete res;
+
+    ServerStop(&srv);
+
+    assert(srv.requests.size() == 2);
+    assert(srv.requests[0] ==
+           "GET /live.m3u8?_HLS_msn=103&_HLS_part=2&_HLS_skip=YES HTTP/1.1");
+    assert(srv.requests[1] ==
+           "GET /live.m3u8?_HLS_msn=104&_HLS_part=1&_HLS_skip=YES HTTP/1.1");
+
+    libvlc_release(vlc);
+    return 0;
+}
@@ -0,0 +1,663 @@
+/*****************************************************************************
+ * mkv_index.cpp: Matroska clusters background index test
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <cstdlib>
+#include <limits>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <vlc_common.h>
+#include <vlc_demux.h>
+#include <vlc_es_out.h>
+#include <vlc_interrupt.h>
+#include <vlc_stream.h>
+#include <vlc_url.h>
+
+#include "../modules/demux/mkv/cluster_indexer.hpp"
+
+using mkv::ClusterIndexer;
+
+const char vlc_module_name[] = "test_mkv_index";
+
+/* Writes a synthetic segment without Cues, with one video track, a keyframe
+ * every KEYINT frames, and one audio track. Every fifth cluster has an
+ * unknown size, and every other cluster stores its blocks in BlockGroups.
+ * Block payloads start with the block number.
+ * The clusters are indexed while the test seeks forward, and the index is
+ * checked against the written file. The index is then loaded from the cache,
+ * and stale cache entries are rejected. Finally, the file is demuxed and
+ * seeks go through the index, if the Matroska demuxer is available. */
+
+#define TIMESCALE   1000000 /* millisecond timecodes */
+#define VIDEO_MS    40
+#define AUDIO_MS    20
+#define KEYINT      25
+#define CLUSTER_MS  2000
+#define DURATION_MS (5 * 60 * 1000)
+
+enum
+{
+    ID_EBML        = 0x1A45DFA3,
+    ID_SEGMENT     = 0x18538067,
+    ID_INFO        = 0x1549A966,
+    ID_TRACKS      = 0x1654AE6B,
+    ID_TRACKENTRY  = 0xAE,
+    ID_CLUSTER     = 0x1F43B675,
+    ID_TIMECODE    = 0xE7,
+    ID_SIMPLEBLOCK = 0xA3,
+    ID_BLOCKGROUP  = 0xA0,
+    ID_BLOCK       = 0xA1,
+    ID_REFERENCE   = 0xFB,
+};
+
+struct test_file
+{
+    std::string path;
+    std::string url;
+    uint64_t size;
+    ClusterIndexer::fptr_t start;
+    ClusterIndexer::fptr_t end;
+    ClusterIndexer::clusters_t clusters;
+    ClusterIndexer::keyframes_t keyframes;
+};
+
+typedef std::vector<uint8_t> buffer_t;
+
+static void PutID(buffer_t &b, uint32_t id)
+{
+    unsigned len = id > 0xFFFFFF ? 4 : id > 0xFFFF ? 3 : id > 0xFF ? 2 : 1;
+
+    while (len-- > 0)
+        b.push_back(id >> (8 * len));
+}
+
+/* Begins an element with an 8 bytes size, to be set by End() */
+static size_t Begin(buffer_t &b, uint32_t id)
+{
+    PutID(b, id);
+    b.push_back(0x01);
+    b.insert(b.end(), 7, 0);
+    return b.size();
+}
+
+static void End(buffer_t &b, size_t pos)
+{
+    const uint64_t size = b.size() - pos;
+
+    for (unsigned i = 0; i < 7; i++)
+        b[pos - 1 - i] = size >> (8 * i);
+}
+
+static void PutUInt(buffer_t &b, uint32_t id, uint64_t val)
+{
+    unsigned len = 1;
+
+    while (len < 8 && (val >> (8 * len)) != 0)
+        len++;
+    PutID(b, id);
+    b.push_back(0x80 | len);
+    while (len-- > 0)
+        b.push_back(val >> (8 * len));
+}
+
+static void PutString(buffer_t &b, uint32_t id, const char *str)
+{
+    const size_t len = strlen(str);
+
+    assert(len < 127);
+    PutID(b, id);
+    b.push_back(0x80 | len);
+    b.insert(b.end(), str, str + len);
+}
+
+static void PutFloat(buffer_t &b, uint32_t id, float f)
+{
+    uint32_t val;
+
+    memcpy(&val, &f, sizeof (val));
+    PutID(b, id);
+    b.push_back(0x84);
+    for (unsigned i = 4; i-- > 0;)
+        b.push_back(val >> (8 * i));
+}
+
+static size_t BlockSize(bool video, uint32_t i)
+{
+    return 5 + (i * 7 + (video ? 0 : 3)) % 11;
+}
+
+static void PutBlock(buffer_t &b, uint32_t id, bool video, uint32_t i,
+                     int16_t timecode, uint8_t flags)
+{
+    const size_t pos = Begin(b, id);
+
+    b.push_back(0x80 | (video ? 1 : 2));
+    b.push_back((uint16_t)timecode >> 8);
+    b.push_back((uint16_t)timecode & 0xFF);
+    b.push_back(flags);
+    b.push_back(video ? 'v' : 'a');
+    for (unsigned j = 4; j-- > 0;)
+        b.push_back(i >> (8 * j));
+    b.insert(b.end(), BlockSize(video, i) - 5, 0);
+    End(b, pos);
+}
+
+static void PutHeaders(buffer_t &b)
+{
+    size_t pos = Begin(b, ID_EBML);
+    PutUInt(b, 0x4286, 1); /* EBMLVersion */
+    PutUInt(b, 0x42F7, 1); /* EBMLReadVersion */
+    PutUInt(b, 0x42F2, 4); /* EBMLMaxIDLength */
+    PutUInt(b, 0x42F3, 8); /* EBMLMaxSizeLength */
+    PutString(b, 0x4282, "matroska");
+    PutUInt(b, 0x4287, 4); /* DocTypeVersion */
+    PutUInt(b, 0x4285, 2); /* DocTypeReadVersion */
+    End(b, pos);
+}
+
+static void PutTracks(buffer_t &b)
+{
+    size_t tracks = Begin(b, ID_TRACKS);
+
+    size_t entry = Begin(b, ID_TRACKENTRY);
+    PutUInt(b, 0xD7, 1); /* TrackNumber */
+    PutUInt(b, 0x73C5, 1); /* TrackUID */
+    PutUInt(b, 0x83, 1); /* TrackType: video */
+    PutString(b, 0x86, "V_MPEG2");
+    size_t video = Begin(b, 0xE0);
+    PutUInt(b, 0xB0, 16); /* PixelWidth */
+    PutUInt(b, 0xBA, 16); /* PixelHeight */
+    End(b, video);
+    End(b, entry);
+
+    entry = Begin(b, ID_TRACKENTRY);
+    PutUInt(b, 0xD7, 2);
+    PutUInt(b, 0x73C5, 2);
+    PutUInt(b, 0x83, 2); /* TrackType: audio */
+    PutString(b, 0x86, "A_MPEG/L2");
+    size_t audio = Begin(b, 0xE1);
+    PutFloat(b, 0xB5, 48000.f); /* SamplingFrequency */
+    PutUInt(b, 0x9F, 2); /* Channels */
+    End(b, audio);
+    End(b, entry);
+
+    End(b, tracks);
+}
+
+/* Writes the clusters, and the index expected for them: the first keyframe
+ * of each track in each cluster */
+static void PutClusters(buffer_t &b, test_file &file)
+{
+    uint32_t v = 0, a = 0;
+
+    for (uint32_t c = 0; c * CLUSTER_MS < DURATION_MS; c++)
+    {
+        const uint32_t ms = c * CLUSTER_MS;
+        const bool unknown_size = (c % 5) == 3; /* ends at the next Cluster */
+        const bool groups = (c % 2) == 1;
+        ClusterIndexer::Cluster cluster = { b.size(), VLC_TICK_FROM_MS(ms), 0 };
+        bool keys[2] = { false, false };
+        size_t pos = 0;
+
+        if (unknown_size)
+        {
+            PutID(b, ID_CLUSTER);
+            b.push_back(0xFF);
+        }
+        else
+            pos = Begin(b, ID_CLUSTER);
+        PutUInt(b, ID_TIMECODE, ms);
+
+        for (;;)
+        {
+            const bool video = v * VIDEO_MS <= a * AUDIO_MS;
+            const uint32_t t = video ? v * VIDEO_MS : a * AUDIO_MS;
+
+            if (t >= ms + CLUSTER_MS || t >= DURATION_MS)
+                break;
+
+            const uint32_t i = video ? v++ : a++;
+            const bool key = !video || (i % KEYINT) == 0;
+            ClusterIndexer::fptr_t fpos;
+
+            if (groups)
+            {
+                size_t group = Begin(b, ID_BLOCKGROUP);
+                fpos = b.size();
+                PutBlock(b, ID_BLOCK, video, i, t - ms, 0);
+                if (!key)
+                {
+                    PutID(b, ID_REFERENCE);
+                    b.push_back(0x81);
+                    b.push_back((uint8_t)-VIDEO_MS);
+                }
+                End(b, group);
+            }
+            else
+            {
+                fpos = b.size();
+                PutBlock(b, ID_SIMPLEBLOCK, video, i, t - ms, key ? 0x80 : 0);
+            }
+
+            if (key && !keys[!video])
+            {
+                ClusterIndexer::Keyframe keyframe = {
+                    video ? 1u : 2u, fpos, VLC_TICK_FROM_MS(t),
+                };
+                file.keyframes.push_back(keyframe);
+                keys[!video] = true;
+            }
+        }
+
+        if (!unknown_size)
+            End(b, pos);
+        cluster.size = b.size() - cluster.fpos;
+        file.clusters.push_back(cluster);
+    }
+}
+
+static void WriteFile(test_file &file)
+{
+    buffer_t b;
+
+    PutHeaders(b);
+
+    size_t segment = Begin(b, ID_SEGMENT);
+    size_t info = Begin(b, ID_INFO);
+    PutUInt(b, 0x2AD7B1, TIMESCALE);
+    PutFloat(b, 0x4489, DURATION_MS); /* Duration */
+    PutString(b, 0x4D80, "test"); /* MuxingApp */
+    PutString(b, 0x5741, "test"); /* WritingApp */
+    End(b, info);
+    PutTracks(b);
+
+    file.start = b.size();
+    PutClusters(b, file);
+    End(b, segment);
+    file.end = file.size = b.size();
+
+    FILE *f = fopen(file.path.c_str(), "wb");
+    assert(f != NULL);
+    assert(fwrite(b.data(), 1, b.size(), f) == b.size());
+    assert(fclose(f) == 0);
+}
+
+static void CheckIndex(const test_file &file, bool audio,
+                       const ClusterIndexer::clusters_t &clusters,
+                       const ClusterIndexer::keyframes_t &keyframes)
+{
+    assert(clusters.size() == file.clusters.size());
+    for (size_t i = 0; i < clusters.size(); i++)
+    {
+        assert(clusters[i].fpos == file.clusters[i].fpos);
+        assert(clusters[i].pts == file.clusters[i].pts);
+        assert(clusters[i].size == file.clusters[i].size);
+    }
+
+    size_t count = 0;
+    for (size_t i = 0; i < file.keyframes.size(); i++)
+    {
+        const ClusterIndexer::Keyframe &expected = file.keyframes[i];
+
+        if (!audio && expected.track_id != 1)
+            continue;
+        assert(count < keyframes.size());
+        assert(keyframes[count].track_id == expected.track_id);
+        assert(keyframes[count].fpos == expected.fpos);
+        assert(keyframes[count].pts == expected.pts);
+        count++;
+    }
+    assert(count == keyframes.size());
+}
+
+static const ClusterIndexer::fptr_t complete_end =
+    std::numeric_limits<ClusterIndexer::fptr_t>::max() - 1;
+
+/* Seeks forward as the index grows, as the demuxer would */
+static void TestIndex(demux_t *demux, const test_file &file, bool audio)
+{
+    ClusterIndexer::track_ids_t tracks(1, 1);
+    if (audio)
+        tracks.push_back(2);
+
+    ClusterIndexer indexer(demux, file.url.c_str(), file.size, TIMESCALE,
+                           file.start, file.end, tracks);
+    ClusterIndexer::clusters_t clusters;
+    ClusterIndexer::keyframes_t keyframes;
+    ClusterIndexer::fptr_t end;
+    bool done = false;
+
+    assert(indexer.Start(false));
+    for (vlc_tick_t pts = 0; !done; pts += VLC_TICK_FROM_SEC(7))
+    {
+        done = indexer.Get(pts, clusters, keyframes, &end);
+        if (!done)
+        {
+            /* the index goes past the date */
+            assert(!clusters.empty() && clusters.back().pts > pts);
+            assert(end == clusters.back().fpos + clusters.back().size);
+        }
+    }
+    assert(end == complete_end);
+    CheckIndex(file, audio, clusters, keyframes);
+}
+
+/* A killed thread does not wait for the index, and gets the rest later */
+static void TestInterrupt(demux_t *demux, const test_file &file)
+{
+    ClusterIndexer::track_ids_t tracks(1, 1);
+    tracks.push_back(2);
+
+    ClusterIndexer indexer(demux, file.url.c_str(), file.size, TIMESCALE,
+                           file.start, file.end, tracks);
+    ClusterIndexer::clusters_t clusters;
+    ClusterIndexer::keyframes_t keyframes;
+    ClusterIndexer::fptr_t end;
+
+    vlc_interrupt_t *ctx = vlc_interrupt_create();
+    assert(ctx != NULL);
+    vlc_interrupt_t *old = vlc_interrupt_set(ctx);
+
+    assert(indexer.Start(false));
+    vlc_interrupt_kill(ctx);
+    indexer.Get(std::numeric_limits<vlc_tick_t>::max(), clusters, keyframes,
+                &end);
+
+    vlc_interrupt_set(old);
+    vlc_interrupt_destroy(ctx);
+
+    while (!indexer.Get(std::numeric_limits<vlc_tick_t>::max(), clusters,
+                        keyframes, &end));
+    assert(end == complete_end);
+    CheckIndex(file, true, clusters, keyframes);
+}
+
+static std::string CacheEntry(const char *cachedir)
+{
+    const std::string dir = std::string(cachedir) + "/vlc/mkv";
+    std::string entry;
+    DIR *d = opendir(dir.c_str());
+    struct dirent *ent;
+
+    if (d == NULL)
+        return entry;
+    while ((ent = readdir(d)) != NULL)
+        if (ent->d_name[0] != '.')
+        {
+            assert(entry.empty());
+            entry = dir + "/" + ent->d_name;
+        }
+    closedir(d);
+    return entry;
+}
+
+/* Indexes the file with the cache enabled, and returns whether the whole
+ * index was found. The complete index is stored when the indexer is
+ * destroyed, as its thread is joined. */
+static bool CacheIndex(demux_t *demux, const test_file &file,
+                       uint64_t timescale)
+{
+    ClusterIndexer::track_ids_t tracks(1, 1);
+    tracks.push_back(2);
+
+    ClusterIndexer indexer(demux, file.url.c_str(), file.size, timescale,
+                           file.start, file.end, tracks);
+    ClusterIndexer::clusters_t clusters;
+    ClusterIndexer::keyframes_t keyframes;
+    ClusterIndexer::fptr_t end;
+
+    assert(indexer.Start(true));
+    while (!indexer.Get(std::numeric_limits<vlc_tick_t>::max(), clusters,
+                        keyframes, &end));
+
+    if (end != complete_end)
+    {
+        /* nothing is returned from a rejected entry */
+        assert(clusters.empty() && keyframes.empty());
+        assert(end == file.start);
+        return false;
+    }
+    if (timescale == TIMESCALE)
+        CheckIndex(file, true, clusters, keyframes);
+    return true;
+}
+
+static void TestCache(demux_t *demux, const test_file &file,
+                      const char *cachedir)
+{
+    const std::string moved = file.path + ".moved";
+
+    assert(CacheEntry(cachedir).empty());
+    assert(CacheIndex(demux, file, TIMESCALE));
+    std::string entry = CacheEntry(cachedir);
+    assert(!entry.empty());
+
+    /* Without the file, the index can only come from the cache */
+    assert(rename(file.path.c_str(), moved.c_str()) == 0);
+    assert(CacheIndex(demux, file, TIMESCALE));
+
+    /* The entry of another timescale is stale, and removed */
+    assert(!CacheIndex(demux, file, TIMESCALE / 2));
+    assert(access(entry.c_str(), F_OK) != 0);
+
+    assert(rename(moved.c_str(), file.path.c_str()) == 0);
+    assert(CacheIndex(demux, file, TIMESCALE));
+    entry = CacheEntry(cachedir);
+    assert(!entry.empty());
+
+    /* A truncated entry is rejected as a whole */
+    struct stat st;
+    assert(stat(entry.c_str(), &st) == 0);
+    assert(truncate(entry.c_str(), st.st_size / 2) == 0);
+    assert(rename(file.path.c_str(), moved.c_str()) == 0);
+    assert(!CacheIndex(demux, file, TIMESCALE));
+    assert(access(entry.c_str(), F_OK) != 0);
+    assert(rename(moved.c_str(), file.path.c_str()) == 0);
+}
+
+struct test_es
+{
+    bool       video;
+    uint32_t   next;
+    bool       resync;
+    vlc_tick_t first;
+};
+
+struct test_out
+{
+    es_out_t       out;
+    struct test_es es[2];
+    unsigned       blocks;
+};
+
+static es_out_id_t *EsOutAdd(es_out_t *out, input_source_t *, const es_format_t *fmt)
+{
+    test_out *sys = container_of(out, test_out, out);
+
+    assert(fmt->i_cat == VIDEO_ES || fmt->i_cat == AUDIO_ES);
+    return (es_out_id_t *) &sys->es[fmt->i_cat == VIDEO_ES ? 0 : 1];
+}
+
+static int EsOutSend(es_out_t *out, es_out_id_t *id, block_t *block)
+{
+    test_out *sys = container_of(out, test_out, out);
+    struct test_es *es = (struct test_es *) id;
+
+    assert(block->i_buffer >= 5);
+    assert(block->p_buffer[0] == (es->video ? 'v' : 'a'));
+    const uint32_t i = GetDWBE(&block->p_buffer[1]);
+    assert(block->i_buffer == BlockSize(es->video, i));
+
+    const vlc_tick_t pts = VLC_TICK_0 +
+        VLC_TICK_FROM_MS(i * (es->video ? VIDEO_MS : AUDIO_MS));
+    assert(block->i_pts == pts);
+
+    if (es->resync)
+    {
+        /* First block after a seek */
+        assert(!es->video || (i % KEYINT) == 0);
+        es->resync = false;
+        es->first = pts;
+    }
+    else
+        assert(i == es->next);
+    es->next = i + 1;
+
+    sys->blocks++;
+    block_Release(block);
+    return VLC_SUCCESS;
+}
+
+static void EsOutDel(es_out_t *, es_out_id_t *)
+{
+}
+
+static int EsOutControl(es_out_t *, input_source_t *, int query, va_list args)
+{
+    if (query == ES_OUT_GET_ES_STATE)
+    {
+        (void) va_arg(args, es_out_id_t *);
+        *va_arg(args, bool *) = true;
+        return VLC_SUCCESS;
+    }
+    return VLC_EGENERIC;
+}
+
+/* Only the first keyframe of a cluster is indexed: the blocks restart from
+ * the beginning of the cluster at worst */
+static void Seek(demux_t *demux, test_out &out, vlc_tick_t time)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(out.es); i++)
+        out.es[i].resync = true;
+    assert(demux_Control(demux, DEMUX_SET_TIME, VLC_TICK_0 + time, true)
+           == VLC_SUCCESS);
+
+    out.blocks = 0;
+    while (out.blocks < 200)
+        assert(demux_Demux(demux) == VLC_DEMUXER_SUCCESS);
+
+    for (size_t i = 0; i < ARRAY_SIZE(out.es); i++)
+    {
+        assert(!out.es[i].resync);
+        assert(out.es[i].first <= VLC_TICK_0 + time);
+        assert(out.es[i].first >= VLC_TICK_0 + time
+                                  - VLC_TICK_FROM_MS(CLUSTER_MS));
+    }
+}
+
+static int TestDemux(vlc_object_t *obj, const test_file &file)
+{
+    static const struct es_out_callbacks cbs = {
+        EsOutAdd, EsOutSend, EsOutDel, EsOutControl, NULL, NULL,
+    };
+    test_out out;
+
+    out.out.cbs = &cbs;
+    for (size_t i = 0; i < ARRAY_SIZE(out.es); i++)
+    {
+        out.es[i].video = i == 0;
+        out.es[i].next = 0;
+        out.es[i].resync = false;
+    }
+
+    stream_t *s = vlc_stream_NewURL(obj, file.url.c_str());
+    assert(s != NULL);
+    demux_t *demux = demux_New(obj, "mkv", s, &out.out);
+    if (demux == NULL)
+    {
+        vlc_stream_Delete(s);
+        return 77;
+    }
+
+    /* Likely before the end of the clusters indexing */
+    const vlc_tick_t duration = VLC_TICK_FROM_MS(DURATION_MS);
+    Seek(demux, out, duration * 3 / 4);
+    Seek(demux, out, duration / 4);
+
+    int ret;
+    while ((ret = demux_Demux(demux)) == VLC_DEMUXER_SUCCESS);
+    assert(ret == VLC_DEMUXER_EOF);
+    assert(out.es[0].next == DURATION_MS / VIDEO_MS);
+    assert(out.es[1].next == DURATION_MS / AUDIO_MS);
+
+    /* Inside clusters of unknown size, and of BlockGroups */
+    Seek(demux, out, VLC_TICK_FROM_MS(3 * CLUSTER_MS + 1500));
+    Seek(demux, out, VLC_TICK_FROM_MS(7 * CLUSTER_MS + 700));
+    Seek(demux, out, duration / 2);
+    Seek(demux, out, VLC_TICK_FROM_SEC(1));
+
+    demux_Delete(demux);
+    vlc_stream_Delete(s);
+    return 0;
+}
+
+int main(void)
+{
+    test_init();
+
+    /* Keeps the index cache out of the user directory */
+    char cachedir[] = "/tmp/vlc-test-mkv-XXXXXX";
+    assert(mkdtemp(cachedir) != NULL);
+    setenv("XDG_CACHE_HOME", cachedir, 1);
+
+    char path[] = "/tmp/vlc-mkv-XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd != -1);
+    close(fd);
+
+    test_file file;
+    file.path = path;
+    char *url = vlc_path2uri(path, "file");
+    assert(url != NULL);
+    file.url = url;
+    free(url);
+    WriteFile(file);
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+    demux_t *demux = (demux_t *) vlc_object_create(obj, sizeof (*demux));
+    assert(demux != NULL);
+
+    TestIndex(demux, file, true);
+    TestIndex(demux, file, false);
+    TestInterrupt(demux, file);
+    TestCache(demux, file, cachedir);
+    vlc_object_delete(demux);
+
+    int ret = TestDemux(obj, file);
+    if (ret != 0)
+        fprintf(stderr, "Matroska demuxer not available\n");
+
+    libvlc_release(vlc);
+    unlink(path);
+
+    const std::string mkvdir = std::string(cachedir) + "/vlc/mkv";
+    rmdir(mkvdir.c_str());
+    rmdir((std::string(cachedir) + "/vlc").c_str());
+    rmdir(cachedir);
+    return ret;
+}
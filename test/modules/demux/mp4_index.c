@@ -0,0 +1,304 @@
+/*****************************************************************************
+ * mp4_index.c: MP4 demuxer sample tables test
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_demux.h>
+#include <vlc_es_out.h>
+#include <vlc_stream.h>
+#include <vlc_url.h>
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc/vlc.h>
+
+#include "mp4_movie.h"
+
+/* Writes a synthetic movie, then demuxes it entirely and checks every sample
+ * of both tracks, and checks seeking. The test runs on a movie small enough
+ * for its tables to be loaded at open, on a movie where they are read from
+ * the file during playback, and on fragmented movies without index, seeking
+ * while their fragments are indexed, with one or several runs per track
+ * fragment. */
+
+struct test_es
+{
+    const test_track_t *track;
+    uint32_t next;
+    bool     resync;
+    vlc_tick_t first;
+};
+
+typedef struct
+{
+    es_out_t        out;
+    struct test_es  es[2];
+    unsigned        blocks;
+} test_out_t;
+
+static es_out_id_t *EsOutAdd(es_out_t *out, input_source_t *in,
+                             const es_format_t *fmt)
+{
+    test_out_t *sys = container_of(out, test_out_t, out);
+    VLC_UNUSED(in);
+
+    assert(fmt->i_cat == VIDEO_ES || fmt->i_cat == AUDIO_ES);
+    return (es_out_id_t *) &sys->es[fmt->i_cat == VIDEO_ES ? 0 : 1];
+}
+
+static int EsOutSend(es_out_t *out, es_out_id_t *id, block_t *block)
+{
+    test_out_t *sys = container_of(out, test_out_t, out);
+    struct test_es *es = (struct test_es *) id;
+    const test_track_t *tk = es->track;
+
+    assert(block->i_buffer >= 5);
+    assert(block->p_buffer[0] == (tk->video ? 'v' : 'a'));
+    const uint32_t i = GetDWBE(&block->p_buffer[1]);
+    assert(i < tk->count);
+    assert(block->i_buffer == SampleSize(tk->video, i));
+
+    if (es->resync)
+    {
+        /* First sample after a seek */
+        assert(!tk->video || tk->fragmented || (i % KEYINT) == 0);
+        es->resync = false;
+        es->first = block->i_dts;
+    }
+    else
+        assert(i == es->next);
+    es->next = i + 1;
+
+    vlc_tick_t dts, pts;
+    if (tk->video)
+    {
+        dts = vlc_tick_from_samples(VideoDTS(i), VIDEO_TIMESCALE);
+        pts = dts + vlc_tick_from_samples(VideoOffset(i), VIDEO_TIMESCALE);
+    }
+    else
+        pts = dts = vlc_tick_from_samples((uint64_t) i * AUDIO_FRAME,
+                                          AUDIO_TIMESCALE);
+    assert(llabs(block->i_dts - (VLC_TICK_0 + dts)) <= 1);
+    assert(llabs(block->i_pts - (VLC_TICK_0 + pts)) <= 1);
+
+    sys->blocks++;
+    block_Release(block);
+    return VLC_SUCCESS;
+}
+
+static void EsOutDel(es_out_t *out, es_out_id_t *id)
+{
+    VLC_UNUSED(out);
+    VLC_UNUSED(id);
+}
+
+static int EsOutControl(es_out_t *out, input_source_t *in, int query,
+                        va_list args)
+{
+    VLC_UNUSED(out);
+    VLC_UNUSED(in);
+
+    if (query == ES_OUT_GET_ES_STATE)
+    {
+        (void) va_arg(args, es_out_id_t *);
+        *va_arg(args, bool *) = true;
+        return VLC_SUCCESS;
+    }
+    return VLC_EGENERIC;
+}
+
+static const struct es_out_callbacks es_out_cbs =
+{
+    .add = EsOutAdd,
+    .send = EsOutSend,
+    .del = EsOutDel,
+    .control = EsOutControl,
+};
+
+static demux_t *Open(vlc_object_t *obj, const char *path, test_out_t *out,
+                     stream_t **ps)
+{
+    char *url = vlc_path2uri(path, "file");
+    assert(url != NULL);
+    stream_t *s = vlc_stream_NewURL(obj, url);
+    free(url);
+    assert(s != NULL);
+
+    demux_t *demux = demux_New(obj, "mp4", s, &out->out);
+    if (demux == NULL)
+    {
+        vlc_stream_Delete(s);
+        return NULL;
+    }
+    *ps = s;
+    return demux;
+}
+
+static void Seek(demux_t *demux, test_out_t *out, vlc_tick_t time)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(out->es); i++)
+        out->es[i].resync = true;
+    assert(demux_Control(demux, DEMUX_SET_TIME, VLC_TICK_0 + time, true)
+           == VLC_SUCCESS);
+
+    out->blocks = 0;
+    while (out->blocks < 200)
+        assert(demux_Demux(demux) == VLC_DEMUXER_SUCCESS);
+
+    /* The video restarts from the previous sync sample */
+    const vlc_tick_t keyint = vlc_tick_from_samples(2 * 1001 * KEYINT,
+                                                    VIDEO_TIMESCALE);
+    for (size_t i = 0; i < ARRAY_SIZE(out->es); i++)
+    {
+        assert(!out->es[i].resync);
+        assert(out->es[i].first <= VLC_TICK_0 + time + 1);
+        assert(out->es[i].first >= VLC_TICK_0 + time - keyint);
+    }
+}
+
+static int Test(vlc_object_t *obj, const char *path, vlc_tick_t duration)
+{
+    test_track_t tracks[2];
+    test_out_t out = { .out = { .cbs = &es_out_cbs } };
+    stream_t *s;
+
+    TrackInit(&tracks[0], true, duration);
+    TrackInit(&tracks[1], false, duration);
+    WriteFile(path, tracks);
+
+    for (size_t i = 0; i < ARRAY_SIZE(out.es); i++)
+        out.es[i].track = &tracks[i];
+
+    demux_t *demux = Open(obj, path, &out, &s);
+    if (demux == NULL)
+    {
+        TrackClean(&tracks[0]);
+        TrackClean(&tracks[1]);
+        return 77;
+    }
+
+    int ret;
+    while ((ret = demux_Demux(demux)) == VLC_DEMUXER_SUCCESS);
+    assert(ret == VLC_DEMUXER_EOF);
+    for (size_t i = 0; i < ARRAY_SIZE(out.es); i++)
+        assert(out.es[i].next == tracks[i].count);
+
+    Seek(demux, &out, duration / 2);
+    Seek(demux, &out, duration / 5);
+    Seek(demux, &out, VLC_TICK_FROM_SEC(1));
+    Seek(demux, &out, duration - VLC_TICK_FROM_SEC(20));
+    Seek(demux, &out, duration / 3);
+
+    demux_Delete(demux);
+    vlc_stream_Delete(s);
+    TrackClean(&tracks[0]);
+    TrackClean(&tracks[1]);
+    return 0;
+}
+
+static int TestFragmented(vlc_object_t *obj, const char *path,
+                          vlc_tick_t duration, bool mehd, unsigned runs)
+{
+    test_track_t tracks[2];
+    test_out_t out = { .out = { .cbs = &es_out_cbs } };
+    stream_t *s;
+
+    TrackInit(&tracks[0], true, duration);
+    TrackInit(&tracks[1], false, duration);
+    WriteFragmentedFile(path, tracks, mehd, runs);
+
+    for (size_t i = 0; i < ARRAY_SIZE(out.es); i++)
+        out.es[i].track = &tracks[i];
+
+    demux_t *demux = Open(obj, path, &out, &s);
+    assert(demux != NULL);
+
+    /* Likely before the end of the fragments indexing */
+    Seek(demux, &out, duration * 3 / 4);
+    Seek(demux, &out, duration / 4);
+
+    int ret;
+    while ((ret = demux_Demux(demux)) == VLC_DEMUXER_SUCCESS);
+    assert(ret == VLC_DEMUXER_EOF);
+    for (size_t i = 0; i < ARRAY_SIZE(out.es); i++)
+        assert(out.es[i].next == tracks[i].count);
+
+    vlc_tick_t length;
+    assert(demux_Control(demux, DEMUX_GET_LENGTH, &length) == VLC_SUCCESS);
+    assert(llabs(length - duration) < VLC_TICK_FROM_SEC(1));
+
+    Seek(demux, &out, duration / 2);
+    Seek(demux, &out, VLC_TICK_FROM_SEC(1));
+    /* Within the last run of a fragment */
+    Seek(demux, &out, vlc_tick_from_samples(VideoDTS(101 * KEYINT - 3),
+                                            VIDEO_TIMESCALE));
+
+    demux_Delete(demux);
+    vlc_stream_Delete(s);
+    TrackClean(&tracks[0]);
+    TrackClean(&tracks[1]);
+    return 0;
+}
+
+int main(void)
+{
+    static const char *const argv[] = { "--quiet", NULL };
+    char path[] = "/tmp/vlc-mp4-XXXXXX";
+    int ret = 0;
+
+    setenv("VLC_PLUGIN_PATH", "../modules", 1);
+
+    int fd = mkstemp(path);
+    assert(fd != -1);
+    close(fd);
+
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(argv) - 1, argv);
+    assert(vlc != NULL);
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+
+    /* 2 minutes fit in the sample tables loaded at open, 40 minutes of
+     * video samples do not */
+    ret = Test(obj, path, VLC_TICK_FROM_SEC(120));
+    if (ret == 0)
+    {
+        ret = Test(obj, path, VLC_TICK_FROM_SEC(40 * 60));
+        /* Seeking waits for the duration, or uses the partial index */
+        ret |= TestFragmented(obj, path, VLC_TICK_FROM_SEC(20 * 60), false, 1);
+        ret |= TestFragmented(obj, path, VLC_TICK_FROM_SEC(20 * 60), true, 1);
+        /* Seeking picks the run of the target in each track fragment */
+        ret |= TestFragmented(obj, path, VLC_TICK_FROM_SEC(20 * 60), true, 3);
+    }
+    else
+        fprintf(stderr, "MP4 demuxer not available\n");
+
+    unlink(path);
+    libvlc_release(vlc);
+    return ret;
+}
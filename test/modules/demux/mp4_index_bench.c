@@ -0,0 +1,183 @@
+/*****************************************************************************
+ * mp4_index_bench.c: MP4 demuxer sample tables benchmark
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_demux.h>
+#include <vlc_es_out.h>
+#include <vlc_stream.h>
+#include <vlc_url.h>
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc/vlc.h>
+
+#include "mp4_movie.h"
+
+/* Prints the opening time and memory usage of the MP4 demuxer on long
+ * synthetic movies, see mp4_index.c for the sample tables test. */
+
+static es_out_id_t *EsOutAdd(es_out_t *out, input_source_t *in,
+                             const es_format_t *fmt)
+{
+    VLC_UNUSED(in);
+    VLC_UNUSED(fmt);
+    return (es_out_id_t *) out;
+}
+
+static int EsOutSend(es_out_t *out, es_out_id_t *id, block_t *block)
+{
+    VLC_UNUSED(out);
+    VLC_UNUSED(id);
+    block_Release(block);
+    return VLC_SUCCESS;
+}
+
+static void EsOutDel(es_out_t *out, es_out_id_t *id)
+{
+    VLC_UNUSED(out);
+    VLC_UNUSED(id);
+}
+
+static int EsOutControl(es_out_t *out, input_source_t *in, int query,
+                        va_list args)
+{
+    VLC_UNUSED(out);
+    VLC_UNUSED(in);
+
+    if (query == ES_OUT_GET_ES_STATE)
+    {
+        (void) va_arg(args, es_out_id_t *);
+        *va_arg(args, bool *) = true;
+        return VLC_SUCCESS;
+    }
+    return VLC_EGENERIC;
+}
+
+static const struct es_out_callbacks es_out_cbs =
+{
+    .add = EsOutAdd,
+    .send = EsOutSend,
+    .del = EsOutDel,
+    .control = EsOutControl,
+};
+
+static long PeakRSS(void)
+{
+    struct rusage ru;
+    assert(getrusage(RUSAGE_SELF, &ru) == 0);
+    return ru.ru_maxrss; /* kB */
+}
+
+/* Opens the movie in a child process, so that peak memory usages of
+ * several movies are not mixed. Returns false if the MP4 demuxer is not
+ * available. */
+static bool Bench(const char *path, vlc_tick_t duration)
+{
+    static const char *const argv[] = { "--quiet", NULL };
+    test_track_t tracks[2];
+
+    TrackInit(&tracks[0], true, duration);
+    TrackInit(&tracks[1], false, duration);
+    const size_t moov_size = WriteFile(path, tracks);
+
+    pid_t pid = fork();
+    assert(pid >= 0);
+    if (pid == 0)
+    {
+        es_out_t out = { .cbs = &es_out_cbs };
+
+        libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(argv) - 1, argv);
+        assert(vlc != NULL);
+        vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+
+        char *url = vlc_path2uri(path, "file");
+        assert(url != NULL);
+        stream_t *s = vlc_stream_NewURL(obj, url);
+        free(url);
+        assert(s != NULL);
+
+        const long rss = PeakRSS();
+        const vlc_tick_t start = vlc_tick_now();
+        demux_t *demux = demux_New(obj, "mp4", s, &out);
+        if (demux == NULL)
+            exit(77);
+        const vlc_tick_t elapsed = vlc_tick_now() - start;
+
+        for (unsigned i = 0; i < 1000; i++)
+            assert(demux_Demux(demux) == VLC_DEMUXER_SUCCESS);
+
+        printf("%3u h, %9u samples, %6zu KiB moov: open %8.3f ms, "
+               "peak RSS +%6ld KiB\n",
+               (unsigned) SEC_FROM_VLC_TICK(duration) / 3600,
+               tracks[0].count + tracks[1].count, moov_size / 1024,
+               secf_from_vlc_tick(elapsed) * 1000., PeakRSS() - rss);
+
+        demux_Delete(demux);
+        vlc_stream_Delete(s);
+        libvlc_release(vlc);
+        exit(0);
+    }
+
+    int status;
+    assert(waitpid(pid, &status, 0) == pid);
+    assert(WIFEXITED(status));
+    TrackClean(&tracks[0]);
+    TrackClean(&tracks[1]);
+    if (WEXITSTATUS(status) == 77)
+        return false;
+    assert(WEXITSTATUS(status) == 0);
+    return true;
+}
+
+int main(void)
+{
+    static const unsigned hours[] = { 1, 4, 12, 24 };
+    char path[] = "/tmp/vlc-mp4-XXXXXX";
+    int ret = 0;
+
+    setenv("VLC_PLUGIN_PATH", "../modules", 1);
+
+    int fd = mkstemp(path);
+    assert(fd != -1);
+    close(fd);
+
+    for (size_t i = 0; i < ARRAY_SIZE(hours); i++)
+        if (!Bench(path, VLC_TICK_FROM_SEC(hours[i] * 3600)))
+        {
+            fprintf(stderr, "MP4 demuxer not available\n");
+            ret = 77;
+            break;
+        }
+
+    unlink(path);
+    return ret;
+}
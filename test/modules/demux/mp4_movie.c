@@ -0,0 +1,580 @@
+/*****************************************************************************
+ * mp4_movie.c: synthetic MP4 movies
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+
+#include "mp4_movie.h"
+
+#define AUDIO_CHUNK     10
+
+uint32_t SampleSize(bool video, uint32_t i)
+{
+    return 8 + (i * 7 + (video ? 0 : 5)) % 23;
+}
+
+/* Frames at 30000/1001 fps, with one frame out of 50 lasting twice longer */
+static uint32_t VideoDelta(uint32_t i)
+{
+    return (i % 50) == 49 ? 2002 : 1001;
+}
+
+uint64_t VideoDTS(uint32_t i)
+{
+    return UINT64_C(1001) * (i + i / 50);
+}
+
+uint32_t VideoOffset(uint32_t i)
+{
+    return 1001 * (1 + i % 3);
+}
+
+static uint32_t VideoChunkSamples(uint32_t chunk)
+{
+    return 1 + chunk % 7;
+}
+
+void TrackInit(test_track_t *tk, bool video, vlc_tick_t duration)
+{
+    tk->video = video;
+    tk->fragmented = false;
+    if (video) /* 51 frames durations every 50 frames */
+        tk->count = samples_from_vlc_tick(duration, VIDEO_TIMESCALE) * 50
+                  / (1001 * 51);
+    else
+        tk->count = samples_from_vlc_tick(duration, AUDIO_TIMESCALE) / AUDIO_FRAME;
+
+    tk->chunk_first = malloc((tk->count + 1) * sizeof (*tk->chunk_first));
+    assert(tk->chunk_first != NULL);
+    tk->chunk_count = 0;
+    for (uint32_t i = 0; i < tk->count; tk->chunk_count++)
+    {
+        tk->chunk_first[tk->chunk_count] = i;
+        i += video ? VideoChunkSamples(tk->chunk_count) : AUDIO_CHUNK;
+    }
+    tk->chunk_first[tk->chunk_count] = tk->count;
+    tk->chunk_offset = malloc(tk->chunk_count * sizeof (*tk->chunk_offset));
+    assert(tk->chunk_offset != NULL);
+}
+
+void TrackClean(test_track_t *tk)
+{
+    free(tk->chunk_first);
+    free(tk->chunk_offset);
+}
+
+static uint64_t TrackDuration(const test_track_t *tk)
+{
+    return tk->video ? VideoDTS(tk->count)
+                     : (uint64_t) tk->count * AUDIO_FRAME;
+}
+
+/* Chunks are interleaved in decoding order, returns the track of the next
+ * chunk to write */
+static test_track_t *NextChunk(test_track_t *tracks, uint32_t *chunks)
+{
+    test_track_t *v = &tracks[0], *a = &tracks[1];
+
+    if (chunks[0] == v->chunk_count)
+        return chunks[1] < a->chunk_count ? a : NULL;
+    if (chunks[1] == a->chunk_count)
+        return v;
+
+    uint64_t vt = VideoDTS(v->chunk_first[chunks[0]]) * AUDIO_TIMESCALE;
+    uint64_t at = (uint64_t) a->chunk_first[chunks[1]] * AUDIO_FRAME
+                * VIDEO_TIMESCALE;
+    return vt <= at ? v : a;
+}
+
+typedef struct
+{
+    uint8_t *p;
+    size_t   size;
+    size_t   alloc;
+} buffer_t;
+
+static void Put(buffer_t *b, const void *data, size_t len)
+{
+    if (b->size + len > b->alloc)
+    {
+        b->alloc = (b->size + len) * 2;
+        b->p = realloc(b->p, b->alloc);
+        assert(b->p != NULL);
+    }
+    memcpy(&b->p[b->size], data, len);
+    b->size += len;
+}
+
+static void Put16(buffer_t *b, uint16_t v)
+{
+    uint8_t buf[2];
+    SetWBE(buf, v);
+    Put(b, buf, 2);
+}
+
+static void Put32(buffer_t *b, uint32_t v)
+{
+    uint8_t buf[4];
+    SetDWBE(buf, v);
+    Put(b, buf, 4);
+}
+
+static void PutZero(buffer_t *b, size_t len)
+{
+    static const uint8_t zero[32];
+    assert(len <= sizeof (zero));
+    Put(b, zero, len);
+}
+
+static size_t BoxBegin(buffer_t *b, const char *type)
+{
+    size_t pos = b->size;
+    Put32(b, 0);
+    Put(b, type, 4);
+    return pos;
+}
+
+static size_t FullBoxBegin(buffer_t *b, const char *type, uint32_t flags)
+{
+    size_t pos = BoxBegin(b, type);
+    Put32(b, flags);
+    return pos;
+}
+
+static void BoxEnd(buffer_t *b, size_t pos)
+{
+    SetDWBE(&b->p[pos], b->size - pos);
+}
+
+static void PutMatrix(buffer_t *b)
+{
+    static const uint32_t matrix[9] = {
+        0x00010000, 0, 0, 0, 0x00010000, 0, 0, 0, 0x40000000,
+    };
+    for (size_t i = 0; i < ARRAY_SIZE(matrix); i++)
+        Put32(b, matrix[i]);
+}
+
+static void PutSampleEntry(buffer_t *b, const test_track_t *tk)
+{
+    size_t entry = BoxBegin(b, tk->video ? "jpeg" : "mp4a");
+    PutZero(b, 6);
+    Put16(b, 1); /* data reference index */
+    if (tk->video)
+    {
+        PutZero(b, 16);
+        Put16(b, 320);
+        Put16(b, 240);
+        Put32(b, 0x00480000);
+        Put32(b, 0x00480000);
+        Put32(b, 0);
+        Put16(b, 1); /* frame count */
+        PutZero(b, 32);
+        Put16(b, 24);
+        Put16(b, 0xffff);
+    }
+    else
+    {
+        PutZero(b, 8);
+        Put16(b, 2);
+        Put16(b, 16);
+        PutZero(b, 4);
+        Put32(b, (uint32_t) AUDIO_TIMESCALE << 16);
+    }
+    BoxEnd(b, entry);
+}
+
+static void PutSampleTable(buffer_t *b, const test_track_t *tk, uint32_t base)
+{
+    size_t stbl = BoxBegin(b, "stbl");
+
+    size_t box = FullBoxBegin(b, "stsd", 0);
+    Put32(b, 1);
+    PutSampleEntry(b, tk);
+    BoxEnd(b, box);
+
+    if (tk->fragmented)
+    {
+        /* All samples are in fragments */
+        static const char *const tables[] = { "stts", "stsc", "stco" };
+        for (size_t i = 0; i < ARRAY_SIZE(tables); i++)
+        {
+            box = FullBoxBegin(b, tables[i], 0);
+            Put32(b, 0);
+            BoxEnd(b, box);
+        }
+        box = FullBoxBegin(b, "stsz", 0);
+        Put32(b, 0);
+        Put32(b, 0);
+        BoxEnd(b, box);
+        BoxEnd(b, stbl);
+        return;
+    }
+
+    box = FullBoxBegin(b, "stts", 0);
+    if (tk->video)
+    {
+        size_t count = b->size;
+        uint32_t entries = 0;
+        Put32(b, 0);
+        for (uint32_t i = 0, run; i < tk->count; i += run)
+        {
+            for (run = 1; i + run < tk->count &&
+                 VideoDelta(i + run) == VideoDelta(i); run++);
+            Put32(b, run);
+            Put32(b, VideoDelta(i));
+            entries++;
+        }
+        SetDWBE(&b->p[count], entries);
+    }
+    else
+    {
+        Put32(b, 1);
+        Put32(b, tk->count);
+        Put32(b, AUDIO_FRAME);
+    }
+    BoxEnd(b, box);
+
+    if (tk->video)
+    {
+        box = FullBoxBegin(b, "ctts", 0);
+        Put32(b, tk->count);
+        for (uint32_t i = 0; i < tk->count; i++)
+        {
+            Put32(b, 1);
+            Put32(b, VideoOffset(i));
+        }
+        BoxEnd(b, box);
+
+        box = FullBoxBegin(b, "stss", 0);
+        Put32(b, (tk->count + KEYINT - 1) / KEYINT);
+        for (uint32_t i = 0; i < tk->count; i += KEYINT)
+            Put32(b, i + 1);
+        BoxEnd(b, box);
+    }
+
+    box = FullBoxBegin(b, "stsc", 0);
+    size_t count = b->size;
+    uint32_t entries = 0;
+    Put32(b, 0);
+    for (uint32_t i = 0; i < tk->chunk_count; i++)
+    {
+        uint32_t samples = tk->chunk_first[i + 1] - tk->chunk_first[i];
+        if (i > 0 && samples == tk->chunk_first[i] - tk->chunk_first[i - 1])
+            continue;
+        Put32(b, i + 1);
+        Put32(b, samples);
+        Put32(b, 1);
+        entries++;
+    }
+    SetDWBE(&b->p[count], entries);
+    BoxEnd(b, box);
+
+    box = FullBoxBegin(b, "stsz", 0);
+    Put32(b, 0);
+    Put32(b, tk->count);
+    for (uint32_t i = 0; i < tk->count; i++)
+        Put32(b, SampleSize(tk->video, i));
+    BoxEnd(b, box);
+
+    box = FullBoxBegin(b, "stco", 0);
+    Put32(b, tk->chunk_count);
+    for (uint32_t i = 0; i < tk->chunk_count; i++)
+        Put32(b, base + tk->chunk_offset[i]);
+    BoxEnd(b, box);
+
+    BoxEnd(b, stbl);
+}
+
+static void PutTrack(buffer_t *b, const test_track_t *tk, unsigned id,
+                     uint32_t base)
+{
+    const uint32_t timescale = tk->video ? VIDEO_TIMESCALE : AUDIO_TIMESCALE;
+    const uint64_t duration = tk->fragmented ? 0 : TrackDuration(tk);
+    size_t trak = BoxBegin(b, "trak");
+
+    size_t box = FullBoxBegin(b, "tkhd", 3);
+    PutZero(b, 8);
+    Put32(b, id);
+    Put32(b, 0);
+    Put32(b, duration * 1000 / timescale);
+    PutZero(b, 12);
+    Put16(b, tk->video ? 0 : 0x0100);
+    Put16(b, 0);
+    PutMatrix(b);
+    Put32(b, tk->video ? 320 << 16 : 0);
+    Put32(b, tk->video ? 240 << 16 : 0);
+    BoxEnd(b, box);
+
+    size_t mdia = BoxBegin(b, "mdia");
+    box = FullBoxBegin(b, "mdhd", 0);
+    PutZero(b, 8);
+    Put32(b, timescale);
+    Put32(b, duration);
+    Put16(b, 0x55c4); /* und */
+    Put16(b, 0);
+    BoxEnd(b, box);
+
+    box = FullBoxBegin(b, "hdlr", 0);
+    Put32(b, 0);
+    Put(b, tk->video ? "vide" : "soun", 4);
+    PutZero(b, 13);
+    BoxEnd(b, box);
+
+    size_t minf = BoxBegin(b, "minf");
+    if (tk->video)
+    {
+        box = FullBoxBegin(b, "vmhd", 1);
+        PutZero(b, 8);
+    }
+    else
+    {
+        box = FullBoxBegin(b, "smhd", 0);
+        PutZero(b, 4);
+    }
+    BoxEnd(b, box);
+
+    size_t dinf = BoxBegin(b, "dinf");
+    box = FullBoxBegin(b, "dref", 0);
+    Put32(b, 1);
+    BoxEnd(b, FullBoxBegin(b, "url ", 1));
+    BoxEnd(b, box);
+    BoxEnd(b, dinf);
+
+    PutSampleTable(b, tk, base);
+    BoxEnd(b, minf);
+    BoxEnd(b, mdia);
+    BoxEnd(b, trak);
+}
+
+static void PutMovie(buffer_t *b, const test_track_t *tracks, uint32_t base,
+                     bool mehd)
+{
+    const uint32_t duration = TrackDuration(&tracks[0]) * 1000 / VIDEO_TIMESCALE;
+    size_t moov = BoxBegin(b, "moov");
+
+    size_t box = FullBoxBegin(b, "mvhd", 0);
+    PutZero(b, 8);
+    Put32(b, 1000);
+    Put32(b, tracks[0].fragmented ? 0 : duration);
+    Put32(b, 0x00010000);
+    Put16(b, 0x0100);
+    PutZero(b, 10);
+    PutMatrix(b);
+    PutZero(b, 24);
+    Put32(b, 3);
+    BoxEnd(b, box);
+
+    PutTrack(b, &tracks[0], 1, base);
+    PutTrack(b, &tracks[1], 2, base);
+
+    if (tracks[0].fragmented)
+    {
+        size_t mvex = BoxBegin(b, "mvex");
+        if (mehd)
+        {
+            box = FullBoxBegin(b, "mehd", 0);
+            Put32(b, duration);
+            BoxEnd(b, box);
+        }
+        for (unsigned i = 0; i < 2; i++)
+        {
+            box = FullBoxBegin(b, "trex", 0);
+            Put32(b, i + 1);
+            Put32(b, 1);
+            PutZero(b, 12);
+            BoxEnd(b, box);
+        }
+        BoxEnd(b, mvex);
+    }
+    BoxEnd(b, moov);
+}
+
+static const uint8_t ftyp[] = {
+    0, 0, 0, 24, 'f', 't', 'y', 'p', 'i', 's', 'o', 'm', 0, 0, 2, 0,
+    'i', 's', 'o', 'm', 'm', 'p', '4', '1',
+};
+
+static void WriteSample(FILE *f, const test_track_t *tk, uint32_t i)
+{
+    uint8_t sample[32];
+    const uint32_t size = SampleSize(tk->video, i);
+
+    assert(size <= sizeof (sample));
+    memset(sample, 0x55, size);
+    sample[0] = tk->video ? 'v' : 'a';
+    SetDWBE(&sample[1], i);
+    assert(fwrite(sample, 1, size, f) == size);
+}
+
+size_t WriteFile(const char *path, test_track_t *tracks)
+{
+    uint32_t chunks[2] = { 0, 0 };
+    uint32_t mdat_size = 8;
+    test_track_t *tk;
+
+    while ((tk = NextChunk(tracks, chunks)) != NULL)
+    {
+        uint32_t *chunk = &chunks[tk - tracks];
+        tk->chunk_offset[*chunk] = mdat_size;
+        for (uint32_t i = tk->chunk_first[*chunk];
+             i < tk->chunk_first[*chunk + 1]; i++)
+            mdat_size += SampleSize(tk->video, i);
+        (*chunk)++;
+    }
+
+    /* Chunk offsets do not change the size of the movie box */
+    buffer_t moov = { NULL, 0, 0 };
+    PutMovie(&moov, tracks, 0, false);
+    const size_t moov_size = moov.size;
+    moov.size = 0;
+    PutMovie(&moov, tracks, sizeof (ftyp) + moov_size, false);
+    assert(moov.size == moov_size);
+
+    FILE *f = fopen(path, "wb");
+    assert(f != NULL);
+    assert(fwrite(ftyp, 1, sizeof (ftyp), f) == sizeof (ftyp));
+    assert(fwrite(moov.p, 1, moov.size, f) == moov.size);
+    free(moov.p);
+
+    uint8_t mdat[8] = { 0, 0, 0, 0, 'm', 'd', 'a', 't' };
+    SetDWBE(mdat, mdat_size);
+    assert(fwrite(mdat, 1, 8, f) == 8);
+
+    chunks[0] = chunks[1] = 0;
+    while ((tk = NextChunk(tracks, chunks)) != NULL)
+    {
+        uint32_t *chunk = &chunks[tk - tracks];
+        for (uint32_t i = tk->chunk_first[*chunk];
+             i < tk->chunk_first[*chunk + 1]; i++)
+            WriteSample(f, tk, i);
+        (*chunk)++;
+    }
+    assert(fclose(f) == 0);
+    return moov_size;
+}
+
+void WriteFragmentedFile(const char *path, test_track_t *tracks, bool mehd,
+                         unsigned runs)
+{
+    test_track_t *v = &tracks[0], *a = &tracks[1];
+    buffer_t b = { NULL, 0, 0 };
+
+    assert(runs >= 1 && runs <= MAX_RUNS);
+    v->fragmented = a->fragmented = true;
+    PutMovie(&b, tracks, 0, mehd);
+
+    FILE *f = fopen(path, "wb");
+    assert(f != NULL);
+    assert(fwrite(ftyp, 1, sizeof (ftyp), f) == sizeof (ftyp));
+    assert(fwrite(b.p, 1, b.size, f) == b.size);
+
+    uint32_t first[2] = { 0, 0 };
+    for (uint32_t seq = 1; first[0] < v->count || first[1] < a->count; seq++)
+    {
+        uint32_t last[2];
+        last[0] = __MIN(first[0] + KEYINT, v->count);
+        /* Audio samples starting before the next fragment video */
+        for (last[1] = first[1]; last[1] < a->count && (last[0] == v->count ||
+             (uint64_t) last[1] * AUDIO_FRAME * VIDEO_TIMESCALE <
+             VideoDTS(last[0]) * AUDIO_TIMESCALE); last[1]++);
+
+        size_t offsets[2][MAX_RUNS];
+        uint32_t data_size = 0;
+
+        b.size = 0;
+        size_t moof = BoxBegin(&b, "moof");
+        size_t box = FullBoxBegin(&b, "mfhd", 0);
+        Put32(&b, seq);
+        BoxEnd(&b, box);
+
+        for (unsigned t = 0; t < 2; t++)
+        {
+            const test_track_t *tk = &tracks[t];
+            size_t traf = BoxBegin(&b, "traf");
+
+            box = FullBoxBegin(&b, "tfhd", 0x020000); /* default base is moof */
+            Put32(&b, t + 1);
+            BoxEnd(&b, box);
+
+            box = FullBoxBegin(&b, "tfdt", 0);
+            Put32(&b, tk->video ? VideoDTS(first[0])
+                                : (uint64_t) first[1] * AUDIO_FRAME);
+            BoxEnd(&b, box);
+
+            /* data offset, durations, sizes, and composition offsets */
+            for (unsigned r = 0; r < runs; r++)
+            {
+                const uint32_t count = last[t] - first[t];
+                const uint32_t start = first[t] + count * r / runs;
+                const uint32_t end = first[t] + count * (r + 1) / runs;
+
+                box = FullBoxBegin(&b, "trun",
+                                   tk->video ? 0x000b01 : 0x000301);
+                Put32(&b, end - start);
+                offsets[t][r] = b.size;
+                Put32(&b, 0);
+                for (uint32_t i = start; i < end; i++)
+                {
+                    Put32(&b, tk->video ? VideoDelta(i) : AUDIO_FRAME);
+                    Put32(&b, SampleSize(tk->video, i));
+                    if (tk->video)
+                        Put32(&b, VideoOffset(i));
+                }
+                BoxEnd(&b, box);
+            }
+            BoxEnd(&b, traf);
+        }
+        BoxEnd(&b, moof);
+
+        for (unsigned t = 0; t < 2; t++)
+            for (unsigned r = 0; r < runs; r++)
+            {
+                const uint32_t count = last[t] - first[t];
+
+                SetDWBE(&b.p[offsets[t][r]], b.size + 8 + data_size);
+                for (uint32_t i = first[t] + count * r / runs;
+                     i < first[t] + count * (r + 1) / runs; i++)
+                    data_size += SampleSize(tracks[t].video, i);
+            }
+        assert(fwrite(b.p, 1, b.size, f) == b.size);
+
+        uint8_t mdat[8] = { 0, 0, 0, 0, 'm', 'd', 'a', 't' };
+        SetDWBE(mdat, 8 + data_size);
+        assert(fwrite(mdat, 1, 8, f) == 8);
+        for (unsigned t = 0; t < 2; t++)
+            for (uint32_t i = first[t]; i < last[t]; i++)
+                WriteSample(f, &tracks[t], i);
+
+        first[0] = last[0];
+        first[1] = last[1];
+    }
+    free(b.p);
+    assert(fclose(f) == 0);
+}
@@ -0,0 +1,60 @@
+/*****************************************************************************
+ * mp4_movie.h: synthetic MP4 movies
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_TEST_MP4_MOVIE_H
+#define VLC_TEST_MP4_MOVIE_H
+
+#include <vlc_common.h>
+
+/* The movie has one video track with composition offsets, a sync sample
+ * every KEYINT frames and varying chunk sizes, and one audio track. Sample
+ * payloads start with the sample number. */
+
+#define VIDEO_TIMESCALE 30000
+#define AUDIO_TIMESCALE 48000
+#define AUDIO_FRAME     1024
+#define KEYINT          30
+#define MAX_RUNS        4
+
+typedef struct
+{
+    bool      video;
+    bool      fragmented; /* one fragment per KEYINT video frames */
+    uint32_t  count;
+    uint32_t  chunk_count;
+    uint32_t *chunk_first; /* first sample of each chunk, and count */
+    uint32_t *chunk_offset;
+} test_track_t;
+
+uint32_t SampleSize(bool video, uint32_t i);
+uint64_t VideoDTS(uint32_t i);
+uint32_t VideoOffset(uint32_t i);
+
+void TrackInit(test_track_t *tk, bool video, vlc_tick_t duration);
+void TrackClean(test_track_t *tk);
+
+/* Writes a movie with its sample tables, returns the size of the movie box */
+size_t WriteFile(const char *path, test_track_t *tracks);
+/* Writes a fragmented movie, without sidx nor mfra index, with the samples
+ * of each track fragment split into runs track runs */
+void WriteFragmentedFile(const char *path, test_track_t *tracks, bool mehd,
+                         unsigned runs);
+
+#endif
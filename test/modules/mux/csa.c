@@ -0,0 +1,156 @@
+/*****************************************************************************
+ * csa.c: CSA batch scrambler test
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TS_NO_CSA_CK_MSG
+#include <vlc_common.h>
+#include "../modules/mux/mpeg/csa.c"
+
+const char vlc_module_name[] = "test_mux_csa";
+
+/* Checks every bitsliced stream cypher against the reference csa_Encrypt,
+ * with packets of any payload size, and that csa_Decrypt gives the clear
+ * packets back. */
+
+#define PACKETS 300
+
+static uint32_t seed = 1;
+
+static uint8_t Rand(void)
+{
+    seed = seed * 1103515245 + 12345;
+    return seed >> 24;
+}
+
+static void NewPackets(uint8_t (*pkts)[188], int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        uint8_t *pkt = pkts[i];
+
+        for (int j = 0; j < 188; j++)
+            pkt[j] = Rand();
+        pkt[0] = 0x47;
+        pkt[3] = 0x10 | (pkt[3] & 0x0f);
+        if (i % 3 == 0)
+        {
+            /* adaptation field, up to a full packet one */
+            pkt[3] |= 0x20;
+            pkt[4] = Rand() % 184;
+        }
+    }
+}
+
+typedef struct
+{
+    const char        *name;
+    csa_stream_batch_t pf_stream;
+    int                i_lanes;
+} kernel_t;
+
+static void Check(const kernel_t *k, csa_t *c, int count, int pkt_size)
+{
+    uint8_t (*clear)[188] = malloc(count * 188);
+    uint8_t (*ref)[188] = malloc(count * 188);
+    uint8_t (*test)[188] = malloc(count * 188);
+    uint8_t **pp = malloc(count * sizeof (*pp));
+    assert(clear != NULL && ref != NULL && test != NULL && pp != NULL);
+
+    NewPackets(clear, count);
+    memcpy(ref, clear, count * 188);
+    memcpy(test, clear, count * 188);
+
+    for (int i = 0; i < count; i++)
+    {
+        csa_Encrypt(c, ref[i], pkt_size);
+        pp[i] = test[i];
+    }
+    csa_EncryptLanes(c, k->pf_stream, k->i_lanes, pp, count, pkt_size);
+
+    for (int i = 0; i < count; i++)
+    {
+        if (memcmp(ref[i], test[i], 188))
+        {
+            fprintf(stderr, "%s: packet %d/%d (size %d) mismatch\n",
+                    k->name, i, count, pkt_size);
+            abort();
+        }
+        csa_Decrypt(c, test[i], pkt_size);
+        assert(memcmp(clear[i], test[i], 188) == 0);
+    }
+
+    free(pp);
+    free(test);
+    free(ref);
+    free(clear);
+}
+
+int main(void)
+{
+    const kernel_t kernels[] = {
+        { "generic", csa_StreamBatch64, 64 },
+#if defined(CAN_COMPILE_SSE2) || defined(HAVE_SSE2_INTRINSICS)
+        { "sse2", csa_StreamBatchSSE2, 128 },
+#endif
+#if defined(CAN_COMPILE_AVX2) || defined(HAVE_AVX2_INTRINSICS)
+        { "avx2", csa_StreamBatchAVX2, 256 },
+#endif
+    };
+    static const int counts[] = { 1, 3, 4, 7, 8, 9, 63, 64, 65, 129, PACKETS };
+    static const int pkt_sizes[] = { 188, 100, 12 };
+
+    csa_t *c = csa_New();
+    assert(c != NULL);
+    assert(csa_SetCW(NULL, c, (char *)"0x0123456789abcdef", true) == 0);
+    assert(csa_SetCW(NULL, c, (char *)"fedcba9876543210", false) == 0);
+
+    for (size_t i = 0; i < ARRAY_SIZE(kernels); i++)
+    {
+        const kernel_t *k = &kernels[i];
+
+        if ((k->i_lanes == 128 && !vlc_CPU_SSE2())
+         || (k->i_lanes == 256 && !vlc_CPU_AVX2()))
+        {
+            printf("%s: not supported by the CPU, skipped\n", k->name);
+            continue;
+        }
+
+        for (int odd = 0; odd < 2; odd++)
+        {
+            assert(csa_UseKey(NULL, c, odd) == 0);
+            for (size_t j = 0; j < ARRAY_SIZE(counts); j++)
+                for (size_t s = 0; s < ARRAY_SIZE(pkt_sizes); s++)
+                    Check(k, c, counts[j], pkt_sizes[s]);
+        }
+        printf("%s: OK\n", k->name);
+    }
+
+    csa_Delete(c);
+    return 0;
+}
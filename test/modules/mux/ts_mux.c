@@ -0,0 +1,147 @@
+/*****************************************************************************
+ * ts_mux.c: TS muxer synthetic MPTS
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_es.h>
+#include <vlc_sout.h>
+
+#include "ts_mux.h"
+
+#define MUX_OPTIONS "tsid=1,netid=1,csa-ck=0123456789abcdef"
+
+typedef struct
+{
+    sout_input_t *input;
+    bool          video;
+    unsigned      frame;
+    vlc_tick_t    dts;
+    uint32_t      seed;
+} test_stream_t;
+
+static block_t *NewFrame(test_stream_t *s)
+{
+    const bool key = s->video && (s->frame % 12) == 0;
+    const size_t size = !s->video ? 576 : key ? 60000 : 15000;
+    const vlc_tick_t length = s->video ? VLC_TICK_FROM_MS(40)
+                                       : VLC_TICK_FROM_MS(24);
+
+    /* Random payload, without paying its generation in the benchmark */
+    static uint8_t pool[2 * 60000];
+    if (pool[0] == 0)
+    {
+        uint32_t seed = 1;
+        for (size_t i = 0; i < sizeof (pool); i++)
+        {
+            seed = seed * 1103515245 + 12345;
+            pool[i] = (seed >> 24) | 1;
+        }
+    }
+    s->seed = s->seed * 1103515245 + 12345;
+
+    block_t *b = block_Alloc(size);
+    assert(b != NULL);
+    memcpy(b->p_buffer, &pool[s->seed % (sizeof (pool) - size)], size);
+    b->i_dts = b->i_pts = s->dts;
+    b->i_length = length;
+    if (s->video)
+        b->i_flags |= key ? BLOCK_FLAG_TYPE_I : BLOCK_FLAG_TYPE_P;
+
+    s->dts += length;
+    s->frame++;
+    return b;
+}
+
+vlc_tick_t Mux(vlc_object_t *obj, const char *path, unsigned threads,
+               unsigned programs, vlc_tick_t duration)
+{
+    sout_access_out_t *access = sout_AccessOutNew(obj, "file", path);
+    assert(access != NULL);
+
+    char *cfg;
+    assert(asprintf(&cfg, "ts{" MUX_OPTIONS ",threads=%u}", threads) >= 0);
+    sout_mux_t *mux = sout_MuxNew(access, cfg);
+    free(cfg);
+    if (mux == NULL)
+    {
+        sout_AccessOutDelete(access);
+        return VLC_TICK_INVALID;
+    }
+
+    const unsigned count = programs * 2;
+    test_stream_t *streams = calloc(count, sizeof (*streams));
+    assert(streams != NULL);
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        test_stream_t *s = &streams[i];
+        es_format_t fmt;
+
+        s->video = (i % 2) == 0;
+        if (s->video)
+        {
+            es_format_Init(&fmt, VIDEO_ES, VLC_CODEC_MP2V);
+            fmt.video.i_width = fmt.video.i_visible_width = 720;
+            fmt.video.i_height = fmt.video.i_visible_height = 576;
+        }
+        else
+        {
+            es_format_Init(&fmt, AUDIO_ES, VLC_CODEC_MPGA);
+            fmt.audio.i_rate = 48000;
+            fmt.audio.i_channels = 2;
+        }
+        fmt.i_id = i + 1;
+
+        s->input = sout_MuxAddStream(mux, &fmt);
+        assert(s->input != NULL);
+        s->dts = VLC_TICK_0 + VLC_TICK_FROM_SEC(1);
+        s->seed = i;
+    }
+
+    const vlc_tick_t end = VLC_TICK_0 + VLC_TICK_FROM_SEC(1) + duration;
+    const vlc_tick_t start = vlc_tick_now();
+
+    /* Feed the frames in decoding order, as the stream output would */
+    for (vlc_tick_t t = VLC_TICK_0 + VLC_TICK_FROM_SEC(1); t < end;
+         t += VLC_TICK_FROM_MS(8))
+        for (unsigned i = 0; i < count; i++)
+            while (streams[i].dts <= t)
+                sout_MuxSendBuffer(mux, streams[i].input,
+                                   NewFrame(&streams[i]));
+
+    const vlc_tick_t elapsed = vlc_tick_now() - start;
+
+    for (unsigned i = 0; i < count; i++)
+        sout_MuxDeleteStream(mux, streams[i].input);
+    sout_MuxDelete(mux);
+    sout_AccessOutDelete(access);
+    free(streams);
+    return elapsed;
+}
@@ -0,0 +1,33 @@
+/*****************************************************************************
+ * ts_mux.h: TS muxer synthetic MPTS
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_TEST_TS_MUX_H
+#define VLC_TEST_TS_MUX_H
+
+#include <vlc_common.h>
+
+/* Muxes duration of a synthetic MPTS of programs programs, each with a video
+ * and an audio stream, with CSA scrambling, on threads packetizing threads
+ * (0 for serial muxing), to a file. Returns the muxing time, or
+ * VLC_TICK_INVALID if the TS muxer is not available. */
+vlc_tick_t Mux(vlc_object_t *obj, const char *path, unsigned threads,
+               unsigned programs, vlc_tick_t duration);
+
+#endif
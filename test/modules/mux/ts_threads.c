@@ -0,0 +1,140 @@
+/*****************************************************************************
+ * ts_threads.c: TS muxer parallel packetization test
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <vlc_common.h>
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc/vlc.h>
+
+#include "ts_mux.h"
+
+/* Runs the TS muxer over a synthetic MPTS, serially then with packetizing
+ * threads and CSA scrambling, and checks that the elementary stream packets
+ * are identical. bench_modules_mux_ts_threads prints the throughput of both
+ * modes. */
+
+#define TS_PID_PAT 0x00
+#define TS_PID_SDT 0x11
+#define TS_PID_PMT 32 /* default sout-ts-pid-pmt */
+
+static uint8_t *Load(const char *path, size_t *size)
+{
+    FILE *f = fopen(path, "rb");
+    assert(f != NULL);
+    assert(fseek(f, 0, SEEK_END) == 0);
+    long len = ftell(f);
+    assert(len >= 0);
+    rewind(f);
+
+    uint8_t *buf = malloc(len ? len : 1);
+    assert(buf != NULL);
+    assert(fread(buf, 1, len, f) == (size_t)len);
+    fclose(f);
+    *size = len;
+    return buf;
+}
+
+static unsigned PID(const uint8_t *pkt)
+{
+    return ((pkt[1] & 0x1f) << 8) | pkt[2];
+}
+
+/* PAT/PMT versions are random per muxer instance, compare the ES packets */
+static void Compare(const char *serial_path, const char *threaded_path)
+{
+    size_t serial_size, threaded_size;
+    uint8_t *serial = Load(serial_path, &serial_size);
+    uint8_t *threaded = Load(threaded_path, &threaded_size);
+    size_t es_packets = 0;
+
+    assert(serial_size > 0);
+    assert(serial_size == threaded_size);
+    assert(serial_size % 188 == 0);
+
+    for (size_t i = 0; i < serial_size; i += 188)
+    {
+        const uint8_t *a = &serial[i], *b = &threaded[i];
+        unsigned pid = PID(a);
+
+        assert(a[0] == 0x47 && b[0] == 0x47);
+        assert(pid == PID(b));
+        if (pid == TS_PID_PAT || pid == TS_PID_PMT || pid == TS_PID_SDT)
+            continue;
+        assert(memcmp(a, b, 188) == 0);
+        es_packets++;
+    }
+    assert(es_packets > 0);
+
+    free(serial);
+    free(threaded);
+}
+
+int main(void)
+{
+    const unsigned programs = 3;
+    const unsigned threads = 2;
+    const vlc_tick_t duration = VLC_TICK_FROM_SEC(2);
+    static const char *const argv[] = { "--quiet", NULL };
+    char serial_path[] = "/tmp/vlc-ts-serial-XXXXXX";
+    char threaded_path[] = "/tmp/vlc-ts-threaded-XXXXXX";
+    int fd;
+
+    setenv("VLC_PLUGIN_PATH", "../modules", 1);
+
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(argv) - 1, argv);
+    assert(vlc != NULL);
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+
+    fd = mkstemp(serial_path);
+    assert(fd != -1);
+    close(fd);
+    fd = mkstemp(threaded_path);
+    assert(fd != -1);
+    close(fd);
+
+    if (Mux(obj, serial_path, 0, programs, duration) == VLC_TICK_INVALID)
+    {
+        fprintf(stderr, "TS muxer not available\n");
+        unlink(serial_path);
+        unlink(threaded_path);
+        libvlc_release(vlc);
+        return 77;
+    }
+    assert(Mux(obj, threaded_path, threads, programs, duration)
+           != VLC_TICK_INVALID);
+
+    Compare(serial_path, threaded_path);
+
+    unlink(serial_path);
+    unlink(threaded_path);
+    libvlc_release(vlc);
+    return 0;
+}
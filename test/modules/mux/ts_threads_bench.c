@@ -0,0 +1,82 @@
+/*****************************************************************************
+ * ts_threads_bench.c: TS muxer parallel packetization benchmark
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <vlc_common.h>
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc/vlc.h>
+
+#include "ts_mux.h"
+
+/* Prints the muxing throughput of a large synthetic MPTS with CSA
+ * scrambling, serially then with packetizing threads. See ts_threads.c for
+ * the test. */
+
+#define PROGRAMS 16
+#define THREADS 4
+#define DURATION VLC_TICK_FROM_SEC(20)
+
+int main(void)
+{
+    static const char *const argv[] = { "--quiet", NULL };
+    char path[] = "/tmp/vlc-ts-bench-XXXXXX";
+
+    setenv("VLC_PLUGIN_PATH", "../modules", 1);
+
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(argv) - 1, argv);
+    assert(vlc != NULL);
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+
+    int fd = mkstemp(path);
+    assert(fd != -1);
+    close(fd);
+
+    vlc_tick_t serial = Mux(obj, path, 0, PROGRAMS, DURATION);
+    if (serial == VLC_TICK_INVALID)
+    {
+        fprintf(stderr, "TS muxer not available\n");
+        unlink(path);
+        libvlc_release(vlc);
+        return 77;
+    }
+    vlc_tick_t threaded = Mux(obj, path, THREADS, PROGRAMS, DURATION);
+    assert(threaded != VLC_TICK_INVALID);
+
+    const double secs = secf_from_vlc_tick(DURATION);
+    printf("%u programs, %.0f s of stream:\n", PROGRAMS, secs);
+    printf(" serial:    %8.3f s, %6.1fx realtime\n",
+           secf_from_vlc_tick(serial), secs / secf_from_vlc_tick(serial));
+    printf(" %u threads: %8.3f s, %6.1fx realtime\n", THREADS,
+           secf_from_vlc_tick(threaded), secs / secf_from_vlc_tick(threaded));
+
+    unlink(path);
+    libvlc_release(vlc);
+    return 0;
+}
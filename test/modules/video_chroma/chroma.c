@@ -0,0 +1,198 @@
+/*****************************************************************************
+ * chroma.c: video converters test
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_es.h>
+#include <vlc_picture.h>
+#include <vlc_filter.h>
+#include <vlc_modules.h>
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc/vlc.h>
+
+#include "converter.h"
+
+/* Runs every video converter module on the same synthetic pictures, and
+ * checks that the SIMD variants of a converter give the same output as the
+ * variant they are derived from.
+ *
+ * It then scales a picture with swscale on one thread and in bands on the
+ * filter threads, and checks that the outputs match. */
+
+/* Converters which must give the same output as another one */
+static const struct
+{
+    const char *module;
+    const char *reference;
+} references[] = {
+    { "i420_rgb_avx2", "i420_rgb_sse2" },
+    { "i420_yuy2_avx2", "i420_yuy2" },
+    { "i420_yuy2_sse2", "i420_yuy2" },
+    { "i420_yuy2_mmx", "i420_yuy2" },
+};
+
+typedef struct
+{
+    bool     valid;
+    uint64_t hash;
+} output_t;
+
+static uint64_t Hash(const picture_t *pic)
+{
+    uint64_t hash = UINT64_C(14695981039346656037);
+
+    for (int i = 0; i < pic->i_planes; i++)
+    {
+        const plane_t *p = &pic->p[i];
+
+        for (int y = 0; y < p->i_visible_lines; y++)
+            for (int x = 0; x < p->i_visible_pitch; x++)
+                hash = (hash ^ p->p_pixels[y * p->i_pitch + x])
+                     * UINT64_C(1099511628211);
+    }
+    return hash;
+}
+
+/* Returns false if the converter does not handle the conversion */
+static bool Convert(vlc_object_t *obj, const char *module,
+                    picture_t *src, const conversion_t *conv,
+                    unsigned count, output_t *out)
+{
+    filter_t *filter = CreateConversion(obj, module, src, conv);
+
+    out->valid = false;
+    if (filter == NULL)
+        return false;
+
+    picture_t *pic = Run(filter, src, count);
+
+    out->hash = Hash(pic);
+    out->valid = true;
+    picture_Release(pic);
+
+    DeleteConverter(filter);
+    return true;
+}
+
+static ssize_t FindModule(module_t *const *modules, size_t count,
+                          const char *name)
+{
+    for (size_t i = 0; i < count; i++)
+        if (strcmp(module_get_object(modules[i]), name) == 0)
+            return i;
+    return -1;
+}
+
+int main(void)
+{
+    const unsigned width = 1002, height = 564;
+    const unsigned count = 2;
+    static const char *const argv[] = { "--quiet", NULL };
+
+    setenv("VLC_PLUGIN_PATH", "../modules", 1);
+
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(argv) - 1, argv);
+    assert(vlc != NULL);
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+
+    size_t n;
+    module_t **modules = ListConverters(&n);
+
+    picture_t **frames = malloc(conversions_count * sizeof (*frames));
+    assert(frames != NULL);
+    for (size_t c = 0; c < conversions_count; c++)
+        frames[c] = NewFrame(conversions[c].in, width, height);
+
+    output_t *outputs = calloc(n * conversions_count, sizeof (*outputs));
+    assert(outputs != NULL);
+    unsigned converted = 0;
+
+    for (size_t m = 0; m < n; m++)
+    {
+        const char *name = module_get_object(modules[m]);
+
+        for (size_t c = 0; c < conversions_count; c++)
+        {
+            output_t *out = &outputs[m * conversions_count + c];
+            if (Convert(obj, name, frames[c], &conversions[c], count, out))
+                converted++;
+        }
+    }
+
+    for (size_t r = 0; r < ARRAY_SIZE(references); r++)
+    {
+        ssize_t m = FindModule(modules, n, references[r].module);
+        ssize_t ref = FindModule(modules, n, references[r].reference);
+        if (m < 0 || ref < 0)
+            continue;
+
+        for (size_t c = 0; c < conversions_count; c++)
+        {
+            const output_t *a = &outputs[m * conversions_count + c];
+            const output_t *b = &outputs[ref * conversions_count + c];
+
+            if (!a->valid || !b->valid)
+                continue;
+            if (a->hash != b->hash)
+                fprintf(stderr, "%s: %s differs from %s\n",
+                        conversions[c].name, references[r].module,
+                        references[r].reference);
+            assert(a->hash == b->hash);
+        }
+    }
+
+    free(outputs);
+    for (size_t c = 0; c < conversions_count; c++)
+        picture_Release(frames[c]);
+    free(frames);
+    module_list_free(modules);
+
+    /* The bands are scaled with margins, only the rounding may differ */
+    picture_t *src = NewFrame(VLC_CODEC_I420, 3840, 2160);
+    picture_t *scaled[2];
+    vlc_tick_t elapsed[2];
+    if (ScaleBands(obj, src, 1920, 1080, count, scaled, elapsed))
+    {
+        assert(MaxDifference(scaled[0], scaled[1]) <= 2);
+        picture_Release(scaled[1]);
+        picture_Release(scaled[0]);
+        converted++;
+    }
+    picture_Release(src);
+
+    libvlc_release(vlc);
+
+    if (converted == 0)
+    {
+        fprintf(stderr, "no video converter available\n");
+        return 77;
+    }
+    return 0;
+}
@@ -0,0 +1,213 @@
+/*****************************************************************************
+ * converter.c: video converters test helpers
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_es.h>
+#include <vlc_picture.h>
+#include <vlc_filter.h>
+#include <vlc_modules.h>
+
+#include "converter.h"
+
+const conversion_t conversions[] = {
+    { "I420 to RV32 (ARGB)", VLC_CODEC_I420, VLC_CODEC_RGB32,
+      0x00ff0000, 0x0000ff00, 0x000000ff },
+    { "I420 to RV32 (ABGR)", VLC_CODEC_I420, VLC_CODEC_RGB32,
+      0x000000ff, 0x0000ff00, 0x00ff0000 },
+    { "I420 to RV16", VLC_CODEC_I420, VLC_CODEC_RGB16,
+      0xf800, 0x07e0, 0x001f },
+    { "I420 to YUY2", VLC_CODEC_I420, VLC_CODEC_YUYV, 0, 0, 0 },
+    { "I420 to YVYU", VLC_CODEC_I420, VLC_CODEC_YVYU, 0, 0, 0 },
+    { "I420 to UYVY", VLC_CODEC_I420, VLC_CODEC_UYVY, 0, 0, 0 },
+    { "I420 to NV12", VLC_CODEC_I420, VLC_CODEC_NV12, 0, 0, 0 },
+    { "NV12 to I420", VLC_CODEC_NV12, VLC_CODEC_I420, 0, 0, 0 },
+    { "I422 to YUY2", VLC_CODEC_I422, VLC_CODEC_YUYV, 0, 0, 0 },
+    { "YUY2 to I420", VLC_CODEC_YUYV, VLC_CODEC_I420, 0, 0, 0 },
+};
+const size_t conversions_count = ARRAY_SIZE(conversions);
+
+module_t **ListConverters(size_t *count)
+{
+    size_t total, n = 0;
+    module_t **modules = module_list_get(&total);
+
+    for (size_t i = 0; i < total; i++)
+        if (module_provides(modules[i], "video converter")
+         && strcmp(module_get_object(modules[i]), "chain") != 0)
+            modules[n++] = modules[i];
+
+    *count = n;
+    return modules;
+}
+
+picture_t *NewFrame(vlc_fourcc_t chroma, unsigned width, unsigned height)
+{
+    video_format_t fmt;
+
+    video_format_Init(&fmt, chroma);
+    video_format_Setup(&fmt, chroma, width, height, width, height, 1, 1);
+
+    picture_t *pic = picture_NewFromFormat(&fmt);
+    assert(pic != NULL);
+
+    /* Gradients with some noise, so that every sample matters */
+    for (int i = 0; i < pic->i_planes; i++)
+    {
+        plane_t *p = &pic->p[i];
+
+        for (int y = 0; y < p->i_visible_lines; y++)
+        {
+            uint8_t *line = &p->p_pixels[y * p->i_pitch];
+
+            for (int x = 0; x < p->i_visible_pitch; x++)
+                line[x] = (x + 3 * y + 64 * i + ((x * y * 2654435761u) >> 28))
+                          & 0xff;
+        }
+    }
+    video_format_Clean(&fmt);
+    return pic;
+}
+
+filter_t *CreateConverter(vlc_object_t *obj, const char *module,
+                          const video_format_t *in, const video_format_t *out,
+                          int64_t swscale_threads)
+{
+    filter_t *filter = vlc_object_create(obj, sizeof (*filter));
+    assert(filter != NULL);
+
+    es_format_Init(&filter->fmt_in, VIDEO_ES, in->i_chroma);
+    video_format_Copy(&filter->fmt_in.video, in);
+    es_format_Init(&filter->fmt_out, VIDEO_ES, out->i_chroma);
+    video_format_Copy(&filter->fmt_out.video, out);
+
+    var_Create(filter, "swscale-threads", VLC_VAR_INTEGER);
+    var_SetInteger(filter, "swscale-threads", swscale_threads);
+
+    filter->p_module = module_need(filter, "video converter", module, true);
+    if (filter->p_module == NULL)
+    {
+        es_format_Clean(&filter->fmt_out);
+        es_format_Clean(&filter->fmt_in);
+        vlc_object_delete(filter);
+        return NULL;
+    }
+    return filter;
+}
+
+void DeleteConverter(filter_t *filter)
+{
+    module_unneed(filter, filter->p_module);
+    es_format_Clean(&filter->fmt_out);
+    es_format_Clean(&filter->fmt_in);
+    vlc_object_delete(filter);
+}
+
+filter_t *CreateConversion(vlc_object_t *obj, const char *module,
+                           const picture_t *src, const conversion_t *conv)
+{
+    video_format_t fmt = src->format;
+
+    fmt.i_chroma = conv->out;
+    fmt.i_rmask = conv->rmask;
+    fmt.i_gmask = conv->gmask;
+    fmt.i_bmask = conv->bmask;
+
+    return CreateConverter(obj, module, &src->format, &fmt, 0);
+}
+
+picture_t *Run(filter_t *filter, picture_t *src, unsigned count)
+{
+    picture_t *first = NULL;
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        picture_t *pic = filter->pf_video_filter(filter, picture_Hold(src));
+
+        assert(pic != NULL);
+        if (first == NULL)
+            first = pic;
+        else
+            picture_Release(pic);
+    }
+    return first;
+}
+
+int MaxDifference(const picture_t *a, const picture_t *b)
+{
+    int max = 0;
+
+    for (int i = 0; i < a->i_planes; i++)
+    {
+        const plane_t *pa = &a->p[i], *pb = &b->p[i];
+
+        assert(pa->i_visible_lines == pb->i_visible_lines);
+        assert(pa->i_visible_pitch == pb->i_visible_pitch);
+        for (int y = 0; y < pa->i_visible_lines; y++)
+            for (int x = 0; x < pa->i_visible_pitch; x++)
+            {
+                int diff = abs(pa->p_pixels[y * pa->i_pitch + x]
+                             - pb->p_pixels[y * pb->i_pitch + x]);
+                max = __MAX(max, diff);
+            }
+    }
+    return max;
+}
+
+bool ScaleBands(vlc_object_t *obj, picture_t *src,
+                unsigned width, unsigned height, unsigned count,
+                picture_t *outputs[2], vlc_tick_t elapsed[2])
+{
+    video_format_t fmt;
+
+    video_format_Init(&fmt, VLC_CODEC_I420);
+    video_format_Setup(&fmt, VLC_CODEC_I420, width, height, width, height,
+                       1, 1);
+
+    /* 1 thread, then the default of one band per filter thread */
+    for (int i = 0; i < 2; i++)
+    {
+        filter_t *filter = CreateConverter(obj, "swscale", &src->format,
+                                           &fmt, i == 0 ? 1 : 0);
+        if (filter == NULL)
+        {
+            if (i > 0)
+                picture_Release(outputs[0]);
+            video_format_Clean(&fmt);
+            return false;
+        }
+
+        const vlc_tick_t start = vlc_tick_now();
+        outputs[i] = Run(filter, src, count);
+        elapsed[i] = vlc_tick_now() - start;
+        DeleteConverter(filter);
+    }
+
+    video_format_Clean(&fmt);
+    return true;
+}
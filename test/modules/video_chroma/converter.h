@@ -0,0 +1,71 @@
+/*****************************************************************************
+ * converter.h: video converters test helpers
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_TEST_VIDEO_CONVERTER_H
+#define VLC_TEST_VIDEO_CONVERTER_H
+
+#include <vlc_common.h>
+#include <vlc_picture.h>
+#include <vlc_filter.h>
+#include <vlc_modules.h>
+
+typedef struct
+{
+    const char *name;
+    vlc_fourcc_t in;
+    vlc_fourcc_t out;
+    uint32_t rmask, gmask, bmask;
+} conversion_t;
+
+/* Conversions run on every video converter */
+extern const conversion_t conversions[];
+extern const size_t conversions_count;
+
+/* Returns the video converter modules, but the chain one, which only builds
+ * chains of the other ones. Release the list with module_list_free(). */
+module_t **ListConverters(size_t *count);
+
+/* Allocates a picture of gradients with some noise */
+picture_t *NewFrame(vlc_fourcc_t chroma, unsigned width, unsigned height);
+
+/* Returns NULL if the module does not handle the conversion */
+filter_t *CreateConverter(vlc_object_t *obj, const char *module,
+                          const video_format_t *in, const video_format_t *out,
+                          int64_t swscale_threads);
+void DeleteConverter(filter_t *filter);
+
+/* Returns NULL if the module does not handle the conversion of the picture */
+filter_t *CreateConversion(vlc_object_t *obj, const char *module,
+                           const picture_t *src, const conversion_t *conv);
+
+/* Converts the picture count times, and returns the first output */
+picture_t *Run(filter_t *filter, picture_t *src, unsigned count);
+
+/* Largest difference between the samples of two pictures */
+int MaxDifference(const picture_t *a, const picture_t *b);
+
+/* Scales the picture count times with swscale on the calling thread, then
+ * in bands on the filter threads, and returns the first output and the
+ * scaling time of each way. Returns false if swscale is not available. */
+bool ScaleBands(vlc_object_t *obj, picture_t *src,
+                unsigned width, unsigned height, unsigned count,
+                picture_t *outputs[2], vlc_tick_t elapsed[2]);
+
+#endif
@@ -0,0 +1,98 @@
+/*****************************************************************************
+ * converters_bench.c: video converters benchmark
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <vlc_common.h>
+#include <vlc_picture.h>
+#include <vlc_filter.h>
+#include <vlc_modules.h>
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc/vlc.h>
+
+#include "converter.h"
+
+/* Runs every video converter module on synthetic 4K pictures, and prints
+ * the throughput of each conversion in megapixels per second. See chroma.c
+ * for the test. */
+
+#define WIDTH  3840
+#define HEIGHT 2160
+#define COUNT  50
+
+int main(void)
+{
+    static const char *const argv[] = { "--quiet", NULL };
+    unsigned converted = 0;
+
+    setenv("VLC_PLUGIN_PATH", "../modules", 1);
+
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(argv) - 1, argv);
+    assert(vlc != NULL);
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+
+    size_t n;
+    module_t **modules = ListConverters(&n);
+
+    for (size_t c = 0; c < conversions_count; c++)
+    {
+        picture_t *src = NewFrame(conversions[c].in, WIDTH, HEIGHT);
+
+        for (size_t m = 0; m < n; m++)
+        {
+            const char *name = module_get_object(modules[m]);
+            filter_t *filter = CreateConversion(obj, name, src,
+                                                &conversions[c]);
+            if (filter == NULL)
+                continue;
+
+            const vlc_tick_t start = vlc_tick_now();
+            picture_t *pic = Run(filter, src, COUNT);
+            const vlc_tick_t elapsed = vlc_tick_now() - start;
+
+            picture_Release(pic);
+            DeleteConverter(filter);
+            converted++;
+
+            printf("%-20s %-16s %8.1f Mpix/s\n", conversions[c].name, name,
+                   (double)WIDTH * HEIGHT * COUNT
+                   / secf_from_vlc_tick(elapsed) / 1e6);
+        }
+        picture_Release(src);
+    }
+
+    module_list_free(modules);
+    libvlc_release(vlc);
+
+    if (converted == 0)
+    {
+        fprintf(stderr, "no video converter available\n");
+        return 77;
+    }
+    return 0;
+}
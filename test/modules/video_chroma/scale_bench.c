@@ -0,0 +1,98 @@
+/*****************************************************************************
+ * scale_bench.c: swscale bands benchmark
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <vlc_common.h>
+#include <vlc_picture.h>
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc/vlc.h>
+
+#include "converter.h"
+
+/* Prints the throughput of swscale on one thread and in bands on the filter
+ * threads, over the downscaling of an ABR ladder. See chroma.c for the
+ * test. */
+
+#define COUNT 50
+
+static const struct
+{
+    unsigned in_width, in_height, out_width, out_height;
+} scalings[] = {
+    { 3840, 2160, 1920, 1080 },
+    { 3840, 2160, 1280,  720 },
+    { 1920, 1080, 1280,  720 },
+    { 1920, 1080,  640,  360 },
+};
+
+int main(void)
+{
+    static const char *const argv[] = { "--quiet", NULL };
+    int ret = 0;
+
+    setenv("VLC_PLUGIN_PATH", "../modules", 1);
+
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(argv) - 1, argv);
+    assert(vlc != NULL);
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+
+    for (size_t i = 0; i < ARRAY_SIZE(scalings); i++)
+    {
+        const unsigned in_width = scalings[i].in_width;
+        const unsigned in_height = scalings[i].in_height;
+        picture_t *src = NewFrame(VLC_CODEC_I420, in_width, in_height);
+        picture_t *outputs[2];
+        vlc_tick_t elapsed[2];
+
+        if (!ScaleBands(obj, src, scalings[i].out_width,
+                        scalings[i].out_height, COUNT, outputs, elapsed))
+        {
+            picture_Release(src);
+            fprintf(stderr, "swscale not available\n");
+            ret = 77;
+            break;
+        }
+
+        const double pixels = (double)in_width * in_height * COUNT;
+        printf("swscale %ux%u to %ux%u: %.1f Mpix/s on 1 thread, "
+               "%.1f Mpix/s in bands (max difference %d)\n",
+               in_width, in_height,
+               scalings[i].out_width, scalings[i].out_height,
+               pixels / secf_from_vlc_tick(elapsed[0]) / 1e6,
+               pixels / secf_from_vlc_tick(elapsed[1]) / 1e6,
+               MaxDifference(outputs[0], outputs[1]));
+
+        picture_Release(outputs[1]);
+        picture_Release(outputs[0]);
+        picture_Release(src);
+    }
+
+    libvlc_release(vlc);
+    return ret;
+}
@@ -0,0 +1,109 @@
+/*****************************************************************************
+ * deinterlace.c: deinterlacer slice threading test
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_picture.h>
+
+#include <vlc/vlc.h>
+
+#include "filtering.h"
+
+/* Deinterlaces the same synthetic interlaced pictures on a libvlc instance
+ * without filter threads, then on one with several, and checks that the
+ * outputs are identical. bench_modules_video_filter_deinterlace prints the
+ * frame rate of both ways. */
+
+static const char *const modes[] = {
+    "yadif", "yadif2x", "linear", "bob", "x", "blend",
+};
+
+int main(void)
+{
+    const unsigned count = 6;
+    static const char *const serial_argv[] = {
+        "--quiet", "--filter-threads=1", NULL };
+    static const char *const threaded_argv[] = {
+        "--quiet", "--filter-threads=4", NULL };
+    video_format_t fmt;
+
+    setenv("VLC_PLUGIN_PATH", "../modules", 1);
+
+    libvlc_instance_t *serial = libvlc_new(ARRAY_SIZE(serial_argv) - 1,
+                                           serial_argv);
+    assert(serial != NULL);
+    libvlc_instance_t *threaded = libvlc_new(ARRAY_SIZE(threaded_argv) - 1,
+                                             threaded_argv);
+    assert(threaded != NULL);
+
+    video_format_Init(&fmt, VLC_CODEC_I420);
+    video_format_Setup(&fmt, VLC_CODEC_I420, 720, 576, 720, 576, 1, 1);
+
+    picture_t **frames = malloc(count * sizeof (*frames));
+    assert(frames != NULL);
+    for (unsigned i = 0; i < count; i++)
+        frames[i] = NewFrame(&fmt, i);
+
+    int ret = 0;
+
+    for (size_t m = 0; m < ARRAY_SIZE(modes); m++)
+    {
+        output_t serial_out, threaded_out;
+        char *chain;
+
+        assert(asprintf(&chain, "deinterlace{mode=%s}", modes[m]) >= 0);
+        if (Filter(serial, chain, frames, count, &serial_out)
+                == VLC_TICK_INVALID)
+        {
+            fprintf(stderr, "deinterlace filter not available\n");
+            free(chain);
+            ret = 77;
+            break;
+        }
+        assert(Filter(threaded, chain, frames, count, &threaded_out)
+                != VLC_TICK_INVALID);
+        free(chain);
+
+        assert(serial_out.count > 0);
+        assert(serial_out.count == threaded_out.count);
+        assert(memcmp(serial_out.hashes, threaded_out.hashes,
+                      serial_out.count * sizeof (*serial_out.hashes)) == 0);
+
+        free(serial_out.hashes);
+        free(threaded_out.hashes);
+    }
+
+    for (unsigned i = 0; i < count; i++)
+        picture_Release(frames[i]);
+    free(frames);
+    video_format_Clean(&fmt);
+    libvlc_release(threaded);
+    libvlc_release(serial);
+    return ret;
+}
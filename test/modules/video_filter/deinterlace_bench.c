@@ -0,0 +1,107 @@
+/*****************************************************************************
+ * deinterlace_bench.c: deinterlacer slice threading bench
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <vlc_common.h>
+#include <vlc_picture.h>
+
+#include <vlc/vlc.h>
+
+#include "filtering.h"
+
+/* Prints the frame rate of each deinterlace mode on 1080i pictures, without
+ * filter threads then with four. See deinterlace.c for the test. */
+
+#define COUNT 100
+
+static const char *const modes[] = {
+    "yadif", "yadif2x", "linear", "bob", "x", "blend",
+};
+
+int main(void)
+{
+    static const char *const serial_argv[] = {
+        "--quiet", "--filter-threads=1", NULL };
+    static const char *const threaded_argv[] = {
+        "--quiet", "--filter-threads=4", NULL };
+    video_format_t fmt;
+
+    setenv("VLC_PLUGIN_PATH", "../modules", 1);
+
+    libvlc_instance_t *serial = libvlc_new(ARRAY_SIZE(serial_argv) - 1,
+                                           serial_argv);
+    assert(serial != NULL);
+    libvlc_instance_t *threaded = libvlc_new(ARRAY_SIZE(threaded_argv) - 1,
+                                             threaded_argv);
+    assert(threaded != NULL);
+
+    video_format_Init(&fmt, VLC_CODEC_I420);
+    video_format_Setup(&fmt, VLC_CODEC_I420, 1920, 1080, 1920, 1080, 1, 1);
+
+    picture_t *frames[COUNT];
+    for (unsigned i = 0; i < COUNT; i++)
+        frames[i] = NewFrame(&fmt, i);
+
+    int ret = 0;
+
+    for (size_t m = 0; m < ARRAY_SIZE(modes); m++)
+    {
+        output_t serial_out, threaded_out;
+        char *chain;
+
+        assert(asprintf(&chain, "deinterlace{mode=%s}", modes[m]) >= 0);
+        vlc_tick_t serial_time = Filter(serial, chain, frames, COUNT,
+                                        &serial_out);
+        if (serial_time == VLC_TICK_INVALID)
+        {
+            fprintf(stderr, "deinterlace filter not available\n");
+            free(chain);
+            ret = 77;
+            break;
+        }
+        vlc_tick_t threaded_time = Filter(threaded, chain, frames, COUNT,
+                                          &threaded_out);
+        assert(threaded_time != VLC_TICK_INVALID);
+        free(chain);
+
+        printf("%-8s %ux%u: serial %7.1f fps, 4 threads %7.1f fps\n",
+               modes[m], fmt.i_visible_width, fmt.i_visible_height,
+               serial_out.count / secf_from_vlc_tick(serial_time),
+               threaded_out.count / secf_from_vlc_tick(threaded_time));
+
+        free(serial_out.hashes);
+        free(threaded_out.hashes);
+    }
+
+    for (unsigned i = 0; i < COUNT; i++)
+        picture_Release(frames[i]);
+    video_format_Clean(&fmt);
+    libvlc_release(threaded);
+    libvlc_release(serial);
+    return ret;
+}
@@ -0,0 +1,99 @@
+/*****************************************************************************
+ * deinterlace_kernels.c: deinterlacer SIMD kernels test helpers
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdlib.h>
+
+#include <vlc_common.h>
+/* the external assembly of yadif is not linked in the test */
+#undef HAVE_X86ASM
+#include "../modules/video_filter/deinterlace/merge.c"
+#include "../modules/video_filter/deinterlace/helpers.c"
+#include "../modules/video_filter/deinterlace/algo_x.c"
+#include "../modules/video_filter/deinterlace/algo_yadif.c"
+#include "../modules/video_filter/deinterlace/algo_phosphor.c"
+
+#include "deinterlace_kernels.h"
+
+static bool Always(void)
+{
+    return true;
+}
+
+#ifdef HAVE_AVX2_INTRINSICS
+static bool HasAVX2(void)
+{
+    return vlc_CPU_AVX2();
+}
+#endif
+
+#ifdef HAVE_AVX512_INTRINSICS
+static bool HasAVX512(void)
+{
+    return vlc_CPU_AVX512();
+}
+#endif
+
+const kernel_t kernels[] = {
+    { "generic", Always, Merge8BitGeneric, Merge16BitGeneric,
+      yadif_filter_line_c, yadif_filter_line_c_16bit,
+      XDeintBand8x8C, DarkenField },
+#ifdef HAVE_AVX2_INTRINSICS
+    { "avx2", HasAVX2, Merge8BitAVX2, Merge16BitAVX2,
+      yadif_filter_line_avx2, yadif_filter_line_avx2_16bit,
+      XDeintBand8x8AVX2, DarkenFieldAVX2 },
+#endif
+#ifdef HAVE_AVX512_INTRINSICS
+    { "avx512", HasAVX512, Merge8BitAVX512, Merge16BitAVX512,
+      NULL, NULL, NULL, NULL },
+#endif
+};
+
+const size_t kernels_count = ARRAY_SIZE(kernels);
+
+static uint32_t seed = 1;
+
+uint8_t Rand(void)
+{
+    seed = seed * 1103515245 + 12345;
+    return seed >> 24;
+}
+
+uint8_t *NewLines(unsigned lines, bool stripes)
+{
+    uint8_t *buf = malloc(PITCH * (lines + 2 * MARGIN / 8) + 2 * MARGIN);
+    assert(buf != NULL);
+
+    for (size_t i = 0; i < PITCH * (lines + 2 * MARGIN / 8) + 2 * MARGIN; i++)
+    {
+        unsigned y = i / PITCH, x = i % PITCH;
+
+        if (stripes && (x / 24) % 3 != 0)
+            buf[i] = (y & 1) ? 200u + (Rand() & 15u) : 20u + (x & 63u);
+        else
+            buf[i] = Rand();
+    }
+    return buf;
+}
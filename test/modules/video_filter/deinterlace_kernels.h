@@ -0,0 +1,56 @@
+/*****************************************************************************
+ * deinterlace_kernels.h: deinterlacer SIMD kernels test helpers
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_TEST_DEINTERLACE_KERNELS_H
+#define VLC_TEST_DEINTERLACE_KERNELS_H
+
+#include <vlc_common.h>
+#include <vlc_picture.h>
+
+#define WIDTH  1920
+#define PITCH  (2 * WIDTH + 128)
+#define MARGIN 64
+
+typedef void (*merge_cb)(void *, const void *, const void *, size_t);
+typedef void (*yadif_cb)(uint8_t *, uint8_t *, uint8_t *, uint8_t *,
+                         int, int, int, int, int);
+
+typedef struct
+{
+    const char *name;
+    bool        (*supported)(void);
+    merge_cb    merge8;
+    merge_cb    merge16;
+    yadif_cb    yadif8;
+    yadif_cb    yadif16;
+    void        (*x_band)(uint8_t *, int, uint8_t *, int, int, int);
+    void        (*darken)(picture_t *, int, int, bool);
+} kernel_t;
+
+/* The C reference first, then the SIMD versions built in */
+extern const kernel_t kernels[];
+extern const size_t kernels_count;
+
+uint8_t Rand(void);
+
+/* Lines of noise, or of interlaced stripes that X and yadif detect */
+uint8_t *NewLines(unsigned lines, bool stripes);
+
+#endif
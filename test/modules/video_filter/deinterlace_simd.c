@@ -0,0 +1,185 @@
+/*****************************************************************************
+ * deinterlace_simd.c: deinterlacer SIMD kernels test
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_picture.h>
+
+#include "deinterlace_kernels.h"
+
+/* Checks the AVX2 and AVX-512 kernels of the deinterlacer against the C
+ * reference, with odd widths and misaligned lines.
+ * bench_modules_video_filter_deinterlace_simd prints the throughput of every
+ * kernel. */
+
+static void CheckMerge(const kernel_t *k, const kernel_t *ref)
+{
+    uint8_t *src = NewLines(2, false);
+    uint8_t out[2][2 * WIDTH];
+
+    for (size_t bytes = 1; bytes <= 300; bytes++)
+        for (size_t offset = 0; offset < 4; offset++)
+        {
+            const uint8_t *s1 = &src[MARGIN + offset];
+            const uint8_t *s2 = &src[MARGIN + PITCH + 2 * offset];
+
+            memset(out, 0xAA, sizeof (out));
+            ref->merge8(out[0], s1, s2, bytes);
+            k->merge8(out[1], s1, s2, bytes);
+            assert(memcmp(out[0], out[1], sizeof (out[0])) == 0);
+
+            memset(out, 0xAA, sizeof (out));
+            ref->merge16(out[0], s1, s2, bytes & ~1);
+            k->merge16(out[1], s1, s2, bytes & ~1);
+            assert(memcmp(out[0], out[1], sizeof (out[0])) == 0);
+        }
+    free(src);
+}
+
+static void CheckYadif(const kernel_t *k, const kernel_t *ref)
+{
+    uint8_t *pics[3] = {
+        NewLines(8, true), NewLines(8, false), NewLines(8, true)
+    };
+    uint8_t out[2][2 * WIDTH];
+
+    for (int w = 1; w <= 200; w++)
+        for (int parity = 0; parity < 2; parity++)
+            for (int mode = 0; mode <= 2; mode += 2)
+                for (int bits = 8; bits <= 16; bits += 8)
+                {
+                    const size_t line = MARGIN + 4 * PITCH;
+                    yadif_cb kernel = bits == 8 ? k->yadif8 : k->yadif16;
+                    yadif_cb reference = bits == 8 ? ref->yadif8
+                                                   : ref->yadif16;
+
+                    memset(out, 0xAA, sizeof (out));
+                    reference(out[0], &pics[0][line], &pics[1][line],
+                              &pics[2][line], w, PITCH, -PITCH, parity, mode);
+                    kernel(out[1], &pics[0][line], &pics[1][line],
+                           &pics[2][line], w, PITCH, -PITCH, parity, mode);
+                    assert(memcmp(out[0], out[1], sizeof (out[0])) == 0);
+                }
+
+    for (int i = 0; i < 3; i++)
+        free(pics[i]);
+}
+
+static void CheckX(const kernel_t *k, const kernel_t *ref)
+{
+    for (int stripes = 0; stripes < 2; stripes++)
+    {
+        uint8_t *src = NewLines(10, stripes);
+        uint8_t *out[2] = { malloc(PITCH * 8), malloc(PITCH * 8) };
+        assert(out[0] != NULL && out[1] != NULL);
+
+        for (int w = 8; w <= 400; w++)
+        {
+            memset(out[0], 0xAA, PITCH * 8);
+            memset(out[1], 0xAA, PITCH * 8);
+            ref->x_band(out[0], PITCH, &src[MARGIN], PITCH, w / 8, w % 8);
+            k->x_band(out[1], PITCH, &src[MARGIN], PITCH, w / 8, w % 8);
+            assert(memcmp(out[0], out[1], PITCH * 8) == 0);
+        }
+
+        free(out[0]);
+        free(out[1]);
+        free(src);
+    }
+}
+
+static picture_t *NewPicture(vlc_fourcc_t chroma, unsigned width)
+{
+    video_format_t fmt;
+
+    video_format_Setup(&fmt, chroma, width, 64, width, 64, 1, 1);
+    picture_t *pic = picture_NewFromFormat(&fmt);
+    assert(pic != NULL);
+
+    for (int i = 0; i < pic->i_planes; i++)
+        for (int j = 0; j < pic->p[i].i_pitch * pic->p[i].i_lines; j++)
+            pic->p[i].p_pixels[j] = Rand();
+    return pic;
+}
+
+static void CheckDarken(const kernel_t *k, const kernel_t *ref)
+{
+    static const vlc_fourcc_t chromas[] = { VLC_CODEC_I420, VLC_CODEC_I444 };
+
+    for (size_t c = 0; c < ARRAY_SIZE(chromas); c++)
+        for (unsigned width = 2; width <= 130; width += 2)
+            for (int field = 0; field < 2; field++)
+                for (int strength = 1; strength <= 3; strength++)
+                {
+                    const bool chroma = chromas[c] == VLC_CODEC_I444;
+                    picture_t *a = NewPicture(chromas[c], width);
+                    picture_t *b = picture_NewFromFormat(&a->format);
+                    assert(b != NULL);
+                    picture_Copy(b, a);
+
+                    ref->darken(a, field, strength, chroma);
+                    k->darken(b, field, strength, chroma);
+                    for (int i = 0; i < a->i_planes; i++)
+                        for (int y = 0; y < a->p[i].i_visible_lines; y++)
+                            assert(memcmp(
+                                &a->p[i].p_pixels[y * a->p[i].i_pitch],
+                                &b->p[i].p_pixels[y * b->p[i].i_pitch],
+                                a->p[i].i_visible_pitch) == 0);
+
+                    picture_Release(a);
+                    picture_Release(b);
+                }
+}
+
+int main(void)
+{
+    const kernel_t *ref = &kernels[0];
+
+    for (size_t i = 1; i < kernels_count; i++)
+    {
+        const kernel_t *k = &kernels[i];
+
+        if (!k->supported())
+        {
+            printf("%s: not supported by the CPU, skipped\n", k->name);
+            continue;
+        }
+
+        CheckMerge(k, ref);
+        if (k->yadif8 != NULL)
+            CheckYadif(k, ref);
+        if (k->x_band != NULL)
+            CheckX(k, ref);
+        if (k->darken != NULL)
+            CheckDarken(k, ref);
+        printf("%s: OK\n", k->name);
+    }
+
+    return 0;
+}
@@ -0,0 +1,126 @@
+/*****************************************************************************
+ * deinterlace_simd_bench.c: deinterlacer SIMD kernels bench
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <vlc_common.h>
+#include <vlc_picture.h>
+#include <vlc_tick.h>
+
+#include "deinterlace_kernels.h"
+
+/* Prints the throughput of every deinterlacer kernel supported by the CPU
+ * on 1080p lines. See deinterlace_simd.c for the test. */
+
+static void Bench(const kernel_t *k)
+{
+    enum { LINES = 1080, RUNS = 20 };
+    uint8_t *src = NewLines(LINES + 8, true);
+    uint8_t *prev = NewLines(LINES + 8, false);
+    uint8_t *next = NewLines(LINES + 8, true);
+    uint8_t *dst = malloc(PITCH * (LINES + 8));
+    assert(dst != NULL);
+    const double pixels = (double)WIDTH * LINES * RUNS;
+    vlc_tick_t start;
+
+    printf("%s:\n", k->name);
+
+    start = vlc_tick_now();
+    for (int r = 0; r < RUNS; r++)
+        for (int y = 0; y < LINES; y++)
+            k->merge8(&dst[y * PITCH], &src[y * PITCH + MARGIN],
+                      &src[(y + 1) * PITCH + MARGIN], WIDTH);
+    printf(" merge 8-bit:  %8.1f Mpix/s\n",
+           pixels / 1e6 / secf_from_vlc_tick(vlc_tick_now() - start));
+
+    start = vlc_tick_now();
+    for (int r = 0; r < RUNS; r++)
+        for (int y = 0; y < LINES; y++)
+            k->merge16(&dst[y * PITCH], &src[y * PITCH + MARGIN],
+                       &src[(y + 1) * PITCH + MARGIN], 2 * WIDTH);
+    printf(" merge 16-bit: %8.1f Mpix/s\n",
+           pixels / 1e6 / secf_from_vlc_tick(vlc_tick_now() - start));
+
+    if (k->yadif8 != NULL)
+    {
+        for (int bits = 8; bits <= 16; bits += 8)
+        {
+            yadif_cb kernel = bits == 8 ? k->yadif8 : k->yadif16;
+
+            start = vlc_tick_now();
+            for (int r = 0; r < RUNS; r++)
+                for (int y = 4; y < LINES + 4; y++)
+                    kernel(&dst[y * PITCH], &prev[y * PITCH + MARGIN],
+                           &src[y * PITCH + MARGIN], &next[y * PITCH + MARGIN],
+                           WIDTH, PITCH, -PITCH, y & 1, 0);
+            printf(" yadif %d-bit: %8.1f Mpix/s\n", bits,
+                   pixels / 1e6 / secf_from_vlc_tick(vlc_tick_now() - start));
+        }
+    }
+
+    if (k->x_band != NULL)
+    {
+        start = vlc_tick_now();
+        for (int r = 0; r < RUNS; r++)
+            for (int y = 0; y < LINES; y += 8)
+                k->x_band(&dst[y * PITCH], PITCH, &src[y * PITCH + MARGIN],
+                          PITCH, WIDTH / 8, 0);
+        printf(" X:            %8.1f Mpix/s\n",
+               pixels / 1e6 / secf_from_vlc_tick(vlc_tick_now() - start));
+    }
+
+    if (k->darken != NULL)
+    {
+        video_format_t fmt;
+
+        video_format_Setup(&fmt, VLC_CODEC_I444, WIDTH, LINES, WIDTH, LINES,
+                           1, 1);
+        picture_t *pic = picture_NewFromFormat(&fmt);
+        assert(pic != NULL);
+
+        start = vlc_tick_now();
+        for (int r = 0; r < RUNS; r++)
+            k->darken(pic, r & 1, 2, true);
+        printf(" phosphor:     %8.1f Mpix/s\n",
+               pixels / 1e6 / secf_from_vlc_tick(vlc_tick_now() - start));
+        picture_Release(pic);
+    }
+
+    free(dst);
+    free(next);
+    free(prev);
+    free(src);
+}
+
+int main(void)
+{
+    for (size_t i = 0; i < kernels_count; i++)
+        if (kernels[i].supported())
+            Bench(&kernels[i]);
+
+    return 0;
+}
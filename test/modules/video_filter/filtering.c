@@ -0,0 +1,132 @@
+/*****************************************************************************
+ * filtering.c: video filters test helpers
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdlib.h>
+
+#include <vlc_common.h>
+#include <vlc_es.h>
+#include <vlc_picture.h>
+#include <vlc_filter.h>
+#include "../../../lib/libvlc_internal.h"
+
+#include "filtering.h"
+
+picture_t *NewFrame(const video_format_t *fmt, unsigned frame)
+{
+    picture_t *pic = picture_NewFromFormat(fmt);
+    assert(pic != NULL);
+
+    for (int i = 0; i < pic->i_planes; i++)
+    {
+        plane_t *p = &pic->p[i];
+
+        for (int y = 0; y < p->i_visible_lines; y++)
+        {
+            uint8_t *line = &p->p_pixels[y * p->i_pitch];
+            const unsigned shift = 2 * frame + (y & 1);
+
+            for (int x = 0; x < p->i_visible_pitch; x++)
+                line[x] = ((x + shift) * 7 + (y / 8) * 13 + i * 50) & 0xff;
+        }
+    }
+    pic->date = VLC_TICK_0 + frame * VLC_TICK_FROM_MS(40);
+    pic->b_progressive = false;
+    pic->b_top_field_first = true;
+    pic->i_nb_fields = 2;
+    return pic;
+}
+
+uint64_t Hash(const picture_t *pic)
+{
+    uint64_t hash = UINT64_C(14695981039346656037);
+
+    for (int i = 0; i < pic->i_planes; i++)
+    {
+        const plane_t *p = &pic->p[i];
+
+        for (int y = 0; y < p->i_visible_lines; y++)
+            for (int x = 0; x < p->i_visible_pitch; x++)
+                hash = (hash ^ p->p_pixels[y * p->i_pitch + x])
+                     * UINT64_C(1099511628211);
+    }
+    return hash;
+}
+
+vlc_tick_t Filter(libvlc_instance_t *vlc, const char *chain_str,
+                  picture_t *const *frames, unsigned count, output_t *out)
+{
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+    const video_format_t *fmt = &frames[0]->format;
+    es_format_t es_fmt;
+
+    es_format_Init(&es_fmt, VIDEO_ES, fmt->i_chroma);
+    video_format_Copy(&es_fmt.video, fmt);
+
+    filter_chain_t *chain = filter_chain_NewVideo(obj, false, NULL);
+    assert(chain != NULL);
+    filter_chain_Reset(chain, &es_fmt, NULL, &es_fmt);
+
+    int ret = filter_chain_AppendFromString(chain, chain_str);
+    es_format_Clean(&es_fmt);
+    if (ret <= 0)
+    {
+        filter_chain_Delete(chain);
+        return VLC_TICK_INVALID;
+    }
+
+    out->count = 0;
+    out->hashes = malloc(2 * count * sizeof (*out->hashes));
+    assert(out->hashes != NULL);
+
+    vlc_tick_t elapsed = 0;
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        const vlc_tick_t start = vlc_tick_now();
+        picture_t *pics[2] = { NULL, NULL };
+        unsigned n = 0;
+
+        /* Drain the framerate doubler outputs too */
+        for (picture_t *in = picture_Hold(frames[i]); ; in = NULL)
+        {
+            picture_t *pic = filter_chain_VideoFilter(chain, in);
+            if (pic == NULL)
+                break;
+            assert(n < ARRAY_SIZE(pics));
+            pics[n++] = pic;
+        }
+        elapsed += vlc_tick_now() - start;
+
+        for (unsigned j = 0; j < n; j++)
+        {
+            out->hashes[out->count++] = Hash(pics[j]);
+            picture_Release(pics[j]);
+        }
+    }
+
+    filter_chain_Delete(chain);
+    return elapsed;
+}
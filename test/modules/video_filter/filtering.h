@@ -0,0 +1,48 @@
+/*****************************************************************************
+ * filtering.h: video filters test helpers
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_TEST_VIDEO_FILTERING_H
+#define VLC_TEST_VIDEO_FILTERING_H
+
+#include <vlc_common.h>
+#include <vlc_picture.h>
+
+#include <vlc/vlc.h>
+
+typedef struct
+{
+    unsigned  count;
+    uint64_t *hashes;
+} output_t;
+
+/* Allocates an interlaced picture of the given frame number, each field of
+ * which moves, so that the filters have something to do */
+picture_t *NewFrame(const video_format_t *fmt, unsigned frame);
+
+uint64_t Hash(const picture_t *pic);
+
+/* Filters the pictures through the filter chain described by chain, on the
+ * libvlc instance, and stores the hash of each output picture into out.
+ * Returns the filtering time, or VLC_TICK_INVALID if the chain cannot be
+ * created. Free out->hashes afterwards. */
+vlc_tick_t Filter(libvlc_instance_t *vlc, const char *chain,
+                  picture_t *const *frames, unsigned count, output_t *out);
+
+#endif
@@ -0,0 +1,361 @@
+/*****************************************************************************
+ * slices.c: video filters slice threading test
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_picture.h>
+#include <vlc_filter.h>
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc/vlc.h>
+
+#include "filtering.h"
+/* reference low-pass of the first line */
+#include "../modules/video_filter/hqdn3d.h"
+
+/* Checks that filter_ExecuteSlices() splits lines in aligned slices which
+ * cover every line once, also when called from a slice, then runs the
+ * sliced filters on a libvlc instance without filter threads and on one
+ * with several, and checks that the outputs are identical. The 10-bit
+ * sharpen and the first line of the spatial only hqdn3d are also checked
+ * against reference computations. */
+
+static const char *const filters[] = {
+    "sharpen{sigma=1}",
+    "adjust{contrast=1.5,brightness=1.2,hue=30,saturation=2}",
+    "gaussianblur{sigma=2}",
+    "gradfun",
+    "hqdn3d",
+    "hqdn3d{luma-temp=0,chroma-temp=0}",
+};
+
+struct slices
+{
+    unsigned lines;
+    unsigned align;
+    bool nested;
+    atomic_uint calls;
+    atomic_uint *counts;
+};
+
+static void Slice(filter_t *filter, void *opaque, unsigned first,
+                  unsigned end)
+{
+    struct slices *s = opaque;
+
+    assert(first < end);
+    assert(end <= s->lines);
+    assert(first % s->align == 0);
+    atomic_fetch_add(&s->calls, 1);
+
+    for (unsigned i = first; i < end; i++)
+        atomic_fetch_add(&s->counts[i], 1);
+
+    if (s->nested)
+    {
+        struct slices inner = {
+            .lines = 100, .align = 4, .nested = false,
+        };
+        atomic_uint counts[100];
+
+        for (unsigned i = 0; i < inner.lines; i++)
+            atomic_init(&counts[i], 0);
+        atomic_init(&inner.calls, 0);
+        inner.counts = counts;
+
+        filter_ExecuteSlices(filter, inner.lines, inner.align, Slice, &inner);
+        for (unsigned i = 0; i < inner.lines; i++)
+            assert(atomic_load(&counts[i]) == 1);
+    }
+}
+
+/* Returns the number of slices */
+static unsigned Execute(filter_t *filter, unsigned lines, unsigned align,
+                        bool nested)
+{
+    struct slices s = {
+        .lines = lines, .align = align, .nested = nested,
+    };
+
+    atomic_init(&s.calls, 0);
+    s.counts = malloc((lines + 1) * sizeof (*s.counts));
+    assert(s.counts != NULL);
+    for (unsigned i = 0; i < lines; i++)
+        atomic_init(&s.counts[i], 0);
+
+    filter_ExecuteSlices(filter, lines, align, Slice, &s);
+
+    for (unsigned i = 0; i < lines; i++)
+        assert(atomic_load(&s.counts[i]) == 1);
+    free(s.counts);
+    return atomic_load(&s.calls);
+}
+
+static void CheckSlices(libvlc_instance_t *vlc, bool threaded)
+{
+    static const unsigned lines[] = { 1, 15, 31, 32, 33, 100, 576, 1081 };
+    static const unsigned aligns[] = { 1, 2, 16, 64 };
+    filter_t *filter = vlc_object_create(vlc->p_libvlc_int,
+                                         sizeof (*filter));
+    assert(filter != NULL);
+
+    assert(Execute(filter, 0, 1, false) == 0);
+
+    for (size_t i = 0; i < ARRAY_SIZE(lines); i++)
+        for (size_t j = 0; j < ARRAY_SIZE(aligns); j++)
+        {
+            unsigned slices = Execute(filter, lines[i], aligns[j], false);
+
+            assert(slices >= 1);
+            /* Small ranges are not worth a thread switch */
+            if (!threaded || lines[i] < 32)
+                assert(slices == 1);
+            else if (lines[i] >= 576)
+                assert(slices > 1);
+        }
+
+    /* Slices waiting for their own slices must not deadlock */
+    for (size_t i = 0; i < ARRAY_SIZE(lines); i++)
+        Execute(filter, lines[i], 1, true);
+
+    vlc_object_delete(filter);
+}
+
+/* Samples of the 10-bit formats are stored on 16 bits */
+static void Mask10Bits(picture_t *pic)
+{
+    for (int i = 0; i < pic->i_planes; i++)
+    {
+        plane_t *p = &pic->p[i];
+
+        for (int y = 0; y < p->i_visible_lines; y++)
+        {
+            uint16_t *line = (uint16_t *)&p->p_pixels[y * p->i_pitch];
+
+            for (int x = 0; x < p->i_visible_pitch / 2; x++)
+                line[x] &= 0x3ff;
+        }
+    }
+}
+
+/* Runs a single picture through a filter, and returns the output */
+static picture_t *FilterOne(libvlc_instance_t *vlc, const char *name,
+                            picture_t *src)
+{
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+    es_format_t es_fmt;
+
+    es_format_Init(&es_fmt, VIDEO_ES, src->format.i_chroma);
+    video_format_Copy(&es_fmt.video, &src->format);
+
+    filter_chain_t *chain = filter_chain_NewVideo(obj, false, NULL);
+    assert(chain != NULL);
+    filter_chain_Reset(chain, &es_fmt, NULL, &es_fmt);
+    int ret = filter_chain_AppendFromString(chain, name);
+    es_format_Clean(&es_fmt);
+
+    picture_t *out = NULL;
+    if (ret > 0)
+        out = filter_chain_VideoFilter(chain, picture_Hold(src));
+    filter_chain_Delete(chain);
+    return out;
+}
+
+/* The 10-bit luma lines used to be processed as if each byte was a pixel,
+ * writing past their end */
+static bool CheckSharpen10Bits(libvlc_instance_t *vlc)
+{
+    video_format_t fmt;
+
+    video_format_Init(&fmt, VLC_CODEC_I420_10L);
+    video_format_Setup(&fmt, VLC_CODEC_I420_10L, 720, 576, 720, 576, 1, 1);
+    picture_t *src = NewFrame(&fmt, 0);
+    Mask10Bits(src);
+
+    picture_t *out = FilterOne(vlc, "sharpen{sigma=1}", src);
+    video_format_Clean(&fmt);
+    if (out == NULL)
+    {
+        picture_Release(src);
+        return false;
+    }
+
+    const plane_t *sp = &src->p[0], *op = &out->p[0];
+    const int width = sp->i_visible_pitch / 2;
+
+    for (int y = 0; y < sp->i_visible_lines; y++)
+    {
+        const uint16_t *s = (const uint16_t *)&sp->p_pixels[y * sp->i_pitch];
+        const uint16_t *o = (const uint16_t *)&op->p_pixels[y * op->i_pitch];
+
+        for (int x = 0; x < width; x++)
+        {
+            int expected = s[x];
+
+            if (y > 0 && y < sp->i_visible_lines - 1
+             && x > 0 && x < width - 1)
+            {
+                /* sigma = 1: the clipped high-pass is added as is */
+                int pix = 9 * s[x];
+
+                for (int dy = -1; dy <= 1; dy++)
+                    for (int dx = -1; dx <= 1; dx++)
+                        pix -= s[x + dy * (sp->i_pitch / 2) + dx];
+                pix = VLC_CLIP(pix, -1023, 1023);
+                expected = VLC_CLIP(s[x] + pix, 0, 1023);
+            }
+            assert(o[x] == expected);
+        }
+    }
+
+    picture_Release(out);
+    picture_Release(src);
+    return true;
+}
+
+/* The first line of the spatial only denoiser used to start the horizontal
+ * low-pass over from the first pixel for every pixel */
+static bool CheckHqdn3dFirstLine(libvlc_instance_t *vlc)
+{
+    video_format_t fmt;
+
+    video_format_Init(&fmt, VLC_CODEC_I420);
+    video_format_Setup(&fmt, VLC_CODEC_I420, 720, 576, 720, 576, 1, 1);
+    picture_t *src = NewFrame(&fmt, 0);
+
+    picture_t *out = FilterOne(vlc, "hqdn3d{luma-temp=0,chroma-temp=0}",
+                               src);
+    video_format_Clean(&fmt);
+    if (out == NULL)
+    {
+        picture_Release(src);
+        return false;
+    }
+
+    static int coefs[512 * 16];
+    const uint8_t *s = src->p[0].p_pixels;
+    const uint8_t *o = out->p[0].p_pixels;
+
+    PrecalcCoefs(coefs, PARAM1_DEFAULT);
+
+    unsigned int ant = s[0] << 16;
+    assert(o[0] == s[0]);
+    for (int x = 1; x < src->p[0].i_visible_pitch; x++)
+    {
+        ant = LowPassMul(ant, s[x] << 16, coefs);
+        assert(o[x] == ((ant + 0x10007FFF) >> 16));
+    }
+
+    picture_Release(out);
+    picture_Release(src);
+    return true;
+}
+
+static void CheckFilter(libvlc_instance_t *serial, libvlc_instance_t *threaded,
+                        const char *name, picture_t *const *frames,
+                        unsigned count)
+{
+    output_t serial_out, threaded_out;
+
+    if (Filter(serial, name, frames, count, &serial_out) == VLC_TICK_INVALID)
+    {
+        printf("%s: filter not available, skipped\n", name);
+        return;
+    }
+    assert(Filter(threaded, name, frames, count, &threaded_out)
+            != VLC_TICK_INVALID);
+
+    assert(serial_out.count == count);
+    assert(serial_out.count == threaded_out.count);
+    assert(memcmp(serial_out.hashes, threaded_out.hashes,
+                  serial_out.count * sizeof (*serial_out.hashes)) == 0);
+
+    free(serial_out.hashes);
+    free(threaded_out.hashes);
+    printf("%s: OK\n", name);
+}
+
+int main(void)
+{
+    picture_t *frames[4];
+    const unsigned count = ARRAY_SIZE(frames);
+    static const char *const serial_argv[] = {
+        "--quiet", "--filter-threads=1", NULL };
+    static const char *const threaded_argv[] = {
+        "--quiet", "--filter-threads=4", NULL };
+    video_format_t fmt;
+
+    setenv("VLC_PLUGIN_PATH", "../modules", 1);
+
+    libvlc_instance_t *serial = libvlc_new(ARRAY_SIZE(serial_argv) - 1,
+                                           serial_argv);
+    assert(serial != NULL);
+    libvlc_instance_t *threaded = libvlc_new(ARRAY_SIZE(threaded_argv) - 1,
+                                             threaded_argv);
+    assert(threaded != NULL);
+
+    CheckSlices(serial, false);
+    CheckSlices(threaded, true);
+
+    video_format_Init(&fmt, VLC_CODEC_I420);
+    video_format_Setup(&fmt, VLC_CODEC_I420, 720, 576, 720, 576, 1, 1);
+
+    for (unsigned i = 0; i < count; i++)
+        frames[i] = NewFrame(&fmt, i);
+
+    for (size_t i = 0; i < ARRAY_SIZE(filters); i++)
+        CheckFilter(serial, threaded, filters[i], frames, count);
+
+    for (unsigned i = 0; i < count; i++)
+        picture_Release(frames[i]);
+
+    /* The same 10-bit pictures on both instances */
+    video_format_Clean(&fmt);
+    video_format_Init(&fmt, VLC_CODEC_I420_10L);
+    video_format_Setup(&fmt, VLC_CODEC_I420_10L, 720, 576, 720, 576, 1, 1);
+    for (unsigned i = 0; i < count; i++)
+    {
+        frames[i] = NewFrame(&fmt, i);
+        Mask10Bits(frames[i]);
+    }
+    CheckFilter(serial, threaded, "sharpen{sigma=1}", frames, count);
+    for (unsigned i = 0; i < count; i++)
+        picture_Release(frames[i]);
+    video_format_Clean(&fmt);
+
+    if (CheckSharpen10Bits(serial))
+        assert(CheckSharpen10Bits(threaded));
+    if (CheckHqdn3dFirstLine(serial))
+        assert(CheckHqdn3dFirstLine(threaded));
+
+    libvlc_release(threaded);
+    libvlc_release(serial);
+    return 0;
+}
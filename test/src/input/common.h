@@ -37,6 +37,9 @@ struct vlc_run_args
 
     /* true to test demux controls */
     bool test_demux_controls;
+
+    /* true to report the demux throughput */
+    bool bench;
 };
 
 void vlc_run_args_init(struct vlc_run_args *args);
@@ -303,6 +303,7 @@ static int demux_process_stream(const struct vlc_run_args *args, stream_t *s)
 
     uintmax_t i = 0;
     int val;
+    vlc_tick_t start = vlc_tick_now();
 
     while ((val = demux_Demux(demux)) == VLC_DEMUXER_SUCCESS)
     {
@@ -328,6 +329,17 @@ static int demux_process_stream(const struct vlc_run_args *args, stream_t *s)
         i++;
     }
 
+    if (args->bench)
+    {
+        vlc_tick_t elapsed = vlc_tick_now() - start;
+        double secs = secf_from_vlc_tick(elapsed > 0 ? elapsed : 1);
+        uint64_t bytes = vlc_stream_Tell(s);
+
+        printf("%s: %"PRIu64" bytes in %.3f s (%.2f MiB/s, %.0f 188-byte "
+               "packets/s, %.0f iterations/s)\n", name, bytes, secs,
+               bytes / secs / (1024 * 1024), bytes / 188. / secs, i / secs);
+    }
+
     demux_Delete(demux);
     es_out_Delete(out);
 
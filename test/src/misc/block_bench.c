@@ -0,0 +1,118 @@
+/*****************************************************************************
+ * block_bench.c: block allocators benchmark
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#undef NDEBUG
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+
+/* Prints the block allocation rate of the heap, then of the slab allocator,
+ * with blocks released by the allocating thread or by another thread, as
+ * from a demuxer to a decoder. See src/test/block_test.c for the test. */
+
+#define BENCH_COUNT 1000000
+#define BENCH_BATCH 64
+
+static const size_t bench_sizes[] = { 188, 1316, 4096, 65536 };
+
+static void bench_block_Local (size_t size)
+{
+    block_t *batch[BENCH_BATCH];
+    vlc_tick_t start = vlc_tick_now ();
+
+    for (unsigned i = 0; i < BENCH_COUNT; i += BENCH_BATCH)
+    {
+        for (unsigned j = 0; j < BENCH_BATCH; j++)
+        {
+            batch[j] = block_Alloc (size);
+            assert (batch[j] != NULL);
+        }
+        for (unsigned j = 0; j < BENCH_BATCH; j++)
+            block_Release (batch[j]);
+    }
+
+    vlc_tick_t elapsed = vlc_tick_now () - start;
+    printf ("  %5zu bytes, same thread: %8.2f Mallocs/s\n", size,
+            BENCH_COUNT / (secf_from_vlc_tick (elapsed) * 1e6));
+}
+
+static void *bench_Consumer (void *data)
+{
+    block_fifo_t *fifo = data;
+
+    for (unsigned i = 0; i < BENCH_COUNT; i++)
+        block_Release (block_FifoGet (fifo));
+    return NULL;
+}
+
+static void bench_block_Remote (size_t size)
+{
+    block_fifo_t *fifo = block_FifoNew ();
+    vlc_thread_t th;
+
+    assert (fifo != NULL);
+    assert (!vlc_clone (&th, bench_Consumer, fifo, VLC_THREAD_PRIORITY_LOW));
+
+    vlc_tick_t start = vlc_tick_now ();
+    for (unsigned i = 0; i < BENCH_COUNT; i++)
+    {
+        block_t *block = block_Alloc (size);
+        assert (block != NULL);
+        block_FifoPut (fifo, block);
+    }
+    vlc_join (th, NULL);
+
+    vlc_tick_t elapsed = vlc_tick_now () - start;
+    printf ("  %5zu bytes, other thread: %8.2f Mallocs/s\n", size,
+            BENCH_COUNT / (secf_from_vlc_tick (elapsed) * 1e6));
+    block_FifoRelease (fifo);
+}
+
+static void bench_block (const char *name)
+{
+    printf ("%s:\n", name);
+    for (size_t i = 0; i < ARRAY_SIZE(bench_sizes); i++)
+        bench_block_Local (bench_sizes[i]);
+    for (size_t i = 0; i < ARRAY_SIZE(bench_sizes); i++)
+        bench_block_Remote (bench_sizes[i]);
+}
+
+int main (void)
+{
+    struct vlc_block_slab_stats stats;
+
+    bench_block ("heap");
+
+    block_slab_Enable ();
+    bench_block ("slab");
+    block_slab_GetStats (&stats);
+    printf ("slab: %llu allocs, %llu magazine hits, %llu depot hits, "
+            "%llu heap allocs, %llu frees, %llu depot returns\n",
+            stats.allocs, stats.magazine_hits, stats.depot_hits,
+            stats.heap_allocs, stats.frees, stats.depot_returns);
+    block_slab_Disable ();
+    return 0;
+}
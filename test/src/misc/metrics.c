@@ -0,0 +1,187 @@
+/*****************************************************************************
+ * metrics.c: test for the metrics export
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <vlc_metrics.h>
+
+static const struct vlc_metric test_counter = {
+    "vlc_test_events_total", "Test events", VLC_METRIC_COUNTER,
+};
+
+static const struct vlc_metric test_gauge = {
+    "vlc_test_level", "Test level", VLC_METRIC_GAUGE,
+};
+
+/* The same metric, as described by another component */
+static const struct vlc_metric test_counter_other = {
+    "vlc_test_events_total", "Other test events", VLC_METRIC_COUNTER,
+};
+
+static void ReportA(void *opaque, vlc_metrics_writer_t *writer)
+{
+    const unsigned *count = opaque;
+
+    vlc_metrics_Report(writer, &test_counter, *count);
+    vlc_metrics_Report(writer, &test_gauge, 0.5);
+}
+
+static void ReportB(void *opaque, vlc_metrics_writer_t *writer)
+{
+    (void) opaque;
+    vlc_metrics_Report(writer, &test_counter, 42);
+}
+
+static void ReportC(void *opaque, vlc_metrics_writer_t *writer)
+{
+    (void) opaque;
+    vlc_metrics_Report(writer, &test_counter_other, 3);
+}
+
+static void ReportValue(void *opaque, vlc_metrics_writer_t *writer)
+{
+    const double *value = opaque;
+
+    vlc_metrics_Report(writer, &test_gauge, *value);
+}
+
+static void test_collect(libvlc_int_t *vlc)
+{
+    unsigned count = 7;
+    char *text;
+
+    /* The instance may have sources of its own: only check ours */
+    vlc_metrics_source_t *a = vlc_metrics_Register(vlc, ReportA, &count,
+                                                   "name", "a", NULL);
+    vlc_metrics_source_t *b = vlc_metrics_Register(vlc, ReportB, NULL,
+                                                   "name", "\"b\\\n",
+                                                   "kind", "", NULL);
+    vlc_metrics_source_t *c = vlc_metrics_Register(vlc, ReportB, NULL, NULL);
+    vlc_metrics_source_t *d = vlc_metrics_Register(vlc, ReportC, NULL,
+                                                   "name", "d", NULL);
+    assert(a != NULL && b != NULL && c != NULL && d != NULL);
+
+    text = vlc_metrics_Collect(vlc);
+    assert(text != NULL);
+    test_log("%s", text);
+
+    /* Samples of the same metric are grouped after a single description,
+     * even when reported with another description of the same name */
+    static const char counter[] =
+        "# HELP vlc_test_events_total Test events\n"
+        "# TYPE vlc_test_events_total counter\n"
+        "vlc_test_events_total{name=\"a\"} 7\n"
+        "vlc_test_events_total{name=\"\\\"b\\\\\\n\",kind=\"\"} 42\n"
+        "vlc_test_events_total 42\n"
+        "vlc_test_events_total{name=\"d\"} 3\n";
+    static const char gauge[] =
+        "# HELP vlc_test_level Test level\n"
+        "# TYPE vlc_test_level gauge\n"
+        "vlc_test_level{name=\"a\"} 0.5\n";
+
+    const char *p = strstr(text, counter);
+    assert(p != NULL);
+    assert(strstr(p + 1, "# HELP vlc_test_events_total") == NULL);
+    assert(strstr(text, gauge) != NULL);
+    assert(strstr(text, "Other test events") == NULL);
+    free(text);
+
+    /* Unregistered sources are not reported anymore */
+    count++;
+    vlc_metrics_Unregister(b);
+    vlc_metrics_Unregister(c);
+    vlc_metrics_Unregister(d);
+
+    text = vlc_metrics_Collect(vlc);
+    assert(text != NULL);
+    assert(strstr(text, "vlc_test_events_total{name=\"a\"} 8\n") != NULL);
+    assert(strstr(text, "} 42\n") == NULL);
+    assert(strstr(text, "vlc_test_events_total 42\n") == NULL);
+    assert(strstr(text, "vlc_test_events_total{name=\"d\"}") == NULL);
+    free(text);
+
+    vlc_metrics_Unregister(a);
+    vlc_metrics_Unregister(NULL);
+
+    text = vlc_metrics_Collect(vlc);
+    assert(text != NULL);
+    assert(strstr(text, "vlc_test_") == NULL);
+    free(text);
+}
+
+/* Values are written as the exposition format spells them */
+static void test_values(libvlc_int_t *vlc)
+{
+    static const struct
+    {
+        double value;
+        const char *text;
+    } values[] = {
+        { 0., "vlc_test_level{name=\"0\"} 0\n" },
+        { -12., "vlc_test_level{name=\"1\"} -12\n" },
+        { 0.25, "vlc_test_level{name=\"2\"} 0.25\n" },
+        { 1e20, "vlc_test_level{name=\"3\"} 1e+20\n" },
+        { INFINITY, "vlc_test_level{name=\"4\"} +Inf\n" },
+        { -INFINITY, "vlc_test_level{name=\"5\"} -Inf\n" },
+        { NAN, "vlc_test_level{name=\"6\"} NaN\n" },
+    };
+    vlc_metrics_source_t *sources[ARRAY_SIZE(values)];
+
+    for (size_t i = 0; i < ARRAY_SIZE(values); i++)
+    {
+        char name[2] = { '0' + i, '\0' };
+
+        sources[i] = vlc_metrics_Register(vlc, ReportValue,
+                                          (void *)&values[i].value,
+                                          "name", name, NULL);
+        assert(sources[i] != NULL);
+    }
+
+    char *text = vlc_metrics_Collect(vlc);
+    assert(text != NULL);
+    test_log("%s", text);
+    for (size_t i = 0; i < ARRAY_SIZE(values); i++)
+        assert(strstr(text, values[i].text) != NULL);
+    free(text);
+
+    for (size_t i = 0; i < ARRAY_SIZE(values); i++)
+        vlc_metrics_Unregister(sources[i]);
+}
+
+int main(void)
+{
+    libvlc_instance_t *vlc;
+
+    test_init();
+
+    test_log("Testing the metrics export\n");
+    vlc = libvlc_new(test_defaults_nargs, test_defaults_args);
+    assert(vlc != NULL);
+
+    test_collect(vlc->p_libvlc_int);
+    test_values(vlc->p_libvlc_int);
+
+    libvlc_release(vlc);
+    return 0;
+}
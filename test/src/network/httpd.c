@@ -0,0 +1,100 @@
+/*****************************************************************************
+ * httpd.c: HTTP server load test
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_httpd.h>
+
+#include "httpd_stream.h"
+
+/* Serves a file, then a stream to many clients, alongside idle connections,
+ * see httpd_stream.c for the stream checks. bench_src_network_httpd measures
+ * how many stream clients one core can serve. */
+
+static void test_file(unsigned port)
+{
+    int fd = Connect(port, "GET /file HTTP/1.0\r\n\r\n");
+    char buf[4096];
+    size_t len = 0;
+
+    for (;;) {
+        struct pollfd ufd = { .fd = fd, .events = POLLIN };
+        poll(&ufd, 1, -1);
+
+        ssize_t val = read(fd, buf + len, sizeof (buf) - 1 - len);
+        if (val == 0)
+            break;
+        if (val < 0) {
+            assert(errno == EAGAIN);
+            continue;
+        }
+        len += val;
+    }
+    buf[len] = '\0';
+    close(fd);
+
+    assert(!strncmp(buf, "HTTP/1.1 200 ", 13));
+    assert(strstr(buf, "\r\n\r\nhello") != NULL);
+}
+
+static int FileFill(httpd_file_sys_t *sys, httpd_file_t *file,
+                    uint8_t *request, uint8_t **data, int *len)
+{
+    (void) sys; (void) file; (void) request;
+    *data = (uint8_t *)strdup("hello");
+    *len = 5;
+    return VLC_SUCCESS;
+}
+
+int main(void)
+{
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+
+    unsigned port;
+    httpd_host_t *host = CreateHost(obj, &port);
+    if (host == NULL) {
+        fprintf(stderr, "cannot create the HTTP host\n");
+        libvlc_release(vlc);
+        return 77;
+    }
+
+    httpd_file_t *file = httpd_FileNew(host, "/file", "text/plain",
+                                       NULL, NULL, FileFill, NULL);
+    assert(file != NULL);
+    test_file(port);
+    httpd_FileDelete(file);
+
+    ServeStream(host, port, 64, 16, VLC_TICK_FROM_SEC(1));
+
+    httpd_HostDelete(host);
+    libvlc_release(vlc);
+    return 0;
+}
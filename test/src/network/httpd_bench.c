@@ -0,0 +1,103 @@
+/*****************************************************************************
+ * httpd_bench.c: HTTP server load benchmark
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <time.h>
+#include <sys/resource.h>
+
+#include <vlc_common.h>
+#include <vlc_httpd.h>
+
+#include "httpd_stream.h"
+
+/* Serves a stream to many clients alongside many idle connections, and
+ * prints the number of clients one core of the HTTP server thread can
+ * serve. See httpd.c for the test. */
+
+#define CLIENTS 2000
+#define IDLE_CLIENTS 2000
+#define DURATION VLC_TICK_FROM_SEC(10)
+
+static double thread_cpu(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double process_cpu(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(void)
+{
+    test_init();
+    alarm(0);
+
+    struct rlimit lim;
+    if (getrlimit(RLIMIT_NOFILE, &lim) == 0) {
+        lim.rlim_cur = lim.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &lim);
+        if (lim.rlim_cur < 2 * (CLIENTS + IDLE_CLIENTS) + 64) {
+            fprintf(stderr, "too few file descriptors\n");
+            return 77;
+        }
+    }
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+
+    unsigned port;
+    httpd_host_t *host = CreateHost(obj, &port);
+    if (host == NULL) {
+        fprintf(stderr, "cannot create the HTTP host\n");
+        libvlc_release(vlc);
+        return 77;
+    }
+
+    const vlc_tick_t start = vlc_tick_now();
+    const double start_process = process_cpu();
+    const double start_thread = thread_cpu();
+
+    size_t total = ServeStream(host, port, CLIENTS, IDLE_CLIENTS, DURATION);
+
+    const vlc_tick_t wall = vlc_tick_now() - start;
+    /* The clients and the stream source run on this thread, the rest is the
+     * HTTP server thread. */
+    const double server_cpu = (process_cpu() - start_process)
+                            - (thread_cpu() - start_thread);
+
+    printf("%u clients (%u idle), %.1f MB/s: server at %.1f%% of a core, "
+           "%.0f clients/core\n", CLIENTS, IDLE_CLIENTS,
+           total / secf_from_vlc_tick(wall) / 1e6,
+           100. * server_cpu / secf_from_vlc_tick(wall),
+           CLIENTS * secf_from_vlc_tick(wall) / __MAX(server_cpu, 1e-6));
+
+    httpd_HostDelete(host);
+    libvlc_release(vlc);
+    return 0;
+}
@@ -0,0 +1,214 @@
+/*****************************************************************************
+ * httpd_stream.c: HTTP server stream clients
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_httpd.h>
+#include <vlc_variables.h>
+
+#include "httpd_stream.h"
+
+#define BLOCK_SIZE 1316
+#define BLOCK_INTERVAL VLC_TICK_FROM_MS(10)
+#define STREAM_BUFFER (16 * BLOCK_SIZE)
+#define PORT_BASE 28000
+
+struct client
+{
+    int fd;
+    bool in_body;
+    char header[512];
+    size_t header_len;
+    unsigned block_pos;
+    uint32_t counter;
+    size_t bytes;
+};
+
+static void FillBlock(uint8_t *p, uint32_t counter)
+{
+    SetDWBE(p, counter);
+    for (unsigned i = 4; i < BLOCK_SIZE; i++)
+        p[i] = counter + i;
+}
+
+int Connect(unsigned port, const char *request)
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    assert(fd != -1);
+    assert(connect(fd, (struct sockaddr *)&addr, sizeof (addr)) == 0);
+    assert(write(fd, request, strlen(request)) == (ssize_t)strlen(request));
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+/* Checks the stream data of a client, block by block */
+static void Receive(struct client *cl, const uint8_t *p, size_t len)
+{
+    if (!cl->in_body) {
+        while (len > 0 && !cl->in_body) {
+            assert(cl->header_len < sizeof (cl->header) - 1);
+            cl->header[cl->header_len++] = *(p++);
+            len--;
+            cl->header[cl->header_len] = '\0';
+            cl->in_body = strstr(cl->header, "\r\n\r\n") != NULL;
+        }
+        if (!cl->in_body)
+            return;
+        assert(!strncmp(cl->header, "HTTP/1.0 200 ", 13));
+    }
+
+    cl->bytes += len;
+    for (size_t i = 0; i < len; i++) {
+        if (cl->block_pos < 4)
+            cl->counter = (cl->counter << 8) | p[i];
+        else if (p[i] != (uint8_t)(cl->counter + cl->block_pos)) {
+            fprintf(stderr, "client %d: bad byte %u of block %"PRIu32"\n",
+                    cl->fd, cl->block_pos, cl->counter);
+            abort();
+        }
+        if (++cl->block_pos == BLOCK_SIZE)
+            cl->block_pos = 0;
+    }
+}
+
+httpd_host_t *CreateHost(vlc_object_t *obj, unsigned *port)
+{
+    var_Create(obj, "http-host", VLC_VAR_STRING);
+    var_SetString(obj, "http-host", "127.0.0.1");
+    var_Create(obj, "http-port", VLC_VAR_INTEGER);
+    var_Create(obj, "http-stream-buffer", VLC_VAR_INTEGER);
+    var_SetInteger(obj, "http-stream-buffer", STREAM_BUFFER);
+
+    for (unsigned p = PORT_BASE; p < PORT_BASE + 100; p++) {
+        var_SetInteger(obj, "http-port", p);
+
+        httpd_host_t *host = vlc_http_HostNew(obj);
+        if (host != NULL) {
+            *port = p;
+            return host;
+        }
+    }
+    return NULL;
+}
+
+size_t ServeStream(httpd_host_t *host, unsigned port, unsigned count,
+                   unsigned idle_count, vlc_tick_t duration)
+{
+    httpd_stream_t *stream = httpd_StreamNew(host, "/stream",
+                                             "application/octet-stream",
+                                             NULL, NULL);
+    assert(stream != NULL);
+
+    struct client *clients = calloc(count, sizeof (*clients));
+    struct pollfd *ufd = calloc(count, sizeof (*ufd));
+    assert(clients != NULL && ufd != NULL);
+
+    for (unsigned i = 0; i < count; i++) {
+        clients[i].fd = Connect(port, "GET /stream HTTP/1.1\r\n"
+                                      "Host: localhost\r\n\r\n");
+        ufd[i].fd = clients[i].fd;
+        ufd[i].events = POLLIN;
+    }
+    /* The first client lags behind */
+    setsockopt(clients[0].fd, SOL_SOCKET, SO_RCVBUF, &(int){ 4096 },
+               sizeof (int));
+    ufd[0].events = 0;
+
+    /* Connections with an incomplete request */
+    int *idle = calloc(idle_count, sizeof (*idle));
+    assert(idle_count == 0 || idle != NULL);
+    for (unsigned i = 0; i < idle_count; i++)
+        idle[i] = Connect(port, "GET /stream HTTP/1.1\r\n");
+
+    uint8_t *buf = malloc(BLOCK_SIZE * 64);
+    assert(buf != NULL);
+
+    const vlc_tick_t start = vlc_tick_now();
+    vlc_tick_t deadline = start;
+    uint32_t counter = 0;
+
+    /* Send a block every BLOCK_INTERVAL, read the clients in between */
+    while (deadline < start + duration) {
+        block_t *block = block_Alloc(BLOCK_SIZE);
+        assert(block != NULL);
+        FillBlock(block->p_buffer, counter++);
+        httpd_StreamSend(stream, block);
+        block_Release(block);
+        deadline += BLOCK_INTERVAL;
+        if (deadline >= start + duration / 2)
+            ufd[0].events = POLLIN;
+
+        for (;;) {
+            vlc_tick_t now = vlc_tick_now();
+            if (now >= deadline)
+                break;
+
+            int n = poll(ufd, count, MS_FROM_VLC_TICK(deadline - now) + 1);
+            for (unsigned i = 0; i < count && n > 0; i++) {
+                if (ufd[i].revents == 0)
+                    continue;
+                n--;
+
+                ssize_t val = read(ufd[i].fd, buf, BLOCK_SIZE * 64);
+                assert(val != 0);
+                if (val > 0)
+                    Receive(&clients[i], buf, val);
+            }
+        }
+    }
+
+    size_t total = 0;
+    for (unsigned i = 0; i < count; i++) {
+        assert(clients[i].in_body);
+        assert(clients[i].bytes > 0);
+        total += clients[i].bytes;
+        close(clients[i].fd);
+    }
+    for (unsigned i = 0; i < idle_count; i++)
+        close(idle[i]);
+    free(idle);
+
+    free(buf);
+    free(ufd);
+    free(clients);
+    httpd_StreamDelete(stream);
+    return total;
+}
@@ -0,0 +1,41 @@
+/*****************************************************************************
+ * httpd_stream.h: HTTP server stream clients
+ *****************************************************************************
+ * Copyright (C) 2021 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_TEST_HTTPD_STREAM_H
+#define VLC_TEST_HTTPD_STREAM_H
+
+#include <vlc_common.h>
+#include <vlc_httpd.h>
+
+/* Opens a connection to the local server and sends the request */
+int Connect(unsigned port, const char *request);
+
+/* Creates a host on the first free local port, returns NULL if none */
+httpd_host_t *CreateHost(vlc_object_t *obj, unsigned *port);
+
+/* Serves a stream to count clients for duration, alongside idle_count
+ * connections with an incomplete request, and checks that every client
+ * receives whole and consistent blocks, including a client that only starts
+ * reading halfway and falls behind the stream buffer. The clients run on the
+ * calling thread. Returns the number of bytes received by all clients. */
+size_t ServeStream(httpd_host_t *host, unsigned port, unsigned count,
+                   unsigned idle_count, vlc_tick_t duration);
+
+#endif